@@ -1,7 +1,20 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <queue>
 #include <paper/blockstore.hpp>
+#include <paper/node/common.hpp>
 #include <paper/versioning.hpp>
 
+#include <blake2/blake2.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace
 {
 /**
@@ -24,7 +37,7 @@ public:
 		assert (value.mv_size != 0);
 		std::vector<uint8_t> data (static_cast<uint8_t *> (value.mv_data), static_cast<uint8_t *> (value.mv_data) + value.mv_size);
 		std::copy (hash.bytes.begin (), hash.bytes.end (), data.end () - hash.bytes.size ());
-		store.block_put_raw (transaction, store.block_database (type), block_a.previous (), paper::mdb_val (data.size (), data.data ()));
+		store.block_put_raw (transaction, block_a.previous (), paper::mdb_val (data.size (), data.data ()));
 	}
 	void send_block (paper::send_block const & block_a) override
 	{
@@ -45,6 +58,122 @@ public:
 	MDB_txn * transaction;
 	paper::block_store & store;
 };
+
+/**
+ * Copy a block so cached blocks aren't shared with callers of block_get
+ */
+class block_copy : public paper::block_visitor
+{
+public:
+	virtual ~block_copy () = default;
+	void send_block (paper::send_block const & block_a) override
+	{
+		result.reset (new paper::send_block (block_a));
+	}
+	void receive_block (paper::receive_block const & block_a) override
+	{
+		result.reset (new paper::receive_block (block_a));
+	}
+	void open_block (paper::open_block const & block_a) override
+	{
+		result.reset (new paper::open_block (block_a));
+	}
+	void change_block (paper::change_block const & block_a) override
+	{
+		result.reset (new paper::change_block (block_a));
+	}
+	std::unique_ptr<paper::block> result;
+};
+
+template <typename T>
+T block_view_field (uint8_t const * data_a, size_t offset_a)
+{
+	T result;
+	std::copy (data_a + offset_a, data_a + offset_a + sizeof (result.bytes), result.bytes.begin ());
+	return result;
+}
+
+// Fields are laid out as serialize_block writes them, the type followed by the hashables in hash order
+size_t constexpr block_view_fields = sizeof (paper::block_type);
+
+void unchecked_write (MDB_txn * transaction_a, MDB_dbi unchecked_a, paper::unchecked_entry const & entry_a)
+{
+	std::vector<uint8_t> vector;
+	{
+		paper::vectorstream stream (vector);
+		entry_a.info.serialize (stream);
+	}
+	auto status (mdb_put (transaction_a, unchecked_a, entry_a.key.val (), paper::mdb_val (vector.size (), vector.data ()), 0));
+	assert (status == 0);
+}
+
+/**
+ * Ledger export file layout
+ * Header: magic, format version, store version
+ * Chunks: table, entry count, payload size, payload of (key size, key, value size, value) entries, blake2b of all the preceding chunk bytes
+ * A chunk with table 0 and no entries ends the file, its digest covers the digests of every chunk before it
+ */
+std::array<uint8_t, 4> constexpr ledger_export_magic = { { 'P', 'L', 'E', 'X' } };
+uint8_t constexpr ledger_export_format = 1;
+size_t constexpr ledger_export_chunk_entries = 4096;
+size_t constexpr ledger_export_chunk_header_size = sizeof (uint8_t) + sizeof (uint32_t) + sizeof (uint32_t);
+size_t constexpr ledger_import_transaction_chunks = 64;
+
+void ledger_export_chunk (std::ostream & stream_a, blake2b_state & file_hash_a, uint8_t table_a, uint32_t count_a, std::vector<uint8_t> const & payload_a)
+{
+	std::vector<uint8_t> header;
+	{
+		paper::vectorstream stream (header);
+		paper::write (stream, table_a);
+		paper::write (stream, count_a);
+		paper::write (stream, static_cast<uint32_t> (payload_a.size ()));
+	}
+	paper::uint256_union digest;
+	if (table_a != 0)
+	{
+		blake2b_state hash;
+		blake2b_init (&hash, sizeof (digest.bytes));
+		blake2b_update (&hash, header.data (), header.size ());
+		blake2b_update (&hash, payload_a.data (), payload_a.size ());
+		blake2b_final (&hash, digest.bytes.data (), sizeof (digest.bytes));
+		blake2b_update (&file_hash_a, digest.bytes.data (), sizeof (digest.bytes));
+	}
+	else
+	{
+		blake2b_final (&file_hash_a, digest.bytes.data (), sizeof (digest.bytes));
+	}
+	stream_a.write (reinterpret_cast<char const *> (header.data ()), header.size ());
+	stream_a.write (reinterpret_cast<char const *> (payload_a.data ()), payload_a.size ());
+	stream_a.write (reinterpret_cast<char const *> (digest.bytes.data ()), digest.bytes.size ());
+}
+
+// Reads one size prefixed key or value from a chunk payload, returns true if it runs past the end
+bool ledger_import_field (uint8_t * payload_a, size_t size_a, size_t & position_a, paper::mdb_val & field_a)
+{
+	uint32_t field_size;
+	auto result (size_a - position_a < sizeof (field_size));
+	if (!result)
+	{
+		std::memcpy (&field_size, payload_a + position_a, sizeof (field_size));
+		position_a += sizeof (field_size);
+		result = size_a - position_a < field_size;
+		if (!result)
+		{
+			field_a = paper::mdb_val (field_size, payload_a + position_a);
+			position_a += field_size;
+		}
+	}
+	return result;
+}
+
+void ledger_export_entry (std::vector<uint8_t> & payload_a, paper::mdb_val const & key_a, paper::mdb_val const & value_a)
+{
+	paper::vectorstream stream (payload_a);
+	paper::write (stream, static_cast<uint32_t> (key_a.size ()));
+	stream.sputn (reinterpret_cast<uint8_t const *> (key_a.data ()), key_a.size ());
+	paper::write (stream, static_cast<uint32_t> (value_a.size ()));
+	stream.sputn (reinterpret_cast<uint8_t const *> (value_a.data ()), value_a.size ());
+}
 }
 
 paper::store_entry::store_entry () :
@@ -174,6 +303,24 @@ bool paper::store_iterator::operator!= (paper::store_iterator const & other_a) c
 	return !(*this == other_a);
 }
 
+paper::store_iterator paper::block_store::block_begin (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+{
+	paper::store_iterator result (transaction_a, blocks, paper::mdb_val (hash_a));
+	return result;
+}
+
+paper::store_iterator paper::block_store::block_begin (MDB_txn * transaction_a)
+{
+	paper::store_iterator result (transaction_a, blocks);
+	return result;
+}
+
+paper::store_iterator paper::block_store::block_end ()
+{
+	paper::store_iterator result (nullptr);
+	return result;
+}
+
 paper::store_iterator paper::block_store::block_info_begin (MDB_txn * transaction_a, paper::block_hash const & hash_a)
 {
 	paper::store_iterator result (transaction_a, blocks_info, paper::mdb_val (hash_a));
@@ -204,6 +351,120 @@ paper::store_iterator paper::block_store::representation_end ()
 	return result;
 }
 
+std::vector<std::pair<paper::account, paper::uint128_t>> paper::block_store::representation_weights (MDB_txn * transaction_a)
+{
+	std::vector<std::pair<paper::account, paper::uint128_t>> result;
+	std::vector<paper::account> stale;
+	auto transaction_id (mdb_txn_id (transaction_a));
+	auto loaded (false);
+	{
+		std::lock_guard<std::mutex> lock (representation_mutex);
+		if (transaction_id >= representation_loaded)
+		{
+			loaded = true;
+			result.reserve (representation_cache.size ());
+			for (auto & i : representation_cache)
+			{
+				paper::uint128_t weight;
+				if (!representation_cached (transaction_id, i.first, weight))
+				{
+					result.push_back (std::make_pair (i.first, weight));
+				}
+				else
+				{
+					stale.push_back (i.first);
+				}
+			}
+		}
+	}
+	if (loaded)
+	{
+		for (auto & i : stale)
+		{
+			paper::uint128_t weight;
+			if (!representation_read (transaction_a, i, weight))
+			{
+				result.push_back (std::make_pair (i, weight));
+			}
+		}
+		std::sort (result.begin (), result.end (), [](std::pair<paper::account, paper::uint128_t> const & lhs, std::pair<paper::account, paper::uint128_t> const & rhs) {
+			return lhs.first < rhs.first;
+		});
+	}
+	else
+	{
+		for (auto i (representation_begin (transaction_a)), n (representation_end ()); i != n; ++i)
+		{
+			paper::uint128_union rep;
+			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+			auto error (paper::read (stream, rep));
+			assert (!error);
+			result.push_back (std::make_pair (paper::account (i->first.uint256 ()), rep.number ()));
+		}
+	}
+	return result;
+}
+
+void paper::block_store::representation_load (MDB_txn * transaction_a)
+{
+	auto transaction_id (mdb_txn_id (transaction_a));
+	std::lock_guard<std::mutex> lock (representation_mutex);
+	representation_cache.clear ();
+	representation_loaded = transaction_id;
+	for (auto i (representation_begin (transaction_a)), n (representation_end ()); i != n; ++i)
+	{
+		paper::uint128_union rep;
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto error (paper::read (stream, rep));
+		assert (!error);
+		representation_cache[i->first.uint256 ()] = paper::representation_entry{ rep.number (), transaction_id, 0, 0 };
+	}
+}
+
+bool paper::block_store::representation_cached (uint64_t transaction_id_a, paper::account const & account_a, paper::uint128_t & weight_a)
+{
+	auto result (transaction_id_a < representation_loaded);
+	if (!result)
+	{
+		auto existing (representation_cache.find (account_a));
+		if (existing == representation_cache.end ())
+		{
+			weight_a = 0;
+		}
+		else if (existing->second.pending_txn != 0 && transaction_id_a >= existing->second.pending_txn)
+		{
+			// Either the writing transaction itself or one started after it committed
+			weight_a = existing->second.pending;
+		}
+		else if (transaction_id_a >= existing->second.valid_from)
+		{
+			weight_a = existing->second.value;
+		}
+		else
+		{
+			result = true;
+		}
+	}
+	return result;
+}
+
+bool paper::block_store::representation_read (MDB_txn * transaction_a, paper::account const & account_a, paper::uint128_t & weight_a)
+{
+	MDB_val value;
+	auto status (mdb_get (transaction_a, representation, paper::mdb_val (account_a), &value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	auto result (status != 0);
+	if (!result)
+	{
+		paper::uint128_union rep;
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.mv_data), value.mv_size);
+		auto error (paper::read (stream, rep));
+		assert (!error);
+		weight_a = rep.number ();
+	}
+	return result;
+}
+
 paper::store_iterator paper::block_store::unchecked_begin (MDB_txn * transaction_a)
 {
 	paper::store_iterator result (transaction_a, unchecked);
@@ -212,7 +473,8 @@ paper::store_iterator paper::block_store::unchecked_begin (MDB_txn * transaction
 
 paper::store_iterator paper::block_store::unchecked_begin (MDB_txn * transaction_a, paper::block_hash const & hash_a)
 {
-	paper::store_iterator result (transaction_a, unchecked, paper::mdb_val (hash_a));
+	paper::unchecked_key key (hash_a, 0);
+	paper::store_iterator result (transaction_a, unchecked, key.val ());
 	return result;
 }
 
@@ -222,40 +484,368 @@ paper::store_iterator paper::block_store::unchecked_end ()
 	return result;
 }
 
-paper::store_iterator paper::block_store::vote_begin (MDB_txn * transaction_a)
+namespace
+{
+void vote_log_record (std::vector<uint8_t> & buffer_a, paper::vote & vote_a)
 {
-	return paper::store_iterator (transaction_a, vote);
+	std::vector<uint8_t> vote_l;
+	{
+		paper::vectorstream stream (vote_l);
+		vote_a.serialize (stream);
+	}
+	paper::vectorstream stream (buffer_a);
+	paper::write (stream, static_cast<uint32_t> (vote_l.size ()));
+	stream.sputn (vote_l.data (), vote_l.size ());
 }
 
-paper::store_iterator paper::block_store::vote_end ()
+// Returns true on error
+bool vote_log_sync (FILE * file_a)
 {
-	return paper::store_iterator (nullptr);
+#ifdef _WIN32
+	auto result (_commit (_fileno (file_a)) != 0);
+#else
+	auto result (fsync (fileno (file_a)) != 0);
+#endif
+	return result;
+}
+
+// Makes a rename within directory_a durable, returns true on error
+bool vote_log_sync_directory (boost::filesystem::path const & directory_a)
+{
+	auto result (false);
+#ifndef _WIN32
+	auto descriptor (open (directory_a.empty () ? "." : directory_a.string ().c_str (), O_RDONLY));
+	result = descriptor < 0;
+	if (!result)
+	{
+		result = fsync (descriptor) != 0;
+		close (descriptor);
+	}
+#endif
+	return result;
+}
+}
+
+paper::vote_log::vote_log (boost::filesystem::path const & path_a) :
+path (path_a),
+records (0),
+damaged (false)
+{
+}
+
+void paper::vote_log::load (std::unordered_map<paper::account, std::shared_ptr<paper::vote>> & votes_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	std::ifstream file (path.string (), std::ios::binary);
+	std::vector<uint8_t> data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+	if (!data.empty ())
+	{
+		paper::bufferstream stream (data.data (), data.size ());
+		size_t consumed (0);
+		uint32_t length;
+		auto done (false);
+		while (!done && !paper::read (stream, length))
+		{
+			// A length running past the end of the file can only come from a damaged record, stop before allocating for it
+			done = length == 0 || length > data.size () - consumed - sizeof (length);
+			if (!done)
+			{
+				std::vector<uint8_t> record (length);
+				// The length was checked against what's left of the file so the whole record is in the buffer
+				stream.sgetn (record.data (), record.size ());
+				++records;
+				consumed += sizeof (length) + length;
+				auto error (false);
+				paper::bufferstream record_stream (record.data (), record.size ());
+				auto vote (std::make_shared<paper::vote> (error, record_stream));
+				if (!error)
+				{
+					auto & existing (votes_a[vote->account]);
+					if (existing == nullptr || existing->sequence < vote->sequence)
+					{
+						existing = vote;
+					}
+				}
+			}
+		}
+		damaged = consumed != data.size ();
+	}
+}
+
+bool paper::vote_log::rewrite (std::unordered_map<paper::account, std::shared_ptr<paper::vote>> const & votes_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	std::vector<uint8_t> buffer;
+	for (auto & i : votes_a)
+	{
+		vote_log_record (buffer, *i.second);
+	}
+	// Written aside then renamed over the log so a crash part way leaves the previous log intact
+	auto temp (path);
+	temp += ".tmp";
+	auto file (fopen (temp.string ().c_str (), "wb"));
+	auto result (file == nullptr);
+	if (!result)
+	{
+		result = fwrite (buffer.data (), 1, buffer.size (), file) != buffer.size ();
+		result = result || fflush (file) != 0;
+		result = result || vote_log_sync (file);
+		result = fclose (file) != 0 || result;
+	}
+	if (!result)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::rename (temp, path, ec);
+		result = !!ec;
+	}
+	if (!result)
+	{
+		result = vote_log_sync_directory (path.parent_path ());
+		records = votes_a.size ();
+		damaged = false;
+	}
+	else
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove (temp, ec);
+	}
+	return result;
+}
+
+bool paper::vote_log::compaction_needed (size_t live_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return damaged || records > 2 * live_a;
+}
+
+void paper::vote_log::append (std::vector<std::shared_ptr<paper::vote>> const & votes_a)
+{
+	if (!votes_a.empty ())
+	{
+		std::vector<uint8_t> buffer;
+		for (auto & i : votes_a)
+		{
+			vote_log_record (buffer, *i);
+		}
+		std::lock_guard<std::mutex> lock (mutex);
+		std::ofstream file (path.string (), std::ios::binary | std::ios::app);
+		file.write (reinterpret_cast<char const *> (buffer.data ()), buffer.size ());
+		records += votes_a.size ();
+	}
+}
+
+paper::unchecked_entry::unchecked_entry (paper::unchecked_key const & key_a, paper::unchecked_info const & info_a) :
+key (key_a),
+info (info_a)
+{
+}
+
+size_t constexpr paper::block_store::unchecked_cache_max_default;
+size_t constexpr paper::block_store::vote_cache_max_default;
+
+paper::block_view::block_view () :
+data (nullptr),
+size (0)
+{
+}
+
+paper::block_view::block_view (MDB_val const & value_a) :
+data (reinterpret_cast<uint8_t const *> (value_a.mv_data)),
+size (value_a.mv_size)
+{
+}
+
+bool paper::block_view::empty () const
+{
+	return size == 0;
+}
+
+paper::block_type paper::block_view::type () const
+{
+	return empty () ? paper::block_type::invalid : static_cast<paper::block_type> (data[0]);
+}
+
+paper::block_hash paper::block_view::hash () const
+{
+	size_t size_l (0);
+	switch (type ())
+	{
+		case paper::block_type::send:
+			size_l = sizeof (paper::block_hash) + sizeof (paper::account) + sizeof (paper::amount);
+			break;
+		case paper::block_type::receive:
+			size_l = sizeof (paper::block_hash) + sizeof (paper::block_hash);
+			break;
+		case paper::block_type::open:
+			size_l = sizeof (paper::block_hash) + sizeof (paper::account) + sizeof (paper::account);
+			break;
+		case paper::block_type::change:
+			size_l = sizeof (paper::block_hash) + sizeof (paper::account);
+			break;
+		default:
+			assert (false);
+			break;
+	}
+	paper::block_hash result;
+	blake2b_state hash_l;
+	auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
+	assert (status == 0);
+	status = blake2b_update (&hash_l, data + block_view_fields, size_l);
+	assert (status == 0);
+	status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
+	assert (status == 0);
+	return result;
+}
+
+paper::block_hash paper::block_view::previous () const
+{
+	paper::block_hash result (0);
+	switch (type ())
+	{
+		case paper::block_type::send:
+		case paper::block_type::receive:
+		case paper::block_type::change:
+			result = block_view_field<paper::block_hash> (data, block_view_fields);
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+paper::block_hash paper::block_view::source () const
+{
+	paper::block_hash result (0);
+	switch (type ())
+	{
+		case paper::block_type::receive:
+			result = block_view_field<paper::block_hash> (data, block_view_fields + sizeof (paper::block_hash));
+			break;
+		case paper::block_type::open:
+			result = block_view_field<paper::block_hash> (data, block_view_fields);
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+paper::block_hash paper::block_view::root () const
+{
+	return type () == paper::block_type::open ? account () : previous ();
+}
+
+paper::account paper::block_view::representative () const
+{
+	paper::account result (0);
+	switch (type ())
+	{
+		case paper::block_type::open:
+		case paper::block_type::change:
+			result = block_view_field<paper::account> (data, block_view_fields + sizeof (paper::block_hash));
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+paper::account paper::block_view::destination () const
+{
+	paper::account result (0);
+	if (type () == paper::block_type::send)
+	{
+		result = block_view_field<paper::account> (data, block_view_fields + sizeof (paper::block_hash));
+	}
+	return result;
+}
+
+paper::amount paper::block_view::balance () const
+{
+	paper::amount result (0);
+	if (type () == paper::block_type::send)
+	{
+		result = block_view_field<paper::amount> (data, block_view_fields + sizeof (paper::block_hash) + sizeof (paper::account));
+	}
+	return result;
+}
+
+paper::account paper::block_view::account () const
+{
+	paper::account result (0);
+	if (type () == paper::block_type::open)
+	{
+		result = block_view_field<paper::account> (data, block_view_fields + sizeof (paper::block_hash) + sizeof (paper::account));
+	}
+	return result;
+}
+
+paper::block_hash paper::block_view::successor () const
+{
+	paper::block_hash result (0);
+	if (!empty ())
+	{
+		assert (size >= block_view_fields + sizeof (result.bytes));
+		result = block_view_field<paper::block_hash> (data, size - sizeof (result.bytes));
+	}
+	return result;
+}
+
+void paper::block_view::serialize (paper::stream & stream_a) const
+{
+	assert (!empty ());
+	auto size_l (size - sizeof (paper::block_hash));
+	auto written (stream_a.sputn (data, size_l));
+	assert (written == size_l);
+}
+
+std::unique_ptr<paper::block> paper::block_view::block () const
+{
+	std::unique_ptr<paper::block> result;
+	if (!empty ())
+	{
+		paper::bufferstream stream (data, size);
+		result = paper::deserialize_block (stream);
+	}
+	return result;
 }
 
-paper::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs) :
+paper::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs, size_t unchecked_cache_max_a, size_t account_cache_max_a, size_t block_cache_max_a, size_t vote_cache_max_a) :
+block_count_txn (0),
+block_cache (block_cache_max_a),
+account_cache (account_cache_max_a),
+pending_cache (account_cache_max_a),
+block_info_cache (block_cache_max_a),
+representation_loaded (0),
+unchecked_cache_max (unchecked_cache_max_a),
+unchecked_hits (0),
+unchecked_evictions (0),
+vote_cache_max (vote_cache_max_a),
+votes (path_a.string () + "-votes"),
 environment (error_a, path_a, lmdb_max_dbs),
 frontiers (0),
 accounts (0),
-send_blocks (0),
-receive_blocks (0),
-open_blocks (0),
-change_blocks (0),
+blocks (0),
 pending (0),
 blocks_info (0),
 representation (0),
 unchecked (0),
 unsynced (0),
-checksum (0)
+checksum (0),
+heights (0),
+block_heights (0)
 {
 	if (!error_a)
 	{
+		environment.before_commit = [this](MDB_txn * transaction_a) {
+			block_count_flush (transaction_a);
+		};
+		// Loaded before upgrading so votes moved out of the vote table are merged with what the log already holds
+		votes.load (vote_cache);
 		paper::transaction transaction (environment, nullptr, true);
 		error_a |= mdb_dbi_open (transaction, "frontiers", MDB_CREATE, &frontiers) != 0;
 		error_a |= mdb_dbi_open (transaction, "accounts", MDB_CREATE, &accounts) != 0;
-		error_a |= mdb_dbi_open (transaction, "send", MDB_CREATE, &send_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "receive", MDB_CREATE, &receive_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "open", MDB_CREATE, &open_blocks) != 0;
-		error_a |= mdb_dbi_open (transaction, "change", MDB_CREATE, &change_blocks) != 0;
+		error_a |= mdb_dbi_open (transaction, "blocks", MDB_CREATE, &blocks) != 0;
 		error_a |= mdb_dbi_open (transaction, "pending", MDB_CREATE, &pending) != 0;
 		error_a |= mdb_dbi_open (transaction, "blocks_info", MDB_CREATE, &blocks_info) != 0;
 		error_a |= mdb_dbi_open (transaction, "representation", MDB_CREATE, &representation) != 0;
@@ -264,12 +854,32 @@ checksum (0)
 		error_a |= mdb_dbi_open (transaction, "checksum", MDB_CREATE, &checksum) != 0;
 		error_a |= mdb_dbi_open (transaction, "vote", MDB_CREATE, &vote) != 0;
 		error_a |= mdb_dbi_open (transaction, "meta", MDB_CREATE, &meta) != 0;
+		error_a |= mdb_dbi_open (transaction, "heights", MDB_CREATE, &heights) != 0;
+		error_a |= mdb_dbi_open (transaction, "block_heights", MDB_CREATE, &block_heights) != 0;
 		if (!error_a)
 		{
+			representation_load (transaction);
 			do_upgrades (transaction);
-			checksum_put (transaction, 0, 0, 0);
+			for (auto & i : vote_cache)
+			{
+				if (representation_get (transaction, i.first) == 0)
+				{
+					vote_cache_unweighted.push_back (i.first);
+				}
+			}
+			// The log can hold more accounts than the cache keeps, the extra ones without weight are dropped as vote_cache_reserve would
+			while (vote_cache.size () > vote_cache_max && !vote_cache_unweighted.empty ())
+			{
+				vote_cache.erase (vote_cache_unweighted.front ());
+				vote_cache_unweighted.pop_front ();
+			}
 		}
 	}
+	if (!error_a && votes.compaction_needed (vote_cache.size ()))
+	{
+		// Compact away records superseded since the log was last rewritten, on failure the log is left as it was and appends continue
+		votes.rewrite (vote_cache);
+	}
 }
 
 void paper::block_store::version_put (MDB_txn * transaction_a, int version_a)
@@ -301,7 +911,13 @@ int paper::block_store::version_get (MDB_txn * transaction_a)
 
 void paper::block_store::do_upgrades (MDB_txn * transaction_a)
 {
-	switch (version_get (transaction_a))
+	auto version (version_get (transaction_a));
+	if (version < 12)
+	{
+		// Earlier upgrades read blocks through block_get so they need to be in the unified table first
+		block_tables_merge (transaction_a);
+	}
+	switch (version)
 	{
 		case 1:
 			upgrade_v1_to_v2 (transaction_a);
@@ -322,6 +938,24 @@ void paper::block_store::do_upgrades (MDB_txn * transaction_a)
 		case 9:
 			upgrade_v9_to_v10 (transaction_a);
 		case 10:
+			upgrade_v10_to_v11 (transaction_a);
+		case 11:
+			upgrade_v11_to_v12 (transaction_a);
+		case 12:
+			upgrade_v12_to_v13 (transaction_a);
+		case 13:
+			upgrade_v13_to_v14 (transaction_a);
+		case 14:
+			upgrade_v14_to_v15 (transaction_a);
+			if (version_get (transaction_a) == 14)
+			{
+				// The vote table is moved again on the next start and later upgrades wait for it, account_history needs the block height index meanwhile
+				block_heights_fill (transaction_a);
+				break;
+			}
+		case 15:
+			upgrade_v15_to_v16 (transaction_a);
+		case 16:
 			break;
 		default:
 			assert (false);
@@ -366,6 +1000,7 @@ void paper::block_store::upgrade_v2_to_v3 (MDB_txn * transaction_a)
 {
 	version_put (transaction_a, 3);
 	mdb_drop (transaction_a, representation, 0);
+	representation_load (transaction_a);
 	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
 	{
 		paper::account account_l (i->first.uint256 ());
@@ -517,9 +1152,140 @@ void paper::block_store::upgrade_v9_to_v10 (MDB_txn * transaction_a)
 	//std::cerr << boost::str (boost::format ("Database upgrade is completed\n"));
 }
 
+void paper::block_store::upgrade_v10_to_v11 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 11);
+	// Entries were keyed by dependency alone, unchecked blocks are transient so they'll be downloaded again
+	mdb_drop (transaction_a, unchecked, 0);
+}
+
+void paper::block_store::upgrade_v11_to_v12 (MDB_txn * transaction_a)
+{
+	// Blocks were moved out of the per type tables by block_tables_merge before any upgrade ran
+	version_put (transaction_a, 12);
+}
+
+void paper::block_store::upgrade_v12_to_v13 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 13);
+	// The checksum was zeroed each time the store was opened, rebuild it from every account head
+	paper::checksum value (0);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		paper::account_info info (i->second);
+		value ^= info.head;
+	}
+	checksum_put (transaction_a, 0, 0, value);
+}
+
+void paper::block_store::upgrade_v13_to_v14 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 14);
+	// Index every account chain by height, walking successors up from the open block
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		paper::account account (i->first.uint256 ());
+		paper::account_info info (i->second);
+		uint64_t height (0);
+		for (auto hash (info.open_block); !hash.is_zero (); hash = block_successor (transaction_a, hash))
+		{
+			height_put (transaction_a, account, ++height, hash);
+		}
+		assert (height == info.block_count);
+	}
+}
+
+void paper::block_store::upgrade_v14_to_v15 (MDB_txn * transaction_a)
+{
+	// Votes are kept in memory and persisted to the vote log, move the table's votes there
+	for (paper::store_iterator i (transaction_a, vote), n (nullptr); i != n; ++i)
+	{
+		auto vote_l (std::make_shared<paper::vote> (i->second));
+		auto & existing (vote_cache[vote_l->account]);
+		if (existing == nullptr || existing->sequence < vote_l->sequence)
+		{
+			existing = vote_l;
+		}
+	}
+	// The table is only dropped once its votes are synced to the log, otherwise the upgrade is retried on the next start
+	if (!votes.rewrite (vote_cache))
+	{
+		auto status (mdb_drop (transaction_a, vote, 0));
+		assert (status == 0);
+		version_put (transaction_a, 15);
+	}
+}
+
+void paper::block_store::upgrade_v15_to_v16 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 16);
+	block_heights_fill (transaction_a);
+}
+
+void paper::block_store::block_heights_fill (MDB_txn * transaction_a)
+{
+	MDB_stat heights_stats;
+	auto status1 (mdb_stat (transaction_a, heights, &heights_stats));
+	assert (status1 == 0);
+	MDB_stat block_heights_stats;
+	auto status2 (mdb_stat (transaction_a, block_heights, &block_heights_stats));
+	assert (status2 == 0);
+	// height_put keeps both tables in step once block_heights exists, so matching counts mean it's complete
+	if (heights_stats.ms_entries != block_heights_stats.ms_entries)
+	{
+		// Index each block's height from the heights table
+		for (paper::store_iterator i (transaction_a, heights), n (nullptr); i != n; ++i)
+		{
+			auto status3 (mdb_put (transaction_a, block_heights, i->second, i->first, 0));
+			assert (status3 == 0);
+		}
+	}
+}
+
+void paper::block_store::block_tables_merge (MDB_txn * transaction_a)
+{
+	auto counts (block_count (transaction_a));
+	std::array<std::pair<char const *, paper::block_type>, 4> tables{ { { "send", paper::block_type::send }, { "receive", paper::block_type::receive }, { "open", paper::block_type::open }, { "change", paper::block_type::change } } };
+	for (auto & i : tables)
+	{
+		MDB_dbi table;
+		if (mdb_dbi_open (transaction_a, i.first, 0, &table) == 0)
+		{
+			for (paper::store_iterator j (transaction_a, table), n (nullptr); j != n; ++j)
+			{
+				// Type byte followed by the block as it was stored in its type's table
+				std::vector<uint8_t> vector (j->second.size () + 1);
+				vector[0] = static_cast<uint8_t> (i.second);
+				std::copy (reinterpret_cast<uint8_t const *> (j->second.data ()), reinterpret_cast<uint8_t const *> (j->second.data ()) + j->second.size (), vector.begin () + 1);
+				auto status (mdb_put (transaction_a, blocks, j->first, paper::mdb_val (vector.size (), vector.data ()), 0));
+				assert (status == 0);
+				counts.add (i.second, 1);
+			}
+			mdb_drop (transaction_a, table, 1);
+		}
+	}
+	block_count_put (transaction_a, counts);
+}
+
 void paper::block_store::clear (MDB_dbi db_a)
 {
 	paper::transaction transaction (environment, nullptr, true);
+	if (db_a == accounts)
+	{
+		account_cache.clear (transaction);
+	}
+	else if (db_a == blocks)
+	{
+		block_cache.clear (transaction);
+	}
+	else if (db_a == pending)
+	{
+		pending_cache.clear (transaction);
+	}
+	else if (db_a == blocks_info)
+	{
+		block_info_cache.clear (transaction);
+	}
 	auto status (mdb_drop (transaction, db_a, 0));
 	assert (status == 0);
 }
@@ -541,33 +1307,10 @@ void paper::block_store::representation_add (MDB_txn * transaction_a, paper::blo
 	representation_put (transaction_a, source_rep, source_previous + amount_a);
 }
 
-MDB_dbi paper::block_store::block_database (paper::block_type type_a)
-{
-	MDB_dbi result;
-	switch (type_a)
-	{
-		case paper::block_type::send:
-			result = send_blocks;
-			break;
-		case paper::block_type::receive:
-			result = receive_blocks;
-			break;
-		case paper::block_type::open:
-			result = open_blocks;
-			break;
-		case paper::block_type::change:
-			result = change_blocks;
-			break;
-		default:
-			assert (false);
-			break;
-	}
-	return result;
-}
-
-void paper::block_store::block_put_raw (MDB_txn * transaction_a, MDB_dbi database_a, paper::block_hash const & hash_a, MDB_val value_a)
+void paper::block_store::block_put_raw (MDB_txn * transaction_a, paper::block_hash const & hash_a, MDB_val value_a)
 {
-	auto status2 (mdb_put (transaction_a, database_a, paper::mdb_val (hash_a), &value_a, 0));
+	block_cache.erase (transaction_a, hash_a);
+	auto status2 (mdb_put (transaction_a, blocks, paper::mdb_val (hash_a), &value_a, 0));
 	assert (status2 == 0);
 }
 
@@ -577,10 +1320,24 @@ void paper::block_store::block_put (MDB_txn * transaction_a, paper::block_hash c
 	std::vector<uint8_t> vector;
 	{
 		paper::vectorstream stream (vector);
-		block_a.serialize (stream);
+		paper::serialize_block (stream, block_a);
 		paper::write (stream, successor_a.bytes);
 	}
-	block_put_raw (transaction_a, block_database (block_a.type ()), hash_a, { vector.size (), vector.data () });
+	auto status (mdb_put (transaction_a, blocks, paper::mdb_val (hash_a), paper::mdb_val (vector.size (), vector.data ()), MDB_NOOVERWRITE));
+	assert (status == 0 || status == MDB_KEYEXIST);
+	if (status == 0)
+	{
+		block_cache.erase (transaction_a, hash_a);
+		block_count_add (transaction_a, block_a.type (), 1);
+	}
+	else
+	{
+		// Rewriting an existing block to change its successor, the failed put pointed its value at the existing entry
+		block_put_raw (transaction_a, hash_a, paper::mdb_val (vector.size (), vector.data ()));
+	}
+	block_copy copy;
+	block_a.visit (copy);
+	block_cache.put (transaction_a, hash_a, std::move (copy.result));
 	set_predecessor predecessor (transaction_a, *this);
 	block_a.visit (predecessor);
 	assert (block_a.previous ().is_zero () || block_successor (transaction_a, block_a.previous ()) == hash_a);
@@ -589,88 +1346,29 @@ void paper::block_store::block_put (MDB_txn * transaction_a, paper::block_hash c
 MDB_val paper::block_store::block_get_raw (MDB_txn * transaction_a, paper::block_hash const & hash_a, paper::block_type & type_a)
 {
 	paper::mdb_val result;
-	auto status (mdb_get (transaction_a, send_blocks, paper::mdb_val (hash_a), result));
+	auto status (mdb_get (transaction_a, blocks, paper::mdb_val (hash_a), result));
 	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status != 0)
-	{
-		auto status (mdb_get (transaction_a, receive_blocks, paper::mdb_val (hash_a), result));
-		assert (status == 0 || status == MDB_NOTFOUND);
-		if (status != 0)
-		{
-			auto status (mdb_get (transaction_a, open_blocks, paper::mdb_val (hash_a), result));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			if (status != 0)
-			{
-				auto status (mdb_get (transaction_a, change_blocks, paper::mdb_val (hash_a), result));
-				assert (status == 0 || status == MDB_NOTFOUND);
-				if (status == 0)
-				{
-					type_a = paper::block_type::change;
-				}
-			}
-			else
-			{
-				type_a = paper::block_type::open;
-			}
-		}
-		else
-		{
-			type_a = paper::block_type::receive;
-		}
-	}
-	else
+	if (status == 0)
 	{
-		type_a = paper::block_type::send;
+		assert (result.size () > 0);
+		type_a = static_cast<paper::block_type> (reinterpret_cast<uint8_t const *> (result.data ())[0]);
 	}
 	return result;
 }
 
-std::unique_ptr<paper::block> paper::block_store::block_random (MDB_txn * transaction_a, MDB_dbi database)
+std::unique_ptr<paper::block> paper::block_store::block_random (MDB_txn * transaction_a)
 {
 	paper::block_hash hash;
 	paper::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
-	paper::store_iterator existing (transaction_a, database, paper::mdb_val (hash));
+	paper::store_iterator existing (transaction_a, blocks, paper::mdb_val (hash));
 	if (existing == paper::store_iterator (nullptr))
 	{
-		existing = paper::store_iterator (transaction_a, database);
+		existing = paper::store_iterator (transaction_a, blocks);
 	}
 	assert (existing != paper::store_iterator (nullptr));
 	return block_get (transaction_a, paper::block_hash (existing->first.uint256 ()));
 }
 
-std::unique_ptr<paper::block> paper::block_store::block_random (MDB_txn * transaction_a)
-{
-	auto count (block_count (transaction_a));
-	auto region (paper::random_pool.GenerateWord32 (0, count.sum () - 1));
-	std::unique_ptr<paper::block> result;
-	if (region < count.send)
-	{
-		result = block_random (transaction_a, send_blocks);
-	}
-	else
-	{
-		region -= count.send;
-		if (region < count.receive)
-		{
-			result = block_random (transaction_a, receive_blocks);
-		}
-		else
-		{
-			region -= count.receive;
-			if (region < count.open)
-			{
-				result = block_random (transaction_a, open_blocks);
-			}
-			else
-			{
-				// change
-				result = block_random (transaction_a, change_blocks);
-			}
-		}
-	}
-	return result;
-}
-
 paper::block_hash paper::block_store::block_successor (MDB_txn * transaction_a, paper::block_hash const & hash_a)
 {
 	paper::block_type type;
@@ -697,92 +1395,146 @@ void paper::block_store::block_successor_clear (MDB_txn * transaction_a, paper::
 }
 
 std::unique_ptr<paper::block> paper::block_store::block_get (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+{
+	std::unique_ptr<paper::block> result;
+	std::shared_ptr<paper::block> cached;
+	if (!block_cache.get (transaction_a, hash_a, cached))
+	{
+		block_copy copy;
+		cached->visit (copy);
+		result = std::move (copy.result);
+	}
+	else
+	{
+		paper::block_type type;
+		auto value (block_get_raw (transaction_a, hash_a, type));
+		if (value.mv_size != 0)
+		{
+			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.mv_data), value.mv_size);
+			result = paper::deserialize_block (stream);
+			assert (result != nullptr && result->type () == type);
+			block_copy copy;
+			result->visit (copy);
+			block_cache.put (transaction_a, hash_a, std::move (copy.result));
+		}
+	}
+	return result;
+}
+
+paper::block_view paper::block_store::block_get_view (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+{
+	paper::block_type type;
+	return paper::block_view (block_get_raw (transaction_a, hash_a, type));
+}
+
+void paper::block_store::block_del (MDB_txn * transaction_a, paper::block_hash const & hash_a)
 {
 	paper::block_type type;
 	auto value (block_get_raw (transaction_a, hash_a, type));
-	std::unique_ptr<paper::block> result;
-	if (value.mv_size != 0)
+	assert (value.mv_size != 0);
+	block_cache.erase (transaction_a, hash_a);
+	auto status (mdb_del (transaction_a, blocks, paper::mdb_val (hash_a), nullptr));
+	assert (status == 0);
+	block_count_add (transaction_a, type, -1);
+}
+
+bool paper::block_store::block_exists (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+{
+	std::shared_ptr<paper::block> cached;
+	auto result (!block_cache.get (transaction_a, hash_a, cached));
+	if (!result)
+	{
+		paper::mdb_val junk;
+		auto status (mdb_get (transaction_a, blocks, paper::mdb_val (hash_a), junk));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		result = status == 0;
+	}
+	return result;
+}
+
+paper::block_counts paper::block_store::block_count (MDB_txn * transaction_a)
+{
+	auto result (block_count_read (transaction_a));
+	auto transaction_id (mdb_txn_id (transaction_a));
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	if (transaction_id == block_count_txn)
 	{
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.mv_data), value.mv_size);
-		result = paper::deserialize_block (stream, type);
-		assert (result != nullptr);
+		result.add (block_count_delta);
 	}
 	return result;
 }
 
-void paper::block_store::block_del (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+void paper::block_store::block_count_put (MDB_txn * transaction_a, paper::block_counts const & counts_a)
 {
-	auto status (mdb_del (transaction_a, send_blocks, paper::mdb_val (hash_a), nullptr));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status != 0)
+	auto transaction_id (mdb_txn_id (transaction_a));
 	{
-		auto status (mdb_del (transaction_a, receive_blocks, paper::mdb_val (hash_a), nullptr));
-		assert (status == 0 || status == MDB_NOTFOUND);
-		if (status != 0)
+		std::lock_guard<std::mutex> lock (block_count_mutex);
+		if (transaction_id == block_count_txn)
 		{
-			auto status (mdb_del (transaction_a, open_blocks, paper::mdb_val (hash_a), nullptr));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			if (status != 0)
-			{
-				auto status (mdb_del (transaction_a, change_blocks, paper::mdb_val (hash_a), nullptr));
-				assert (status == 0);
-			}
+			// Replaces the counts including changes already made by this transaction
+			block_count_delta = paper::block_counts ();
 		}
 	}
+	block_count_write (transaction_a, counts_a);
 }
 
-bool paper::block_store::block_exists (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+void paper::block_store::block_count_add (MDB_txn * transaction_a, paper::block_type type_a, int64_t amount_a)
 {
-	auto exists (true);
-	paper::mdb_val junk;
-	auto status (mdb_get (transaction_a, send_blocks, paper::mdb_val (hash_a), junk));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	exists = status == 0;
-	if (!exists)
+	auto transaction_id (mdb_txn_id (transaction_a));
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	if (transaction_id != block_count_txn)
 	{
-		auto status (mdb_get (transaction_a, receive_blocks, paper::mdb_val (hash_a), junk));
-		assert (status == 0 || status == MDB_NOTFOUND);
-		exists = status == 0;
-		if (!exists)
-		{
-			auto status (mdb_get (transaction_a, open_blocks, paper::mdb_val (hash_a), junk));
-			assert (status == 0 || status == MDB_NOTFOUND);
-			exists = status == 0;
-			if (!exists)
-			{
-				auto status (mdb_get (transaction_a, change_blocks, paper::mdb_val (hash_a), junk));
-				assert (status == 0 || status == MDB_NOTFOUND);
-				exists = status == 0;
-			}
-		}
+		block_count_delta = paper::block_counts ();
+		block_count_txn = transaction_id;
 	}
-	return exists;
+	block_count_delta.add (type_a, amount_a);
 }
 
-paper::block_counts paper::block_store::block_count (MDB_txn * transaction_a)
+void paper::block_store::block_count_flush (MDB_txn * transaction_a)
+{
+	auto transaction_id (mdb_txn_id (transaction_a));
+	std::lock_guard<std::mutex> lock (block_count_mutex);
+	if (transaction_id == block_count_txn)
+	{
+		auto counts (block_count_read (transaction_a));
+		counts.add (block_count_delta);
+		block_count_write (transaction_a, counts);
+		block_count_delta = paper::block_counts ();
+		block_count_txn = 0;
+	}
+}
+
+paper::block_counts paper::block_store::block_count_read (MDB_txn * transaction_a)
 {
 	paper::block_counts result;
-	MDB_stat send_stats;
-	auto status1 (mdb_stat (transaction_a, send_blocks, &send_stats));
-	assert (status1 == 0);
-	MDB_stat receive_stats;
-	auto status2 (mdb_stat (transaction_a, receive_blocks, &receive_stats));
-	assert (status2 == 0);
-	MDB_stat open_stats;
-	auto status3 (mdb_stat (transaction_a, open_blocks, &open_stats));
-	assert (status3 == 0);
-	MDB_stat change_stats;
-	auto status4 (mdb_stat (transaction_a, change_blocks, &change_stats));
-	assert (status4 == 0);
-	result.send = send_stats.ms_entries;
-	result.receive = receive_stats.ms_entries;
-	result.open = open_stats.ms_entries;
-	result.change = change_stats.ms_entries;
+	paper::uint256_union count_key (2);
+	paper::mdb_val value;
+	auto status (mdb_get (transaction_a, meta, paper::mdb_val (count_key), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == 0)
+	{
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		auto error (result.deserialize (stream));
+		assert (!error);
+	}
 	return result;
 }
 
+void paper::block_store::block_count_write (MDB_txn * transaction_a, paper::block_counts const & counts_a)
+{
+	paper::uint256_union count_key (2);
+	std::vector<uint8_t> vector;
+	{
+		paper::vectorstream stream (vector);
+		counts_a.serialize (stream);
+	}
+	auto status (mdb_put (transaction_a, meta, paper::mdb_val (count_key), paper::mdb_val (vector.size (), vector.data ()), 0));
+	assert (status == 0);
+}
+
 void paper::block_store::account_del (MDB_txn * transaction_a, paper::account const & account_a)
 {
+	account_cache.erase (transaction_a, account_a);
 	auto status (mdb_del (transaction_a, accounts, paper::mdb_val (account_a), nullptr));
 	assert (status == 0);
 }
@@ -794,24 +1546,80 @@ bool paper::block_store::account_exists (MDB_txn * transaction_a, paper::account
 }
 
 bool paper::block_store::account_get (MDB_txn * transaction_a, paper::account const & account_a, paper::account_info & info_a)
+{
+	auto result (account_cache.get (transaction_a, account_a, info_a));
+	if (result)
+	{
+		paper::mdb_val value;
+		auto status (mdb_get (transaction_a, accounts, paper::mdb_val (account_a), value));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		if (status == 0)
+		{
+			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+			result = info_a.deserialize (stream);
+			assert (!result);
+			account_cache.put (transaction_a, account_a, info_a);
+		}
+	}
+	return result;
+}
+
+void paper::block_store::height_put (MDB_txn * transaction_a, paper::account const & account_a, uint64_t height_a, paper::block_hash const & hash_a)
+{
+	paper::height_key key (account_a, height_a);
+	auto status (mdb_put (transaction_a, heights, key.val (), paper::mdb_val (hash_a), 0));
+	assert (status == 0);
+	auto status2 (mdb_put (transaction_a, block_heights, paper::mdb_val (hash_a), key.val (), 0));
+	assert (status2 == 0);
+}
+
+void paper::block_store::height_del (MDB_txn * transaction_a, paper::account const & account_a, uint64_t height_a)
+{
+	auto hash (height_get (transaction_a, account_a, height_a));
+	auto status (mdb_del (transaction_a, heights, paper::height_key (account_a, height_a).val (), nullptr));
+	assert (status == 0);
+	auto status2 (mdb_del (transaction_a, block_heights, paper::mdb_val (hash), nullptr));
+	assert (status2 == 0);
+}
+
+paper::block_hash paper::block_store::height_get (MDB_txn * transaction_a, paper::account const & account_a, uint64_t height_a)
 {
 	paper::mdb_val value;
-	auto status (mdb_get (transaction_a, accounts, paper::mdb_val (account_a), value));
+	auto status (mdb_get (transaction_a, heights, paper::height_key (account_a, height_a).val (), value));
 	assert (status == 0 || status == MDB_NOTFOUND);
-	bool result;
-	if (status == MDB_NOTFOUND)
+	paper::block_hash result (0);
+	if (status == 0)
 	{
-		result = true;
+		result = value.uint256 ();
 	}
-	else
+	return result;
+}
+
+uint64_t paper::block_store::block_height (MDB_txn * transaction_a, paper::block_hash const & hash_a)
+{
+	paper::mdb_val value;
+	auto status (mdb_get (transaction_a, block_heights, paper::mdb_val (hash_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	uint64_t result (0);
+	if (status == 0)
 	{
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
-		result = info_a.deserialize (stream);
-		assert (!result);
+		result = paper::height_key (value).height ();
 	}
 	return result;
 }
 
+paper::store_iterator paper::block_store::height_begin (MDB_txn * transaction_a, paper::account const & account_a, uint64_t height_a)
+{
+	paper::store_iterator result (transaction_a, heights, paper::height_key (account_a, height_a).val ());
+	return result;
+}
+
+paper::store_iterator paper::block_store::height_end ()
+{
+	paper::store_iterator result (nullptr);
+	return result;
+}
+
 void paper::block_store::frontier_put (MDB_txn * transaction_a, paper::block_hash const & block_a, paper::account const & account_a)
 {
 	auto status (mdb_put (transaction_a, frontiers, paper::mdb_val (block_a), paper::mdb_val (account_a), 0));
@@ -848,18 +1656,23 @@ size_t paper::block_store::frontier_count (MDB_txn * transaction_a)
 
 void paper::block_store::account_put (MDB_txn * transaction_a, paper::account const & account_a, paper::account_info const & info_a)
 {
+	account_cache.erase (transaction_a, account_a);
 	auto status (mdb_put (transaction_a, accounts, paper::mdb_val (account_a), info_a.val (), 0));
 	assert (status == 0);
+	account_cache.put (transaction_a, account_a, info_a);
 }
 
 void paper::block_store::pending_put (MDB_txn * transaction_a, paper::pending_key const & key_a, paper::pending_info const & pending_a)
 {
+	pending_cache.erase (transaction_a, key_a.hash);
 	auto status (mdb_put (transaction_a, pending, key_a.val (), pending_a.val (), 0));
 	assert (status == 0);
+	pending_cache.put (transaction_a, key_a.hash, std::make_pair (key_a.account, pending_a));
 }
 
 void paper::block_store::pending_del (MDB_txn * transaction_a, paper::pending_key const & key_a)
 {
+	pending_cache.erase (transaction_a, key_a.hash);
 	auto status (mdb_del (transaction_a, pending, key_a.val (), nullptr));
 	assert (status == 0);
 }
@@ -872,23 +1685,29 @@ bool paper::block_store::pending_exists (MDB_txn * transaction_a, paper::pending
 
 bool paper::block_store::pending_get (MDB_txn * transaction_a, paper::pending_key const & key_a, paper::pending_info & pending_a)
 {
-	paper::mdb_val value;
-	auto status (mdb_get (transaction_a, pending, key_a.val (), value));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	bool result;
-	if (status == MDB_NOTFOUND)
+	std::pair<paper::account, paper::pending_info> cached;
+	// A receive can name a send to another account, that lookup goes to the table and finds nothing
+	auto result (pending_cache.get (transaction_a, key_a.hash, cached) || cached.first != key_a.account);
+	if (!result)
 	{
-		result = true;
+		pending_a = cached.second;
 	}
 	else
 	{
-		result = false;
-		assert (value.size () == sizeof (pending_a.source.bytes) + sizeof (pending_a.amount.bytes));
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
-		auto error1 (paper::read (stream, pending_a.source));
-		assert (!error1);
-		auto error2 (paper::read (stream, pending_a.amount));
-		assert (!error2);
+		paper::mdb_val value;
+		auto status (mdb_get (transaction_a, pending, key_a.val (), value));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		if (status == 0)
+		{
+			result = false;
+			assert (value.size () == sizeof (pending_a.source.bytes) + sizeof (pending_a.amount.bytes));
+			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+			auto error1 (paper::read (stream, pending_a.source));
+			assert (!error1);
+			auto error2 (paper::read (stream, pending_a.amount));
+			assert (!error2);
+			pending_cache.put (transaction_a, key_a.hash, std::make_pair (key_a.account, pending_a));
+		}
 	}
 	return result;
 }
@@ -913,12 +1732,15 @@ paper::store_iterator paper::block_store::pending_end ()
 
 void paper::block_store::block_info_put (MDB_txn * transaction_a, paper::block_hash const & hash_a, paper::block_info const & block_info_a)
 {
+	block_info_cache.erase (transaction_a, hash_a);
 	auto status (mdb_put (transaction_a, blocks_info, paper::mdb_val (hash_a), block_info_a.val (), 0));
 	assert (status == 0);
+	block_info_cache.put (transaction_a, hash_a, block_info_a);
 }
 
 void paper::block_store::block_info_del (MDB_txn * transaction_a, paper::block_hash const & hash_a)
 {
+	block_info_cache.erase (transaction_a, hash_a);
 	auto status (mdb_del (transaction_a, blocks_info, paper::mdb_val (hash_a), nullptr));
 	assert (status == 0);
 }
@@ -931,44 +1753,39 @@ bool paper::block_store::block_info_exists (MDB_txn * transaction_a, paper::bloc
 
 bool paper::block_store::block_info_get (MDB_txn * transaction_a, paper::block_hash const & hash_a, paper::block_info & block_info_a)
 {
-	paper::mdb_val value;
-	auto status (mdb_get (transaction_a, blocks_info, paper::mdb_val (hash_a), value));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	bool result;
-	if (status == MDB_NOTFOUND)
+	auto result (block_info_cache.get (transaction_a, hash_a, block_info_a));
+	if (result)
 	{
-		result = true;
-	}
-	else
-	{
-		result = false;
-		assert (value.size () == sizeof (block_info_a.account.bytes) + sizeof (block_info_a.balance.bytes));
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
-		auto error1 (paper::read (stream, block_info_a.account));
-		assert (!error1);
-		auto error2 (paper::read (stream, block_info_a.balance));
-		assert (!error2);
+		paper::mdb_val value;
+		auto status (mdb_get (transaction_a, blocks_info, paper::mdb_val (hash_a), value));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		if (status == 0)
+		{
+			result = false;
+			assert (value.size () == sizeof (block_info_a.account.bytes) + sizeof (block_info_a.balance.bytes));
+			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+			auto error1 (paper::read (stream, block_info_a.account));
+			assert (!error1);
+			auto error2 (paper::read (stream, block_info_a.balance));
+			assert (!error2);
+			block_info_cache.put (transaction_a, hash_a, block_info_a);
+		}
 	}
 	return result;
 }
 
 paper::uint128_t paper::block_store::representation_get (MDB_txn * transaction_a, paper::account const & account_a)
 {
-	paper::mdb_val value;
-	auto status (mdb_get (transaction_a, representation, paper::mdb_val (account_a), value));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	paper::uint128_t result;
-	if (status == 0)
+	paper::uint128_t result (0);
+	bool stale;
 	{
-		paper::uint128_union rep;
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
-		auto error (paper::read (stream, rep));
-		assert (!error);
-		result = rep.number ();
+		std::lock_guard<std::mutex> lock (representation_mutex);
+		stale = representation_cached (mdb_txn_id (transaction_a), account_a, result);
 	}
-	else
+	if (stale)
 	{
 		result = 0;
+		representation_read (transaction_a, account_a, result);
 	}
 	return result;
 }
@@ -978,47 +1795,65 @@ void paper::block_store::representation_put (MDB_txn * transaction_a, paper::acc
 	paper::uint128_union rep (representation_a);
 	auto status (mdb_put (transaction_a, representation, paper::mdb_val (account_a), paper::mdb_val (rep), 0));
 	assert (status == 0);
+	auto transaction_id (mdb_txn_id (transaction_a));
+	std::lock_guard<std::mutex> lock (representation_mutex);
+	auto existing (representation_cache.find (account_a));
+	if (existing == representation_cache.end ())
+	{
+		// Older snapshots don't have this account and read LMDB
+		representation_cache[account_a] = paper::representation_entry{ 0, transaction_id, representation_a, transaction_id };
+	}
+	else
+	{
+		auto & entry (existing->second);
+		if (entry.pending_txn != 0 && entry.pending_txn < transaction_id)
+		{
+			// Only one write transaction runs at a time so an earlier writer has committed
+			entry.value = entry.pending;
+			entry.valid_from = entry.pending_txn;
+		}
+		entry.pending = representation_a;
+		entry.pending_txn = transaction_id;
+	}
 }
 
 void paper::block_store::unchecked_clear (MDB_txn * transaction_a)
 {
+	{
+		std::lock_guard<std::mutex> lock (cache_mutex);
+		unchecked_cache.clear ();
+	}
 	auto status (mdb_drop (transaction_a, unchecked, 0));
 	assert (status == 0);
 }
 
 void paper::block_store::unchecked_put (MDB_txn * transaction_a, paper::block_hash const & hash_a, std::shared_ptr<paper::block> const & block_a)
 {
-	// Checking if same unchecked block is already in database
-	bool exists (false);
-	auto block_hash (block_a->hash ());
-	auto cached (unchecked_get (transaction_a, hash_a));
-	for (auto i (cached.begin ()), n (cached.end ()); i != n && !exists; ++i)
+	paper::unchecked_key key (hash_a, block_a->hash ());
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	// Checking if same unchecked block is already in memory or database
+	if (unchecked_cache.find (key) == unchecked_cache.end ())
 	{
-		if ((*i)->hash () == block_hash)
+		paper::mdb_val value;
+		auto status (mdb_get (transaction_a, unchecked, key.val (), value));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		if (status == MDB_NOTFOUND)
 		{
-			exists = true;
+			unchecked_cache.insert (paper::unchecked_entry (key, paper::unchecked_info (block_a, paper::seconds_since_epoch ())));
+			auto & arrival (unchecked_cache.get<1> ());
+			while (unchecked_cache.size () > unchecked_cache_max)
+			{
+				unchecked_write (transaction_a, unchecked, arrival.front ());
+				arrival.pop_front ();
+			}
 		}
 	}
-	// Inserting block if it wasn't found in database
-	if (!exists)
-	{
-		std::lock_guard<std::mutex> lock (cache_mutex);
-		unchecked_cache.insert (std::make_pair (hash_a, block_a));
-	}
 }
 
 std::shared_ptr<paper::vote> paper::block_store::vote_get (MDB_txn * transaction_a, paper::account const & account_a)
 {
-	std::shared_ptr<paper::vote> result;
-	paper::mdb_val value;
-	auto status (mdb_get (transaction_a, vote, paper::mdb_val (account_a), value));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status == 0)
-	{
-		result = std::make_shared<paper::vote> (value);
-		assert (result != nullptr);
-	}
-	return result;
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	return vote_current (transaction_a, account_a);
 }
 
 std::vector<std::shared_ptr<paper::block>> paper::block_store::unchecked_get (MDB_txn * transaction_a, paper::block_hash const & hash_a)
@@ -1026,42 +1861,76 @@ std::vector<std::shared_ptr<paper::block>> paper::block_store::unchecked_get (MD
 	std::vector<std::shared_ptr<paper::block>> result;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		for (auto i (unchecked_cache.find (hash_a)), n (unchecked_cache.end ()); i != n && i->first == hash_a; ++i)
+		for (auto i (unchecked_cache.lower_bound (paper::unchecked_key (hash_a, 0))), n (unchecked_cache.end ()); i != n && i->key.dependency == hash_a; ++i)
 		{
-			result.push_back (i->second);
+			result.push_back (i->info.block);
 		}
 	}
-	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && paper::block_hash (i->first.uint256 ()) == hash_a; i.next_dup ())
+	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && paper::unchecked_key (i->first).dependency == hash_a; ++i)
 	{
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		result.push_back (paper::deserialize_block (stream));
+		paper::unchecked_info info (i->second);
+		result.push_back (info.block);
+	}
+	if (!result.empty ())
+	{
+		++unchecked_hits;
 	}
 	return result;
 }
 
 void paper::block_store::unchecked_del (MDB_txn * transaction_a, paper::block_hash const & hash_a, paper::block const & block_a)
 {
+	paper::unchecked_key key (hash_a, block_a.hash ());
+	{
+		std::lock_guard<std::mutex> lock (cache_mutex);
+		unchecked_cache.erase (key);
+	}
+	auto status (mdb_del (transaction_a, unchecked, key.val (), nullptr));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+size_t paper::block_store::unchecked_evict (MDB_txn * transaction_a, uint64_t cutoff_a, paper::unchecked_key & next_a, size_t max_a)
+{
+	size_t result (0);
+	paper::unchecked_key start (0, 0);
+	if (next_a == start)
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		for (auto i (unchecked_cache.find (hash_a)), n (unchecked_cache.end ()); i != n && i->first == hash_a;)
+		auto & arrival (unchecked_cache.get<1> ());
+		while (!arrival.empty () && arrival.front ().info.modified < cutoff_a)
 		{
-			if (*i->second == block_a)
-			{
-				i = unchecked_cache.erase (i);
-			}
-			else
-			{
-				++i;
-			}
+			arrival.pop_front ();
+			++result;
 		}
 	}
-	std::vector<uint8_t> vector;
+	std::vector<paper::unchecked_key> expired;
+	auto position (next_a);
+	next_a = start;
+	size_t scanned (0);
+	for (auto i (paper::store_iterator (transaction_a, unchecked, position.val ())), n (unchecked_end ()); i != n; ++i, ++scanned)
 	{
-		paper::vectorstream stream (vector);
-		paper::serialize_block (stream, block_a);
+		if (scanned == max_a)
+		{
+			next_a = paper::unchecked_key (i->first);
+			break;
+		}
+		uint64_t modified;
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto error (paper::read (stream, modified));
+		assert (!error);
+		if (modified < cutoff_a)
+		{
+			expired.push_back (paper::unchecked_key (i->first));
+		}
 	}
-	auto status (mdb_del (transaction_a, unchecked, paper::mdb_val (hash_a), paper::mdb_val (vector.size (), vector.data ())));
-	assert (status == 0 || status == MDB_NOTFOUND);
+	for (auto & i : expired)
+	{
+		auto status (mdb_del (transaction_a, unchecked, i.val (), nullptr));
+		assert (status == 0);
+	}
+	result += expired.size ();
+	unchecked_evictions += result;
+	return result;
 }
 
 size_t paper::block_store::unchecked_count (MDB_txn * transaction_a)
@@ -1070,6 +1939,8 @@ size_t paper::block_store::unchecked_count (MDB_txn * transaction_a)
 	auto status (mdb_stat (transaction_a, unchecked, &unchecked_stats));
 	assert (status == 0);
 	auto result (unchecked_stats.ms_entries);
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	result += unchecked_cache.size ();
 	return result;
 }
 
@@ -1146,34 +2017,32 @@ void paper::block_store::checksum_del (MDB_txn * transaction_a, uint64_t prefix,
 
 void paper::block_store::flush (MDB_txn * transaction_a)
 {
-	std::unordered_map<paper::account, std::shared_ptr<paper::vote>> sequence_cache_l;
-	std::unordered_multimap<paper::block_hash, std::shared_ptr<paper::block>> unchecked_cache_l;
+	std::vector<paper::unchecked_entry> unchecked_cache_l;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		sequence_cache_l.swap (vote_cache);
-		unchecked_cache_l.swap (unchecked_cache);
+		unchecked_cache_l.assign (unchecked_cache.begin (), unchecked_cache.end ());
+		unchecked_cache.clear ();
 	}
 	for (auto & i : unchecked_cache_l)
 	{
-		std::vector<uint8_t> vector;
-		{
-			paper::vectorstream stream (vector);
-			paper::serialize_block (stream, *i.second);
-		}
-		auto status (mdb_put (transaction_a, unchecked, paper::mdb_val (i.first), paper::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status == 0);
+		unchecked_write (transaction_a, unchecked, i);
 	}
-	for (auto i (sequence_cache_l.begin ()), n (sequence_cache_l.end ()); i != n; ++i)
+}
+
+void paper::block_store::vote_flush ()
+{
+	std::vector<std::shared_ptr<paper::vote>> votes_l;
 	{
-		std::vector<uint8_t> vector;
+		std::lock_guard<std::mutex> lock (cache_mutex);
+		for (auto & i : vote_dirty)
 		{
-			paper::vectorstream stream (vector);
-			i->second->serialize (stream);
+			votes_l.push_back (vote_cache[i]);
 		}
-		auto status1 (mdb_put (transaction_a, vote, paper::mdb_val (i->first), paper::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status1 == 0);
+		vote_dirty.clear ();
 	}
+	votes.append (votes_l);
 }
+
 std::shared_ptr<paper::vote> paper::block_store::vote_current (MDB_txn * transaction_a, paper::account const & account_a)
 {
 	assert (!cache_mutex.try_lock ());
@@ -1183,10 +2052,6 @@ std::shared_ptr<paper::vote> paper::block_store::vote_current (MDB_txn * transac
 	{
 		result = existing->second;
 	}
-	else
-	{
-		result = vote_get (transaction_a, account_a);
-	}
 	return result;
 }
 
@@ -1197,6 +2062,7 @@ std::shared_ptr<paper::vote> paper::block_store::vote_generate (MDB_txn * transa
 	uint64_t sequence ((result ? result->sequence : 0) + 1);
 	result = std::make_shared<paper::vote> (account_a, key_a, sequence, block_a);
 	vote_cache[account_a] = result;
+	vote_dirty.insert (account_a);
 	return result;
 }
 
@@ -1212,7 +2078,42 @@ std::shared_ptr<paper::vote> paper::block_store::vote_max (MDB_txn * transaction
 			result = current;
 		}
 	}
-	vote_cache[vote_a->account] = result;
+	if (result != current)
+	{
+		if (current != nullptr || vote_cache_reserve (transaction_a, vote_a->account))
+		{
+			vote_cache[vote_a->account] = result;
+			vote_dirty.insert (vote_a->account);
+		}
+		else
+		{
+			// Without a record of its sequence number the vote could be replayed, so it isn't taken as new
+			result = nullptr;
+		}
+	}
+	return result;
+}
+
+bool paper::block_store::vote_cache_reserve (MDB_txn * transaction_a, paper::account const & account_a)
+{
+	assert (!cache_mutex.try_lock ());
+	auto weighted (representation_get (transaction_a, account_a) != 0);
+	// Each queued account is looked at once, ones that gained weight since they were queued stay cached
+	while (weighted && vote_cache.size () >= vote_cache_max && !vote_cache_unweighted.empty ())
+	{
+		auto account_l (vote_cache_unweighted.front ());
+		vote_cache_unweighted.pop_front ();
+		if (representation_get (transaction_a, account_l) == 0)
+		{
+			vote_cache.erase (account_l);
+			vote_dirty.erase (account_l);
+		}
+	}
+	auto result (vote_cache.size () < vote_cache_max);
+	if (result && !weighted)
+	{
+		vote_cache_unweighted.push_back (account_a);
+	}
 	return result;
 }
 
@@ -1224,7 +2125,12 @@ paper::vote_result paper::block_store::vote_validate (MDB_txn * transaction_a, s
 	{
 		result.code = paper::vote_code::replay;
 		result.vote = vote_max (transaction_a, vote_a); // Make sure this sequence number is > any we've seen from this account before
-		if (result.vote == vote_a)
+		if (result.vote == nullptr)
+		{
+			// The full cache couldn't record its sequence number, treat it like a replay
+			result.vote = vote_a;
+		}
+		else if (result.vote == vote_a)
 		{
 			result.code = paper::vote_code::vote;
 		}
@@ -1249,3 +2155,183 @@ paper::store_iterator paper::block_store::latest_end ()
 	paper::store_iterator result (nullptr);
 	return result;
 }
+
+std::vector<std::pair<MDB_dbi, bool>> paper::block_store::ledger_tables ()
+{
+	// Table ids in an export are the position here plus one, tables the constructor already writes to can't be appended to
+	return {
+		{ accounts, true },
+		{ blocks, true },
+		{ pending, true },
+		{ representation, true },
+		{ frontiers, true },
+		{ blocks_info, true },
+		{ heights, true },
+		{ block_heights, true },
+		{ checksum, false },
+		{ meta, false }
+	};
+}
+
+void paper::block_store::ledger_export (MDB_txn * transaction_a, std::ostream & stream_a)
+{
+	// Counts changed by this transaction go in to the meta table before it's exported
+	block_count_flush (transaction_a);
+	std::vector<uint8_t> header;
+	{
+		paper::vectorstream stream (header);
+		paper::write (stream, ledger_export_magic);
+		paper::write (stream, ledger_export_format);
+		paper::write (stream, static_cast<uint32_t> (version_get (transaction_a)));
+	}
+	stream_a.write (reinterpret_cast<char const *> (header.data ()), header.size ());
+	blake2b_state file_hash;
+	blake2b_init (&file_hash, sizeof (paper::uint256_union));
+	auto tables (ledger_tables ());
+	for (size_t table (0); table < tables.size (); ++table)
+	{
+		std::vector<uint8_t> payload;
+		uint32_t count (0);
+		for (paper::store_iterator i (transaction_a, tables[table].first), n (nullptr); i != n; ++i)
+		{
+			ledger_export_entry (payload, i->first, i->second);
+			if (++count == ledger_export_chunk_entries)
+			{
+				ledger_export_chunk (stream_a, file_hash, table + 1, count, payload);
+				payload.clear ();
+				count = 0;
+			}
+		}
+		if (count != 0)
+		{
+			ledger_export_chunk (stream_a, file_hash, table + 1, count, payload);
+		}
+	}
+	ledger_export_chunk (stream_a, file_hash, 0, 0, std::vector<uint8_t> ());
+}
+
+bool paper::block_store::ledger_import (std::istream & stream_a)
+{
+	auto result (false);
+	{
+		paper::transaction transaction (environment, nullptr, false);
+		// Entries are appended so only a store without a ledger can be loaded
+		result = latest_begin (transaction) != latest_end ();
+	}
+	// Chunk sizes come from the file so they're checked against what's left of it before anything is allocated
+	uint64_t remaining (0);
+	if (!result)
+	{
+		auto start (stream_a.tellg ());
+		stream_a.seekg (0, std::ios::end);
+		auto end (stream_a.tellg ());
+		stream_a.seekg (start);
+		result = !stream_a || start == std::istream::pos_type (-1) || end < start;
+		remaining = end - start;
+	}
+	if (!result)
+	{
+		std::unique_ptr<paper::transaction> transaction (new paper::transaction (environment, nullptr, true));
+		std::array<uint8_t, sizeof (ledger_export_magic) + sizeof (uint8_t) + sizeof (uint32_t)> header;
+		result = remaining < header.size () || !stream_a.read (reinterpret_cast<char *> (header.data ()), header.size ());
+		if (!result)
+		{
+			remaining -= header.size ();
+			paper::bufferstream stream (header.data (), header.size ());
+			std::array<uint8_t, 4> magic;
+			uint8_t format;
+			uint32_t version;
+			result = paper::read (stream, magic) || paper::read (stream, format) || paper::read (stream, version);
+			result = result || magic != ledger_export_magic || format != ledger_export_format || version != version_get (*transaction);
+		}
+		blake2b_state file_hash;
+		blake2b_init (&file_hash, sizeof (paper::uint256_union));
+		auto tables (ledger_tables ());
+		auto done (false);
+		size_t chunks (0);
+		std::vector<uint8_t> chunk;
+		while (!result && !done)
+		{
+			chunk.resize (ledger_export_chunk_header_size);
+			paper::uint256_union digest;
+			result = remaining < chunk.size () + digest.bytes.size () || !stream_a.read (reinterpret_cast<char *> (chunk.data ()), chunk.size ());
+			uint8_t table (0);
+			uint32_t count (0);
+			uint32_t size (0);
+			if (!result)
+			{
+				remaining -= chunk.size () + digest.bytes.size ();
+				paper::bufferstream stream (chunk.data (), chunk.size ());
+				result = paper::read (stream, table) || paper::read (stream, count) || paper::read (stream, size) || table > tables.size () || size > remaining;
+			}
+			if (!result)
+			{
+				remaining -= size;
+				chunk.resize (ledger_export_chunk_header_size + size);
+				result = !stream_a.read (reinterpret_cast<char *> (chunk.data () + ledger_export_chunk_header_size), size) || !stream_a.read (reinterpret_cast<char *> (digest.bytes.data ()), digest.bytes.size ());
+			}
+			if (!result)
+			{
+				paper::uint256_union expected;
+				if (table != 0)
+				{
+					blake2b_state hash;
+					blake2b_init (&hash, sizeof (expected.bytes));
+					blake2b_update (&hash, chunk.data (), chunk.size ());
+					blake2b_final (&hash, expected.bytes.data (), sizeof (expected.bytes));
+					blake2b_update (&file_hash, expected.bytes.data (), sizeof (expected.bytes));
+				}
+				else
+				{
+					blake2b_final (&file_hash, expected.bytes.data (), sizeof (expected.bytes));
+					done = true;
+				}
+				result = digest != expected;
+			}
+			if (!result && table != 0)
+			{
+				// Checksum matched so entries go straight in to their tables without block validation
+				auto & destination (tables[table - 1]);
+				auto payload (chunk.data () + ledger_export_chunk_header_size);
+				size_t position (0);
+				for (uint32_t i (0); !result && i < count; ++i)
+				{
+					paper::mdb_val key;
+					paper::mdb_val value;
+					result = ledger_import_field (payload, size, position, key) || ledger_import_field (payload, size, position, value);
+					if (!result)
+					{
+						auto status (mdb_put (*transaction, destination.first, key, value, destination.second ? MDB_APPEND : 0));
+						result = status != 0;
+					}
+				}
+				if (!result && ++chunks % ledger_import_transaction_chunks == 0)
+				{
+					// Keys keep ascending across transactions so appending carries on where the last one stopped
+					transaction.reset ();
+					transaction.reset (new paper::transaction (environment, nullptr, true));
+				}
+			}
+		}
+		if (!result)
+		{
+			// Chunk checksums only cover the file, the imported heads must also add up to the checksum the ledger recorded
+			paper::checksum checksum (0);
+			for (auto i (latest_begin (*transaction)), n (latest_end ()); i != n; ++i)
+			{
+				checksum ^= paper::account_info (i->second).head;
+			}
+			paper::checksum recorded;
+			result = checksum_get (*transaction, 0, 0, recorded) || recorded != checksum;
+		}
+		if (!result)
+		{
+			account_cache.clear (*transaction);
+			block_cache.clear (*transaction);
+			pending_cache.clear (*transaction);
+			block_info_cache.clear (*transaction);
+			representation_load (*transaction);
+		}
+	}
+	return result;
+}
@@ -2,6 +2,15 @@
 
 #include <paper/common.hpp>
 
+#include <deque>
+#include <unordered_set>
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+
 namespace paper
 {
 /**
@@ -40,26 +49,236 @@ public:
 	paper::store_entry current;
 };
 
+/**
+ * An unchecked block held in memory until it's flushed or spilled to the unchecked table
+ */
+class unchecked_entry
+{
+public:
+	unchecked_entry (paper::unchecked_key const &, paper::unchecked_info const &);
+	paper::unchecked_key key;
+	paper::unchecked_info info;
+};
+
+/**
+ * Fields of a blocks table entry read in place from LMDB's memory instead of deserializing a block.
+ * Only valid until the transaction it was read through ends, fields a block type doesn't have read as zero
+ */
+class block_view
+{
+public:
+	block_view ();
+	block_view (MDB_val const &);
+	bool empty () const;
+	paper::block_type type () const;
+	paper::block_hash hash () const;
+	paper::block_hash previous () const;
+	paper::block_hash source () const;
+	paper::block_hash root () const;
+	paper::account representative () const;
+	paper::account destination () const;
+	paper::amount balance () const;
+	paper::account account () const;
+	paper::block_hash successor () const;
+	// Write the block the same as serialize_block
+	void serialize (paper::stream &) const;
+	std::unique_ptr<paper::block> block () const;
+	uint8_t const * data;
+	size_t size;
+};
+
+/**
+ * A value read from a table, servable to transactions at or after valid_from
+ */
+template <typename T>
+class store_cache_entry
+{
+public:
+	paper::uint256_union key;
+	T value;
+	uint64_t valid_from;
+};
+
+/**
+ * Size bounded LRU of values read from a table, split in to shards that lock independently.
+ * Writers erase the keys they change and move their shard's write_txn forward, only transactions whose snapshot
+ * includes every write to a shard fill it so an entry is never older than the snapshot it's served to.
+ * An entry a write transaction fills after changing its shard is only served once that transaction has committed.
+ */
+template <typename T>
+class store_cache
+{
+public:
+	store_cache (size_t max_a) :
+	max (max_a),
+	shard_max ((max_a + shard_count - 1) / shard_count),
+	hits (0),
+	misses (0)
+	{
+	}
+	// Returns true if the key isn't cached for this transaction
+	bool get (MDB_txn * transaction_a, paper::uint256_union const & key_a, T & value_a)
+	{
+		auto & shard (shards[key_a.bytes[0] % shard_count]);
+		auto transaction_id (mdb_txn_id (transaction_a));
+		auto result (true);
+		{
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			auto existing (shard.entries.find (key_a));
+			if (existing != shard.entries.end () && transaction_id >= existing->valid_from)
+			{
+				value_a = existing->value;
+				auto & order (shard.entries.template get<1> ());
+				order.relocate (order.begin (), shard.entries.template project<1> (existing));
+				result = false;
+			}
+		}
+		++(result ? misses : hits);
+		return result;
+	}
+	// Cache a value just read or written through a transaction
+	void put (MDB_txn * transaction_a, paper::uint256_union const & key_a, T const & value_a)
+	{
+		if (shard_max > 0)
+		{
+			auto transaction_id (mdb_txn_id (transaction_a));
+			auto & shard (shards[key_a.bytes[0] % shard_count]);
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			// A write transaction's id is one past the last commit so its own changes are served from when it commits
+			if (transaction_id >= shard.write_txn)
+			{
+				auto & order (shard.entries.template get<1> ());
+				shard.entries.erase (key_a);
+				order.push_front (paper::store_cache_entry<T>{ key_a, value_a, shard.write_txn });
+				while (order.size () > shard_max)
+				{
+					order.pop_back ();
+				}
+			}
+		}
+	}
+	// Drop a key before writing it
+	void erase (MDB_txn * transaction_a, paper::uint256_union const & key_a)
+	{
+		auto & shard (shards[key_a.bytes[0] % shard_count]);
+		auto transaction_id (mdb_txn_id (transaction_a));
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		shard.write_txn = std::max<uint64_t> (shard.write_txn, transaction_id);
+		shard.entries.erase (key_a);
+	}
+	// Drop every key before rewriting the table
+	void clear (MDB_txn * transaction_a)
+	{
+		auto transaction_id (mdb_txn_id (transaction_a));
+		for (auto & shard : shards)
+		{
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			shard.write_txn = std::max<uint64_t> (shard.write_txn, transaction_id);
+			shard.entries.clear ();
+		}
+	}
+	size_t size ()
+	{
+		size_t result (0);
+		for (auto & shard : shards)
+		{
+			std::lock_guard<std::mutex> lock (shard.mutex);
+			result += shard.entries.size ();
+		}
+		return result;
+	}
+	static size_t constexpr shard_count = 16;
+	class shard_entries
+	{
+	public:
+		std::mutex mutex;
+		boost::multi_index_container<
+		paper::store_cache_entry<T>,
+		boost::multi_index::indexed_by<
+		boost::multi_index::hashed_unique<boost::multi_index::member<paper::store_cache_entry<T>, paper::uint256_union, &paper::store_cache_entry<T>::key>>,
+		boost::multi_index::sequenced<>>>
+		entries;
+		// Id of the newest transaction that has written to this shard
+		uint64_t write_txn = 0;
+	};
+	std::array<shard_entries, shard_count> shards;
+	size_t max;
+	size_t shard_max;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+};
+
+/**
+ * Weight of a representative as of transaction valid_from, pending is the weight written by transaction pending_txn which may not have committed
+ */
+class representation_entry
+{
+public:
+	paper::uint128_t value;
+	uint64_t valid_from;
+	paper::uint128_t pending;
+	uint64_t pending_txn;
+};
+
+/**
+ * Append-only file of votes kept beside the LMDB environment, each record is a uint32 length followed by a vote serialized with its block type.
+ * Replaying keeps the highest sequence number per account, a final record cut short by a crash is ignored.
+ * Appends aren't synced to disk, a representative whose sequence number goes backwards learns the higher one from the replays peers send.
+ * Rewrites are synced before and after renaming over the log so a crash never loses votes that were already on disk.
+ */
+class vote_log
+{
+public:
+	vote_log (boost::filesystem::path const &);
+	void load (std::unordered_map<paper::account, std::shared_ptr<paper::vote>> &);
+	// Replaces the file with one record per account, returns true on error leaving the previous file in place
+	bool rewrite (std::unordered_map<paper::account, std::shared_ptr<paper::vote>> const &);
+	void append (std::vector<std::shared_ptr<paper::vote>> const &);
+	// Whether enough records are superseded, or the tail is damaged, that the file should be rewritten
+	bool compaction_needed (size_t);
+	boost::filesystem::path path;
+	std::mutex mutex;
+	// Records in the file, counted while loading and appending
+	size_t records;
+	// The last record loaded was cut short, appending after it would hide the new records
+	bool damaged;
+};
+
 /**
  * Manages block storage and iteration
  */
 class block_store
 {
 public:
-	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128);
+	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128, size_t = unchecked_cache_max_default, size_t = account_cache_max_default, size_t = block_cache_max_default, size_t = vote_cache_max_default);
 
-	MDB_dbi block_database (paper::block_type);
-	void block_put_raw (MDB_txn *, MDB_dbi, paper::block_hash const &, MDB_val);
+	void block_put_raw (MDB_txn *, paper::block_hash const &, MDB_val);
 	void block_put (MDB_txn *, paper::block_hash const &, paper::block const &, paper::block_hash const & = paper::block_hash (0));
 	MDB_val block_get_raw (MDB_txn *, paper::block_hash const &, paper::block_type &);
 	paper::block_hash block_successor (MDB_txn *, paper::block_hash const &);
 	void block_successor_clear (MDB_txn *, paper::block_hash const &);
 	std::unique_ptr<paper::block> block_get (MDB_txn *, paper::block_hash const &);
+	paper::block_view block_get_view (MDB_txn *, paper::block_hash const &);
 	std::unique_ptr<paper::block> block_random (MDB_txn *);
-	std::unique_ptr<paper::block> block_random (MDB_txn *, MDB_dbi);
 	void block_del (MDB_txn *, paper::block_hash const &);
 	bool block_exists (MDB_txn *, paper::block_hash const &);
 	paper::block_counts block_count (MDB_txn *);
+	void block_count_put (MDB_txn *, paper::block_counts const &);
+	void block_count_add (MDB_txn *, paper::block_type, int64_t);
+	// Writes the counts changed by block_put and block_del, called before each write transaction commits
+	void block_count_flush (MDB_txn *);
+	paper::block_counts block_count_read (MDB_txn *);
+	void block_count_write (MDB_txn *, paper::block_counts const &);
+	// Changes made by write transaction block_count_txn that aren't in the meta table yet
+	paper::block_counts block_count_delta;
+	uint64_t block_count_txn;
+	std::mutex block_count_mutex;
+	paper::store_iterator block_begin (MDB_txn *, paper::block_hash const &);
+	paper::store_iterator block_begin (MDB_txn *);
+	paper::store_iterator block_end ();
+	// Recently read or written blocks, a block_get hit returns a copy
+	paper::store_cache<std::shared_ptr<paper::block>> block_cache;
+	static size_t constexpr block_cache_max_default = 64 * 1024;
 
 	void frontier_put (MDB_txn *, paper::block_hash const &, paper::account const &);
 	paper::account frontier_get (MDB_txn *, paper::block_hash const &);
@@ -74,6 +293,18 @@ public:
 	paper::store_iterator latest_begin (MDB_txn *);
 	paper::store_iterator latest_end ();
 
+	void height_put (MDB_txn *, paper::account const &, uint64_t, paper::block_hash const &);
+	void height_del (MDB_txn *, paper::account const &, uint64_t);
+	// Block at a height of an account's chain, zero if the chain isn't that long
+	paper::block_hash height_get (MDB_txn *, paper::account const &, uint64_t);
+	// Height of a block in its account's chain, zero if the block isn't in the ledger
+	uint64_t block_height (MDB_txn *, paper::block_hash const &);
+	paper::store_iterator height_begin (MDB_txn *, paper::account const &, uint64_t);
+	paper::store_iterator height_end ();
+	// Recently read or written account_info, the head of busy accounts is read for every block they process
+	paper::store_cache<paper::account_info> account_cache;
+	static size_t constexpr account_cache_max_default = 64 * 1024;
+
 	void pending_put (MDB_txn *, paper::pending_key const &, paper::pending_info const &);
 	void pending_del (MDB_txn *, paper::pending_key const &);
 	bool pending_get (MDB_txn *, paper::pending_key const &, paper::pending_info &);
@@ -81,6 +312,8 @@ public:
 	paper::store_iterator pending_begin (MDB_txn *, paper::pending_key const &);
 	paper::store_iterator pending_begin (MDB_txn *);
 	paper::store_iterator pending_end ();
+	// Recently read or written pending entries keyed by send hash along with their destination, sized like account_cache
+	paper::store_cache<std::pair<paper::account, paper::pending_info>> pending_cache;
 
 	void block_info_put (MDB_txn *, paper::block_hash const &, paper::block_info const &);
 	void block_info_del (MDB_txn *, paper::block_hash const &);
@@ -89,6 +322,8 @@ public:
 	paper::store_iterator block_info_begin (MDB_txn *, paper::block_hash const &);
 	paper::store_iterator block_info_begin (MDB_txn *);
 	paper::store_iterator block_info_end ();
+	// Recently read or written block_info, sized like block_cache
+	paper::store_cache<paper::block_info> block_info_cache;
 	paper::uint128_t block_balance (MDB_txn *, paper::block_hash const &);
 	static size_t const block_info_max = 32;
 
@@ -97,16 +332,44 @@ public:
 	void representation_add (MDB_txn *, paper::account const &, paper::uint128_t const &);
 	paper::store_iterator representation_begin (MDB_txn *);
 	paper::store_iterator representation_end ();
+	// Every representative and its weight as seen by a transaction, in account order like the representation table
+	std::vector<std::pair<paper::account, paper::uint128_t>> representation_weights (MDB_txn *);
+	void representation_load (MDB_txn *);
+	// Returns true if the weight seen by this transaction isn't in memory, representation_mutex must be held
+	bool representation_cached (uint64_t, paper::account const &, paper::uint128_t &);
+	// Returns true if the account isn't in the representation table
+	bool representation_read (MDB_txn *, paper::account const &, paper::uint128_t &);
+	// Copy of the representation table, written through by representation_put so weight lookups don't read LMDB
+	// A write only becomes visible to transactions started after it commits, older snapshots read LMDB
+	std::unordered_map<paper::account, paper::representation_entry> representation_cache;
+	// Id of the transaction the copy was loaded from
+	uint64_t representation_loaded;
+	std::mutex representation_mutex;
 
 	void unchecked_clear (MDB_txn *);
 	void unchecked_put (MDB_txn *, paper::block_hash const &, std::shared_ptr<paper::block> const &);
 	std::vector<std::shared_ptr<paper::block>> unchecked_get (MDB_txn *, paper::block_hash const &);
 	void unchecked_del (MDB_txn *, paper::block_hash const &, paper::block const &);
+	// Delete unchecked blocks that arrived before cutoff seconds since epoch, returns the number deleted
+	// Scans at most max entries of the table starting at next, which is left at the key to continue from or zeroed once the end is reached
+	size_t unchecked_evict (MDB_txn *, uint64_t, paper::unchecked_key & next, size_t max);
 	paper::store_iterator unchecked_begin (MDB_txn *);
 	paper::store_iterator unchecked_begin (MDB_txn *, paper::block_hash const &);
 	paper::store_iterator unchecked_end ();
 	size_t unchecked_count (MDB_txn *);
-	std::unordered_multimap<paper::block_hash, std::shared_ptr<paper::block>> unchecked_cache;
+	// Unchecked blocks not yet written to LMDB, ordered by key and by arrival.  Guarded by cache_mutex
+	boost::multi_index_container<
+	paper::unchecked_entry,
+	boost::multi_index::indexed_by<
+	boost::multi_index::ordered_unique<boost::multi_index::member<paper::unchecked_entry, paper::unchecked_key, &paper::unchecked_entry::key>>,
+	boost::multi_index::sequenced<>>>
+	unchecked_cache;
+	// Oldest entries are spilled to LMDB once unchecked_cache grows past this
+	size_t unchecked_cache_max;
+	// Number of unchecked_get calls that found at least one block
+	std::atomic<uint64_t> unchecked_hits;
+	std::atomic<uint64_t> unchecked_evictions;
+	static size_t constexpr unchecked_cache_max_default = 64 * 1024;
 
 	void unsynced_put (MDB_txn *, paper::block_hash const &);
 	void unsynced_del (MDB_txn *, paper::block_hash const &);
@@ -120,19 +383,30 @@ public:
 	void checksum_del (MDB_txn *, uint64_t, uint8_t);
 
 	paper::vote_result vote_validate (MDB_txn *, std::shared_ptr<paper::vote>);
-	// Return latest vote for an account from store
+	// Return latest vote for an account
 	std::shared_ptr<paper::vote> vote_get (MDB_txn *, paper::account const &);
 	// Populate vote with the next sequence number
 	std::shared_ptr<paper::vote> vote_generate (MDB_txn *, paper::account const &, paper::raw_key const &, std::shared_ptr<paper::block>);
-	// Return either vote or the stored vote with a higher sequence number
+	// Return either vote or the stored vote with a higher sequence number, nullptr if vote is newer but the full cache can't keep it
 	std::shared_ptr<paper::vote> vote_max (MDB_txn *, std::shared_ptr<paper::vote>);
-	// Return latest vote for an account considering the vote cache
+	// Return latest vote for an account, cache_mutex must be held
 	std::shared_ptr<paper::vote> vote_current (MDB_txn *, paper::account const &);
 	void flush (MDB_txn *);
-	paper::store_iterator vote_begin (MDB_txn *);
-	paper::store_iterator vote_end ();
+	// Append votes changed since the last call to the vote log, this doesn't touch LMDB
+	void vote_flush ();
 	std::mutex cache_mutex;
+	// Latest vote seen for every account, loaded from the vote log when the store is opened
 	std::unordered_map<paper::account, std::shared_ptr<paper::vote>> vote_cache;
+	// Accounts whose vote changed since the last vote_flush
+	std::unordered_set<paper::account> vote_dirty;
+	// Once vote_cache holds this many accounts votes from accounts without voting weight are dropped
+	size_t vote_cache_max;
+	static size_t constexpr vote_cache_max_default = 64 * 1024;
+	// Make room in a full vote_cache for account, returns false if its vote shouldn't be cached, cache_mutex must be held
+	bool vote_cache_reserve (MDB_txn *, paper::account const &);
+	// Accounts that had no voting weight when their vote was cached, oldest first, these are evicted to make room for representatives
+	std::deque<paper::account> vote_cache_unweighted;
+	paper::vote_log votes;
 
 	void version_put (MDB_txn *, int);
 	int version_get (MDB_txn *);
@@ -146,35 +420,50 @@ public:
 	void upgrade_v7_to_v8 (MDB_txn *);
 	void upgrade_v8_to_v9 (MDB_txn *);
 	void upgrade_v9_to_v10 (MDB_txn *);
+	void upgrade_v10_to_v11 (MDB_txn *);
+	void upgrade_v11_to_v12 (MDB_txn *);
+	void upgrade_v12_to_v13 (MDB_txn *);
+	void upgrade_v13_to_v14 (MDB_txn *);
+	void upgrade_v14_to_v15 (MDB_txn *);
+	void upgrade_v15_to_v16 (MDB_txn *);
+	void block_tables_merge (MDB_txn *);
+	// Fills block_heights from heights unless every height is already indexed
+	void block_heights_fill (MDB_txn *);
 
 	void clear (MDB_dbi);
 
+	// Ledger tables in export order, paired with whether an import can append to them in key order
+	std::vector<std::pair<MDB_dbi, bool>> ledger_tables ();
+	// Stream the ledger tables as a versioned file of checksummed chunks
+	void ledger_export (MDB_txn *, std::ostream &);
+	// Bulk load an export in to a store with no accounts in batches of write transactions, returns true on error
+	// A failed import can leave part of the ledger behind so it should go in to a store that's thrown away on error
+	bool ledger_import (std::istream &);
+
 	paper::mdb_env environment;
 	// block_hash -> account                                        // Maps head blocks to owning account
 	MDB_dbi frontiers;
 	// account -> block_hash, representative, balance, timestamp    // Account to head block, representative, balance, last_change
 	MDB_dbi accounts;
-	// block_hash -> send_block
-	MDB_dbi send_blocks;
-	// block_hash -> receive_block
-	MDB_dbi receive_blocks;
-	// block_hash -> open_block
-	MDB_dbi open_blocks;
-	// block_hash -> change_block
-	MDB_dbi change_blocks;
+	// block_hash -> block_type, block, successor                   // Blocks of every type tagged with their type
+	MDB_dbi blocks;
 	// block_hash -> sender, amount, destination                    // Pending blocks to sender account, amount, destination account
 	MDB_dbi pending;
 	// block_hash -> account, balance                               // Blocks info
 	MDB_dbi blocks_info;
 	// account -> weight                                            // Representation
 	MDB_dbi representation;
-	// block_hash -> block                                          // Unchecked bootstrap blocks
+	// block_hash, block_hash -> uint64_t, block                    // Unchecked bootstrap blocks keyed by dependency then hash, with arrival time
 	MDB_dbi unchecked;
 	// block_hash ->                                                // Blocks that haven't been broadcast
 	MDB_dbi unsynced;
 	// (uint56_t, uint8_t) -> block_hash                            // Mapping of region to checksum
 	MDB_dbi checksum;
-	// account -> uint64_t											// Highest vote observed for account
+	// account, uint64_t -> block_hash                              // Block at each height of an account's chain, the open block is height 1
+	MDB_dbi heights;
+	// block_hash -> account, uint64_t                              // Reverse of heights, where each block sits in its account's chain
+	MDB_dbi block_heights;
+	// account -> vote											// Highest vote observed for account, emptied in to the vote log by the v15 upgrade
 	MDB_dbi vote;
 	// uint256_union -> ?											// Meta information about block store
 	MDB_dbi meta;
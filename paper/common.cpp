@@ -7,6 +7,7 @@
 
 #include <boost/property_tree/json_parser.hpp>
 
+#include <cstring>
 #include <queue>
 
 #include <ed25519-donna/ed25519.h>
@@ -253,6 +254,64 @@ change (0)
 {
 }
 
+void paper::block_counts::serialize (paper::stream & stream_a) const
+{
+	paper::write (stream_a, static_cast<uint64_t> (send));
+	paper::write (stream_a, static_cast<uint64_t> (receive));
+	paper::write (stream_a, static_cast<uint64_t> (open));
+	paper::write (stream_a, static_cast<uint64_t> (change));
+}
+
+bool paper::block_counts::deserialize (paper::stream & stream_a)
+{
+	uint64_t send_l;
+	uint64_t receive_l;
+	uint64_t open_l;
+	uint64_t change_l;
+	auto error (paper::read (stream_a, send_l));
+	error = error || paper::read (stream_a, receive_l);
+	error = error || paper::read (stream_a, open_l);
+	error = error || paper::read (stream_a, change_l);
+	if (!error)
+	{
+		send = send_l;
+		receive = receive_l;
+		open = open_l;
+		change = change_l;
+	}
+	return error;
+}
+
+void paper::block_counts::add (paper::block_type type_a, int64_t amount_a)
+{
+	switch (type_a)
+	{
+		case paper::block_type::send:
+			send += amount_a;
+			break;
+		case paper::block_type::receive:
+			receive += amount_a;
+			break;
+		case paper::block_type::open:
+			open += amount_a;
+			break;
+		case paper::block_type::change:
+			change += amount_a;
+			break;
+		default:
+			assert (false);
+			break;
+	}
+}
+
+void paper::block_counts::add (paper::block_counts const & other_a)
+{
+	send += other_a.send;
+	receive += other_a.receive;
+	open += other_a.open;
+	change += other_a.change;
+}
+
 size_t paper::block_counts::sum ()
 {
 	return send + receive + open + change;
@@ -342,6 +401,103 @@ paper::mdb_val paper::pending_key::val () const
 	return paper::mdb_val (sizeof (*this), const_cast<paper::pending_key *> (this));
 }
 
+paper::unchecked_key::unchecked_key (paper::block_hash const & dependency_a, paper::block_hash const & hash_a) :
+dependency (dependency_a),
+hash (hash_a)
+{
+}
+
+paper::unchecked_key::unchecked_key (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (dependency) + sizeof (hash) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+bool paper::unchecked_key::operator== (paper::unchecked_key const & other_a) const
+{
+	return dependency == other_a.dependency && hash == other_a.hash;
+}
+
+bool paper::unchecked_key::operator< (paper::unchecked_key const & other_a) const
+{
+	// Same byte order LMDB sorts the table by
+	return std::memcmp (this, &other_a, sizeof (*this)) < 0;
+}
+
+paper::mdb_val paper::unchecked_key::val () const
+{
+	return paper::mdb_val (sizeof (*this), const_cast<paper::unchecked_key *> (this));
+}
+
+paper::height_key::height_key (paper::account const & account_a, uint64_t height_a) :
+account (account_a)
+{
+	for (auto i (height_bytes.rbegin ()), n (height_bytes.rend ()); i != n; ++i)
+	{
+		*i = static_cast<uint8_t> (height_a);
+		height_a >>= 8;
+	}
+}
+
+paper::height_key::height_key (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (account) + sizeof (height_bytes) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+uint64_t paper::height_key::height () const
+{
+	uint64_t result (0);
+	for (auto i : height_bytes)
+	{
+		result = (result << 8) | i;
+	}
+	return result;
+}
+
+paper::mdb_val paper::height_key::val () const
+{
+	return paper::mdb_val (sizeof (*this), const_cast<paper::height_key *> (this));
+}
+
+paper::unchecked_info::unchecked_info () :
+modified (0)
+{
+}
+
+paper::unchecked_info::unchecked_info (MDB_val const & val_a) :
+modified (0)
+{
+	paper::bufferstream stream (reinterpret_cast<uint8_t const *> (val_a.mv_data), val_a.mv_size);
+	auto error (deserialize (stream));
+	assert (!error);
+}
+
+paper::unchecked_info::unchecked_info (std::shared_ptr<paper::block> block_a, uint64_t modified_a) :
+block (block_a),
+modified (modified_a)
+{
+}
+
+void paper::unchecked_info::serialize (paper::stream & stream_a) const
+{
+	paper::write (stream_a, modified);
+	paper::serialize_block (stream_a, *block);
+}
+
+bool paper::unchecked_info::deserialize (paper::stream & stream_a)
+{
+	auto error (paper::read (stream_a, modified));
+	if (!error)
+	{
+		block = paper::deserialize_block (stream_a);
+		error = block == nullptr;
+	}
+	return error;
+}
+
 paper::block_info::block_info () :
 account (0),
 balance (0)
@@ -415,60 +571,45 @@ store (store_a)
 {
 }
 
-void paper::amount_visitor::send_block (paper::send_block const & block_a)
-{
-	balance_visitor prev (transaction, store);
-	prev.compute (block_a.hashables.previous);
-	result = prev.result - block_a.hashables.balance.number ();
-}
-
-void paper::amount_visitor::receive_block (paper::receive_block const & block_a)
-{
-	from_send (block_a.hashables.source);
-}
-
-void paper::amount_visitor::open_block (paper::open_block const & block_a)
-{
-	if (block_a.hashables.source != paper::genesis_account)
-	{
-		from_send (block_a.hashables.source);
-	}
-	else
-	{
-		result = paper::genesis_amount;
-	}
-}
-
-void paper::amount_visitor::change_block (paper::change_block const & block_a)
-{
-	result = 0;
-}
-
-void paper::amount_visitor::from_send (paper::block_hash const & hash_a)
-{
-	auto source_block (store.block_get (transaction, hash_a));
-	assert (source_block != nullptr);
-	source_block->visit (*this);
-}
-
 void paper::amount_visitor::compute (paper::block_hash const & block_hash)
 {
-	auto block (store.block_get (transaction, block_hash));
-	if (block != nullptr)
-	{
-		block->visit (*this);
-	}
-	else
+	auto block (store.block_get_view (transaction, block_hash));
+	switch (block.type ())
 	{
-		if (block_hash == paper::genesis_account)
+		case paper::block_type::send:
 		{
-			result = std::numeric_limits<paper::uint128_t>::max ();
+			balance_visitor prev (transaction, store);
+			prev.compute (block.previous ());
+			result = prev.result - block.balance ().number ();
+			break;
 		}
-		else
-		{
-			assert (false);
+		case paper::block_type::receive:
+			compute (block.source ());
+			break;
+		case paper::block_type::open:
+			if (block.source () != paper::genesis_account)
+			{
+				compute (block.source ());
+			}
+			else
+			{
+				result = paper::genesis_amount;
+			}
+			break;
+		case paper::block_type::change:
 			result = 0;
-		}
+			break;
+		default:
+			if (block_hash == paper::genesis_account)
+			{
+				result = std::numeric_limits<paper::uint128_t>::max ();
+			}
+			else
+			{
+				assert (false);
+				result = 0;
+			}
+			break;
 	}
 }
 
@@ -480,59 +621,58 @@ result (0)
 {
 }
 
-void paper::balance_visitor::send_block (paper::send_block const & block_a)
-{
-	result += block_a.hashables.balance.number ();
-	current = 0;
-}
-
-void paper::balance_visitor::receive_block (paper::receive_block const & block_a)
-{
-	amount_visitor source (transaction, store);
-	source.compute (block_a.hashables.source);
-	paper::block_info block_info;
-	if (!store.block_info_get (transaction, block_a.hash (), block_info))
-	{
-		result += block_info.balance.number ();
-		current = 0;
-	}
-	else
-	{
-		result += source.result;
-		current = block_a.hashables.previous;
-	}
-}
-
-void paper::balance_visitor::open_block (paper::open_block const & block_a)
-{
-	amount_visitor source (transaction, store);
-	source.compute (block_a.hashables.source);
-	result += source.result;
-	current = 0;
-}
-
-void paper::balance_visitor::change_block (paper::change_block const & block_a)
-{
-	paper::block_info block_info;
-	if (!store.block_info_get (transaction, block_a.hash (), block_info))
-	{
-		result += block_info.balance.number ();
-		current = 0;
-	}
-	else
-	{
-		current = block_a.hashables.previous;
-	}
-}
-
 void paper::balance_visitor::compute (paper::block_hash const & block_hash)
 {
 	current = block_hash;
 	while (!current.is_zero ())
 	{
-		auto block (store.block_get (transaction, current));
-		assert (block != nullptr);
-		block->visit (*this);
+		auto block (store.block_get_view (transaction, current));
+		assert (!block.empty ());
+		paper::block_info block_info;
+		switch (block.type ())
+		{
+			case paper::block_type::send:
+				result += block.balance ().number ();
+				current = 0;
+				break;
+			case paper::block_type::receive:
+				if (!store.block_info_get (transaction, current, block_info))
+				{
+					result += block_info.balance.number ();
+					current = 0;
+				}
+				else
+				{
+					amount_visitor source (transaction, store);
+					source.compute (block.source ());
+					result += source.result;
+					current = block.previous ();
+				}
+				break;
+			case paper::block_type::open:
+			{
+				amount_visitor source (transaction, store);
+				source.compute (block.source ());
+				result += source.result;
+				current = 0;
+				break;
+			}
+			case paper::block_type::change:
+				if (!store.block_info_get (transaction, current, block_info))
+				{
+					result += block_info.balance.number ();
+					current = 0;
+				}
+				else
+				{
+					current = block.previous ();
+				}
+				break;
+			default:
+				assert (false);
+				current = 0;
+				break;
+		}
 	}
 }
 
@@ -548,32 +688,26 @@ void paper::representative_visitor::compute (paper::block_hash const & hash_a)
 	current = hash_a;
 	while (result.is_zero ())
 	{
-		auto block (store.block_get (transaction, current));
-		assert (block != nullptr);
-		block->visit (*this);
+		auto block (store.block_get_view (transaction, current));
+		assert (!block.empty ());
+		switch (block.type ())
+		{
+			case paper::block_type::send:
+			case paper::block_type::receive:
+				current = block.previous ();
+				break;
+			case paper::block_type::open:
+			case paper::block_type::change:
+				result = current;
+				break;
+			default:
+				assert (false);
+				result = current;
+				break;
+		}
 	}
 }
 
-void paper::representative_visitor::send_block (paper::send_block const & block_a)
-{
-	current = block_a.previous ();
-}
-
-void paper::representative_visitor::receive_block (paper::receive_block const & block_a)
-{
-	current = block_a.previous ();
-}
-
-void paper::representative_visitor::open_block (paper::open_block const & block_a)
-{
-	result = block_a.hash ();
-}
-
-void paper::representative_visitor::change_block (paper::change_block const & block_a)
-{
-	result = block_a.hash ();
-}
-
 paper::vote::vote (paper::vote const & other_a) :
 sequence (other_a.sequence),
 block (other_a.block),
@@ -694,6 +828,7 @@ void paper::genesis::initialize (MDB_txn * transaction_a, paper::block_store & s
 	assert (store_a.latest_begin (transaction_a) == store_a.latest_end ());
 	store_a.block_put (transaction_a, hash_l, *open);
 	store_a.account_put (transaction_a, genesis_account, { hash_l, open->hash (), open->hash (), std::numeric_limits<paper::uint128_t>::max (), paper::seconds_since_epoch (), 1 });
+	store_a.height_put (transaction_a, genesis_account, 1, hash_l);
 	store_a.representation_put (transaction_a, genesis_account, std::numeric_limits<paper::uint128_t>::max ());
 	store_a.checksum_put (transaction_a, 0, 0, hash_l);
 	store_a.frontier_put (transaction_a, hash_l, genesis_account);
@@ -25,18 +25,13 @@ namespace paper
 {
 class block_store;
 /**
- * Determine the balance as of this block
+ * Determine the balance as of this block, walking the chain through block views
  */
-class balance_visitor : public paper::block_visitor
+class balance_visitor
 {
 public:
 	balance_visitor (MDB_txn *, paper::block_store &);
-	virtual ~balance_visitor () = default;
 	void compute (paper::block_hash const &);
-	void send_block (paper::send_block const &) override;
-	void receive_block (paper::receive_block const &) override;
-	void open_block (paper::open_block const &) override;
-	void change_block (paper::change_block const &) override;
 	MDB_txn * transaction;
 	paper::block_store & store;
 	paper::block_hash current;
@@ -46,17 +41,11 @@ public:
 /**
  * Determine the amount delta resultant from this block
  */
-class amount_visitor : public paper::block_visitor
+class amount_visitor
 {
 public:
 	amount_visitor (MDB_txn *, paper::block_store &);
-	virtual ~amount_visitor () = default;
 	void compute (paper::block_hash const &);
-	void send_block (paper::send_block const &) override;
-	void receive_block (paper::receive_block const &) override;
-	void open_block (paper::open_block const &) override;
-	void change_block (paper::change_block const &) override;
-	void from_send (paper::block_hash const &);
 	MDB_txn * transaction;
 	paper::block_store & store;
 	paper::uint128_t result;
@@ -65,16 +54,11 @@ public:
 /**
  * Determine the representative for this block
  */
-class representative_visitor : public paper::block_visitor
+class representative_visitor
 {
 public:
 	representative_visitor (MDB_txn * transaction_a, paper::block_store & store_a);
-	virtual ~representative_visitor () = default;
 	void compute (paper::block_hash const & hash_a);
-	void send_block (paper::send_block const & block_a) override;
-	void receive_block (paper::receive_block const & block_a) override;
-	void open_block (paper::open_block const & block_a) override;
-	void change_block (paper::change_block const & block_a) override;
 	MDB_txn * transaction;
 	paper::block_store & store;
 	paper::block_hash current;
@@ -148,6 +132,42 @@ public:
 	paper::account account;
 	paper::block_hash hash;
 };
+// Key of the unchecked table, the hash a block is waiting on followed by the block's own hash
+class unchecked_key
+{
+public:
+	unchecked_key (paper::block_hash const &, paper::block_hash const &);
+	unchecked_key (MDB_val const &);
+	bool operator== (paper::unchecked_key const &) const;
+	bool operator< (paper::unchecked_key const &) const;
+	paper::mdb_val val () const;
+	paper::block_hash dependency;
+	paper::block_hash hash;
+};
+// Key of the heights table, an account followed by the height of one of its blocks
+class height_key
+{
+public:
+	height_key (paper::account const &, uint64_t);
+	height_key (MDB_val const &);
+	uint64_t height () const;
+	paper::mdb_val val () const;
+	paper::account account;
+	// Stored big endian so LMDB orders an account's blocks by height
+	std::array<uint8_t, 8> height_bytes;
+};
+// Value of the unchecked table, the arrival time in seconds since epoch followed by the block
+class unchecked_info
+{
+public:
+	unchecked_info ();
+	unchecked_info (MDB_val const &);
+	unchecked_info (std::shared_ptr<paper::block>, uint64_t);
+	void serialize (paper::stream &) const;
+	bool deserialize (paper::stream &);
+	std::shared_ptr<paper::block> block;
+	uint64_t modified;
+};
 class block_info
 {
 public:
@@ -165,6 +185,10 @@ class block_counts
 {
 public:
 	block_counts ();
+	void serialize (paper::stream &) const;
+	bool deserialize (paper::stream &);
+	void add (paper::block_type, int64_t);
+	void add (paper::block_counts const &);
 	size_t sum ();
 	size_t send;
 	size_t receive;
@@ -221,6 +245,12 @@ enum class process_result
 	account_mismatch, // Account number in open block doesn't match send destination
 	opened_burn_account // The impossible happened, someone found the private key associated with the public key '0'.
 };
+// Whether a block's signature was already checked before reaching the ledger
+enum class signature_verification
+{
+	unknown, // Signature has not been checked, the ledger must validate it
+	valid // Signature was checked against the block's account by a batch verification stage
+};
 class process_return
 {
 public:
@@ -25,6 +25,36 @@ TEST (ed25519, signing)
 	ASSERT_NE (0, valid2);
 }
 
+TEST (ed25519, batch_signing)
+{
+	size_t const count (8);
+	std::vector<paper::keypair> keys (count);
+	std::vector<paper::uint256_union> messages (count);
+	std::vector<paper::uint512_union> signatures (count);
+	std::vector<unsigned char const *> message_pointers (count);
+	std::vector<size_t> message_lengths (count, sizeof (paper::uint256_union));
+	std::vector<unsigned char const *> pub_keys (count);
+	std::vector<unsigned char const *> signature_pointers (count);
+	for (size_t i (0); i < count; ++i)
+	{
+		messages[i] = paper::uint256_union (i);
+		signatures[i] = paper::sign_message (keys[i].prv, keys[i].pub, messages[i]);
+		message_pointers[i] = messages[i].bytes.data ();
+		pub_keys[i] = keys[i].pub.bytes.data ();
+		signature_pointers[i] = signatures[i].bytes.data ();
+	}
+	std::vector<int> verifications1 (count);
+	ASSERT_FALSE (paper::validate_message_batch (message_pointers.data (), message_lengths.data (), pub_keys.data (), signature_pointers.data (), count, verifications1.data ()));
+	ASSERT_EQ (std::vector<int> (count, 1), verifications1);
+	signatures[3].bytes[32] ^= 0x1;
+	std::vector<int> verifications2 (count);
+	ASSERT_TRUE (paper::validate_message_batch (message_pointers.data (), message_lengths.data (), pub_keys.data (), signature_pointers.data (), count, verifications2.data ()));
+	for (size_t i (0); i < count; ++i)
+	{
+		ASSERT_EQ (i == 3 ? 0 : 1, verifications2[i]);
+	}
+}
+
 TEST (transaction_block, empty)
 {
 	paper::keypair key1;
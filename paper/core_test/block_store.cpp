@@ -211,6 +211,82 @@ TEST (unchecked, multiple)
 	ASSERT_FALSE (block4.empty ());
 }
 
+TEST (unchecked, spill)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path (), 128, 2);
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<paper::send_block> (4, 1, 2, paper::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<paper::send_block> (5, 1, 2, paper::keypair ().prv, 4, 5));
+	auto block3 (std::make_shared<paper::send_block> (6, 1, 2, paper::keypair ().prv, 4, 5));
+	paper::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, 1, block1);
+	store.unchecked_put (transaction, 1, block2);
+	ASSERT_EQ (store.unchecked_end (), store.unchecked_begin (transaction));
+	store.unchecked_put (transaction, 1, block3);
+	ASSERT_EQ (2, store.unchecked_cache.size ());
+	ASSERT_EQ (3, store.unchecked_count (transaction));
+	// The oldest block was written to the store
+	auto begin (store.unchecked_begin (transaction));
+	ASSERT_NE (store.unchecked_end (), begin);
+	ASSERT_EQ (block1->hash (), paper::unchecked_key (begin->first).hash);
+	store.unchecked_put (transaction, 1, block1);
+	ASSERT_EQ (3, store.unchecked_count (transaction));
+	ASSERT_EQ (3, store.unchecked_get (transaction, 1).size ());
+	ASSERT_EQ (1, store.unchecked_hits);
+	ASSERT_EQ (0, store.unchecked_get (transaction, 2).size ());
+	ASSERT_EQ (1, store.unchecked_hits);
+	store.unchecked_del (transaction, 1, *block1);
+	ASSERT_EQ (2, store.unchecked_count (transaction));
+}
+
+TEST (unchecked, evict)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<paper::send_block> (4, 1, 2, paper::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<paper::send_block> (5, 1, 2, paper::keypair ().prv, 4, 5));
+	paper::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	store.unchecked_put (transaction, block2->previous (), block2);
+	auto now (paper::seconds_since_epoch ());
+	paper::unchecked_key next (0, 0);
+	ASSERT_EQ (0, store.unchecked_evict (transaction, now - 60, next, 16));
+	ASSERT_EQ (paper::unchecked_key (0, 0), next);
+	ASSERT_EQ (2, store.unchecked_count (transaction));
+	ASSERT_EQ (2, store.unchecked_evict (transaction, now + 60, next, 16));
+	ASSERT_EQ (0, store.unchecked_count (transaction));
+	ASSERT_EQ (2, store.unchecked_evictions);
+}
+
+// Eviction scans the table in slices that resume where the previous one stopped
+TEST (unchecked, evict_slices)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::transaction transaction (store.environment, nullptr, true);
+	for (auto i (0); i < 5; ++i)
+	{
+		auto block (std::make_shared<paper::send_block> (i + 1, 1, 2, paper::keypair ().prv, 4, 5));
+		store.unchecked_put (transaction, block->previous (), block);
+	}
+	store.flush (transaction);
+	ASSERT_EQ (0, store.unchecked_cache.size ());
+	auto cutoff (paper::seconds_since_epoch () + 60);
+	paper::unchecked_key next (0, 0);
+	ASSERT_EQ (2, store.unchecked_evict (transaction, cutoff, next, 2));
+	ASSERT_EQ (paper::block_hash (3), next.dependency);
+	ASSERT_EQ (3, store.unchecked_count (transaction));
+	ASSERT_EQ (2, store.unchecked_evict (transaction, cutoff, next, 2));
+	ASSERT_EQ (paper::block_hash (5), next.dependency);
+	ASSERT_EQ (1, store.unchecked_evict (transaction, cutoff, next, 2));
+	ASSERT_EQ (paper::unchecked_key (0, 0), next);
+	ASSERT_EQ (0, store.unchecked_count (transaction));
+}
+
 TEST (unchecked, double_put)
 {
 	bool init (false);
@@ -289,10 +365,11 @@ TEST (block_store, one_bootstrap)
 	auto begin (store.unchecked_begin (transaction));
 	auto end (store.unchecked_end ());
 	ASSERT_NE (end, begin);
-	auto hash1 (begin->first.uint256 ());
-	ASSERT_EQ (block1->hash (), hash1);
-	auto block2 (paper::deserialize_block (begin->second));
-	ASSERT_EQ (*block1, *block2);
+	paper::unchecked_key key1 (begin->first);
+	ASSERT_EQ (block1->hash (), key1.dependency);
+	ASSERT_EQ (block1->hash (), key1.hash);
+	paper::unchecked_info info1 (begin->second);
+	ASSERT_EQ (*block1, *info1.block);
 	++begin;
 	ASSERT_EQ (end, begin);
 }
@@ -586,6 +663,35 @@ TEST (block_store, block_count)
 	paper::uint256_union hash1 (block.hash ());
 	store.block_put (paper::transaction (store.environment, nullptr, true), hash1, block);
 	ASSERT_EQ (1, store.block_count (paper::transaction (store.environment, nullptr, false)).sum ());
+	// Rewriting a block doesn't count it twice
+	store.block_put (paper::transaction (store.environment, nullptr, true), hash1, block);
+	auto count1 (store.block_count (paper::transaction (store.environment, nullptr, false)));
+	ASSERT_EQ (1, count1.open);
+	ASSERT_EQ (1, count1.sum ());
+	store.block_del (paper::transaction (store.environment, nullptr, true), hash1);
+	ASSERT_EQ (0, store.block_count (paper::transaction (store.environment, nullptr, false)).sum ());
+}
+
+// Counts changed by a write transaction are written to the meta table once, when it commits
+TEST (block_store, block_count_flush)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::open_block block1 (0, 1, 0, paper::keypair ().prv, 0, 0);
+	paper::open_block block2 (0, 2, 0, paper::keypair ().prv, 0, 0);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.block_put (transaction, block1.hash (), block1);
+		store.block_put (transaction, block2.hash (), block2);
+		ASSERT_EQ (0, store.block_count_read (transaction).sum ());
+		ASSERT_EQ (2, store.block_count (transaction).open);
+		store.block_del (transaction, block1.hash ());
+		ASSERT_EQ (1, store.block_count (transaction).sum ());
+	}
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (1, store.block_count_read (transaction).open);
+	ASSERT_EQ (1, store.block_count (transaction).sum ());
 }
 
 TEST (block_store, frontier_count)
@@ -675,6 +781,271 @@ TEST (block_store, upgrade_v2_v3)
 	ASSERT_EQ (change_hash, info.rep_block);
 }
 
+// Weights are served from memory and still match the representation table after reopening
+TEST (block_store, representation_cache)
+{
+	paper::keypair key1;
+	paper::keypair key2;
+	auto path (paper::unique_path ());
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		ASSERT_EQ (0, store.representation_get (transaction, key1.pub));
+		store.representation_put (transaction, key1.pub, 7);
+		store.representation_put (transaction, key2.pub, 6);
+		store.representation_put (transaction, key2.pub, 5);
+		ASSERT_EQ (7, store.representation_get (transaction, key1.pub));
+		ASSERT_EQ (5, store.representation_get (transaction, key2.pub));
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (7, store.representation_get (transaction, key1.pub));
+	ASSERT_EQ (5, store.representation_get (transaction, key2.pub));
+	auto weights (store.representation_weights (transaction));
+	ASSERT_EQ (2, weights.size ());
+	auto j (weights.begin ());
+	for (auto i (store.representation_begin (transaction)), n (store.representation_end ()); i != n; ++i, ++j)
+	{
+		ASSERT_NE (weights.end (), j);
+		ASSERT_EQ (paper::account (i->first.uint256 ()), j->first);
+		paper::uint128_union weight;
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		ASSERT_FALSE (paper::read (stream, weight));
+		ASSERT_EQ (weight.number (), j->second);
+	}
+}
+
+// Transactions only see weights written by transactions that committed before they started
+TEST (block_store, representation_cache_snapshot)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::keypair key1;
+	paper::keypair key2;
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.representation_put (transaction, key1.pub, 7);
+	}
+	paper::transaction before (store.environment, nullptr, false);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.representation_put (transaction, key1.pub, 8);
+		store.representation_put (transaction, key2.pub, 5);
+		ASSERT_EQ (8, store.representation_get (transaction, key1.pub));
+		ASSERT_EQ (5, store.representation_get (transaction, key2.pub));
+		paper::transaction during (store.environment, nullptr, false);
+		ASSERT_EQ (7, store.representation_get (during, key1.pub));
+		ASSERT_EQ (0, store.representation_get (during, key2.pub));
+		ASSERT_EQ (1, store.representation_weights (during).size ());
+	}
+	ASSERT_EQ (7, store.representation_get (before, key1.pub));
+	ASSERT_EQ (0, store.representation_get (before, key2.pub));
+	auto weights_before (store.representation_weights (before));
+	ASSERT_EQ (1, weights_before.size ());
+	ASSERT_EQ (7, weights_before[0].second);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.representation_put (transaction, key1.pub, 9);
+	}
+	paper::transaction after (store.environment, nullptr, false);
+	ASSERT_EQ (9, store.representation_get (after, key1.pub));
+	ASSERT_EQ (5, store.representation_get (after, key2.pub));
+	ASSERT_EQ (2, store.representation_weights (after).size ());
+	ASSERT_EQ (7, store.representation_get (before, key1.pub));
+}
+
+TEST (block_store, account_cache)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::account account (1);
+	paper::account_info info1 (2, 3, 4, 5, 6, 7);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.account_put (transaction, account, info1);
+	}
+	paper::transaction old (store.environment, nullptr, false);
+	paper::account_info info2;
+	// The writer filled the cache with what it wrote
+	ASSERT_FALSE (store.account_get (old, account, info2));
+	ASSERT_EQ (info1, info2);
+	ASSERT_EQ (1, store.account_cache.hits);
+	ASSERT_EQ (1, store.account_cache.size ());
+	paper::account_info info3 (8, 3, 4, 9, 10, 8);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.account_put (transaction, account, info3);
+		ASSERT_EQ (1, store.account_cache.size ());
+		ASSERT_FALSE (store.account_get (transaction, account, info2));
+		ASSERT_EQ (info3, info2);
+		ASSERT_EQ (2, store.account_cache.hits);
+		// Snapshots from before the write don't see the change while it isn't committed
+		paper::transaction concurrent (store.environment, nullptr, false);
+		ASSERT_FALSE (store.account_get (concurrent, account, info2));
+		ASSERT_EQ (info1, info2);
+		ASSERT_EQ (1, store.account_cache.misses);
+	}
+	{
+		paper::transaction transaction (store.environment, nullptr, false);
+		ASSERT_FALSE (store.account_get (transaction, account, info2));
+		ASSERT_EQ (info3, info2);
+		ASSERT_EQ (3, store.account_cache.hits);
+	}
+	// A snapshot from before the write still reads the old value
+	ASSERT_FALSE (store.account_get (old, account, info2));
+	ASSERT_EQ (info1, info2);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.account_del (transaction, account);
+	}
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_TRUE (store.account_get (transaction, account, info2));
+}
+
+TEST (block_store, block_cache)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::keypair key1;
+	paper::open_block block1 (0, 1, key1.pub, key1.prv, key1.pub, 0);
+	paper::receive_block block2 (block1.hash (), 2, key1.prv, key1.pub, 0);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.block_put (transaction, block1.hash (), block1);
+	}
+	{
+		paper::transaction transaction (store.environment, nullptr, false);
+		auto block3 (store.block_get (transaction, block1.hash ()));
+		ASSERT_NE (nullptr, block3);
+		ASSERT_EQ (block1, *block3);
+		ASSERT_EQ (1, store.block_cache.hits);
+		auto block4 (store.block_get (transaction, block1.hash ()));
+		ASSERT_NE (nullptr, block4);
+		ASSERT_EQ (block1, *block4);
+		ASSERT_NE (block3.get (), block4.get ());
+		ASSERT_TRUE (store.block_exists (transaction, block1.hash ()));
+		ASSERT_EQ (3, store.block_cache.hits);
+		ASSERT_EQ (0, store.block_successor (transaction, block1.hash ()).number ());
+	}
+	{
+		// Setting the successor rewrites the predecessor
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.block_put (transaction, block2.hash (), block2);
+		// The predecessor's entry is dropped and the new block is cached
+		ASSERT_EQ (1, store.block_cache.size ());
+	}
+	{
+		paper::transaction transaction (store.environment, nullptr, false);
+		ASSERT_EQ (block2.hash (), store.block_successor (transaction, block1.hash ()));
+		ASSERT_NE (nullptr, store.block_get (transaction, block2.hash ()));
+		ASSERT_EQ (1, store.block_cache.size ());
+	}
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.block_del (transaction, block2.hash ());
+	}
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (nullptr, store.block_get (transaction, block2.hash ()));
+	ASSERT_FALSE (store.block_exists (transaction, block2.hash ()));
+}
+
+TEST (block_store, pending_cache)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::keypair key1;
+	paper::keypair key2;
+	paper::pending_key key (key1.pub, 1);
+	paper::pending_info info1 (2, 3);
+	paper::block_info block_info1;
+	block_info1.account = key1.pub;
+	block_info1.balance = 4;
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.pending_put (transaction, key, info1);
+		store.block_info_put (transaction, 5, block_info1);
+	}
+	paper::transaction transaction (store.environment, nullptr, false);
+	paper::pending_info info2;
+	ASSERT_FALSE (store.pending_get (transaction, key, info2));
+	ASSERT_EQ (info1, info2);
+	ASSERT_EQ (1, store.pending_cache.hits);
+	// The same send hash for another account isn't served from the cache
+	ASSERT_TRUE (store.pending_get (transaction, paper::pending_key (key2.pub, 1), info2));
+	paper::block_info block_info2;
+	ASSERT_FALSE (store.block_info_get (transaction, 5, block_info2));
+	ASSERT_EQ (block_info1, block_info2);
+	ASSERT_EQ (1, store.block_info_cache.hits);
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.pending_del (transaction, key);
+		store.block_info_del (transaction, 5);
+	}
+	paper::transaction transaction2 (store.environment, nullptr, false);
+	ASSERT_TRUE (store.pending_get (transaction2, key, info2));
+	ASSERT_TRUE (store.block_info_get (transaction2, 5, block_info2));
+	// The older snapshot still reads the deleted entries from the table
+	ASSERT_FALSE (store.pending_get (transaction, key, info2));
+	ASSERT_FALSE (store.block_info_get (transaction, 5, block_info2));
+}
+
+TEST (block_store, block_view)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::keypair key1;
+	paper::open_block open (1, 2, key1.pub, key1.prv, key1.pub, 3);
+	paper::send_block send (open.hash (), 4, 5, key1.prv, key1.pub, 6);
+	paper::receive_block receive (send.hash (), 7, key1.prv, key1.pub, 8);
+	paper::change_block change (receive.hash (), 9, key1.prv, key1.pub, 10);
+	paper::transaction transaction (store.environment, nullptr, true);
+	ASSERT_TRUE (store.block_get_view (transaction, open.hash ()).empty ());
+	std::vector<paper::block *> blocks ({ &open, &send, &receive, &change });
+	for (auto i : blocks)
+	{
+		store.block_put (transaction, i->hash (), *i);
+	}
+	for (auto i : blocks)
+	{
+		auto view (store.block_get_view (transaction, i->hash ()));
+		ASSERT_FALSE (view.empty ());
+		ASSERT_EQ (i->type (), view.type ());
+		ASSERT_EQ (i->hash (), view.hash ());
+		ASSERT_EQ (i->previous (), view.previous ());
+		ASSERT_EQ (i->source (), view.source ());
+		ASSERT_EQ (i->root (), view.root ());
+		ASSERT_EQ (i->representative (), view.representative ());
+		ASSERT_EQ (store.block_successor (transaction, i->hash ()), view.successor ());
+		ASSERT_EQ (*i, *view.block ());
+		std::vector<uint8_t> bytes1;
+		{
+			paper::vectorstream stream (bytes1);
+			paper::serialize_block (stream, *i);
+		}
+		std::vector<uint8_t> bytes2;
+		{
+			paper::vectorstream stream (bytes2);
+			view.serialize (stream);
+		}
+		ASSERT_EQ (bytes1, bytes2);
+	}
+	auto view (store.block_get_view (transaction, send.hash ()));
+	ASSERT_EQ (paper::account (4), view.destination ());
+	ASSERT_EQ (paper::amount (5), view.balance ());
+	ASSERT_EQ (receive.hash (), view.successor ());
+	ASSERT_EQ (key1.pub, store.block_get_view (transaction, open.hash ()).account ());
+	ASSERT_TRUE (store.block_get_view (transaction, change.hash ()).successor ().is_zero ());
+}
+
 TEST (block_store, upgrade_v3_v4)
 {
 	paper::keypair key1;
@@ -827,7 +1198,7 @@ TEST (block_store, upgrade_v6_v7)
 	ASSERT_EQ (store.unchecked_end (), store.unchecked_begin (transaction));
 }
 
-// Databases need to be dropped in order to convert to dupsort compatible
+// Unchecked keys include the block hash so blocks waiting on the same dependency are distinct entries whether or not the table is dupsort
 TEST (block_store, change_dupsort)
 {
 	auto path (paper::unique_path ());
@@ -845,16 +1216,7 @@ TEST (block_store, change_dupsort)
 	{
 		auto iterator1 (store.unchecked_begin (transaction));
 		++iterator1;
-		ASSERT_EQ (store.unchecked_end (), iterator1);
-	}
-	ASSERT_EQ (0, mdb_drop (transaction, store.unchecked, 0));
-	mdb_dbi_close (store.environment, store.unchecked);
-	ASSERT_EQ (0, mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &store.unchecked));
-	store.unchecked_put (transaction, send1->hash (), send1);
-	store.unchecked_put (transaction, send1->hash (), send2);
-	store.flush (transaction);
-	{
-		auto iterator1 (store.unchecked_begin (transaction));
+		ASSERT_NE (store.unchecked_end (), iterator1);
 		++iterator1;
 		ASSERT_EQ (store.unchecked_end (), iterator1);
 	}
@@ -904,18 +1266,194 @@ TEST (block_store, upgrade_v7_v8)
 TEST (block_store, sequence_flush)
 {
 	auto path (paper::unique_path ());
+	paper::keypair key1;
+	std::shared_ptr<paper::vote> vote1;
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, false);
+		auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+		vote1 = store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		auto seq2 (store.vote_get (transaction, vote1->account));
+		ASSERT_EQ (*seq2, *vote1);
+		ASSERT_EQ (1, store.vote_dirty.size ());
+		store.vote_flush ();
+		ASSERT_TRUE (store.vote_dirty.empty ());
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	auto seq3 (store.vote_get (transaction, vote1->account));
+	ASSERT_NE (nullptr, seq3);
+	ASSERT_EQ (*seq3, *vote1);
+}
+
+TEST (block_store, vote_log_replay)
+{
+	auto path (paper::unique_path ());
+	paper::keypair key1;
+	paper::keypair key2;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, false);
+		store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		store.vote_flush ();
+		store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		store.vote_generate (transaction, key2.pub, key2.prv, send1);
+		store.vote_flush ();
+	}
+	auto log (path.string () + "-votes");
+	auto size (boost::filesystem::file_size (log));
+	{
+		// A record cut short, as if the node died while appending
+		std::ofstream file (log, std::ios::binary | std::ios::app);
+		uint32_t length (1000);
+		file.write (reinterpret_cast<char const *> (&length), sizeof (length));
+		file.write ("abc", 3);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (2, store.vote_get (transaction, key1.pub)->sequence);
+	ASSERT_EQ (1, store.vote_get (transaction, key2.pub)->sequence);
+	// Opening compacted the log down to one record per account
+	ASSERT_LT (boost::filesystem::file_size (log), size);
+	auto vote3 (store.vote_generate (transaction, key1.pub, key1.prv, send1));
+	ASSERT_EQ (3, vote3->sequence);
+}
+
+// A length larger than the rest of the file ends the replay instead of being allocated
+TEST (vote_log, oversized_length)
+{
+	auto path (paper::unique_path ());
+	paper::keypair key1;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	{
+		paper::vote_log log (path);
+		log.append (std::vector<std::shared_ptr<paper::vote>>{ std::make_shared<paper::vote> (key1.pub, key1.prv, 1, send1) });
+	}
+	{
+		std::ofstream file (path.string (), std::ios::binary | std::ios::app);
+		uint32_t length (std::numeric_limits<uint32_t>::max ());
+		file.write (reinterpret_cast<char const *> (&length), sizeof (length));
+		file.write ("abc", 3);
+	}
+	paper::vote_log log (path);
+	std::unordered_map<paper::account, std::shared_ptr<paper::vote>> votes;
+	log.load (votes);
+	ASSERT_EQ (1, votes.size ());
+	ASSERT_EQ (1, log.records);
+	ASSERT_TRUE (log.damaged);
+}
+
+TEST (block_store, vote_log_compaction)
+{
+	auto path (paper::unique_path ());
+	paper::keypair key1;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	auto log (path.string () + "-votes");
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, false);
+		store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		store.vote_flush ();
+		store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		store.vote_flush ();
+	}
+	auto size (boost::filesystem::file_size (log));
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		// Two records for one account aren't worth rewriting
+		ASSERT_EQ (size, boost::filesystem::file_size (log));
+		ASSERT_EQ (2, store.votes.records);
+		paper::transaction transaction (store.environment, nullptr, false);
+		store.vote_generate (transaction, key1.pub, key1.prv, send1);
+		store.vote_flush ();
+		ASSERT_EQ (3, store.votes.records);
+	}
 	bool init (false);
 	paper::block_store store (init, path);
 	ASSERT_FALSE (init);
+	ASSERT_LT (boost::filesystem::file_size (log), size);
+	ASSERT_EQ (1, store.votes.records);
+	ASSERT_FALSE (boost::filesystem::exists (log + ".tmp"));
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (3, store.vote_get (transaction, key1.pub)->sequence);
+}
+
+TEST (block_store, vote_cache_max)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::genesis genesis;
 	paper::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	store.vote_cache_max = 1;
 	paper::keypair key1;
+	paper::keypair key2;
 	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
-	auto vote1 (store.vote_generate (transaction, key1.pub, key1.prv, send1));
-	auto seq2 (store.vote_get (transaction, vote1->account));
-	ASSERT_EQ (nullptr, seq2);
-	store.flush (transaction);
-	auto seq3 (store.vote_get (transaction, vote1->account));
-	ASSERT_EQ (*seq3, *vote1);
+	auto vote1 (std::make_shared<paper::vote> (key1.pub, key1.prv, 1, send1));
+	ASSERT_EQ (vote1, store.vote_max (transaction, vote1));
+	ASSERT_NE (nullptr, store.vote_get (transaction, key1.pub));
+	// Neither account has weight, the full cache keeps the vote it already has
+	auto vote2 (std::make_shared<paper::vote> (key2.pub, key2.prv, 1, send1));
+	ASSERT_EQ (nullptr, store.vote_max (transaction, vote2));
+	ASSERT_EQ (nullptr, store.vote_get (transaction, key2.pub));
+	// A vote that can't be recorded isn't counted as new
+	auto result1 (store.vote_validate (transaction, vote2));
+	ASSERT_EQ (paper::vote_code::replay, result1.code);
+	ASSERT_EQ (vote2, result1.vote);
+	// A representative pushes out accounts without weight
+	auto vote3 (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1));
+	ASSERT_EQ (vote3, store.vote_max (transaction, vote3));
+	ASSERT_EQ (nullptr, store.vote_get (transaction, key1.pub));
+	ASSERT_NE (nullptr, store.vote_get (transaction, paper::test_genesis_key.pub));
+	ASSERT_EQ (1, store.vote_dirty.size ());
+	ASSERT_TRUE (store.vote_cache_unweighted.empty ());
+	// Nothing left to evict, a full cache of representatives keeps what it has
+	store.representation_put (transaction, key2.pub, 1);
+	ASSERT_EQ (nullptr, store.vote_max (transaction, vote2));
+	ASSERT_EQ (nullptr, store.vote_get (transaction, key2.pub));
+	store.vote_flush ();
+}
+
+TEST (block_store, vote_cache_max_load)
+{
+	auto path (paper::unique_path ());
+	paper::genesis genesis;
+	paper::keypair key1;
+	paper::keypair key2;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_NE (nullptr, store.vote_max (transaction, std::make_shared<paper::vote> (key1.pub, key1.prv, 1, send1)));
+		ASSERT_NE (nullptr, store.vote_max (transaction, std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1)));
+		ASSERT_NE (nullptr, store.vote_max (transaction, std::make_shared<paper::vote> (key2.pub, key2.prv, 1, send1)));
+		store.vote_flush ();
+	}
+	// Reopened with room for one account, the representative's vote is the one kept
+	bool init (false);
+	paper::block_store store (init, path, 128, paper::block_store::unchecked_cache_max_default, paper::block_store::account_cache_max_default, paper::block_store::block_cache_max_default, 1);
+	ASSERT_FALSE (init);
+	ASSERT_EQ (1, store.vote_cache.size ());
+	ASSERT_TRUE (store.vote_cache_unweighted.empty ());
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_NE (nullptr, store.vote_get (transaction, paper::test_genesis_key.pub));
 }
 
 // Upgrading tracking block sequence numbers to whole vote.
@@ -986,3 +1524,361 @@ TEST (block_store, upgrade_v9_v10)
 	ASSERT_EQ (block_info.account, paper::test_genesis_key.pub);
 	ASSERT_EQ (block_info.balance.number (), paper::genesis_amount - paper::Gppr_ratio * 31);
 }
+
+TEST (block_store, upgrade_v10_v11)
+{
+	auto path (paper::unique_path ());
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.version_put (transaction, 10);
+		// Version 10 entries were keyed by the dependency alone
+		auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+		std::vector<uint8_t> vector;
+		{
+			paper::vectorstream stream (vector);
+			paper::serialize_block (stream, *send1);
+		}
+		ASSERT_EQ (0, mdb_put (transaction, store.unchecked, paper::mdb_val (send1->previous ()), paper::mdb_val (vector.size (), vector.data ()), 0));
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (10, store.version_get (transaction));
+	ASSERT_EQ (store.unchecked_end (), store.unchecked_begin (transaction));
+}
+
+TEST (block_store, upgrade_v11_v12)
+{
+	auto path (paper::unique_path ());
+	paper::send_block send1 (0, 1, 2, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	paper::change_block change1 (send1.hash (), 3, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		store.version_put (transaction, 11);
+		// Version 11 kept each block type in its own table with the successor appended
+		auto put_legacy ([&transaction](char const * name_a, paper::block const & block_a, paper::block_hash const & successor_a) {
+			MDB_dbi table;
+			ASSERT_EQ (0, mdb_dbi_open (transaction, name_a, MDB_CREATE, &table));
+			std::vector<uint8_t> vector;
+			{
+				paper::vectorstream stream (vector);
+				block_a.serialize (stream);
+				paper::write (stream, successor_a.bytes);
+			}
+			ASSERT_EQ (0, mdb_put (transaction, table, paper::mdb_val (block_a.hash ()), paper::mdb_val (vector.size (), vector.data ()), 0));
+		});
+		put_legacy ("send", send1, change1.hash ());
+		put_legacy ("change", change1, 0);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (11, store.version_get (transaction));
+	auto block1 (store.block_get (transaction, send1.hash ()));
+	ASSERT_NE (nullptr, block1);
+	ASSERT_EQ (send1, *block1);
+	ASSERT_EQ (change1.hash (), store.block_successor (transaction, send1.hash ()));
+	auto block2 (store.block_get (transaction, change1.hash ()));
+	ASSERT_NE (nullptr, block2);
+	ASSERT_EQ (change1, *block2);
+	auto counts (store.block_count (transaction));
+	ASSERT_EQ (1, counts.send);
+	ASSERT_EQ (1, counts.change);
+	ASSERT_EQ (2, counts.sum ());
+	MDB_dbi table;
+	ASSERT_EQ (MDB_NOTFOUND, mdb_dbi_open (transaction, "send", 0, &table));
+}
+
+TEST (block_store, ledger_export_import)
+{
+	bool init (false);
+	paper::block_store store1 (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::ledger ledger1 (store1);
+	paper::genesis genesis;
+	paper::keypair key2;
+	paper::send_block send (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	std::stringstream exported;
+	{
+		paper::transaction transaction (store1.environment, nullptr, true);
+		genesis.initialize (transaction, store1);
+		ASSERT_EQ (paper::process_result::progress, ledger1.process (transaction, send).code);
+		store1.ledger_export (transaction, exported);
+	}
+	paper::block_store store2 (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::ledger ledger2 (store2);
+	ASSERT_FALSE (store2.ledger_import (exported));
+	paper::transaction transaction1 (store1.environment, nullptr, false);
+	paper::transaction transaction2 (store2.environment, nullptr, false);
+	ASSERT_EQ (ledger1.latest (transaction1, paper::test_genesis_key.pub), ledger2.latest (transaction2, paper::test_genesis_key.pub));
+	ASSERT_EQ (*store1.block_get (transaction1, send.hash ()), *store2.block_get (transaction2, send.hash ()));
+	ASSERT_EQ (send.hash (), store2.block_successor (transaction2, genesis.hash ()));
+	paper::pending_info pending;
+	ASSERT_FALSE (store2.pending_get (transaction2, paper::pending_key (key2.pub, send.hash ()), pending));
+	ASSERT_EQ (100, pending.amount.number ());
+	ASSERT_EQ (paper::genesis_amount - 100, ledger2.weight (transaction2, paper::test_genesis_key.pub));
+	ASSERT_EQ (2, store2.block_count (transaction2).sum ());
+	ASSERT_EQ (ledger1.checksum (transaction1, 0, std::numeric_limits<paper::uint256_t>::max ()), ledger2.checksum (transaction2, 0, std::numeric_limits<paper::uint256_t>::max ()));
+}
+
+TEST (block_store, ledger_import_corrupt)
+{
+	bool init (false);
+	paper::block_store store1 (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::genesis genesis;
+	std::string exported;
+	{
+		paper::transaction transaction (store1.environment, nullptr, true);
+		genesis.initialize (transaction, store1);
+		std::stringstream stream;
+		store1.ledger_export (transaction, stream);
+		exported = stream.str ();
+	}
+	// One flipped bit fails its chunk checksum
+	auto corrupt (exported);
+	corrupt[corrupt.size () / 2] ^= 1;
+	{
+		paper::block_store store2 (init, paper::unique_path ());
+		ASSERT_FALSE (init);
+		std::stringstream stream (corrupt);
+		ASSERT_TRUE (store2.ledger_import (stream));
+	}
+	// A truncated file is missing its final checksum
+	{
+		paper::block_store store2 (init, paper::unique_path ());
+		ASSERT_FALSE (init);
+		std::stringstream stream (exported.substr (0, exported.size () - 1));
+		ASSERT_TRUE (store2.ledger_import (stream));
+	}
+	// A chunk size past the end of the file is rejected before it's read
+	{
+		auto oversized (exported);
+		uint32_t size (std::numeric_limits<uint32_t>::max ());
+		// Payload size of the first chunk follows the file header, table and entry count
+		std::memcpy (&oversized[4 + 1 + 4 + 1 + 4], &size, sizeof (size));
+		paper::block_store store2 (init, paper::unique_path ());
+		ASSERT_FALSE (init);
+		std::stringstream stream (oversized);
+		ASSERT_TRUE (store2.ledger_import (stream));
+	}
+	// Imports only go in to a store without a ledger
+	{
+		std::stringstream stream (exported);
+		ASSERT_TRUE (store1.ledger_import (stream));
+	}
+}
+
+TEST (block_store, ledger_import_checksum)
+{
+	bool init (false);
+	paper::block_store store1 (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::genesis genesis;
+	std::stringstream exported;
+	{
+		paper::transaction transaction (store1.environment, nullptr, true);
+		genesis.initialize (transaction, store1);
+		// An export whose chunks are intact but whose ledger doesn't add up to its checksum
+		store1.checksum_put (transaction, 0, 0, 1);
+		store1.ledger_export (transaction, exported);
+	}
+	paper::block_store store2 (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	ASSERT_TRUE (store2.ledger_import (exported));
+}
+
+TEST (block_store, upgrade_v12_v13)
+{
+	auto path (paper::unique_path ());
+	paper::genesis genesis;
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		// Version 12 stores had their checksum zeroed on every open
+		store.checksum_put (transaction, 0, 0, 0);
+		store.version_put (transaction, 12);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (12, store.version_get (transaction));
+	paper::checksum checksum;
+	ASSERT_FALSE (store.checksum_get (transaction, 0, 0, checksum));
+	ASSERT_EQ (genesis.hash (), checksum);
+}
+
+TEST (block_store, upgrade_v14_v15)
+{
+	auto path (paper::unique_path ());
+	paper::keypair key1;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	auto vote1 (std::make_shared<paper::vote> (key1.pub, key1.prv, 7, send1));
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		std::vector<uint8_t> vector;
+		{
+			paper::vectorstream stream (vector);
+			vote1->serialize (stream);
+		}
+		ASSERT_EQ (0, mdb_put (transaction, store.vote, paper::mdb_val (key1.pub), paper::mdb_val (vector.size (), vector.data ()), 0));
+		store.version_put (transaction, 14);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (14, store.version_get (transaction));
+	auto vote2 (store.vote_get (transaction, key1.pub));
+	ASSERT_NE (nullptr, vote2);
+	ASSERT_EQ (*vote1, *vote2);
+	paper::store_iterator i (transaction, store.vote);
+	ASSERT_EQ (paper::store_iterator (nullptr), i);
+	// The moved votes were written to the log before the table was dropped
+	paper::vote_log log (store.votes.path);
+	std::unordered_map<paper::account, std::shared_ptr<paper::vote>> votes;
+	log.load (votes);
+	ASSERT_EQ (1, votes.size ());
+	ASSERT_EQ (*vote1, *votes[key1.pub]);
+}
+
+TEST (block_store, upgrade_v14_v15_log_failure)
+{
+	auto path (paper::unique_path ());
+	paper::genesis genesis;
+	paper::keypair key1;
+	auto send1 (std::make_shared<paper::send_block> (0, 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	auto vote1 (std::make_shared<paper::vote> (key1.pub, key1.prv, 7, send1));
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, true);
+		std::vector<uint8_t> vector;
+		{
+			paper::vectorstream stream (vector);
+			vote1->serialize (stream);
+		}
+		ASSERT_EQ (0, mdb_put (transaction, store.vote, paper::mdb_val (key1.pub), paper::mdb_val (vector.size (), vector.data ()), 0));
+		genesis.initialize (transaction, store);
+		// Version 14 stores only index heights by account
+		ASSERT_EQ (0, mdb_drop (transaction, store.block_heights, 0));
+		store.version_put (transaction, 14);
+	}
+	// A directory where the rewrite's temporary file goes makes writing the log fail
+	boost::filesystem::create_directory (path.string () + "-votes.tmp");
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::transaction transaction (store.environment, nullptr, false);
+		ASSERT_EQ (14, store.version_get (transaction));
+		paper::store_iterator i (transaction, store.vote);
+		ASSERT_NE (paper::store_iterator (nullptr), i);
+		// The block height index doesn't wait for the vote table to move
+		ASSERT_EQ (1, store.block_height (transaction, genesis.hash ()));
+	}
+	boost::filesystem::remove (path.string () + "-votes.tmp");
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (14, store.version_get (transaction));
+	auto vote2 (store.vote_get (transaction, key1.pub));
+	ASSERT_NE (nullptr, vote2);
+	ASSERT_EQ (*vote1, *vote2);
+	ASSERT_EQ (1, store.block_height (transaction, genesis.hash ()));
+}
+
+TEST (block_store, upgrade_v13_v14)
+{
+	auto path (paper::unique_path ());
+	paper::genesis genesis;
+	paper::keypair key1;
+	paper::send_block send1 (genesis.hash (), key1.pub, paper::genesis_amount - 50, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	paper::send_block send2 (send1.hash (), key1.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::ledger ledger (store);
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send2).code);
+		// Version 13 stores have no height index
+		ASSERT_EQ (0, mdb_drop (transaction, store.heights, 0));
+		store.version_put (transaction, 13);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (13, store.version_get (transaction));
+	ASSERT_EQ (genesis.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 1));
+	ASSERT_EQ (send1.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 2));
+	ASSERT_EQ (send2.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 3));
+	ASSERT_TRUE (store.height_get (transaction, paper::test_genesis_key.pub, 4).is_zero ());
+}
+
+TEST (block_store, upgrade_v15_v16)
+{
+	auto path (paper::unique_path ());
+	paper::genesis genesis;
+	paper::keypair key1;
+	paper::send_block send1 (genesis.hash (), key1.pub, paper::genesis_amount - 50, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	{
+		bool init (false);
+		paper::block_store store (init, path);
+		ASSERT_FALSE (init);
+		paper::ledger ledger (store);
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+		// Version 15 stores only index heights by account
+		ASSERT_EQ (0, mdb_drop (transaction, store.block_heights, 0));
+		store.version_put (transaction, 15);
+	}
+	bool init (false);
+	paper::block_store store (init, path);
+	ASSERT_FALSE (init);
+	paper::transaction transaction (store.environment, nullptr, false);
+	ASSERT_EQ (16, store.version_get (transaction));
+	ASSERT_EQ (1, store.block_height (transaction, genesis.hash ()));
+	ASSERT_EQ (2, store.block_height (transaction, send1.hash ()));
+	ASSERT_EQ (0, store.block_height (transaction, key1.pub));
+}
+
+TEST (block_store, block_height_rollback)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_FALSE (init);
+	paper::ledger ledger (store);
+	paper::genesis genesis;
+	paper::keypair key1;
+	paper::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	paper::send_block send1 (genesis.hash (), key1.pub, paper::genesis_amount - 50, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+	ASSERT_EQ (2, store.block_height (transaction, send1.hash ()));
+	ledger.rollback (transaction, send1.hash ());
+	ASSERT_EQ (0, store.block_height (transaction, send1.hash ()));
+	ASSERT_EQ (1, store.block_height (transaction, genesis.hash ()));
+}
@@ -9,17 +9,15 @@ TEST (conflicts, start_stop)
 	paper::keypair key1;
 	auto send1 (std::make_shared<paper::send_block> (genesis.hash (), key1.pub, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
 	ASSERT_EQ (paper::process_result::progress, node1.process (*send1).code);
-	ASSERT_EQ (0, node1.active.roots.size ());
+	ASSERT_EQ (0, node1.active.size ());
 	auto node_l (system.nodes[0]);
 	{
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send1);
 	}
-	ASSERT_EQ (1, node1.active.roots.size ());
+	ASSERT_EQ (1, node1.active.size ());
 	auto root1 (send1->root ());
-	auto existing1 (node1.active.roots.find (root1));
-	ASSERT_NE (node1.active.roots.end (), existing1);
-	auto votes1 (existing1->election);
+	auto votes1 (node1.active.election (root1));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 }
@@ -43,11 +41,11 @@ TEST (conflicts, add_existing)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send2);
 	}
-	ASSERT_EQ (1, node1.active.roots.size ());
+	ASSERT_EQ (1, node1.active.size ());
 	auto vote1 (std::make_shared<paper::vote> (key2.pub, key2.prv, 0, send2));
 	node1.active.vote (vote1);
-	ASSERT_EQ (1, node1.active.roots.size ());
-	auto votes1 (node1.active.roots.find (send2->root ())->election);
+	ASSERT_EQ (1, node1.active.size ());
+	auto votes1 (node1.active.election (send2->root ()));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (2, votes1->votes.rep_votes.size ());
 	ASSERT_NE (votes1->votes.rep_votes.end (), votes1->votes.rep_votes.find (key2.pub));
@@ -73,5 +71,79 @@ TEST (conflicts, add_two)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send2);
 	}
-	ASSERT_EQ (2, node1.active.roots.size ());
+	ASSERT_EQ (2, node1.active.size ());
+}
+
+TEST (conflicts, shard_order)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::block_hash low (0);
+	paper::block_hash high (0);
+	high.bytes[0] = 0xff;
+	ASSERT_EQ (&node1.active.shards.front (), &node1.active.shard (low));
+	ASSERT_EQ (&node1.active.shards.back (), &node1.active.shard (high));
+	// Chain sends until the roots land in more than one shard
+	std::vector<std::shared_ptr<paper::block>> blocks;
+	std::unordered_set<paper::active_shard *> used;
+	paper::block_hash previous (paper::genesis ().hash ());
+	while (used.size () < 2)
+	{
+		auto send (std::make_shared<paper::send_block> (previous, 0, paper::genesis_amount - blocks.size () - 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+		ASSERT_EQ (paper::process_result::progress, node1.process (*send).code);
+		{
+			paper::transaction transaction (node1.store.environment, nullptr, true);
+			ASSERT_FALSE (node1.active.start (transaction, send));
+		}
+		used.insert (&node1.active.shard (send->root ()));
+		blocks.push_back (send);
+		previous = send->hash ();
+	}
+	ASSERT_EQ (blocks.size (), node1.active.size ());
+	auto elections (node1.active.elections ());
+	ASSERT_EQ (blocks.size (), elections.size ());
+	for (size_t i (1); i < elections.size (); ++i)
+	{
+		ASSERT_LT (elections[i - 1]->votes.id, elections[i]->votes.id);
+	}
+	for (auto & i : blocks)
+	{
+		ASSERT_TRUE (node1.active.active (*i));
+	}
+}
+
+TEST (conflicts, announce_all)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	// More elections than announcements_per_interval, spread over the shards
+	std::vector<std::shared_ptr<paper::block>> blocks;
+	paper::block_hash previous (paper::genesis ().hash ());
+	while (blocks.size () < paper::active_transactions::announcements_per_interval + 8)
+	{
+		auto send (std::make_shared<paper::send_block> (previous, 0, paper::genesis_amount - blocks.size () - 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+		ASSERT_EQ (paper::process_result::progress, node1.process (*send).code);
+		{
+			paper::transaction transaction (node1.store.environment, nullptr, true);
+			ASSERT_FALSE (node1.active.start (transaction, send));
+		}
+		blocks.push_back (send);
+		previous = send->hash ();
+	}
+	node1.active.announce_votes ();
+	std::vector<unsigned> announcements;
+	for (auto & shard : node1.active.shards)
+	{
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		for (auto & i : shard.roots)
+		{
+			announcements.push_back (i.announcements);
+		}
+	}
+	ASSERT_EQ (blocks.size (), announcements.size ());
+	// Every election is announced each sweep, so none of them loses its count towards confirm_cutoff
+	for (auto i : announcements)
+	{
+		ASSERT_EQ (1, i);
+	}
 }
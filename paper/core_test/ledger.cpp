@@ -731,7 +731,7 @@ TEST (votes, add_one)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send1);
 	}
-	auto votes1 (node1.active.roots.find (send1->root ())->election);
+	auto votes1 (node1.active.election (send1->root ()));
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 	auto vote1 (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1));
 	votes1->vote (vote1);
@@ -763,7 +763,7 @@ TEST (votes, add_two)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send1);
 	}
-	auto votes1 (node1.active.roots.find (send1->root ())->election);
+	auto votes1 (node1.active.election (send1->root ()));
 	auto vote1 (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1));
 	votes1->vote (vote1);
 	paper::keypair key2;
@@ -797,7 +797,7 @@ TEST (votes, add_existing)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send1);
 	}
-	auto votes1 (node1.active.roots.find (send1->root ())->election);
+	auto votes1 (node1.active.election (send1->root ()));
 	auto vote1 (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1));
 	votes1->vote (vote1);
 	paper::keypair key2;
@@ -829,7 +829,7 @@ TEST (votes, add_old)
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		node1.active.start (transaction, send1);
 	}
-	auto votes1 (node1.active.roots.find (send1->root ())->election);
+	auto votes1 (node1.active.election (send1->root ()));
 	auto vote1 (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 2, send1));
 	node1.vote_processor.vote (vote1, paper::endpoint ());
 	paper::keypair key2;
@@ -844,6 +844,50 @@ TEST (votes, add_old)
 	ASSERT_EQ (*send1, *winner.second);
 }
 
+// The running tally in an election matches a full recount through new votes and changed votes
+TEST (votes, tally_incremental)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::genesis genesis;
+	paper::keypair key1;
+	auto send1 (std::make_shared<paper::send_block> (genesis.hash (), key1.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	{
+		paper::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, *send1).code);
+		node1.active.start (transaction, send1);
+	}
+	auto votes1 (node1.active.election (send1->root ()));
+	auto compare ([&node1, &votes1]() {
+		paper::transaction transaction (node1.store.environment, nullptr, false);
+		auto expected (node1.ledger.tally (transaction, votes1->votes));
+		auto actual (votes1->tally ());
+		ASSERT_EQ (expected.size (), actual.size ());
+		for (auto i (expected.begin ()), j (actual.begin ()), n (expected.end ()); i != n; ++i, ++j)
+		{
+			ASSERT_EQ (i->first, j->first);
+			ASSERT_EQ (*i->second, *j->second);
+		}
+	});
+	compare ();
+	votes1->vote (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 1, send1));
+	compare ();
+	paper::keypair key2;
+	auto send2 (std::make_shared<paper::send_block> (genesis.hash (), key2.pub, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	votes1->vote (std::make_shared<paper::vote> (key2.pub, key2.prv, 1, send2));
+	compare ();
+	ASSERT_EQ (2, votes1->totals.size ());
+	votes1->vote (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 2, send2));
+	compare ();
+	ASSERT_EQ (paper::genesis_amount - 100, votes1->tally ().begin ()->first);
+	ASSERT_EQ (*send2, *votes1->tally ().begin ()->second);
+	// Moving back to the first block leaves the second with only the zero weight representative
+	votes1->vote (std::make_shared<paper::vote> (paper::test_genesis_key.pub, paper::test_genesis_key.prv, 3, send1));
+	compare ();
+	ASSERT_EQ (2, votes1->totals.size ());
+	ASSERT_EQ (0, votes1->totals[send2->hash ()].weight);
+}
+
 // Query for block successor
 TEST (ledger, successor)
 {
@@ -1454,3 +1498,99 @@ TEST (ledger, bootstrap_rep_weight)
 		ASSERT_EQ (0, ledger.weight (transaction, key2.pub));
 	}
 }
+
+TEST (ledger, heights)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::ledger ledger (store, 0);
+	paper::transaction transaction (store.environment, nullptr, true);
+	paper::genesis genesis;
+	genesis.initialize (transaction, store);
+	ASSERT_EQ (genesis.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 1));
+	paper::keypair key1;
+	paper::send_block send1 (genesis.hash (), key1.pub, paper::genesis_amount - 50, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+	paper::change_block change1 (send1.hash (), key1.pub, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+	ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, change1).code);
+	paper::open_block open (send1.hash (), key1.pub, key1.pub, key1.prv, key1.pub, 0);
+	ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, open).code);
+	ASSERT_EQ (send1.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 2));
+	ASSERT_EQ (change1.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 3));
+	ASSERT_TRUE (store.height_get (transaction, paper::test_genesis_key.pub, 4).is_zero ());
+	ASSERT_EQ (open.hash (), store.height_get (transaction, key1.pub, 1));
+	std::vector<paper::block_hash> chain;
+	for (auto i (store.height_begin (transaction, paper::test_genesis_key.pub, 1)), n (store.height_end ()); i != n && paper::height_key (i->first).account == paper::test_genesis_key.pub; ++i)
+	{
+		ASSERT_EQ (chain.size () + 1, paper::height_key (i->first).height ());
+		chain.push_back (i->second.uint256 ());
+	}
+	ASSERT_EQ (std::vector<paper::block_hash> ({ genesis.hash (), send1.hash (), change1.hash () }), chain);
+	// Rolling back the send takes the open and the change above it with it
+	ledger.rollback (transaction, send1.hash ());
+	ASSERT_EQ (genesis.hash (), store.height_get (transaction, paper::test_genesis_key.pub, 1));
+	ASSERT_TRUE (store.height_get (transaction, paper::test_genesis_key.pub, 2).is_zero ());
+	ASSERT_TRUE (store.height_get (transaction, paper::test_genesis_key.pub, 3).is_zero ());
+	ASSERT_TRUE (store.height_get (transaction, key1.pub, 1).is_zero ());
+}
+
+TEST (ledger_validator, consistent)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::ledger ledger (store);
+	paper::genesis genesis;
+	paper::work_pool pool (std::numeric_limits<unsigned>::max (), nullptr);
+	paper::keypair key2;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, pool.generate (genesis.hash ()));
+	paper::send_block send2 (send1.hash (), key2.pub, paper::genesis_amount - 300, paper::test_genesis_key.prv, paper::test_genesis_key.pub, pool.generate (send1.hash ()));
+	paper::open_block open (send1.hash (), key2.pub, key2.pub, key2.prv, key2.pub, pool.generate (key2.pub));
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send2).code);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, open).code);
+	}
+	paper::ledger_validator validator (ledger);
+	ASSERT_FALSE (validator.validate (2));
+	ASSERT_EQ (0, validator.error_count);
+	ASSERT_EQ (2, validator.accounts);
+	ASSERT_EQ (4, validator.blocks);
+	ASSERT_EQ (1, validator.pending);
+}
+
+TEST (ledger_validator, corrupt)
+{
+	bool init (false);
+	paper::block_store store (init, paper::unique_path ());
+	ASSERT_TRUE (!init);
+	paper::ledger ledger (store);
+	paper::genesis genesis;
+	paper::work_pool pool (std::numeric_limits<unsigned>::max (), nullptr);
+	paper::keypair key2;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, pool.generate (genesis.hash ()));
+	{
+		paper::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_EQ (paper::process_result::progress, ledger.process (transaction, send1).code);
+		// Wrong balance on the account and a weight that doesn't add up
+		paper::account_info info;
+		ASSERT_FALSE (store.account_get (transaction, paper::test_genesis_key.pub, info));
+		info.balance = info.balance.number () - 1;
+		store.account_put (transaction, paper::test_genesis_key.pub, info);
+		store.representation_put (transaction, key2.pub, 5);
+		// Signature no longer matches the block contents
+		auto bad (send1);
+		bad.signature.bytes[0] ^= 1;
+		store.block_put (transaction, bad.hash (), bad);
+		store.height_del (transaction, paper::test_genesis_key.pub, 2);
+	}
+	paper::ledger_validator validator (ledger);
+	ASSERT_TRUE (validator.validate (2));
+	// Balance, genesis representative weight, key2 weight, the signature and the missing height
+	ASSERT_EQ (5, validator.error_count);
+	ASSERT_EQ (validator.error_count, validator.errors.size ());
+}
@@ -54,8 +54,8 @@ TEST (message, publish_serialization)
 	ASSERT_EQ (8, bytes.size ());
 	ASSERT_EQ (0x52, bytes[0]);
 	ASSERT_EQ (0x41, bytes[1]);
-	ASSERT_EQ (0x06, bytes[2]);
-	ASSERT_EQ (0x06, bytes[3]);
+	ASSERT_EQ (0x07, bytes[2]);
+	ASSERT_EQ (0x07, bytes[3]);
 	ASSERT_EQ (0x01, bytes[4]);
 	ASSERT_EQ (static_cast<uint8_t> (paper::message_type::publish), bytes[5]);
 	ASSERT_EQ (0x02, bytes[6]);
@@ -68,8 +68,8 @@ TEST (message, publish_serialization)
 	std::bitset<16> extensions;
 	ASSERT_FALSE (paper::message::read_header (stream, version_max, version_using, version_min, type, extensions));
 	ASSERT_EQ (0x01, version_min);
-	ASSERT_EQ (0x06, version_using);
-	ASSERT_EQ (0x06, version_max);
+	ASSERT_EQ (0x07, version_using);
+	ASSERT_EQ (0x07, version_max);
 	ASSERT_EQ (paper::message_type::publish, type);
 }
 
@@ -89,3 +89,33 @@ TEST (message, confirm_ack_serialization)
 	ASSERT_FALSE (error);
 	ASSERT_EQ (con1, con2);
 }
+
+TEST (message, bulk_pull_blocks_heights_serialization)
+{
+	paper::bulk_pull_blocks request1;
+	request1.min_hash = 1;
+	request1.mode = paper::bulk_pull_blocks_mode::list_chain_heights;
+	request1.max_count = 0;
+	request1.min_height = 2;
+	request1.max_height = 3;
+	std::vector<uint8_t> bytes;
+	{
+		paper::vectorstream stream (bytes);
+		request1.serialize (stream);
+	}
+	// Heights follow the fixed fields only for list_chain_heights
+	ASSERT_EQ (8 + 32 + 32 + 1 + 4 + 8 + 8, bytes.size ());
+	paper::bulk_pull_blocks request2;
+	paper::bufferstream stream (bytes.data (), bytes.size ());
+	ASSERT_FALSE (request2.deserialize (stream));
+	ASSERT_EQ (request1.min_hash, request2.min_hash);
+	ASSERT_EQ (2, request2.min_height);
+	ASSERT_EQ (3, request2.max_height);
+	request1.mode = paper::bulk_pull_blocks_mode::list_chains;
+	bytes.clear ();
+	{
+		paper::vectorstream stream (bytes);
+		request1.serialize (stream);
+	}
+	ASSERT_EQ (8 + 32 + 32 + 1 + 4, bytes.size ());
+}
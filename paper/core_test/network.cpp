@@ -52,12 +52,60 @@ TEST (network, construction)
 TEST (network, self_discard)
 {
 	paper::system system (24000, 1);
-	system.nodes[0]->network.remote = system.nodes[0]->network.endpoint ();
+	paper::datagram datagram;
+	datagram.remote = system.nodes[0]->network.endpoint ();
+	datagram.size = 0;
 	ASSERT_EQ (0, system.nodes[0]->network.bad_sender_count);
-	system.nodes[0]->network.receive_action (boost::system::error_code{}, 0);
+	system.nodes[0]->network.process_datagrams (std::vector<paper::datagram *>{ &datagram });
 	ASSERT_EQ (1, system.nodes[0]->network.bad_sender_count);
 }
 
+TEST (datagram_ring, cycle)
+{
+	paper::datagram_ring ring (4);
+	std::vector<paper::datagram *> datagrams;
+	ring.allocate (datagrams, 3);
+	ASSERT_EQ (3, datagrams.size ());
+	std::vector<paper::datagram *> rest;
+	ring.allocate (rest, 3);
+	ASSERT_EQ (1, rest.size ());
+	ring.enqueue (datagrams);
+	std::vector<paper::datagram *> received;
+	ASSERT_TRUE (ring.dequeue (received, 2));
+	ASSERT_EQ (2, received.size ());
+	ASSERT_EQ (datagrams[0], received[0]);
+	ring.release (received);
+	ring.release (rest);
+	ring.stop ();
+	received.clear ();
+	ASSERT_TRUE (ring.dequeue (received, 2));
+	ASSERT_EQ (1, received.size ());
+	ASSERT_EQ (datagrams[2], received[0]);
+	received.clear ();
+	ASSERT_FALSE (ring.dequeue (received, 2));
+}
+
+TEST (datagram_ring, resume_when_released)
+{
+	paper::datagram_ring ring (1);
+	auto resumed (0);
+	ring.available = [&resumed]() { ++resumed; };
+	std::vector<paper::datagram *> datagrams;
+	ring.allocate (datagrams, 1);
+	ASSERT_EQ (1, datagrams.size ());
+	std::vector<paper::datagram *> none;
+	ring.allocate (none, 1);
+	ASSERT_TRUE (none.empty ());
+	ASSERT_EQ (0, resumed);
+	ring.release (datagrams);
+	ASSERT_EQ (1, resumed);
+	// Only a reader that found the ring empty is woken
+	datagrams.clear ();
+	ring.allocate (datagrams, 1);
+	ring.release (datagrams);
+	ASSERT_EQ (1, resumed);
+}
+
 TEST (network, send_keepalive)
 {
 	paper::system system (24000, 1);
@@ -257,6 +305,105 @@ TEST (network, send_insufficient_work)
 	ASSERT_EQ (1, system.nodes[1]->network.insufficient_work_count);
 }
 
+TEST (network, send_insufficient_work_burst)
+{
+	paper::system system (24000, 2);
+	auto node1 (system.nodes[1]->shared ());
+	auto send (system.nodes[0]);
+	auto publish_send = [&system, send, node1](paper::block_hash const & previous_a, uint64_t work_a) {
+		paper::publish publish (std::unique_ptr<paper::block> (new paper::send_block (previous_a, 1, 20, paper::test_genesis_key.prv, paper::test_genesis_key.pub, work_a)));
+		std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+		{
+			paper::vectorstream stream (*bytes);
+			publish.serialize (stream);
+		}
+		send->network.send_buffer (bytes->data (), bytes->size (), node1->network.endpoint (), [bytes](boost::system::error_code const & ec, size_t size) {});
+	};
+	for (auto i (1); i <= 10; ++i)
+	{
+		publish_send (i, 0);
+	}
+	paper::block_hash previous (11);
+	publish_send (previous, system.work.generate (previous));
+	auto iterations (0);
+	while (node1->network.insufficient_work_count < 10 || node1->network.incoming.publish == 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ (10, node1->network.insufficient_work_count);
+	ASSERT_EQ (1, node1->network.incoming.publish);
+}
+
+TEST (network, send_coalesce)
+{
+	paper::system system (24000, 2);
+	auto node1 (system.nodes[1]->shared ());
+	auto send (system.nodes[0]);
+	auto callbacks (0);
+	auto publish_send = [send, node1, &callbacks]() {
+		paper::publish publish (std::unique_ptr<paper::block> (new paper::send_block (1, 1, 20, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0)));
+		std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+		{
+			paper::vectorstream stream (*bytes);
+			publish.serialize (stream);
+		}
+		send->network.send_buffer (bytes->data (), bytes->size (), node1->network.endpoint (), [bytes, &callbacks](boost::system::error_code const & ec, size_t size) {
+			ASSERT_FALSE (ec);
+			ASSERT_EQ (bytes->size (), size);
+			++callbacks;
+		});
+		return bytes->size ();
+	};
+	auto bytes_before (send->network.send_bytes.publish.load ());
+	auto size (publish_send ());
+	publish_send ();
+	ASSERT_EQ (1, send->network.send_queued.publish);
+	auto iterations (0);
+	while (callbacks < 2 || node1->network.insufficient_work_count == 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ (0, send->network.send_queued.publish);
+	ASSERT_EQ (bytes_before + size, send->network.send_bytes.publish);
+	ASSERT_EQ (0, send->network.send_dropped.publish);
+	ASSERT_EQ (1, node1->network.insufficient_work_count);
+}
+
+TEST (network, send_abort_on_stop)
+{
+	paper::system system (24000, 2);
+	auto node1 (system.nodes[1]);
+	auto send (system.nodes[0]);
+	paper::keepalive message;
+	std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+	{
+		paper::vectorstream stream (*bytes);
+		message.serialize (stream);
+	}
+	// The callback holds the destination node, stopping the sender must release it
+	boost::system::error_code result;
+	send->network.send_buffer (bytes->data (), bytes->size (), node1->network.endpoint (), [bytes, node1, &result](boost::system::error_code const & ec, size_t) {
+		result = ec;
+	});
+	ASSERT_TRUE (send->network.send_flushing);
+	ASSERT_NE (0, send->network.send_queued.keepalive);
+	send->network.stop ();
+	ASSERT_EQ (boost::asio::error::operation_aborted, result);
+	ASSERT_FALSE (send->network.send_flushing);
+	ASSERT_TRUE (send->network.send_queue.empty ());
+	ASSERT_EQ (0, send->network.send_queued.keepalive);
+	result = boost::system::error_code ();
+	send->network.send_buffer (bytes->data (), bytes->size (), node1->network.endpoint (), [&result](boost::system::error_code const & ec, size_t) {
+		result = ec;
+	});
+	ASSERT_EQ (boost::asio::error::operation_aborted, result);
+	ASSERT_TRUE (send->network.send_queue.empty ());
+}
+
 TEST (receivable_processor, confirm_insufficient_pos)
 {
 	paper::system system (24000, 1);
@@ -465,7 +612,7 @@ TEST (bulk_pull, none)
 	connection->requests.push (std::unique_ptr<paper::message>{});
 	auto request (std::make_shared<paper::bulk_pull_server> (connection, std::move (req)));
 	auto block (request->get_next ());
-	ASSERT_EQ (nullptr, block);
+	ASSERT_TRUE (block.empty ());
 }
 
 TEST (bulk_pull, get_next_on_open)
@@ -478,12 +625,277 @@ TEST (bulk_pull, get_next_on_open)
 	connection->requests.push (std::unique_ptr<paper::message>{});
 	auto request (std::make_shared<paper::bulk_pull_server> (connection, std::move (req)));
 	auto block (request->get_next ());
-	ASSERT_NE (nullptr, block);
-	ASSERT_TRUE (block->previous ().is_zero ());
+	ASSERT_FALSE (block.empty ());
+	ASSERT_TRUE (block.previous ().is_zero ());
 	ASSERT_FALSE (connection->requests.empty ());
 	ASSERT_EQ (request->current, request->request->end);
 }
 
+TEST (bulk_pull, get_next_batch)
+{
+	paper::system system (24000, 1);
+	paper::keypair key2;
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	auto connection (std::make_shared<paper::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<paper::bulk_pull> req (new paper::bulk_pull{});
+	req->start = paper::test_genesis_key.pub;
+	req->end.clear ();
+	connection->requests.push (std::unique_ptr<paper::message>{});
+	auto request (std::make_shared<paper::bulk_pull_server> (connection, std::move (req)));
+	ASSERT_EQ (nullptr, request->transaction);
+	auto block1 (request->get_next ());
+	ASSERT_FALSE (block1.empty ());
+	// One read transaction serves the rest of the batch
+	ASSERT_NE (nullptr, request->transaction);
+	MDB_txn * transaction (*request->transaction);
+	auto block2 (request->get_next ());
+	ASSERT_FALSE (block2.empty ());
+	ASSERT_EQ (block1.previous (), block2.hash ());
+	auto block3 (request->get_next ());
+	ASSERT_FALSE (block3.empty ());
+	ASSERT_TRUE (block3.previous ().is_zero ());
+	ASSERT_EQ (transaction, static_cast<MDB_txn *> (*request->transaction));
+	ASSERT_TRUE (request->get_next ().empty ());
+}
+
+TEST (bulk_pull_blocks, list_range)
+{
+	paper::system system (24000, 1);
+	paper::keypair key2;
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	auto connection (std::make_shared<paper::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<paper::bulk_pull_blocks> req (new paper::bulk_pull_blocks{});
+	req->min_hash.clear ();
+	req->max_hash = std::numeric_limits<paper::uint256_t>::max ();
+	req->mode = paper::bulk_pull_blocks_mode::list_blocks;
+	req->max_count = 0;
+	connection->requests.push (std::unique_ptr<paper::message>{});
+	auto request (std::make_shared<paper::bulk_pull_blocks_server> (connection, std::move (req)));
+	std::vector<paper::block_hash> hashes;
+	for (auto block (request->get_next ()); !block.empty (); block = request->get_next ())
+	{
+		hashes.push_back (block.hash ());
+	}
+	// Every block in the ledger, in hash order
+	ASSERT_EQ (3, hashes.size ());
+	ASSERT_TRUE (std::is_sorted (hashes.begin (), hashes.end ()));
+	paper::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
+	for (auto & i : hashes)
+	{
+		ASSERT_TRUE (system.nodes[0]->store.block_exists (transaction, i));
+	}
+}
+
+TEST (bulk_pull_blocks, list_chains)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key2;
+	paper::genesis genesis;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	paper::open_block open (send1.hash (), key2.pub, key2.pub, key2.prv, key2.pub, system.work.generate (key2.pub));
+	paper::send_block send2 (open.hash (), paper::test_genesis_key.pub, 0, key2.prv, key2.pub, system.work.generate (open.hash ()));
+	{
+		paper::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, send1).code);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, open).code);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, send2).code);
+	}
+	auto connection (std::make_shared<paper::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<paper::bulk_pull_blocks> req (new paper::bulk_pull_blocks{});
+	req->min_hash.clear ();
+	req->max_hash = std::numeric_limits<paper::uint256_t>::max ();
+	req->mode = paper::bulk_pull_blocks_mode::list_chains;
+	req->max_count = 0;
+	connection->requests.push (std::unique_ptr<paper::message>{});
+	auto request (std::make_shared<paper::bulk_pull_blocks_server> (connection, std::move (req)));
+	paper::transaction transaction (node1.store.environment, nullptr, false);
+	std::vector<paper::account> accounts;
+	paper::block_hash previous (0);
+	auto count (0);
+	for (auto block (request->get_next ()); !block.empty (); block = request->get_next ())
+	{
+		// Each chain starts at its open block and continues in height order
+		if (block.previous ().is_zero ())
+		{
+			accounts.push_back (node1.ledger.account (transaction, block.hash ()));
+		}
+		else
+		{
+			ASSERT_EQ (previous, block.previous ());
+		}
+		previous = block.hash ();
+		++count;
+	}
+	ASSERT_EQ (4, count);
+	ASSERT_EQ (2, accounts.size ());
+	ASSERT_TRUE (std::is_sorted (accounts.begin (), accounts.end ()));
+}
+
+TEST (bulk_pull_blocks, list_chain_heights)
+{
+	paper::system system (24000, 1);
+	paper::keypair key2;
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	auto send1 (system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, send1);
+	auto send2 (system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, send2);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	auto connection (std::make_shared<paper::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<paper::bulk_pull_blocks> req (new paper::bulk_pull_blocks{});
+	req->min_hash = paper::test_genesis_key.pub;
+	req->min_height = 2;
+	req->max_height = 4;
+	req->mode = paper::bulk_pull_blocks_mode::list_chain_heights;
+	req->max_count = 0;
+	connection->requests.push (std::unique_ptr<paper::message>{});
+	auto request (std::make_shared<paper::bulk_pull_blocks_server> (connection, std::move (req)));
+	auto block1 (request->get_next ());
+	ASSERT_FALSE (block1.empty ());
+	ASSERT_EQ (send1->hash (), block1.hash ());
+	auto block2 (request->get_next ());
+	ASSERT_FALSE (block2.empty ());
+	ASSERT_EQ (send2->hash (), block2.hash ());
+	ASSERT_TRUE (request->get_next ().empty ());
+}
+
+// Chain modes send the blocks themselves over the socket, not just a terminator
+TEST (bulk_pull_blocks, send_chains)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key2;
+	paper::genesis genesis;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	paper::open_block open (send1.hash (), key2.pub, key2.pub, key2.prv, key2.pub, system.work.generate (key2.pub));
+	paper::send_block send2 (open.hash (), paper::test_genesis_key.pub, 0, key2.prv, key2.pub, system.work.generate (open.hash ()));
+	{
+		paper::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, send1).code);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, open).code);
+		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, send2).code);
+	}
+	boost::asio::ip::tcp::acceptor acceptor (system.service);
+	boost::asio::ip::tcp::endpoint endpoint (boost::asio::ip::address_v4::loopback (), 24100);
+	acceptor.open (endpoint.protocol ());
+	acceptor.set_option (boost::asio::ip::tcp::acceptor::reuse_address (true));
+	acceptor.bind (endpoint);
+	acceptor.listen ();
+	auto modes = { paper::bulk_pull_blocks_mode::list_chains, paper::bulk_pull_blocks_mode::list_chain_heights };
+	for (auto mode : modes)
+	{
+		auto incoming (std::make_shared<boost::asio::ip::tcp::socket> (system.service));
+		boost::asio::ip::tcp::socket client (system.service);
+		auto accepted (false);
+		acceptor.async_accept (*incoming, [&accepted](boost::system::error_code const & ec_a) {
+			ASSERT_FALSE (ec_a);
+			accepted = true;
+		});
+		client.connect (endpoint);
+		while (!accepted)
+		{
+			system.poll ();
+		}
+		auto connection (std::make_shared<paper::bootstrap_server> (incoming, system.nodes[0]));
+		std::unique_ptr<paper::bulk_pull_blocks> req (new paper::bulk_pull_blocks{});
+		req->mode = mode;
+		req->max_count = 0;
+		if (mode == paper::bulk_pull_blocks_mode::list_chains)
+		{
+			req->min_hash.clear ();
+			req->max_hash = std::numeric_limits<paper::uint256_t>::max ();
+		}
+		else
+		{
+			req->min_hash = key2.pub;
+			req->min_height = 1;
+			req->max_height = 3;
+		}
+		connection->requests.push (std::unique_ptr<paper::message>{});
+		auto request (std::make_shared<paper::bulk_pull_blocks_server> (connection, std::move (req)));
+		request->send_next ();
+		auto iterations (0);
+		while (!connection->requests.empty ())
+		{
+			system.poll ();
+			++iterations;
+			ASSERT_LT (iterations, 200);
+		}
+		std::vector<uint8_t> bytes (client.available ());
+		ASSERT_FALSE (bytes.empty ());
+		boost::asio::read (client, boost::asio::buffer (bytes.data (), bytes.size ()));
+		paper::bufferstream stream (bytes.data (), bytes.size ());
+		std::vector<paper::block_hash> hashes;
+		paper::block_type type;
+		ASSERT_FALSE (paper::read (stream, type));
+		while (type != paper::block_type::not_a_block)
+		{
+			auto block (paper::deserialize_block (stream, type));
+			ASSERT_NE (nullptr, block);
+			hashes.push_back (block->hash ());
+			ASSERT_FALSE (paper::read (stream, type));
+		}
+		if (mode == paper::bulk_pull_blocks_mode::list_chains)
+		{
+			ASSERT_EQ (4, hashes.size ());
+		}
+		else
+		{
+			ASSERT_EQ (std::vector<paper::block_hash> ({ open.hash (), send2.hash () }), hashes);
+		}
+	}
+}
+
+TEST (block_reassembly, order)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key2;
+	paper::genesis genesis;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	paper::send_block send2 (send1.hash (), key2.pub, paper::genesis_amount - 200, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (send1.hash ()));
+	paper::send_block send3 (send2.hash (), key2.pub, paper::genesis_amount - 300, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (send2.hash ()));
+	paper::block_reassembly reassembly (node1);
+	// Later segments of a chain can arrive before earlier ones
+	ASSERT_TRUE (reassembly.add (std::make_shared<paper::send_block> (send3)));
+	ASSERT_TRUE (reassembly.add (std::make_shared<paper::send_block> (send2)));
+	ASSERT_EQ (2, reassembly.size ());
+	ASSERT_EQ (0, node1.block_processor.incoming_size () + node1.block_processor.verified_size ());
+	ASSERT_FALSE (reassembly.add (std::make_shared<paper::send_block> (send1)));
+	ASSERT_EQ (0, reassembly.size ());
+	node1.block_processor.flush ();
+	paper::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_TRUE (node1.store.block_exists (transaction, send1.hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, send2.hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, send3.hash ()));
+	ASSERT_EQ (0, node1.store.unchecked_count (transaction));
+}
+
+TEST (block_reassembly, flush)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key2;
+	paper::genesis genesis;
+	paper::send_block send1 (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	paper::send_block send2 (send1.hash (), key2.pub, paper::genesis_amount - 200, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (send1.hash ()));
+	paper::block_reassembly reassembly (node1);
+	reassembly.add (std::make_shared<paper::send_block> (send2));
+	ASSERT_EQ (1, reassembly.size ());
+	// A dependency that never arrives is left to the block processor's unchecked table
+	reassembly.flush ();
+	ASSERT_EQ (0, reassembly.size ());
+	node1.block_processor.flush ();
+	paper::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_FALSE (node1.store.block_exists (transaction, send2.hash ()));
+	ASSERT_EQ (1, node1.store.unchecked_count (transaction));
+}
+
 TEST (bootstrap_processor, DISABLED_process_none)
 {
 	paper::system system (24000, 1);
@@ -519,7 +931,62 @@ TEST (bootstrap_processor, process_one)
 		++iterations;
 		ASSERT_LT (iterations, 200);
 	}
-	ASSERT_EQ (0, node1->active.roots.size ());
+	ASSERT_EQ (0, node1->active.size ());
+	node1->stop ();
+}
+
+TEST (bootstrap_processor, process_ranges)
+{
+	paper::system system (24000, 1);
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	paper::keypair key2;
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	paper::node_init init1;
+	paper::node_config config1 (24001, system.logging);
+	config1.bootstrap_ranges = 4;
+	auto node1 (std::make_shared<paper::node> (init1, system.service, paper::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	ASSERT_FALSE (node1->bootstrap_initiator.ranges_complete);
+	node1->peers.insert (system.nodes[0]->network.endpoint (), paper::protocol_version_chain_pulls);
+	node1->bootstrap_initiator.bootstrap (system.nodes[0]->network.endpoint ());
+	auto attempt (node1->bootstrap_initiator.current_attempt ());
+	ASSERT_NE (nullptr, attempt);
+	auto iterations (0);
+	while (!node1->bootstrap_initiator.ranges_complete)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	// Ranges are flushed in to the ledger before the frontier pass, which hasn't had a chance to pull anything yet
+	ASSERT_LE (3, attempt->total_blocks);
+	ASSERT_EQ (system.nodes[0]->latest (paper::test_genesis_key.pub), node1->latest (paper::test_genesis_key.pub));
+	node1->stop ();
+}
+
+// A peer that doesn't advertise chain pulls is only asked for frontiers, the ranges stay incomplete
+TEST (bootstrap_processor, process_ranges_old_peer)
+{
+	paper::system system (24000, 1);
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	paper::keypair key2;
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	paper::node_init init1;
+	paper::node_config config1 (24001, system.logging);
+	config1.bootstrap_ranges = 4;
+	auto node1 (std::make_shared<paper::node> (init1, system.service, paper::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->peers.insert (system.nodes[0]->network.endpoint (), paper::protocol_version_chain_pulls - 1);
+	node1->bootstrap_initiator.bootstrap (system.nodes[0]->network.endpoint ());
+	auto iterations (0);
+	while (node1->latest (paper::test_genesis_key.pub) != system.nodes[0]->latest (paper::test_genesis_key.pub))
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_FALSE (node1->bootstrap_initiator.ranges_complete);
 	node1->stop ();
 }
 
@@ -735,6 +1202,36 @@ TEST (frontier_req, time_cutoff)
 	ASSERT_EQ (genesis.hash (), request->info.head);
 }
 
+TEST (frontier_req, skip_old_scan)
+{
+	paper::system system (24000, 1);
+	paper::keypair key1;
+	paper::keypair key2;
+	paper::keypair key3;
+	{
+		paper::transaction transaction (system.nodes[0]->store.environment, nullptr, true);
+		system.nodes[0]->store.account_put (transaction, key1.pub, paper::account_info (1, 2, 3, 4, 0, 1));
+		system.nodes[0]->store.account_put (transaction, key2.pub, paper::account_info (1, 2, 3, 4, paper::seconds_since_epoch (), 1));
+		system.nodes[0]->store.account_put (transaction, key3.pub, paper::account_info (1, 2, 3, 4, 0, 1));
+	}
+	auto connection (std::make_shared<paper::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<paper::frontier_req> req (new paper::frontier_req);
+	req->start.clear ();
+	req->age = 10;
+	req->count = std::numeric_limits<decltype (req->count)>::max ();
+	connection->requests.push (std::unique_ptr<paper::message>{});
+	auto request (std::make_shared<paper::frontier_req_server> (connection, std::move (req)));
+	std::set<paper::account> accounts;
+	while (!request->current.is_zero ())
+	{
+		accounts.insert (request->current);
+		request->next ();
+	}
+	ASSERT_EQ (2, accounts.size ());
+	ASSERT_NE (accounts.end (), accounts.find (paper::test_genesis_key.pub));
+	ASSERT_NE (accounts.end (), accounts.find (key2.pub));
+}
+
 TEST (bulk, genesis)
 {
 	paper::system system (24000, 1);
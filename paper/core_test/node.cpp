@@ -3,6 +3,7 @@
 #include <paper/node/working.hpp>
 
 #include <boost/make_shared.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 TEST (node, stop)
 {
@@ -470,13 +471,13 @@ TEST (logging, DISABLED_upgrade_v1_v2)
 TEST (node, price)
 {
 	paper::system system (24000, 1);
-	auto price1 (system.nodes[0]->price (paper::Gxrb_ratio, 1));
+	auto price1 (system.nodes[0]->price (paper::Gppr_ratio, 1));
 	ASSERT_EQ (paper::node::price_max * 100.0, price1);
-	auto price2 (system.nodes[0]->price (paper::Gxrb_ratio * int(paper::node::free_cutoff + 1), 1));
+	auto price2 (system.nodes[0]->price (paper::Gppr_ratio * int(paper::node::free_cutoff + 1), 1));
 	ASSERT_EQ (0, price2);
-	auto price3 (system.nodes[0]->price (paper::Gxrb_ratio * int(paper::node::free_cutoff + 2) / 2, 1));
+	auto price3 (system.nodes[0]->price (paper::Gppr_ratio * int(paper::node::free_cutoff + 2) / 2, 1));
 	ASSERT_EQ (paper::node::price_max * 100.0 / 2, price3);
-	auto price4 (system.nodes[0]->price (paper::Gxrb_ratio * int(paper::node::free_cutoff) * 2, 1));
+	auto price4 (system.nodes[0]->price (paper::Gppr_ratio * int(paper::node::free_cutoff) * 2, 1));
 	ASSERT_EQ (0, price4);
 }
 
@@ -494,7 +495,12 @@ TEST (node_config, serialization)
 	config1.callback_address = "test";
 	config1.callback_port = 10;
 	config1.callback_target = "test";
+	config1.callback_connections = 7;
+	config1.callback_batch = 16;
 	config1.lmdb_max_dbs = 256;
+	config1.network_threads = 17;
+	config1.wallet_threads = 3;
+	config1.stream_address = boost::asio::ip::address_v6::loopback ();
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	paper::logging logging2;
@@ -510,6 +516,11 @@ TEST (node_config, serialization)
 	ASSERT_NE (config2.callback_address, config1.callback_address);
 	ASSERT_NE (config2.callback_port, config1.callback_port);
 	ASSERT_NE (config2.callback_target, config1.callback_target);
+	ASSERT_NE (config2.callback_connections, config1.callback_connections);
+	ASSERT_NE (config2.callback_batch, config1.callback_batch);
+	ASSERT_NE (config2.network_threads, config1.network_threads);
+	ASSERT_NE (config2.wallet_threads, config1.wallet_threads);
+	ASSERT_NE (config2.stream_address, config1.stream_address);
 
 	bool upgraded (false);
 	config2.deserialize_json (upgraded, tree);
@@ -518,12 +529,17 @@ TEST (node_config, serialization)
 	ASSERT_EQ (config2.peering_port, config1.peering_port);
 	ASSERT_EQ (config2.logging.node_lifetime_tracing_value, config1.logging.node_lifetime_tracing_value);
 	ASSERT_EQ (config2.inactive_supply, config1.inactive_supply);
+	ASSERT_EQ (config2.stream_address, config1.stream_address);
 	ASSERT_EQ (config2.password_fanout, config1.password_fanout);
 	ASSERT_EQ (config2.enable_voting, config1.enable_voting);
 	ASSERT_EQ (config2.callback_address, config1.callback_address);
 	ASSERT_EQ (config2.callback_port, config1.callback_port);
 	ASSERT_EQ (config2.callback_target, config1.callback_target);
+	ASSERT_EQ (config2.callback_connections, config1.callback_connections);
+	ASSERT_EQ (config2.callback_batch, config1.callback_batch);
 	ASSERT_EQ (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
+	ASSERT_EQ (config2.network_threads, config1.network_threads);
+	ASSERT_EQ (config2.wallet_threads, config1.wallet_threads);
 }
 
 TEST (node_config, v1_v2_upgrade)
@@ -585,10 +601,10 @@ TEST (node_config, unversioned_v2_upgrade)
 	config1.deserialize_json (upgraded, tree);
 	ASSERT_TRUE (upgraded);
 	ASSERT_EQ (1, config1.preconfigured_representatives.size ());
-	ASSERT_EQ ("xrb_3e3j5tkog48pnny9dmfzj1r16pg8t1e76dz5tmac6iq689wyjfpiij4txtdo", config1.preconfigured_representatives[0].to_account ());
+	ASSERT_EQ ("ppr_3e3j5tkog48pnny9dmfzj1r16pg8t1e76dz5tmac6iq689wyjfpiij4txtdo", config1.preconfigured_representatives[0].to_account ());
 	auto reps (tree.get_child ("preconfigured_representatives"));
 	ASSERT_EQ (1, reps.size ());
-	ASSERT_EQ ("xrb_3e3j5tkog48pnny9dmfzj1r16pg8t1e76dz5tmac6iq689wyjfpiij4txtdo", reps.begin ()->second.get<std::string> (""));
+	ASSERT_EQ ("ppr_3e3j5tkog48pnny9dmfzj1r16pg8t1e76dz5tmac6iq689wyjfpiij4txtdo", reps.begin ()->second.get<std::string> (""));
 	auto version (tree.get<std::string> ("version"));
 	ASSERT_GT (std::stoull (version), 1);
 }
@@ -659,8 +675,8 @@ TEST (node, block_replace)
 {
 	paper::system system (24000, 2);
 	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
-	auto block1 (system.wallet (0)->send_action (paper::test_genesis_key.pub, 0, paper::Gxrb_ratio));
-	auto block3 (system.wallet (0)->send_action (paper::test_genesis_key.pub, 0, paper::Gxrb_ratio));
+	auto block1 (system.wallet (0)->send_action (paper::test_genesis_key.pub, 0, paper::Gppr_ratio));
+	auto block3 (system.wallet (0)->send_action (paper::test_genesis_key.pub, 0, paper::Gppr_ratio));
 	ASSERT_NE (nullptr, block1);
 	auto initial_work (block1->block_work ());
 	while (paper::work_value (block1->root (), block1->block_work ()) <= paper::work_value (block1->root (), initial_work))
@@ -714,10 +730,9 @@ TEST (node, fork_publish)
 		auto send2 (std::make_shared<paper::send_block> (genesis.hash (), key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
 		node1.process_active (send1);
 		node1.block_processor.flush ();
-		ASSERT_EQ (1, node1.active.roots.size ());
-		auto existing (node1.active.roots.find (send1->root ()));
-		ASSERT_NE (node1.active.roots.end (), existing);
-		auto election (existing->election);
+		ASSERT_EQ (1, node1.active.size ());
+		auto election (node1.active.election (send1->root ()));
+		ASSERT_NE (nullptr, election);
 		ASSERT_EQ (2, election->votes.rep_votes.size ());
 		node1.process_active (send2);
 		node1.block_processor.flush ();
@@ -749,15 +764,13 @@ TEST (node, fork_keep)
 	node1.block_processor.flush ();
 	node2.process_active (send1);
 	node2.block_processor.flush ();
-	ASSERT_EQ (1, node1.active.roots.size ());
-	ASSERT_EQ (1, node2.active.roots.size ());
+	ASSERT_EQ (1, node1.active.size ());
+	ASSERT_EQ (1, node2.active.size ());
 	node1.process_active (send2);
 	node1.block_processor.flush ();
 	node2.process_active (send2);
 	node2.block_processor.flush ();
-	auto conflict (node2.active.roots.find (genesis.hash ()));
-	ASSERT_NE (node2.active.roots.end (), conflict);
-	auto votes1 (conflict->election);
+	auto votes1 (node2.active.election (genesis.hash ()));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 	{
@@ -804,15 +817,13 @@ TEST (node, fork_flip)
 	node1.block_processor.flush ();
 	node2.process_message (publish2, node1.network.endpoint ());
 	node2.block_processor.flush ();
-	ASSERT_EQ (1, node1.active.roots.size ());
-	ASSERT_EQ (1, node2.active.roots.size ());
+	ASSERT_EQ (1, node1.active.size ());
+	ASSERT_EQ (1, node2.active.size ());
 	node1.process_message (publish2, node1.network.endpoint ());
 	node1.block_processor.flush ();
 	node2.process_message (publish1, node2.network.endpoint ());
 	node2.block_processor.flush ();
-	auto conflict (node2.active.roots.find (genesis.hash ()));
-	ASSERT_NE (node2.active.roots.end (), conflict);
-	auto votes1 (conflict->election);
+	auto votes1 (node2.active.election (genesis.hash ()));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 	{
@@ -835,8 +846,21 @@ TEST (node, fork_flip)
 	ASSERT_EQ (*publish1.block, *winner.second);
 	ASSERT_EQ (paper::genesis_amount - 100, winner.first);
 	ASSERT_TRUE (node1.store.block_exists (transaction, publish1.block->hash ()));
-	ASSERT_TRUE (node2.store.block_exists (transaction, publish1.block->hash ()));
-	ASSERT_FALSE (node2.store.block_exists (transaction, publish2.block->hash ()));
+	// Each store is read through its own transactions, node2 rolls back its fork after the vote arrives
+	auto flipped (false);
+	while (!flipped)
+	{
+		paper::transaction transaction2 (node2.store.environment, nullptr, false);
+		flipped = node2.store.block_exists (transaction2, publish1.block->hash ());
+		if (!flipped)
+		{
+			system.poll ();
+			++iterations;
+			ASSERT_LT (iterations, 200);
+		}
+	}
+	paper::transaction transaction2 (node2.store.environment, nullptr, false);
+	ASSERT_FALSE (node2.store.block_exists (transaction2, publish2.block->hash ()));
 }
 
 TEST (node, fork_multi_flip)
@@ -863,16 +887,14 @@ TEST (node, fork_multi_flip)
 	node2.process_message (publish2, node2.network.endpoint ());
 	node2.process_message (publish3, node2.network.endpoint ());
 	node2.block_processor.flush ();
-	ASSERT_EQ (1, node1.active.roots.size ());
-	ASSERT_EQ (2, node2.active.roots.size ());
+	ASSERT_EQ (1, node1.active.size ());
+	ASSERT_EQ (2, node2.active.size ());
 	node1.process_message (publish2, node1.network.endpoint ());
 	node1.process_message (publish3, node1.network.endpoint ());
 	node1.block_processor.flush ();
 	node2.process_message (publish1, node2.network.endpoint ());
 	node2.block_processor.flush ();
-	auto conflict (node2.active.roots.find (genesis.hash ()));
-	ASSERT_NE (node2.active.roots.end (), conflict);
-	auto votes1 (conflict->election);
+	auto votes1 (node2.active.election (genesis.hash ()));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 	{
@@ -896,9 +918,21 @@ TEST (node, fork_multi_flip)
 	ASSERT_EQ (*publish1.block, *winner.second);
 	ASSERT_EQ (paper::genesis_amount - 100, winner.first);
 	ASSERT_TRUE (node1.store.block_exists (transaction, publish1.block->hash ()));
-	ASSERT_TRUE (node2.store.block_exists (transaction, publish1.block->hash ()));
-	ASSERT_FALSE (node2.store.block_exists (transaction, publish2.block->hash ()));
-	ASSERT_FALSE (node2.store.block_exists (transaction, publish3.block->hash ()));
+	auto flipped (false);
+	while (!flipped)
+	{
+		paper::transaction transaction2 (node2.store.environment, nullptr, false);
+		flipped = node2.store.block_exists (transaction2, publish1.block->hash ());
+		if (!flipped)
+		{
+			system.poll ();
+			++iterations;
+			ASSERT_LT (iterations, 200);
+		}
+	}
+	paper::transaction transaction2 (node2.store.environment, nullptr, false);
+	ASSERT_FALSE (node2.store.block_exists (transaction2, publish2.block->hash ()));
+	ASSERT_FALSE (node2.store.block_exists (transaction2, publish3.block->hash ()));
 }
 
 // Blocks that are no longer actively being voted on should be able to be evicted through bootstrapping.
@@ -912,9 +946,9 @@ TEST (node, DISABLED_fork_bootstrap_flip)
 	system0.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
 	paper::block_hash latest (system0.nodes[0]->latest (paper::test_genesis_key.pub));
 	paper::keypair key1;
-	auto send1 (std::make_shared<paper::send_block> (latest, key1.pub, paper::genesis_amount - paper::Gxrb_ratio, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system0.work.generate (latest)));
+	auto send1 (std::make_shared<paper::send_block> (latest, key1.pub, paper::genesis_amount - paper::Gppr_ratio, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system0.work.generate (latest)));
 	paper::keypair key2;
-	auto send2 (std::make_shared<paper::send_block> (latest, key2.pub, paper::genesis_amount - paper::Gxrb_ratio, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system0.work.generate (latest)));
+	auto send2 (std::make_shared<paper::send_block> (latest, key2.pub, paper::genesis_amount - paper::Gppr_ratio, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system0.work.generate (latest)));
 	// Insert but don't rebroadcast, simulating settled blocks
 	node1.block_processor.process_receive_many (paper::block_processor_item (send1));
 	node1.block_processor.flush ();
@@ -967,7 +1001,7 @@ TEST (node, fork_open)
 	std::unique_ptr<paper::open_block> open2 (new paper::open_block (publish1.block->hash (), 2, key1.pub, key1.prv, key1.pub, system.work.generate (key1.pub)));
 	paper::publish publish3;
 	publish3.block = std::move (open2);
-	ASSERT_EQ (2, node1.active.roots.size ());
+	ASSERT_EQ (2, node1.active.size ());
 	node1.process_message (publish3, node1.network.endpoint ());
 	node1.block_processor.flush ();
 }
@@ -997,16 +1031,14 @@ TEST (node, fork_open_flip)
 	// node2 gets copy that will be evicted
 	node2.process_active (open2);
 	node2.block_processor.flush ();
-	ASSERT_EQ (2, node1.active.roots.size ());
-	ASSERT_EQ (2, node2.active.roots.size ());
+	ASSERT_EQ (2, node1.active.size ());
+	ASSERT_EQ (2, node2.active.size ());
 	// Notify both nodes that a fork exists
 	node1.process_active (open2);
 	node1.block_processor.flush ();
 	node2.process_active (open1);
 	node2.block_processor.flush ();
-	auto conflict (node2.active.roots.find (open1->root ()));
-	ASSERT_NE (node2.active.roots.end (), conflict);
-	auto votes1 (conflict->election);
+	auto votes1 (node2.active.election (open1->root ()));
 	ASSERT_NE (nullptr, votes1);
 	ASSERT_EQ (1, votes1->votes.rep_votes.size ());
 	ASSERT_TRUE (node1.block (open1->hash ()) != nullptr);
@@ -1105,11 +1137,11 @@ TEST (node, broadcast_elected)
 		paper::transaction transaction0 (node0->store.environment, nullptr, true);
 		paper::transaction transaction1 (node1->store.environment, nullptr, true);
 		paper::transaction transaction2 (node2->store.environment, nullptr, true);
-		paper::send_block fund_big (node0->ledger.latest (transaction0, paper::test_genesis_key.pub), rep_big.pub, paper::Gxrb_ratio * 5, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+		paper::send_block fund_big (node0->ledger.latest (transaction0, paper::test_genesis_key.pub), rep_big.pub, paper::Gppr_ratio * 5, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
 		paper::open_block open_big (fund_big.hash (), rep_big.pub, rep_big.pub, rep_big.prv, rep_big.pub, 0);
-		paper::send_block fund_small (fund_big.hash (), rep_small.pub, paper::Gxrb_ratio * 2, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+		paper::send_block fund_small (fund_big.hash (), rep_small.pub, paper::Gppr_ratio * 2, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
 		paper::open_block open_small (fund_small.hash (), rep_small.pub, rep_small.pub, rep_small.prv, rep_small.pub, 0);
-		paper::send_block fund_other (fund_small.hash (), rep_other.pub, paper::Gxrb_ratio * 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+		paper::send_block fund_other (fund_small.hash (), rep_other.pub, paper::Gppr_ratio * 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
 		paper::open_block open_other (fund_other.hash (), rep_other.pub, rep_other.pub, rep_other.prv, rep_other.pub, 0);
 		node0->generate_work (fund_big);
 		node0->generate_work (open_big);
@@ -1186,9 +1218,9 @@ TEST (node, rep_self_vote)
 		paper::transaction transaction (node0->store.environment, nullptr, true);
 		active.start (transaction, block0, [](std::shared_ptr<paper::block>, bool) {});
 	}
-	auto existing (active.roots.find (block0->root ()));
-	ASSERT_NE (active.roots.end (), existing);
-	auto & rep_votes (existing->election->votes.rep_votes);
+	auto election (active.election (block0->root ()));
+	ASSERT_NE (nullptr, election);
+	auto & rep_votes (election->votes.rep_votes);
 	ASSERT_EQ (3, rep_votes.size ());
 	ASSERT_NE (rep_votes.end (), rep_votes.find (paper::test_genesis_key.pub));
 	ASSERT_NE (rep_votes.end (), rep_votes.find (rep_big.pub));
@@ -1210,7 +1242,7 @@ TEST (node, DISABLED_bootstrap_no_publish)
 	}
 	ASSERT_FALSE (node1->bootstrap_initiator.in_progress ());
 	node1->bootstrap_initiator.bootstrap (node0->network.endpoint ());
-	ASSERT_TRUE (node1->active.roots.empty ());
+	ASSERT_TRUE (node1->active.empty ());
 	auto iterations1 (0);
 	while (node1->block (send0.hash ()) == nullptr)
 	{
@@ -1218,7 +1250,7 @@ TEST (node, DISABLED_bootstrap_no_publish)
 		system0.poll ();
 		system1.poll ();
 		// There should never be an active transaction because the only activity is bootstrapping 1 block which shouldn't be publishing.
-		ASSERT_TRUE (node1->active.roots.empty ());
+		ASSERT_TRUE (node1->active.empty ());
 		++iterations1;
 		ASSERT_GT (200, iterations1);
 	}
@@ -1250,7 +1282,7 @@ TEST (node, bootstrap_fork_open)
 	}
 	ASSERT_FALSE (node1->bootstrap_initiator.in_progress ());
 	node1->bootstrap_initiator.bootstrap (node0->network.endpoint ());
-	ASSERT_TRUE (node1->active.roots.empty ());
+	ASSERT_TRUE (node1->active.empty ());
 	int iterations (0);
 	while (node1->ledger.block_exists (open1.hash ()))
 	{
@@ -1272,21 +1304,21 @@ TEST (node, DISABLED_unconfirmed_send)
 	paper::keypair key0;
 	wallet1->insert_adhoc (key0.prv);
 	wallet0->insert_adhoc (paper::test_genesis_key.prv);
-	auto send1 (wallet0->send_action (paper::genesis_account, key0.pub, 2 * paper::Mxrb_ratio));
+	auto send1 (wallet0->send_action (paper::genesis_account, key0.pub, 2 * paper::Mppr_ratio));
 	auto iterations0 (0);
-	while (node1.balance (key0.pub) != 2 * paper::Mxrb_ratio || node1.bootstrap_initiator.in_progress ())
+	while (node1.balance (key0.pub) != 2 * paper::Mppr_ratio || node1.bootstrap_initiator.in_progress ())
 	{
 		system.poll ();
 		++iterations0;
 		ASSERT_GT (200, iterations0);
 	}
 	auto latest (node1.latest (key0.pub));
-	paper::send_block send2 (latest, paper::genesis_account, paper::Mxrb_ratio, key0.prv, key0.pub, node0.generate_work (latest));
+	paper::send_block send2 (latest, paper::genesis_account, paper::Mppr_ratio, key0.prv, key0.pub, node0.generate_work (latest));
 	{
 		paper::transaction transaction (node1.store.environment, nullptr, true);
 		ASSERT_EQ (paper::process_result::progress, node1.ledger.process (transaction, send2).code);
 	}
-	auto send3 (wallet1->send_action (key0.pub, paper::genesis_account, paper::Mxrb_ratio));
+	auto send3 (wallet1->send_action (key0.pub, paper::genesis_account, paper::Mppr_ratio));
 	auto iterations (0);
 	while (node0.balance (paper::genesis_account) != paper::genesis_amount)
 	{
@@ -1308,7 +1340,7 @@ TEST (node, rep_list)
 	wallet0->insert_adhoc (paper::test_genesis_key.prv);
 	paper::keypair key1;
 	// Broadcast a confirm so others should know this is a rep node
-	wallet0->send_action (paper::test_genesis_key.pub, key1.pub, paper::Mxrb_ratio);
+	wallet0->send_action (paper::test_genesis_key.pub, key1.pub, paper::Mppr_ratio);
 	ASSERT_EQ (0, node1.peers.representatives (1).size ());
 	auto iterations (0);
 	auto done (false);
@@ -1345,7 +1377,7 @@ TEST (node, no_voting)
 	paper::keypair key1;
 	wallet1->insert_adhoc (key1.prv);
 	// Broadcast a confirm so others should know this is a rep node
-	wallet0->send_action (paper::test_genesis_key.pub, key1.pub, paper::Mxrb_ratio);
+	wallet0->send_action (paper::test_genesis_key.pub, key1.pub, paper::Mppr_ratio);
 	auto iterations (0);
 	while (node1.balance (key1.pub).is_zero ())
 	{
@@ -1395,6 +1427,199 @@ TEST (node, send_callback)
 	ASSERT_EQ (std::numeric_limits<paper::uint128_t>::max () - system.nodes[0]->config.receive_minimum.number (), system.nodes[0]->balance (paper::test_genesis_key.pub));
 }
 
+TEST (node, callback_keepalive_batch)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.callback_address = "::1";
+	node1.config.callback_port = 24100;
+	node1.config.callback_target = "/";
+	node1.config.callback_connections = 1;
+	node1.config.callback_batch = 2;
+	boost::asio::io_service service;
+	boost::asio::ip::tcp::acceptor acceptor (service, paper::tcp_endpoint (boost::asio::ip::address_v6::loopback (), 24100));
+	std::vector<std::string> bodies;
+	auto accepted (0);
+	std::thread server ([&acceptor, &service, &bodies, &accepted]() {
+		boost::asio::ip::tcp::socket sock (service);
+		acceptor.accept (sock);
+		++accepted;
+		boost::beast::flat_buffer buffer;
+		boost::system::error_code ec;
+		while (!ec)
+		{
+			boost::beast::http::request<boost::beast::http::string_body> req;
+			boost::beast::http::read (sock, buffer, req, ec);
+			if (!ec)
+			{
+				bodies.push_back (req.body ());
+				boost::beast::http::response<boost::beast::http::string_body> res;
+				res.version (11);
+				res.result (boost::beast::http::status::ok);
+				res.keep_alive (true);
+				res.prepare_payload ();
+				boost::beast::http::write (sock, res, ec);
+			}
+		}
+	});
+	node1.callbacks.add ("{\"event\": \"1\"}");
+	node1.callbacks.add ("{\"event\": \"2\"}");
+	node1.callbacks.add ("{\"event\": \"3\"}");
+	auto iterations (0);
+	while (node1.callbacks.delivered < 3)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ (1, node1.callbacks.connection_count ());
+	node1.callbacks.stop ();
+	server.join ();
+	ASSERT_EQ (1, accepted);
+	ASSERT_EQ (2, bodies.size ());
+	boost::property_tree::ptree events1;
+	std::stringstream stream1 (bodies[0]);
+	boost::property_tree::read_json (stream1, events1);
+	ASSERT_EQ (2, events1.size ());
+	boost::property_tree::ptree events2;
+	std::stringstream stream2 (bodies[1]);
+	boost::property_tree::read_json (stream2, events2);
+	ASSERT_EQ (1, events2.size ());
+	ASSERT_EQ (0, node1.callbacks.failed);
+	ASSERT_EQ (0, node1.callbacks.dropped);
+}
+
+TEST (node, callback_queue_full)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.callback_address = "::1";
+	node1.config.callback_port = 24100;
+	node1.config.callback_target = "/";
+	node1.config.callback_queue_max = 2;
+	// Nothing is sent until the address has been resolved, which needs the service to run
+	node1.callbacks.add ("{}");
+	node1.callbacks.add ("{}");
+	node1.callbacks.add ("{}");
+	ASSERT_EQ (2, node1.callbacks.queue_size ());
+	ASSERT_EQ (1, node1.callbacks.dropped);
+}
+
+TEST (node, stream_resume)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.stream_port = 24200;
+	node1.stream.start ();
+	// Retained without subscribers so a client resuming from sequence 1 is sent record 2
+	paper::keypair key;
+	auto vote (std::make_shared<paper::vote> (key.pub, key.prv, 1, std::make_shared<paper::send_block> (0, 1, 2, key.prv, key.pub, 3)));
+	node1.stream.vote (*vote);
+	node1.stream.vote (*vote);
+	std::atomic<bool> done (false);
+	std::vector<std::pair<uint64_t, std::vector<uint8_t>>> records;
+	std::thread client ([&done, &records]() {
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::socket sock (service);
+		boost::system::error_code ec;
+		sock.connect (paper::tcp_endpoint (boost::asio::ip::address_v4::loopback (), 24200), ec);
+		std::vector<uint8_t> request;
+		{
+			paper::vectorstream stream (request);
+			paper::write (stream, static_cast<uint8_t> (static_cast<uint8_t> (paper::stream_topic::vote) | static_cast<uint8_t> (paper::stream_topic::account_balance)));
+			paper::write (stream, uint64_t (1));
+		}
+		boost::asio::write (sock, boost::asio::buffer (request), ec);
+		while (!ec && records.size () < 3)
+		{
+			uint32_t length;
+			boost::asio::read (sock, boost::asio::buffer (&length, sizeof (length)), ec);
+			std::vector<uint8_t> record (length);
+			boost::asio::read (sock, boost::asio::buffer (record), ec);
+			if (!ec)
+			{
+				uint64_t sequence;
+				paper::bufferstream stream (record.data (), record.size ());
+				paper::read (stream, sequence);
+				records.push_back (std::make_pair (sequence, std::vector<uint8_t> (record.begin () + sizeof (sequence), record.end ())));
+			}
+		}
+		done = true;
+	});
+	while (node1.stream.subscriber_count () == 0)
+	{
+		system.poll ();
+	}
+	node1.stream.account_balance (paper::test_genesis_key.pub, false);
+	while (!done)
+	{
+		system.poll ();
+	}
+	client.join ();
+	ASSERT_EQ (3, records.size ());
+	// The subscription is acknowledged with the run id and the last sequence number published
+	ASSERT_EQ (2, records[0].first);
+	paper::bufferstream stream0 (records[0].second.data (), records[0].second.size ());
+	paper::stream_topic topic;
+	uint64_t run_id;
+	ASSERT_FALSE (paper::read (stream0, topic));
+	ASSERT_FALSE (paper::read (stream0, run_id));
+	ASSERT_EQ (paper::stream_topic::subscribed, topic);
+	ASSERT_EQ (node1.stream.run_id, run_id);
+	ASSERT_EQ (2, records[1].first);
+	ASSERT_EQ (3, records[2].first);
+	paper::bufferstream stream (records[2].second.data (), records[2].second.size ());
+	paper::account account;
+	uint8_t pending;
+	paper::amount balance;
+	ASSERT_FALSE (paper::read (stream, topic));
+	ASSERT_FALSE (paper::read (stream, account));
+	ASSERT_FALSE (paper::read (stream, pending));
+	ASSERT_FALSE (paper::read (stream, balance));
+	ASSERT_EQ (paper::stream_topic::account_balance, topic);
+	ASSERT_EQ (paper::test_genesis_key.pub, account);
+	ASSERT_EQ (0, pending);
+	ASSERT_EQ (paper::genesis_amount, balance.number ());
+}
+
+// A stream address that can't be bound is logged and leaves the node running without the stream
+TEST (node, stream_bind_error)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.stream_address = boost::asio::ip::address_v4::from_string ("192.0.2.1");
+	node1.config.stream_port = 24200;
+	ASSERT_NO_THROW (node1.stream.start ());
+	ASSERT_FALSE (node1.stream.on);
+}
+
+TEST (node, stream_slow_subscriber)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.stream_buffer = 2;
+	node1.config.stream_port = 24200;
+	node1.stream.start ();
+	auto subscriber (std::make_shared<paper::stream_subscriber> (node1.stream));
+	// Marked as mid-write so nothing drains its buffer, like a consumer that stopped reading
+	subscriber->writing = true;
+	node1.stream.subscribe (subscriber, static_cast<uint8_t> (paper::stream_topic::vote), 0);
+	ASSERT_EQ (1, node1.stream.subscriber_count ());
+	paper::keypair key;
+	auto vote (std::make_shared<paper::vote> (key.pub, key.prv, 1, std::make_shared<paper::send_block> (0, 1, 2, key.prv, key.pub, 3)));
+	for (auto i (0); i < 5; ++i)
+	{
+		node1.stream.vote (*vote);
+	}
+	// Nobody wants balances so they aren't looked up
+	node1.stream.account_balance (paper::test_genesis_key.pub, false);
+	ASSERT_TRUE (node1.stream.balances.empty ());
+	// The subscribed record and the oldest votes were dropped
+	ASSERT_EQ (2, subscriber->buffer.size ());
+	ASSERT_EQ (4, subscriber->dropped);
+	ASSERT_EQ (5, node1.stream.history.size ());
+}
+
 // Check that votes get replayed back to nodes if they sent an old sequence number.
 // This helps representatives continue from their last sequence number if their node is reinitialized and the old sequence number is lost
 TEST (node, vote_replay)
@@ -1415,7 +1640,7 @@ TEST (node, vote_replay)
 		ASSERT_EQ (nullptr, vote);
 	}
 	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
-	auto block (system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Gxrb_ratio));
+	auto block (system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Gppr_ratio));
 	ASSERT_NE (nullptr, block);
 	auto done (false);
 	auto iterations (0);
@@ -1464,8 +1689,8 @@ TEST (node, bootstrap_connection_scaling)
 {
 	paper::system system (24000, 1);
 	auto & node1 (*system.nodes[0]);
-	node1.bootstrap_initiator.bootstrap ();
-	auto & attempt = node1.bootstrap_initiator.attempt;
+	// The initiator's attempt is reset by its thread once the attempt stops, which it does straight away without peers
+	auto attempt (std::make_shared<paper::bootstrap_attempt> (node1.shared ()));
 	ASSERT_EQ (34, attempt->target_connections (25000));
 	ASSERT_EQ (4, attempt->target_connections (0));
 	ASSERT_EQ (64, attempt->target_connections (50000));
@@ -1480,3 +1705,143 @@ TEST (node, bootstrap_connection_scaling)
 	ASSERT_EQ (1, attempt->target_connections (0));
 	ASSERT_EQ (1, attempt->target_connections (50000));
 }
+
+TEST (block_processor, verify_signatures)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key1;
+	paper::genesis genesis;
+	auto send1 (std::make_shared<paper::send_block> (genesis.hash (), key1.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (genesis.hash ())));
+	auto send2 (std::make_shared<paper::send_block> (send1->hash (), key1.pub, paper::genesis_amount - 200, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (send1->hash ())));
+	auto open (std::make_shared<paper::open_block> (send1->hash (), key1.pub, key1.pub, key1.prv, key1.pub, system.work.generate (key1.pub)));
+	auto receive (std::make_shared<paper::receive_block> (open->hash (), send2->hash (), key1.prv, key1.pub, system.work.generate (open->hash ())));
+	receive->signature.bytes[32] ^= 0x1;
+	// Previous block isn't known yet so the signing account can't be determined
+	paper::keypair key2;
+	auto unknown (std::make_shared<paper::send_block> (1, key2.pub, 0, key2.prv, key2.pub, 0));
+	std::deque<paper::block_processor_item> items;
+	items.push_back (paper::block_processor_item (send1));
+	items.push_back (paper::block_processor_item (send2));
+	items.push_back (paper::block_processor_item (open));
+	items.push_back (paper::block_processor_item (receive));
+	items.push_back (paper::block_processor_item (unknown));
+	node1.block_processor.verify_signatures (items);
+	ASSERT_EQ (paper::signature_verification::valid, items[0].verification);
+	ASSERT_EQ (paper::signature_verification::valid, items[1].verification);
+	ASSERT_EQ (paper::signature_verification::valid, items[2].verification);
+	ASSERT_EQ (paper::signature_verification::unknown, items[3].verification);
+	ASSERT_EQ (paper::signature_verification::unknown, items[4].verification);
+	node1.block_processor.process_receive_many (items);
+	paper::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_TRUE (node1.store.block_exists (transaction, send1->hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, send2->hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, open->hash ()));
+	ASSERT_FALSE (node1.store.block_exists (transaction, receive->hash ()));
+}
+
+TEST (block_processor, order_dependencies)
+{
+	paper::keypair key1;
+	paper::genesis genesis;
+	auto send1 (std::make_shared<paper::send_block> (genesis.hash (), key1.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	auto send2 (std::make_shared<paper::send_block> (send1->hash (), key1.pub, paper::genesis_amount - 200, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	auto open (std::make_shared<paper::open_block> (send1->hash (), key1.pub, key1.pub, key1.prv, key1.pub, 0));
+	auto receive (std::make_shared<paper::receive_block> (open->hash (), send2->hash (), key1.prv, key1.pub, 0));
+	auto unrelated (std::make_shared<paper::send_block> (1, key1.pub, 0, key1.prv, key1.pub, 0));
+	std::deque<paper::block_processor_item> items;
+	items.push_back (paper::block_processor_item (receive));
+	items.push_back (paper::block_processor_item (unrelated));
+	items.push_back (paper::block_processor_item (open));
+	items.push_back (paper::block_processor_item (send2));
+	items.push_back (paper::block_processor_item (send1));
+	paper::block_processor::order_dependencies (items);
+	ASSERT_EQ (5, items.size ());
+	std::unordered_map<paper::block_hash, size_t> positions;
+	for (size_t i (0); i < items.size (); ++i)
+	{
+		positions[items[i].block->hash ()] = i;
+	}
+	ASSERT_EQ (5, positions.size ());
+	ASSERT_LT (positions[send1->hash ()], positions[send2->hash ()]);
+	ASSERT_LT (positions[send1->hash ()], positions[open->hash ()]);
+	ASSERT_LT (positions[open->hash ()], positions[receive->hash ()]);
+	ASSERT_LT (positions[send2->hash ()], positions[receive->hash ()]);
+}
+
+// A chain queued newest first comes out of the pipeline fully written
+TEST (block_processor, pipeline)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	paper::keypair key1;
+	std::vector<std::shared_ptr<paper::block>> blocks;
+	auto previous (node1.latest (paper::test_genesis_key.pub));
+	for (auto i (0); i < 32; ++i)
+	{
+		auto send (std::make_shared<paper::send_block> (previous, key1.pub, paper::genesis_amount - i - 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+		blocks.push_back (send);
+		previous = send->hash ();
+	}
+	ASSERT_FALSE (node1.block_processor.full ());
+	for (auto i (blocks.rbegin ()), n (blocks.rend ()); i != n; ++i)
+	{
+		node1.block_processor.add (paper::block_processor_item (*i));
+	}
+	node1.block_processor.flush ();
+	ASSERT_EQ (0, node1.block_processor.incoming_size ());
+	ASSERT_EQ (0, node1.block_processor.verified_size ());
+	paper::transaction transaction (node1.store.environment, nullptr, false);
+	for (auto & i : blocks)
+	{
+		ASSERT_TRUE (node1.store.block_exists (transaction, i->hash ()));
+	}
+	ASSERT_EQ (0, node1.store.unchecked_count (transaction));
+}
+
+// Producers that don't check full are dropped at queue_limit
+TEST (block_processor, add_limit)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.block_processor.stop ();
+	paper::genesis genesis;
+	auto send (std::make_shared<paper::send_block> (genesis.hash (), 0, 0, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+	for (size_t i (0); i < paper::block_processor::queue_limit; ++i)
+	{
+		ASSERT_FALSE (node1.block_processor.add (paper::block_processor_item (send)));
+	}
+	ASSERT_TRUE (node1.block_processor.full ());
+	ASSERT_EQ (0, node1.block_processor.dropped);
+	ASSERT_TRUE (node1.block_processor.add (paper::block_processor_item (send)));
+	ASSERT_EQ (1, node1.block_processor.dropped);
+	ASSERT_EQ (paper::block_processor::queue_limit, node1.block_processor.incoming_size ());
+}
+
+TEST (signature_checker, many)
+{
+	size_t const count (1000);
+	paper::keypair key;
+	std::vector<paper::uint256_union> messages (count);
+	std::vector<paper::uint512_union> signatures (count);
+	std::vector<unsigned char const *> message_pointers (count);
+	std::vector<size_t> message_lengths (count, sizeof (paper::uint256_union));
+	std::vector<unsigned char const *> pub_keys (count, key.pub.bytes.data ());
+	std::vector<unsigned char const *> signature_pointers (count);
+	std::vector<int> verifications (count, 0);
+	for (size_t i (0); i < count; ++i)
+	{
+		messages[i] = paper::uint256_union (i);
+		signatures[i] = paper::sign_message (key.prv, key.pub, messages[i]);
+		message_pointers[i] = messages[i].bytes.data ();
+		signature_pointers[i] = signatures[i].bytes.data ();
+	}
+	signatures[700].bytes[32] ^= 0x1;
+	paper::signature_checker checker (4);
+	paper::signature_check_set check = { count, message_pointers.data (), message_lengths.data (), pub_keys.data (), signature_pointers.data (), verifications.data () };
+	checker.verify (check);
+	for (size_t i (0); i < count; ++i)
+	{
+		ASSERT_EQ (i == 700 ? 0 : 1, verifications[i]);
+	}
+}
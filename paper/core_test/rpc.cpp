@@ -869,6 +869,146 @@ TEST (rpc, frontier_startpoint)
 	ASSERT_EQ (source.begin ()->first.to_account (), frontiers_node.begin ()->first);
 }
 
+TEST (rpc, frontier_chunked)
+{
+	paper::system system (24000, 1);
+	std::unordered_map<paper::account, paper::block_hash> source;
+	{
+		paper::transaction transaction (system.nodes[0]->store.environment, nullptr, true);
+		for (auto i (0); i < 2 * paper::rpc_body_source::batch_size + 10; ++i)
+		{
+			paper::keypair key;
+			source[key.pub] = key.prv.data;
+			system.nodes[0]->store.account_put (transaction, key.pub, paper::account_info (key.prv.data, 0, 0, 0, 0, 0));
+		}
+	}
+	paper::rpc rpc (system.service, *system.nodes[0], paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "frontiers");
+	request.put ("account", paper::account (0).to_account ());
+	request.put ("count", std::to_string (std::numeric_limits<uint64_t>::max ()));
+	test_response response (request, rpc, system.service);
+	while (response.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response.status);
+	ASSERT_TRUE (response.resp.chunked ());
+	std::unordered_map<paper::account, paper::block_hash> frontiers;
+	for (auto & i : response.json.get_child ("frontiers"))
+	{
+		paper::account account;
+		ASSERT_FALSE (account.decode_account (i.first));
+		paper::block_hash frontier;
+		ASSERT_FALSE (frontier.decode_hex (i.second.get<std::string> ("")));
+		frontiers[account] = frontier;
+	}
+	ASSERT_EQ (1, frontiers.erase (paper::test_genesis_key.pub));
+	ASSERT_EQ (source, frontiers);
+	// Counts that end partway through a batch
+	request.put ("count", std::to_string (paper::rpc_body_source::batch_size + 1));
+	test_response response2 (request, rpc, system.service);
+	while (response2.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response2.status);
+	ASSERT_EQ (paper::rpc_body_source::batch_size + 1, response2.json.get_child ("frontiers").size ());
+	// The action's limiter slot is released once the body has been sent
+	auto running ([&rpc]() {
+		std::lock_guard<std::mutex> lock (rpc.limiter.mutex);
+		return rpc.limiter.running["frontiers"];
+	});
+	auto iterations (0);
+	while (running () != 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+}
+
+namespace
+{
+class test_body_source : public paper::rpc_body_source
+{
+public:
+	test_body_source (std::vector<std::pair<std::string, std::string>> const & values_a, uint64_t count_a) :
+	rpc_body_source ("values", count_a),
+	values (values_a),
+	position (0)
+	{
+	}
+	bool fill (std::vector<std::pair<std::string, boost::property_tree::ptree>> & entries_a, size_t max_a) override
+	{
+		// Two entries a batch so the listing spans several chunks
+		for (; position < values.size () && entries_a.size () < std::min<size_t> (max_a, 2); ++position)
+		{
+			entries_a.push_back (std::make_pair (values[position].first, boost::property_tree::ptree (values[position].second)));
+		}
+		return position == values.size ();
+	}
+	std::vector<std::pair<std::string, std::string>> values;
+	size_t position;
+};
+}
+
+TEST (rpc, body_source)
+{
+	std::vector<std::pair<std::string, std::string>> values ({ { "a", "1" }, { "b", "{\n    \"quoted\": \"2\"\n}\n" }, { "c", "3" }, { "d", "4" }, { "e", "5" } });
+	auto parse ([](paper::rpc_body_source & source_a) {
+		std::string body;
+		size_t chunks (0);
+		auto done (false);
+		while (!done)
+		{
+			done = source_a.next (body);
+			++chunks;
+		}
+		std::stringstream stream (body);
+		boost::property_tree::ptree tree;
+		boost::property_tree::read_json (stream, tree);
+		return std::make_pair (chunks, tree);
+	});
+	test_body_source source1 (values, std::numeric_limits<uint64_t>::max ());
+	auto result1 (parse (source1));
+	ASSERT_EQ (3, result1.first);
+	auto & values1 (result1.second.get_child ("values"));
+	ASSERT_EQ (values.size (), values1.size ());
+	auto j (values1.begin ());
+	for (auto i (values.begin ()), n (values.end ()); i != n; ++i, ++j)
+	{
+		ASSERT_EQ (i->first, j->first);
+		ASSERT_EQ (i->second, j->second.get<std::string> (""));
+	}
+	test_body_source source2 (values, 3);
+	auto result2 (parse (source2));
+	ASSERT_EQ (2, result2.first);
+	ASSERT_EQ (3, result2.second.get_child ("values").size ());
+	test_body_source source3 (values, 0);
+	auto result3 (parse (source3));
+	ASSERT_EQ (1, result3.first);
+	ASSERT_TRUE (result3.second.get_child ("values").empty ());
+	// An empty listing looks the same as one written by write_json
+	boost::property_tree::ptree empty;
+	empty.put_child ("values", boost::property_tree::ptree ());
+	std::stringstream expected;
+	boost::property_tree::write_json (expected, empty, false);
+	test_body_source source5 ({}, std::numeric_limits<uint64_t>::max ());
+	std::string body5;
+	ASSERT_TRUE (source5.next (body5));
+	ASSERT_EQ (expected.str (), body5);
+	auto finished (false);
+	{
+		auto source4 (std::make_shared<test_body_source> (values, 1));
+		source4->finished = [&finished]() {
+			finished = true;
+		};
+	}
+	ASSERT_TRUE (finished);
+}
+
 TEST (rpc, history)
 {
 	paper::system system (24000, 1);
@@ -939,6 +1079,81 @@ TEST (rpc, history_count)
 	ASSERT_EQ (1, history_node.size ());
 }
 
+TEST (rpc, account_history_paging)
+{
+	paper::system system (24000, 1);
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	paper::keypair key1;
+	std::vector<paper::block_hash> hashes;
+	for (auto i (0); i < 4; ++i)
+	{
+		auto send (system.wallet (0)->send_action (paper::test_genesis_key.pub, key1.pub, 1));
+		ASSERT_NE (nullptr, send);
+		hashes.push_back (send->hash ());
+	}
+	paper::rpc rpc (system.service, *system.nodes[0], paper::rpc_config (true));
+	rpc.start ();
+	auto page ([&](boost::property_tree::ptree const & request_a) {
+		test_response response (request_a, rpc, system.service);
+		while (response.status == 0)
+		{
+			system.poll ();
+		}
+		EXPECT_EQ (200, response.status);
+		return response.json;
+	});
+	boost::property_tree::ptree request;
+	request.put ("action", "account_history");
+	request.put ("account", paper::test_genesis_key.pub.to_account ());
+	request.put ("count", "2");
+	request.put ("offset", "1");
+	auto response1 (page (request));
+	std::vector<std::string> page1;
+	for (auto & i : response1.get_child ("history"))
+	{
+		page1.push_back (i.second.get<std::string> ("hash"));
+	}
+	ASSERT_EQ (std::vector<std::string> ({ hashes[2].to_string (), hashes[1].to_string () }), page1);
+	ASSERT_EQ (hashes[0].to_string (), response1.get<std::string> ("previous"));
+	// Continue from the previous page's last block
+	request.erase ("offset");
+	request.put ("head", response1.get<std::string> ("previous"));
+	request.put ("count", "10");
+	auto response2 (page (request));
+	std::vector<std::string> page2;
+	for (auto & i : response2.get_child ("history"))
+	{
+		page2.push_back (i.second.get<std::string> ("hash"));
+	}
+	paper::genesis genesis;
+	ASSERT_EQ (std::vector<std::string> ({ hashes[0].to_string (), genesis.hash ().to_string () }), page2);
+	ASSERT_FALSE (response2.get_optional<std::string> ("previous").is_initialized ());
+	// Offsets count back from the head
+	request.put ("head", hashes[3].to_string ());
+	request.put ("offset", "2");
+	request.put ("count", "1");
+	auto response6 (page (request));
+	ASSERT_EQ (1, response6.get_child ("history").size ());
+	ASSERT_EQ (hashes[1].to_string (), response6.get_child ("history").front ().second.get<std::string> ("hash"));
+	request.put ("offset", "5");
+	auto response7 (page (request));
+	ASSERT_TRUE (response7.get_child ("history").empty ());
+	// Offsets past the open block give an empty page
+	request.erase ("head");
+	request.put ("offset", "5");
+	auto response3 (page (request));
+	ASSERT_TRUE (response3.get_child ("history").empty ());
+	boost::property_tree::ptree request2;
+	request2.put ("action", "account_block_at_height");
+	request2.put ("account", paper::test_genesis_key.pub.to_account ());
+	request2.put ("height", "3");
+	auto response4 (page (request2));
+	ASSERT_EQ (hashes[1].to_string (), response4.get<std::string> ("hash"));
+	request2.put ("height", "6");
+	auto response5 (page (request2));
+	ASSERT_EQ ("Block not found", response5.get<std::string> ("error"));
+}
+
 TEST (rpc, process_block)
 {
 	paper::system system (24000, 1);
@@ -1230,7 +1445,7 @@ TEST (rpc, payment_wait)
 	boost::property_tree::ptree request1;
 	request1.put ("action", "payment_wait");
 	request1.put ("account", key.pub.to_account ());
-	request1.put ("amount", paper::amount (paper::Mxrb_ratio).to_string_dec ());
+	request1.put ("amount", paper::amount (paper::Mppr_ratio).to_string_dec ());
 	request1.put ("timeout", "100");
 	test_response response1 (request1, rpc, system.service);
 	while (response1.status == 0)
@@ -1240,9 +1455,9 @@ TEST (rpc, payment_wait)
 	ASSERT_EQ (200, response1.status);
 	ASSERT_EQ ("nothing", response1.json.get<std::string> ("status"));
 	request1.put ("timeout", "100000");
-	system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Mxrb_ratio);
+	system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Mppr_ratio);
 	system.alarm.add (std::chrono::steady_clock::now () + std::chrono::milliseconds (500), [&]() {
-		system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Mxrb_ratio);
+		system.wallet (0)->send_action (paper::test_genesis_key.pub, key.pub, paper::Mppr_ratio);
 	});
 	test_response response2 (request1, rpc, system.service);
 	while (response2.status == 0)
@@ -1251,7 +1466,7 @@ TEST (rpc, payment_wait)
 	}
 	ASSERT_EQ (200, response2.status);
 	ASSERT_EQ ("success", response2.json.get<std::string> ("status"));
-	request1.put ("amount", paper::amount (paper::Mxrb_ratio * 2).to_string_dec ());
+	request1.put ("amount", paper::amount (paper::Mppr_ratio * 2).to_string_dec ());
 	test_response response3 (request1, rpc, system.service);
 	while (response3.status == 0)
 	{
@@ -1360,6 +1575,9 @@ TEST (rpc_config, serialization)
 	config1.enable_control = true;
 	config1.frontier_request_limit = 8192;
 	config1.chain_request_limit = 4096;
+	config1.threads = 64;
+	config1.action_limits = { { "ledger", 3 } };
+	config1.keepalive_timeout = 5;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	paper::rpc_config config2;
@@ -1368,12 +1586,18 @@ TEST (rpc_config, serialization)
 	ASSERT_NE (config2.enable_control, config1.enable_control);
 	ASSERT_NE (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_NE (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_NE (config2.threads, config1.threads);
+	ASSERT_NE (config2.action_limits, config1.action_limits);
+	ASSERT_NE (config2.keepalive_timeout, config1.keepalive_timeout);
 	config2.deserialize_json (tree);
 	ASSERT_EQ (config2.address, config1.address);
 	ASSERT_EQ (config2.port, config1.port);
 	ASSERT_EQ (config2.enable_control, config1.enable_control);
 	ASSERT_EQ (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_EQ (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_EQ (config2.threads, config1.threads);
+	ASSERT_EQ (config2.action_limits, config1.action_limits);
+	ASSERT_EQ (config2.keepalive_timeout, config1.keepalive_timeout);
 }
 
 TEST (rpc, search_pending)
@@ -1423,7 +1647,7 @@ TEST (rpc, version)
 	ASSERT_EQ (200, response1.status);
 	ASSERT_EQ ("1", response1.json.get<std::string> ("rpc_version"));
 	ASSERT_EQ (200, response1.status);
-	ASSERT_EQ ("10", response1.json.get<std::string> ("store_version"));
+	ASSERT_EQ ("16", response1.json.get<std::string> ("store_version"));
 	ASSERT_EQ (boost::str (boost::format ("Paper %1%.%2%") % PAPER_VERSION_MAJOR % PAPER_VERSION_MINOR), response1.json.get<std::string> ("node_vendor"));
 	auto headers (response1.resp.base ());
 	auto allowed_origin (headers.at ("Access-Control-Allow-Origin"));
@@ -1594,6 +1818,134 @@ TEST (rpc, block_count)
 	ASSERT_EQ ("0", response1.json.get<std::string> ("unchecked"));
 }
 
+TEST (rpc, store_cache)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	{
+		paper::transaction transaction (node1.store.environment, nullptr, false);
+		paper::account_info info;
+		ASSERT_FALSE (node1.store.account_get (transaction, paper::test_genesis_key.pub, info));
+		ASSERT_TRUE (node1.store.account_get (transaction, paper::keypair ().pub, info));
+	}
+	paper::rpc rpc (system.service, node1, paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "store_cache");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_LE (1, std::stoull (response1.json.get<std::string> ("accounts.hits")));
+	ASSERT_LE (1, std::stoull (response1.json.get<std::string> ("accounts.misses")));
+	ASSERT_LE (1, std::stoull (response1.json.get<std::string> ("accounts.size")));
+	ASSERT_EQ (std::to_string (node1.config.account_cache_max), response1.json.get<std::string> ("accounts.max"));
+	ASSERT_EQ (std::to_string (node1.config.block_cache_max), response1.json.get<std::string> ("blocks.max"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("blocks.hits"));
+	ASSERT_EQ (std::to_string (node1.config.account_cache_max), response1.json.get<std::string> ("pending.max"));
+	ASSERT_EQ (std::to_string (node1.config.block_cache_max), response1.json.get<std::string> ("blocks_info.max"));
+}
+
+TEST (rpc, block_processor_stats)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	++node1.network.receive_dropped.publish;
+	paper::rpc rpc (system.service, node1, paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "block_processor_stats");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_EQ ("0", response1.json.get<std::string> ("incoming"));
+	ASSERT_EQ ("0", response1.json.get<std::string> ("verified"));
+	ASSERT_EQ (std::to_string (paper::block_processor::queue_max), response1.json.get<std::string> ("queue_max"));
+	ASSERT_EQ ("0", response1.json.get<std::string> ("dropped"));
+	ASSERT_EQ ("1", response1.json.get<std::string> ("publish_dropped"));
+}
+
+TEST (rpc, network_stats)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.network.receive_dropped.add (paper::message_type::confirm_ack, 2);
+	paper::rpc rpc (system.service, node1, paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "network_stats");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_EQ ("2", response1.json.get<std::string> ("receive_dropped.confirm_ack"));
+	ASSERT_EQ ("0", response1.json.get<std::string> ("receive_dropped.publish"));
+	ASSERT_EQ ("0", response1.json.get<std::string> ("kernel_dropped"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("incoming.keepalive"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("send_dropped.publish"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("ring_full"));
+}
+
+TEST (rpc, callback_stats)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	node1.config.callback_address = "::1";
+	node1.config.callback_port = 24100;
+	node1.config.callback_queue_max = 1;
+	node1.callbacks.add ("{}");
+	node1.callbacks.add ("{}");
+	paper::rpc rpc (system.service, node1, paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "callback_stats");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_EQ ("1", response1.json.get<std::string> ("dropped"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("delivered"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("failed"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("queue"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("connections"));
+}
+
+TEST (rpc, wallet_action_stats)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	system.wallet (0)->insert_adhoc (paper::test_genesis_key.prv);
+	paper::keypair key1;
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key1.pub, 100));
+	paper::rpc rpc (system.service, node1, paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "wallet_action_stats");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_NO_THROW (response1.json.get<std::string> ("queued"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("running"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("accounts"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("completed"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("wait_average"));
+	ASSERT_NO_THROW (response1.json.get<std::string> ("wait_max"));
+	// The one send used either cached or freshly generated work
+	ASSERT_EQ (1, std::stoull (response1.json.get<std::string> ("work_cached")) + std::stoull (response1.json.get<std::string> ("work_waited")));
+}
+
 TEST (rpc, frontier_count)
 {
 	paper::system system (24000, 1);
@@ -1664,7 +2016,7 @@ TEST (rpc, mpaper_to_raw)
 		system.poll ();
 	}
 	ASSERT_EQ (200, response1.status);
-	ASSERT_EQ (paper::Mxrb_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
+	ASSERT_EQ (paper::Mppr_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
 }
 
 TEST (rpc, mpaper_from_raw)
@@ -1676,7 +2028,7 @@ TEST (rpc, mpaper_from_raw)
 	rpc.start ();
 	boost::property_tree::ptree request1;
 	request1.put ("action", "mpaper_from_raw");
-	request1.put ("amount", paper::Mxrb_ratio.convert_to<std::string> ());
+	request1.put ("amount", paper::Mppr_ratio.convert_to<std::string> ());
 	test_response response1 (request1, rpc, system.service);
 	while (response1.status == 0)
 	{
@@ -1702,7 +2054,7 @@ TEST (rpc, kpaper_to_raw)
 		system.poll ();
 	}
 	ASSERT_EQ (200, response1.status);
-	ASSERT_EQ (paper::kxrb_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
+	ASSERT_EQ (paper::kppr_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
 }
 
 TEST (rpc, kpaper_from_raw)
@@ -1714,7 +2066,7 @@ TEST (rpc, kpaper_from_raw)
 	rpc.start ();
 	boost::property_tree::ptree request1;
 	request1.put ("action", "kpaper_from_raw");
-	request1.put ("amount", paper::kxrb_ratio.convert_to<std::string> ());
+	request1.put ("amount", paper::kppr_ratio.convert_to<std::string> ());
 	test_response response1 (request1, rpc, system.service);
 	while (response1.status == 0)
 	{
@@ -1740,7 +2092,7 @@ TEST (rpc, paper_to_raw)
 		system.poll ();
 	}
 	ASSERT_EQ (200, response1.status);
-	ASSERT_EQ (paper::xrb_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
+	ASSERT_EQ (paper::ppr_ratio.convert_to<std::string> (), response1.json.get<std::string> ("amount"));
 }
 
 TEST (rpc, paper_from_raw)
@@ -1752,7 +2104,7 @@ TEST (rpc, paper_from_raw)
 	rpc.start ();
 	boost::property_tree::ptree request1;
 	request1.put ("action", "paper_from_raw");
-	request1.put ("amount", paper::xrb_ratio.convert_to<std::string> ());
+	request1.put ("amount", paper::ppr_ratio.convert_to<std::string> ());
 	test_response response1 (request1, rpc, system.service);
 	while (response1.status == 0)
 	{
@@ -2029,6 +2381,42 @@ TEST (rpc, bootstrap_any)
 	ASSERT_TRUE (success.empty ());
 }
 
+TEST (rpc, bootstrap_status)
+{
+	paper::system system (24000, 1);
+	paper::rpc rpc (system.service, *system.nodes[0], paper::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "bootstrap_status");
+	{
+		test_response response (request, rpc, system.service);
+		while (response.status == 0)
+		{
+			system.poll ();
+		}
+		ASSERT_EQ (200, response.status);
+		ASSERT_EQ ("0", response.json.get<std::string> ("in_progress"));
+	}
+	// Without peers a running attempt stops on its own, stop the initiator's thread so this one stays in place
+	auto & initiator (system.nodes[0]->bootstrap_initiator);
+	initiator.stop ();
+	initiator.attempt = std::make_shared<paper::bootstrap_attempt> (system.nodes[0]);
+	{
+		test_response response (request, rpc, system.service);
+		while (response.status == 0)
+		{
+			system.poll ();
+		}
+		ASSERT_EQ (200, response.status);
+		ASSERT_EQ ("1", response.json.get<std::string> ("in_progress"));
+		ASSERT_EQ ("0", response.json.get<std::string> ("reassembly_size"));
+		ASSERT_EQ ("0", response.json.get<std::string> ("total_blocks"));
+		ASSERT_TRUE (response.json.get_optional<std::string> ("pulls_outstanding").is_initialized ());
+		ASSERT_TRUE (response.json.get_child_optional ("peers").is_initialized ());
+	}
+	initiator.attempt = nullptr;
+}
+
 TEST (rpc, republish)
 {
 	paper::system system (24000, 2);
@@ -3120,7 +3508,7 @@ TEST (rpc, wallet_create_fail)
 	paper::rpc rpc (system.service, *system.nodes[0], paper::rpc_config (true));
 	auto node = system.nodes[0];
 	// lmdb_max_dbs should be removed once the wallet store is refactored to support more wallets.
-	for (int i = 0; i < 113; i++)
+	for (int i = 0; i < 116; i++)
 	{
 		paper::keypair key;
 		node->wallets.create (key.pub);
@@ -3135,3 +3523,122 @@ TEST (rpc, wallet_create_fail)
 	}
 	ASSERT_EQ ("Failed to create wallet. Increase lmdb_max_dbs in node config.", response.json.get<std::string> ("error"));
 }
+
+TEST (rpc, keepalive_pipelining)
+{
+	paper::system system (24000, 1);
+	paper::rpc rpc (system.service, *system.nodes[0], paper::rpc_config (true));
+	rpc.start ();
+	std::atomic<bool> done (false);
+	std::vector<std::string> counts;
+	std::thread client ([&rpc, &done, &counts]() {
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::socket sock (service);
+		boost::system::error_code ec;
+		sock.connect (paper::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), ec);
+		if (!ec)
+		{
+			// Send both requests before reading either response
+			for (auto i (0); i < 2; ++i)
+			{
+				boost::beast::http::request<boost::beast::http::string_body> req;
+				req.method (boost::beast::http::verb::post);
+				req.target ("/");
+				req.version (11);
+				req.keep_alive (true);
+				req.body () = "{\"action\": \"block_count\"}";
+				req.prepare_payload ();
+				boost::beast::http::write (sock, req, ec);
+			}
+			boost::beast::flat_buffer buffer;
+			for (auto i (0); !ec && i < 2; ++i)
+			{
+				boost::beast::http::response<boost::beast::http::string_body> resp;
+				boost::beast::http::read (sock, buffer, resp, ec);
+				if (!ec)
+				{
+					EXPECT_TRUE (resp.keep_alive ());
+					boost::property_tree::ptree json;
+					std::stringstream body (resp.body ());
+					boost::property_tree::read_json (body, json);
+					counts.push_back (json.get<std::string> ("count"));
+				}
+			}
+		}
+		done = true;
+	});
+	while (!done)
+	{
+		system.poll ();
+	}
+	client.join ();
+	ASSERT_EQ (2, counts.size ());
+	ASSERT_EQ ("1", counts[0]);
+	ASSERT_EQ ("1", counts[1]);
+}
+
+TEST (rpc, keepalive_timeout)
+{
+	paper::system system (24000, 1);
+	paper::rpc_config config (true);
+	config.keepalive_timeout = 1;
+	paper::rpc rpc (system.service, *system.nodes[0], config);
+	rpc.start ();
+	std::atomic<bool> done (false);
+	boost::system::error_code closed;
+	std::thread client ([&rpc, &done, &closed]() {
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::socket sock (service);
+		sock.connect (paper::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), closed);
+		if (!closed)
+		{
+			boost::beast::http::request<boost::beast::http::string_body> req;
+			req.method (boost::beast::http::verb::post);
+			req.target ("/");
+			req.version (11);
+			req.keep_alive (true);
+			req.body () = "{\"action\": \"block_count\"}";
+			req.prepare_payload ();
+			boost::beast::http::write (sock, req, closed);
+			boost::beast::flat_buffer buffer;
+			boost::beast::http::response<boost::beast::http::string_body> resp;
+			boost::beast::http::read (sock, buffer, resp, closed);
+			if (!closed)
+			{
+				// Without another request the server closes the connection once it has been idle too long
+				boost::beast::http::response<boost::beast::http::string_body> resp2;
+				boost::beast::http::read (sock, buffer, resp2, closed);
+			}
+		}
+		done = true;
+	});
+	auto iterations (0);
+	while (!done)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 2000);
+	}
+	client.join ();
+	ASSERT_EQ (boost::beast::http::error::end_of_stream, closed);
+}
+
+TEST (rpc, action_limiter)
+{
+	boost::asio::io_service service;
+	paper::rpc_action_limiter limiter (service, { { "ledger", 1 } });
+	ASSERT_TRUE (limiter.limited ("ledger"));
+	ASSERT_FALSE (limiter.limited ("block_count"));
+	auto ran (0);
+	limiter.run ("ledger", [&ran]() { ++ran; });
+	limiter.run ("ledger", [&ran]() { ++ran; });
+	ASSERT_EQ (1, ran);
+	ASSERT_EQ (1, limiter.pending_size ("ledger"));
+	limiter.finished ("ledger");
+	ASSERT_EQ (0, limiter.pending_size ("ledger"));
+	service.poll ();
+	ASSERT_EQ (2, ran);
+	limiter.finished ("ledger");
+	limiter.run ("ledger", [&ran]() { ++ran; });
+	ASSERT_EQ (3, ran);
+}
@@ -63,31 +63,31 @@ struct test_punct : std::moneypunct<char>
 
 TEST (uint128_union, balance_format)
 {
-	ASSERT_EQ ("0", paper::amount (paper::uint128_t ("0")).format_balance (paper::Mxrb_ratio, 0, false));
-	ASSERT_EQ ("0", paper::amount (paper::uint128_t ("0")).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("340,282,366", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF")).format_balance (paper::Mxrb_ratio, 0, true));
-	ASSERT_EQ ("340,282,366.920938463463374607431768211455", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF")).format_balance (paper::Mxrb_ratio, 64, true));
+	ASSERT_EQ ("0", paper::amount (paper::uint128_t ("0")).format_balance (paper::Mppr_ratio, 0, false));
+	ASSERT_EQ ("0", paper::amount (paper::uint128_t ("0")).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("340,282,366", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF")).format_balance (paper::Mppr_ratio, 0, true));
+	ASSERT_EQ ("340,282,366.920938463463374607431768211455", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF")).format_balance (paper::Mppr_ratio, 64, true));
 	ASSERT_EQ ("340,282,366,920,938,463,463,374,607,431,768,211,455", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF")).format_balance (1, 4, true));
-	ASSERT_EQ ("340,282,366", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mxrb_ratio, 0, true));
-	ASSERT_EQ ("340,282,366.920938463463374607431768211454", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mxrb_ratio, 64, true));
+	ASSERT_EQ ("340,282,366", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mppr_ratio, 0, true));
+	ASSERT_EQ ("340,282,366.920938463463374607431768211454", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mppr_ratio, 64, true));
 	ASSERT_EQ ("340282366920938463463374607431768211454", paper::amount (paper::uint128_t ("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (1, 4, false));
-	ASSERT_EQ ("170,141,183", paper::amount (paper::uint128_t ("0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mxrb_ratio, 0, true));
-	ASSERT_EQ ("170,141,183.460469231731687303715884105726", paper::amount (paper::uint128_t ("0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mxrb_ratio, 64, true));
+	ASSERT_EQ ("170,141,183", paper::amount (paper::uint128_t ("0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mppr_ratio, 0, true));
+	ASSERT_EQ ("170,141,183.460469231731687303715884105726", paper::amount (paper::uint128_t ("0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (paper::Mppr_ratio, 64, true));
 	ASSERT_EQ ("170141183460469231731687303715884105726", paper::amount (paper::uint128_t ("0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE")).format_balance (1, 4, false));
-	ASSERT_EQ ("1", paper::amount (paper::uint128_t ("1000000000000000000000000000000")).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("1.2", paper::amount (paper::uint128_t ("1200000000000000000000000000000")).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("1.23", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("1.2", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mxrb_ratio, 1, true));
-	ASSERT_EQ ("1", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mxrb_ratio, 0, true));
-	ASSERT_EQ ("< 0.01", paper::amount (paper::xrb_ratio * 10).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("< 0.1", paper::amount (paper::xrb_ratio * 10).format_balance (paper::Mxrb_ratio, 1, true));
-	ASSERT_EQ ("< 1", paper::amount (paper::xrb_ratio * 10).format_balance (paper::Mxrb_ratio, 0, true));
-	ASSERT_EQ ("< 0.01", paper::amount (paper::xrb_ratio * 9999).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("0.01", paper::amount (paper::xrb_ratio * 10000).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("123456789", paper::amount (paper::Mxrb_ratio * 123456789).format_balance (paper::Mxrb_ratio, 2, false));
-	ASSERT_EQ ("123,456,789", paper::amount (paper::Mxrb_ratio * 123456789).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("123,456,789.12", paper::amount (paper::Mxrb_ratio * 123456789 + paper::kxrb_ratio * 123).format_balance (paper::Mxrb_ratio, 2, true));
-	ASSERT_EQ ("12-3456-789+123", paper::amount (paper::Mxrb_ratio * 123456789 + paper::kxrb_ratio * 123).format_balance (paper::Mxrb_ratio, 4, true, std::locale (std::cout.getloc (), new test_punct)));
+	ASSERT_EQ ("1", paper::amount (paper::uint128_t ("1000000000000000000000000000000")).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("1.2", paper::amount (paper::uint128_t ("1200000000000000000000000000000")).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("1.23", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("1.2", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mppr_ratio, 1, true));
+	ASSERT_EQ ("1", paper::amount (paper::uint128_t ("1230000000000000000000000000000")).format_balance (paper::Mppr_ratio, 0, true));
+	ASSERT_EQ ("< 0.01", paper::amount (paper::ppr_ratio * 10).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("< 0.1", paper::amount (paper::ppr_ratio * 10).format_balance (paper::Mppr_ratio, 1, true));
+	ASSERT_EQ ("< 1", paper::amount (paper::ppr_ratio * 10).format_balance (paper::Mppr_ratio, 0, true));
+	ASSERT_EQ ("< 0.01", paper::amount (paper::ppr_ratio * 9999).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("0.01", paper::amount (paper::ppr_ratio * 10000).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("123456789", paper::amount (paper::Mppr_ratio * 123456789).format_balance (paper::Mppr_ratio, 2, false));
+	ASSERT_EQ ("123,456,789", paper::amount (paper::Mppr_ratio * 123456789).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("123,456,789.12", paper::amount (paper::Mppr_ratio * 123456789 + paper::kppr_ratio * 123).format_balance (paper::Mppr_ratio, 2, true));
+	ASSERT_EQ ("12-3456-789+123", paper::amount (paper::Mppr_ratio * 123456789 + paper::kppr_ratio * 123).format_balance (paper::Mppr_ratio, 4, true, std::locale (std::cout.getloc (), new test_punct)));
 }
 
 TEST (unions, identity)
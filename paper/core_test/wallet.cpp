@@ -871,11 +871,11 @@ TEST (wallet, send_race)
 	paper::keypair key2;
 	system.nodes[0]->block_processor.stop ();
 	{
-		ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, paper::Gxrb_ratio));
-		ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, paper::Gxrb_ratio));
+		ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, paper::Gppr_ratio));
+		ASSERT_NE (nullptr, system.wallet (0)->send_action (paper::test_genesis_key.pub, key2.pub, paper::Gppr_ratio));
 	}
 	auto iterations (0);
-	while (system.nodes[0]->balance (paper::test_genesis_key.pub) != paper::genesis_amount - paper::Gxrb_ratio * 2)
+	while (system.nodes[0]->balance (paper::test_genesis_key.pub) != paper::genesis_amount - paper::Gppr_ratio * 2)
 	{
 		system.poll ();
 		++iterations;
@@ -978,3 +978,82 @@ TEST (wallet, password_race_corrupt_seed)
 		}
 	}
 }
+
+TEST (wallet, work_precompute_external)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	wallet->insert_adhoc (paper::test_genesis_key.prv);
+	paper::keypair key2;
+	paper::block_hash latest (node1.latest (paper::test_genesis_key.pub));
+	// A block for a wallet account created outside the wallet
+	auto send (std::make_shared<paper::send_block> (latest, key2.pub, paper::genesis_amount - 100, paper::test_genesis_key.prv, paper::test_genesis_key.pub, system.work.generate (latest)));
+	node1.process_active (send);
+	auto iterations (0);
+	auto done (false);
+	while (!done)
+	{
+		{
+			paper::transaction transaction (node1.store.environment, nullptr, false);
+			uint64_t work;
+			ASSERT_FALSE (wallet->store.work_get (transaction, paper::test_genesis_key.pub, work));
+			done = node1.latest (paper::test_genesis_key.pub) == send->hash () && !paper::work_validate (send->hash (), work);
+		}
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	auto cached (node1.wallets.work_cached.load ());
+	auto waited (node1.wallets.work_waited.load ());
+	ASSERT_NE (nullptr, wallet->send_action (paper::test_genesis_key.pub, key2.pub, 100));
+	ASSERT_EQ (cached + 1, node1.wallets.work_cached);
+	ASSERT_EQ (waited, node1.wallets.work_waited);
+}
+
+TEST (wallet, exists_mem)
+{
+	paper::system system (24000, 1);
+	auto wallet (system.wallet (0));
+	paper::keypair key1;
+	ASSERT_FALSE (wallet->store.exists_mem (key1.pub));
+	{
+		paper::transaction transaction (wallet->store.environment, nullptr, true);
+		wallet->store.insert_adhoc (transaction, key1.prv);
+	}
+	ASSERT_TRUE (wallet->store.exists_mem (key1.pub));
+	ASSERT_FALSE (wallet->store.exists_mem (paper::wallet_store::seed_special));
+	{
+		paper::transaction transaction (wallet->store.environment, nullptr, true);
+		wallet->store.erase (transaction, key1.pub);
+	}
+	ASSERT_FALSE (wallet->store.exists_mem (key1.pub));
+}
+
+TEST (wallet, work_precompute_uncached)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	paper::keypair key1;
+	{
+		// Inserted without generating work, the entry's work is zero
+		paper::transaction transaction (wallet->store.environment, nullptr, true);
+		wallet->store.insert_adhoc (transaction, key1.prv);
+	}
+	node1.wallets.work_precompute (key1.pub);
+	auto iterations (0);
+	auto done (false);
+	while (!done)
+	{
+		{
+			paper::transaction transaction (node1.store.environment, nullptr, false);
+			uint64_t work;
+			ASSERT_FALSE (wallet->store.work_get (transaction, key1.pub, work));
+			done = !paper::work_validate (key1.pub, work);
+		}
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+}
@@ -76,7 +76,7 @@ TEST (wallets, wallet_create_max)
 	paper::system system (24000, 1);
 	bool error (false);
 	paper::wallets wallets (error, *system.nodes[0]);
-	const int nonWalletDbs = 17;
+	const int nonWalletDbs = 15;
 	for (int i = 0; i < system.nodes[0]->config.lmdb_max_dbs - nonWalletDbs; i++)
 	{
 		paper::keypair key;
@@ -93,3 +93,76 @@ TEST (wallets, wallet_create_max)
 	auto existing = wallets.items.find (key.pub);
 	ASSERT_TRUE (existing == wallets.items.end ());
 }
+
+TEST (wallets, actions_account_ordering)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	ASSERT_LT (1, node1.config.wallet_threads);
+	paper::keypair key1;
+	paper::keypair key2;
+	std::promise<void> release;
+	auto released (release.get_future ().share ());
+	std::mutex mutex;
+	std::vector<int> order;
+	node1.wallets.queue_wallet_action (paper::wallets::high_priority, key1.pub, [released, &mutex, &order]() {
+		released.wait ();
+		std::lock_guard<std::mutex> lock (mutex);
+		order.push_back (1);
+	});
+	node1.wallets.queue_wallet_action (paper::wallets::high_priority, key1.pub, [&mutex, &order]() {
+		std::lock_guard<std::mutex> lock (mutex);
+		order.push_back (2);
+	});
+	// An action for another account isn't held up behind the blocked one
+	std::promise<void> other;
+	node1.wallets.queue_wallet_action (paper::wallets::high_priority, key2.pub, [&other]() {
+		other.set_value ();
+	});
+	ASSERT_EQ (std::future_status::ready, other.get_future ().wait_for (std::chrono::seconds (10)));
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		ASSERT_TRUE (order.empty ());
+	}
+	release.set_value ();
+	auto deadline (std::chrono::steady_clock::now () + std::chrono::seconds (10));
+	auto done ([&]() {
+		std::lock_guard<std::mutex> lock (mutex);
+		return node1.wallets.actions_size () == 0 && order.size () == 2;
+	});
+	while (!done ())
+	{
+		system.poll ();
+		ASSERT_LT (std::chrono::steady_clock::now (), deadline);
+	}
+	std::lock_guard<std::mutex> lock (mutex);
+	ASSERT_EQ (std::vector<int> ({ 1, 2 }), order);
+}
+
+TEST (wallets, actions_observer)
+{
+	paper::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	std::mutex mutex;
+	std::vector<bool> states;
+	// The observer may call back into wallets, it's invoked without the wallets mutex held
+	node1.wallets.observer = [&node1, &mutex, &states](bool active_a) {
+		node1.wallets.actions_size ();
+		std::lock_guard<std::mutex> lock (mutex);
+		states.push_back (active_a);
+	};
+	paper::keypair key1;
+	node1.wallets.queue_wallet_action (paper::wallets::high_priority, key1.pub, []() {});
+	auto deadline (std::chrono::steady_clock::now () + std::chrono::seconds (10));
+	auto done ([&]() {
+		std::lock_guard<std::mutex> lock (mutex);
+		return states.size () == 2;
+	});
+	while (!done ())
+	{
+		system.poll ();
+		ASSERT_LT (std::chrono::steady_clock::now (), deadline);
+	}
+	std::lock_guard<std::mutex> lock (mutex);
+	ASSERT_EQ (std::vector<bool> ({ true, false }), states);
+}
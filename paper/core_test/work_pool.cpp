@@ -20,6 +20,49 @@ TEST (work, validate)
 	ASSERT_FALSE (paper::work_validate (send_block));
 }
 
+TEST (work, kernels)
+{
+	auto & kernels (paper::work_kernels ());
+	ASSERT_FALSE (kernels.empty ());
+	ASSERT_EQ (std::string ("scalar"), kernels.front ().name);
+	paper::uint256_union root;
+	paper::random_pool.GenerateBlock (root.bytes.data (), root.bytes.size ());
+	for (auto & kernel : kernels)
+	{
+		ASSERT_LE (kernel.lanes, paper::work_kernel::max_lanes);
+		std::array<uint64_t, paper::work_kernel::max_lanes> nonces;
+		std::array<uint64_t, paper::work_kernel::max_lanes> values;
+		for (auto i (0); i < 16; ++i)
+		{
+			paper::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (nonces.data ()), nonces.size () * sizeof (uint64_t));
+			kernel.values (root, nonces.data (), values.data ());
+			for (size_t j (0); j < kernel.lanes; ++j)
+			{
+				ASSERT_EQ (paper::work_value (root, nonces[j]), values[j]);
+			}
+		}
+	}
+}
+
+TEST (work, validate_many)
+{
+	paper::work_pool pool (std::numeric_limits<unsigned>::max (), nullptr);
+	std::vector<std::pair<paper::block_hash, uint64_t>> items;
+	for (auto i (0); i < 13; ++i)
+	{
+		paper::block_hash root (i + 1);
+		items.push_back (std::make_pair (root, i % 3 == 0 ? pool.generate (root) : i));
+	}
+	auto result (paper::work_validate (items));
+	ASSERT_EQ (items.size (), result.size ());
+	for (size_t i (0); i < items.size (); ++i)
+	{
+		ASSERT_EQ (paper::work_validate (items[i].first, items[i].second), result[i]);
+	}
+	ASSERT_FALSE (result[0]);
+	ASSERT_TRUE (paper::work_validate (std::vector<std::pair<paper::block_hash, uint64_t>> ()).empty ());
+}
+
 TEST (work, cancel)
 {
 	paper::work_pool pool (std::numeric_limits<unsigned>::max (), nullptr);
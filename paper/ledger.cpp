@@ -1,7 +1,10 @@
 #include <paper/blockstore.hpp>
 #include <paper/ledger.hpp>
+#include <paper/lib/work.hpp>
 #include <paper/node/common.hpp>
 
+#include <thread>
+
 namespace
 {
 /**
@@ -100,17 +103,25 @@ public:
 class ledger_processor : public paper::block_visitor
 {
 public:
-	ledger_processor (paper::ledger &, MDB_txn *);
+	ledger_processor (paper::ledger &, MDB_txn *, paper::signature_verification);
 	virtual ~ledger_processor () = default;
 	void send_block (paper::send_block const &) override;
 	void receive_block (paper::receive_block const &) override;
 	void open_block (paper::open_block const &) override;
 	void change_block (paper::change_block const &) override;
+	bool bad_signature (paper::account const &, paper::block_hash const &, paper::signature const &);
 	paper::ledger & ledger;
 	MDB_txn * transaction;
+	paper::signature_verification verification;
 	paper::process_return result;
 };
 
+// Signatures checked by a batch verification stage don't need to be checked again
+bool ledger_processor::bad_signature (paper::account const & account_a, paper::block_hash const & hash_a, paper::signature const & signature_a)
+{
+	return verification != paper::signature_verification::valid && paper::validate_message (account_a, hash_a, signature_a);
+}
+
 void ledger_processor::change_block (paper::change_block const & block_a)
 {
 	auto hash (block_a.hash ());
@@ -130,7 +141,7 @@ void ledger_processor::change_block (paper::change_block const & block_a)
 				auto latest_error (ledger.store.account_get (transaction, account, info));
 				assert (!latest_error);
 				assert (info.head == block_a.hashables.previous);
-				result.code = validate_message (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is this block signed correctly (Malformed)
+				result.code = bad_signature (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is this block signed correctly (Malformed)
 				if (result.code == paper::process_result::progress)
 				{
 					ledger.store.block_put (transaction, hash, block_a);
@@ -163,7 +174,7 @@ void ledger_processor::send_block (paper::send_block const & block_a)
 			result.code = account.is_zero () ? paper::process_result::fork : paper::process_result::progress;
 			if (result.code == paper::process_result::progress)
 			{
-				result.code = validate_message (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is this block signed correctly (Malformed)
+				result.code = bad_signature (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is this block signed correctly (Malformed)
 				if (result.code == paper::process_result::progress)
 				{
 					paper::account_info info;
@@ -204,7 +215,7 @@ void ledger_processor::receive_block (paper::receive_block const & block_a)
 			result.code = account.is_zero () ? paper::process_result::gap_previous : paper::process_result::progress; //Have we seen the previous block? No entries for account at all (Harmless)
 			if (result.code == paper::process_result::progress)
 			{
-				result.code = paper::validate_message (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is the signature valid (Malformed)
+				result.code = bad_signature (account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is the signature valid (Malformed)
 				if (result.code == paper::process_result::progress)
 				{
 					paper::account_info info;
@@ -252,7 +263,7 @@ void ledger_processor::open_block (paper::open_block const & block_a)
 		result.code = source_missing ? paper::process_result::gap_source : paper::process_result::progress; // Have we seen the source block? (Harmless)
 		if (result.code == paper::process_result::progress)
 		{
-			result.code = paper::validate_message (block_a.hashables.account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is the signature valid (Malformed)
+			result.code = bad_signature (block_a.hashables.account, hash, block_a.signature) ? paper::process_result::bad_signature : paper::process_result::progress; // Is the signature valid (Malformed)
 			if (result.code == paper::process_result::progress)
 			{
 				paper::account_info info;
@@ -285,9 +296,10 @@ void ledger_processor::open_block (paper::open_block const & block_a)
 	}
 }
 
-ledger_processor::ledger_processor (paper::ledger & ledger_a, MDB_txn * transaction_a) :
+ledger_processor::ledger_processor (paper::ledger & ledger_a, MDB_txn * transaction_a, paper::signature_verification verification_a) :
 ledger (ledger_a),
-transaction (transaction_a)
+transaction (transaction_a),
+verification (verification_a)
 {
 }
 } // namespace
@@ -377,9 +389,9 @@ paper::uint128_t paper::ledger::account_pending (MDB_txn * transaction_a, paper:
 	return result;
 }
 
-paper::process_return paper::ledger::process (MDB_txn * transaction_a, paper::block const & block_a)
+paper::process_return paper::ledger::process (MDB_txn * transaction_a, paper::block const & block_a, paper::signature_verification verification_a)
 {
-	ledger_processor processor (*this, transaction_a);
+	ledger_processor processor (*this, transaction_a, verification_a);
 	block_a.visit (processor);
 	return processor.result;
 }
@@ -568,6 +580,11 @@ void paper::ledger::change_latest (MDB_txn * transaction_a, paper::account const
 	if (exists)
 	{
 		checksum_update (transaction_a, info.head);
+		if (block_count_a < info.block_count)
+		{
+			// Rolling back the head
+			store.height_del (transaction_a, account_a, info.block_count);
+		}
 	}
 	else
 	{
@@ -582,6 +599,7 @@ void paper::ledger::change_latest (MDB_txn * transaction_a, paper::account const
 		info.modified = paper::seconds_since_epoch ();
 		info.block_count = block_count_a;
 		store.account_put (transaction_a, account_a, info);
+		store.height_put (transaction_a, account_a, block_count_a, hash_a);
 		if (!(block_count_a % store.block_info_max))
 		{
 			paper::block_info block_info;
@@ -635,3 +653,271 @@ std::unique_ptr<paper::block> paper::ledger::forked_block (MDB_txn * transaction
 	}
 	return result;
 }
+
+namespace paper
+{
+// Blocks whose signatures and work are checked together
+class ledger_validation_batch
+{
+public:
+	std::vector<paper::block_hash> hashes;
+	std::vector<paper::signature> signatures;
+	std::vector<paper::account> accounts;
+	std::vector<std::pair<paper::block_hash, uint64_t>> work;
+};
+}
+
+size_t constexpr paper::ledger_validator::errors_max;
+size_t constexpr paper::ledger_validator::batch_size;
+
+paper::ledger_validator::ledger_validator (paper::ledger & ledger_a) :
+ledger (ledger_a),
+accounts (0),
+blocks (0),
+pending (0),
+elapsed (0),
+error_count (0)
+{
+}
+
+bool paper::ledger_validator::validate (unsigned threads_a)
+{
+	auto begin (std::chrono::steady_clock::now ());
+	std::vector<std::pair<paper::account, paper::account_info>> account_infos;
+	paper::checksum checksum (0);
+	{
+		paper::transaction transaction (ledger.store.environment, nullptr, false);
+		for (auto i (ledger.store.latest_begin (transaction)), n (ledger.store.latest_end ()); i != n; ++i)
+		{
+			account_infos.push_back (std::make_pair (paper::account (i->first.uint256 ()), paper::account_info (i->second)));
+			checksum ^= account_infos.back ().second.head;
+		}
+	}
+	// Each thread takes a run of accounts at a time and tallies representative weights on its own
+	std::vector<std::unordered_map<paper::account, paper::uint128_t>> weights (std::max (1u, threads_a));
+	std::atomic<size_t> next (0);
+	size_t const accounts_per_take (64);
+	std::vector<std::thread> threads;
+	for (auto & weights_l : weights)
+	{
+		threads.push_back (std::thread ([this, &account_infos, &next, &weights_l, accounts_per_take]() {
+			paper::transaction transaction (ledger.store.environment, nullptr, false);
+			paper::ledger_validation_batch batch;
+			for (auto i (next.fetch_add (accounts_per_take)); i < account_infos.size (); i = next.fetch_add (accounts_per_take))
+			{
+				for (auto j (i), n (std::min (i + accounts_per_take, account_infos.size ())); j < n; ++j)
+				{
+					validate_account (transaction, account_infos[j].first, account_infos[j].second, weights_l, batch);
+				}
+			}
+			validate_batch (batch);
+		}));
+	}
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
+	std::unordered_map<paper::account, paper::uint128_t> totals;
+	for (auto & i : weights)
+	{
+		for (auto & j : i)
+		{
+			totals[j.first] += j.second;
+		}
+	}
+	paper::transaction transaction (ledger.store.environment, nullptr, false);
+	validate_weights (transaction, totals);
+	validate_pending (transaction);
+	auto stored_count (ledger.store.block_count (transaction).sum ());
+	if (stored_count != blocks)
+	{
+		error (boost::str (boost::format ("Block count is %1% but account chains hold %2% blocks") % stored_count % blocks));
+	}
+	auto stored_checksum (ledger.checksum (transaction, 0, std::numeric_limits<paper::uint256_t>::max ()));
+	if (stored_checksum != checksum)
+	{
+		error (boost::str (boost::format ("Ledger checksum is %1% but account heads give %2%") % stored_checksum.to_string () % checksum.to_string ()));
+	}
+	elapsed = std::chrono::steady_clock::now () - begin;
+	std::lock_guard<std::mutex> lock (mutex);
+	return error_count != 0;
+}
+
+void paper::ledger_validator::validate_account (MDB_txn * transaction_a, paper::account const & account_a, paper::account_info const & info_a, std::unordered_map<paper::account, paper::uint128_t> & weights_a, paper::ledger_validation_batch & batch_a)
+{
+	++accounts;
+	uint64_t count (0);
+	auto hash (info_a.head);
+	auto open (hash);
+	auto complete (true);
+	while (!hash.is_zero () && complete)
+	{
+		auto block (ledger.store.block_get (transaction_a, hash));
+		if (block != nullptr)
+		{
+			++count;
+			if (count <= info_a.block_count && ledger.store.height_get (transaction_a, account_a, info_a.block_count - count + 1) != hash)
+			{
+				error (boost::str (boost::format ("Account %1% height %2% isn't indexed as block %3%") % account_a.to_account () % (info_a.block_count - count + 1) % hash.to_string ()));
+			}
+			batch_a.hashes.push_back (hash);
+			batch_a.signatures.push_back (block->block_signature ());
+			batch_a.accounts.push_back (account_a);
+			batch_a.work.push_back (std::make_pair (block->root (), block->block_work ()));
+			if (batch_a.hashes.size () >= batch_size)
+			{
+				validate_batch (batch_a);
+			}
+			open = hash;
+			hash = block->previous ();
+			if (hash.is_zero ())
+			{
+				auto open_block (dynamic_cast<paper::open_block *> (block.get ()));
+				if (open_block == nullptr || open_block->hashables.account != account_a)
+				{
+					error (boost::str (boost::format ("Account %1% chain ends in block %2% which is not its open block") % account_a.to_account () % open.to_string ()));
+				}
+			}
+		}
+		else
+		{
+			error (boost::str (boost::format ("Account %1% is missing block %2%") % account_a.to_account () % hash.to_string ()));
+			complete = false;
+		}
+	}
+	blocks += count;
+	if (complete)
+	{
+		if (open != info_a.open_block)
+		{
+			error (boost::str (boost::format ("Account %1% open block is %2% but its chain starts at %3%") % account_a.to_account () % info_a.open_block.to_string () % open.to_string ()));
+		}
+		if (count != info_a.block_count)
+		{
+			error (boost::str (boost::format ("Account %1% block count is %2% but its chain has %3% blocks") % account_a.to_account () % info_a.block_count % count));
+		}
+		if (!ledger.store.height_get (transaction_a, account_a, info_a.block_count + 1).is_zero ())
+		{
+			error (boost::str (boost::format ("Account %1% has heights indexed past its head") % account_a.to_account ()));
+		}
+		auto balance (ledger.balance (transaction_a, info_a.head));
+		if (balance != info_a.balance.number ())
+		{
+			error (boost::str (boost::format ("Account %1% balance is %2% but its head block gives %3%") % account_a.to_account () % info_a.balance.number ().convert_to<std::string> () % balance.convert_to<std::string> ()));
+		}
+		auto rep_block (ledger.representative_calculated (transaction_a, info_a.head));
+		if (rep_block != info_a.rep_block)
+		{
+			error (boost::str (boost::format ("Account %1% representative block is %2% but its chain gives %3%") % account_a.to_account () % info_a.rep_block.to_string () % rep_block.to_string ()));
+		}
+		auto block (ledger.store.block_get (transaction_a, rep_block));
+		if (block != nullptr)
+		{
+			weights_a[block->representative ()] += info_a.balance.number ();
+		}
+	}
+	if (ledger.store.frontier_get (transaction_a, info_a.head) != account_a)
+	{
+		error (boost::str (boost::format ("Account %1% head %2% has no frontier entry") % account_a.to_account () % info_a.head.to_string ()));
+	}
+}
+
+void paper::ledger_validator::validate_batch (paper::ledger_validation_batch & batch_a)
+{
+	auto size (batch_a.hashes.size ());
+	if (size > 0)
+	{
+		std::vector<unsigned char const *> messages (size);
+		std::vector<size_t> lengths (size, sizeof (paper::block_hash));
+		std::vector<unsigned char const *> pub_keys (size);
+		std::vector<unsigned char const *> signatures (size);
+		std::vector<int> valid (size);
+		for (size_t i (0); i < size; ++i)
+		{
+			messages[i] = batch_a.hashes[i].bytes.data ();
+			pub_keys[i] = batch_a.accounts[i].bytes.data ();
+			signatures[i] = batch_a.signatures[i].bytes.data ();
+		}
+		paper::validate_message_batch (messages.data (), lengths.data (), pub_keys.data (), signatures.data (), size, valid.data ());
+		auto work (paper::work_validate (batch_a.work));
+		for (size_t i (0); i < size; ++i)
+		{
+			if (valid[i] != 1)
+			{
+				error (boost::str (boost::format ("Block %1% has a bad signature") % batch_a.hashes[i].to_string ()));
+			}
+			if (work[i])
+			{
+				error (boost::str (boost::format ("Block %1% has insufficient work") % batch_a.hashes[i].to_string ()));
+			}
+		}
+		batch_a.hashes.clear ();
+		batch_a.signatures.clear ();
+		batch_a.accounts.clear ();
+		batch_a.work.clear ();
+	}
+}
+
+void paper::ledger_validator::validate_weights (MDB_txn * transaction_a, std::unordered_map<paper::account, paper::uint128_t> const & weights_a)
+{
+	auto remaining (weights_a);
+	for (auto i (ledger.store.representation_begin (transaction_a)), n (ledger.store.representation_end ()); i != n; ++i)
+	{
+		paper::account representative (i->first.uint256 ());
+		paper::uint128_union stored;
+		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		paper::read (stream, stored);
+		paper::uint128_t calculated (0);
+		auto existing (remaining.find (representative));
+		if (existing != remaining.end ())
+		{
+			calculated = existing->second;
+			remaining.erase (existing);
+		}
+		if (stored.number () != calculated)
+		{
+			error (boost::str (boost::format ("Representative %1% weight is %2% but account balances give %3%") % representative.to_account () % stored.number ().convert_to<std::string> () % calculated.convert_to<std::string> ()));
+		}
+	}
+	for (auto & i : remaining)
+	{
+		if (i.second != 0)
+		{
+			error (boost::str (boost::format ("Representative %1% has no weight entry but account balances give %2%") % i.first.to_account () % i.second.convert_to<std::string> ()));
+		}
+	}
+}
+
+void paper::ledger_validator::validate_pending (MDB_txn * transaction_a)
+{
+	for (auto i (ledger.store.pending_begin (transaction_a)), n (ledger.store.pending_end ()); i != n; ++i)
+	{
+		++pending;
+		paper::pending_key key (i->first);
+		paper::pending_info info (i->second);
+		auto block (ledger.store.block_get (transaction_a, key.hash));
+		auto send (dynamic_cast<paper::send_block *> (block.get ()));
+		if (send == nullptr || send->hashables.destination != key.account)
+		{
+			error (boost::str (boost::format ("Pending entry for %1% refers to %2% which is not a send to that account") % key.account.to_account () % key.hash.to_string ()));
+		}
+		else
+		{
+			auto amount (ledger.amount (transaction_a, key.hash));
+			if (amount != info.amount.number () || ledger.account (transaction_a, key.hash) != info.source)
+			{
+				error (boost::str (boost::format ("Pending entry for %1% from send %2% doesn't match the send") % key.account.to_account () % key.hash.to_string ()));
+			}
+		}
+	}
+}
+
+void paper::ledger_validator::error (std::string const & error_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	if (errors.size () < errors_max)
+	{
+		errors.push_back (error_a);
+	}
+	++error_count;
+}
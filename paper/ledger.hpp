@@ -36,7 +36,7 @@ public:
 	std::string block_text (char const *);
 	std::string block_text (paper::block_hash const &);
 	paper::uint128_t supply (MDB_txn *);
-	paper::process_return process (MDB_txn *, paper::block const &);
+	paper::process_return process (MDB_txn *, paper::block const &, paper::signature_verification = paper::signature_verification::unknown);
 	void rollback (MDB_txn *, paper::block_hash const &);
 	void change_latest (MDB_txn *, paper::account const &, paper::block_hash const &, paper::account const &, paper::uint128_union const &, uint64_t);
 	void checksum_update (MDB_txn *, paper::block_hash const &);
@@ -49,4 +49,33 @@ public:
 	uint64_t bootstrap_weight_max_blocks;
 	std::atomic<bool> check_bootstrap_weights;
 };
+class ledger_validation_batch;
+/**
+ * Offline consistency check of a whole ledger
+ * Account chains are split across threads, every block's signature and work are rechecked in batches,
+ * and the weights, block counts, pending entries and checksum the ledger derives from the chains are recomputed and compared against the store
+ */
+class ledger_validator
+{
+public:
+	ledger_validator (paper::ledger &);
+	// Returns true if any inconsistency was found
+	bool validate (unsigned);
+	void validate_account (MDB_txn *, paper::account const &, paper::account_info const &, std::unordered_map<paper::account, paper::uint128_t> &, paper::ledger_validation_batch &);
+	void validate_batch (paper::ledger_validation_batch &);
+	void validate_weights (MDB_txn *, std::unordered_map<paper::account, paper::uint128_t> const &);
+	void validate_pending (MDB_txn *);
+	void error (std::string const &);
+	paper::ledger & ledger;
+	std::atomic<uint64_t> accounts;
+	std::atomic<uint64_t> blocks;
+	std::atomic<uint64_t> pending;
+	std::chrono::steady_clock::duration elapsed;
+	std::mutex mutex;
+	// First errors_max errors found, error_count keeps counting past that
+	std::vector<std::string> errors;
+	uint64_t error_count;
+	static size_t constexpr errors_max = 1000;
+	static size_t constexpr batch_size = 256;
+};
 };
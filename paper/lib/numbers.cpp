@@ -118,7 +118,9 @@ bool paper::uint256_union::decode_account (std::string const & source_a)
 	auto error (source_a.size () != 64);
 	if (!error)
 	{
-		if (source_a[0] == 'x' && source_a[1] == 'r' && source_a[2] == 'b' && (source_a[3] == '_' || source_a[3] == '-'))
+		auto xrb_prefix (source_a[0] == 'x' && source_a[1] == 'r' && source_a[2] == 'b');
+		auto ppr_prefix (source_a[0] == 'p' && source_a[1] == 'p' && source_a[2] == 'r');
+		if ((xrb_prefix || ppr_prefix) && (source_a[3] == '_' || source_a[3] == '-'))
 		{
 			paper::uint512_t number_l;
 			for (auto i (source_a.begin () + 4), j (source_a.end ()); !error && i != j; ++i)
@@ -249,7 +251,7 @@ void paper::uint256_union::encode_hex (std::string & text) const
 {
 	assert (text.empty ());
 	std::stringstream stream;
-	stream << std::hex << std::noshowbase << std::setw (64) << std::setfill ('0');
+	stream << std::hex << std::uppercase << std::noshowbase << std::setw (64) << std::setfill ('0');
 	stream << number ();
 	text = stream.str ();
 }
@@ -364,7 +366,7 @@ void paper::uint512_union::encode_hex (std::string & text) const
 {
 	assert (text.empty ());
 	std::stringstream stream;
-	stream << std::hex << std::noshowbase << std::setw (128) << std::setfill ('0');
+	stream << std::hex << std::uppercase << std::noshowbase << std::setw (128) << std::setfill ('0');
 	stream << number ();
 	text = stream.str ();
 }
@@ -459,6 +461,12 @@ bool paper::validate_message (paper::public_key const & public_key, paper::uint2
 	return result;
 }
 
+bool paper::validate_message_batch (unsigned char const ** m, size_t * mlen, unsigned char const ** pk, unsigned char const ** RS, size_t num, int * valid)
+{
+	auto result (0 != ed25519_sign_open_batch (m, mlen, pk, RS, num, valid));
+	return result;
+}
+
 paper::uint128_union::uint128_union (std::string const & string_a)
 {
 	decode_hex (string_a);
@@ -516,7 +524,7 @@ void paper::uint128_union::encode_hex (std::string & text) const
 {
 	assert (text.empty ());
 	std::stringstream stream;
-	stream << std::hex << std::noshowbase << std::setw (32) << std::setfill ('0');
+	stream << std::hex << std::uppercase << std::noshowbase << std::setw (32) << std::setfill ('0');
 	stream << number ();
 	text = stream.str ();
 }
@@ -124,6 +124,8 @@ using signature = uint512_union;
 
 paper::uint512_union sign_message (paper::raw_key const &, paper::public_key const &, paper::uint256_union const &);
 bool validate_message (paper::public_key const &, paper::uint256_union const &, paper::uint512_union const &);
+// Validate `num' signatures at once, valid[i] is set to 1 for each good signature and 0 otherwise. Returns true if any signature is bad
+bool validate_message_batch (unsigned char const **, size_t *, unsigned char const **, unsigned char const **, size_t, int *);
 void deterministic_key (paper::uint256_union const &, uint32_t, paper::uint256_union &);
 }
 
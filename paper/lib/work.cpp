@@ -3,8 +3,14 @@
 #include <paper/lib/blocks.hpp>
 #include <paper/node/xorshift.hpp>
 
+#include <array>
+#include <cstring>
 #include <future>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PAPER_WORK_LANES 1
+#endif
+
 bool paper::work_validate (paper::block_hash const & root_a, uint64_t work_a)
 {
 	return paper::work_value (root_a, work_a) < paper::work_pool::publish_threshold;
@@ -15,6 +21,32 @@ bool paper::work_validate (paper::block const & block_a)
 	return work_validate (block_a.root (), block_a.block_work ());
 }
 
+std::vector<bool> paper::work_validate (std::vector<std::pair<paper::block_hash, uint64_t>> const & items_a)
+{
+	std::vector<bool> result;
+	result.reserve (items_a.size ());
+	auto & kernel (paper::work_kernels ().back ());
+	std::array<paper::block_hash, paper::work_kernel::max_lanes> roots;
+	std::array<uint64_t, paper::work_kernel::max_lanes> nonces;
+	std::array<uint64_t, paper::work_kernel::max_lanes> values;
+	for (size_t i (0), n (items_a.size ()); i < n; i += kernel.lanes)
+	{
+		for (size_t j (0); j < kernel.lanes; ++j)
+		{
+			// Lanes past the end of the batch repeat the last item, their values are ignored
+			auto & item (items_a[std::min (i + j, n - 1)]);
+			roots[j] = item.first;
+			nonces[j] = item.second;
+		}
+		kernel.values_roots (roots.data (), nonces.data (), values.data ());
+		for (size_t j (0); j < kernel.lanes && i + j < n; ++j)
+		{
+			result.push_back (values[j] < paper::work_pool::publish_threshold);
+		}
+	}
+	return result;
+}
+
 uint64_t paper::work_value (paper::block_hash const & root_a, uint64_t work_a)
 {
 	uint64_t result;
@@ -26,10 +58,176 @@ uint64_t paper::work_value (paper::block_hash const & root_a, uint64_t work_a)
 	return result;
 }
 
+namespace
+{
+void work_values_scalar (paper::block_hash const & root_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	values_a[0] = paper::work_value (root_a, nonces_a[0]);
+}
+
+void work_values_roots_scalar (paper::block_hash const * roots_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	values_a[0] = paper::work_value (roots_a[0], nonces_a[0]);
+}
+
+#ifdef PAPER_WORK_LANES
+uint64_t const blake2b_iv[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+uint8_t const blake2b_sigma[12][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+	{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+	{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+	{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+	{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+	{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+	{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+	{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+typedef uint64_t work_lanes4 __attribute__ ((vector_size (32)));
+typedef uint64_t work_lanes8 __attribute__ ((vector_size (64)));
+
+/*
+ * A work value is an 8 byte blake2b digest of one 40 byte message block, the nonce followed by the root.
+ * Each lane of V hashes a different nonce, either against a root of its own or against roots_a[0] when SharedRoot is set.
+ * The parameter block and the counters are the same for every lane.
+ */
+template <typename V, bool SharedRoot>
+inline __attribute__ ((always_inline)) void work_values_lanes (paper::block_hash const * roots_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	size_t constexpr lanes (sizeof (V) / sizeof (uint64_t));
+	V zero;
+	std::memset (&zero, 0, sizeof (zero));
+	V m[16];
+	std::memcpy (&m[0], nonces_a, sizeof (V));
+	for (auto i (0); i < 4; ++i)
+	{
+		uint64_t words[lanes];
+		for (size_t j (0); j < lanes; ++j)
+		{
+			words[j] = roots_a[SharedRoot ? 0 : j].qwords[i];
+		}
+		std::memcpy (&m[i + 1], words, sizeof (V));
+	}
+	for (auto i (5); i < 16; ++i)
+	{
+		m[i] = zero;
+	}
+	// Parameter block for an unkeyed 8 byte digest, fanout 1, depth 1
+	auto h0 (blake2b_iv[0] ^ 0x01010008ULL);
+	V v[16];
+	v[0] = zero + h0;
+	for (auto i (1); i < 8; ++i)
+	{
+		v[i] = zero + blake2b_iv[i];
+	}
+	for (auto i (0); i < 8; ++i)
+	{
+		v[i + 8] = zero + blake2b_iv[i];
+	}
+	v[12] ^= zero + 40; // Bytes hashed
+	v[14] = ~v[14]; // Last block
+#define PAPER_WORK_ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define PAPER_WORK_G(r, i, a, b, c, d)                     \
+	a = a + b + m[blake2b_sigma[r][2 * i + 0]];           \
+	d = PAPER_WORK_ROTR (d ^ a, 32);                      \
+	c = c + d;                                            \
+	b = PAPER_WORK_ROTR (b ^ c, 24);                      \
+	a = a + b + m[blake2b_sigma[r][2 * i + 1]];           \
+	d = PAPER_WORK_ROTR (d ^ a, 16);                      \
+	c = c + d;                                            \
+	b = PAPER_WORK_ROTR (b ^ c, 63);
+#define PAPER_WORK_ROUND(r)                              \
+	PAPER_WORK_G (r, 0, v[0], v[4], v[8], v[12]);        \
+	PAPER_WORK_G (r, 1, v[1], v[5], v[9], v[13]);        \
+	PAPER_WORK_G (r, 2, v[2], v[6], v[10], v[14]);       \
+	PAPER_WORK_G (r, 3, v[3], v[7], v[11], v[15]);       \
+	PAPER_WORK_G (r, 4, v[0], v[5], v[10], v[15]);       \
+	PAPER_WORK_G (r, 5, v[1], v[6], v[11], v[12]);       \
+	PAPER_WORK_G (r, 6, v[2], v[7], v[8], v[13]);        \
+	PAPER_WORK_G (r, 7, v[3], v[4], v[9], v[14]);
+	PAPER_WORK_ROUND (0);
+	PAPER_WORK_ROUND (1);
+	PAPER_WORK_ROUND (2);
+	PAPER_WORK_ROUND (3);
+	PAPER_WORK_ROUND (4);
+	PAPER_WORK_ROUND (5);
+	PAPER_WORK_ROUND (6);
+	PAPER_WORK_ROUND (7);
+	PAPER_WORK_ROUND (8);
+	PAPER_WORK_ROUND (9);
+	PAPER_WORK_ROUND (10);
+	PAPER_WORK_ROUND (11);
+#undef PAPER_WORK_ROUND
+#undef PAPER_WORK_G
+#undef PAPER_WORK_ROTR
+	// Only the first output word is needed for an 8 byte digest
+	V result (v[0] ^ v[8] ^ h0);
+	std::memcpy (values_a, &result, sizeof (V));
+}
+
+__attribute__ ((target ("avx2"))) void work_values_avx2 (paper::block_hash const & root_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	work_values_lanes<work_lanes4, true> (&root_a, nonces_a, values_a);
+}
+
+__attribute__ ((target ("avx2"))) void work_values_roots_avx2 (paper::block_hash const * roots_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	work_values_lanes<work_lanes4, false> (roots_a, nonces_a, values_a);
+}
+
+__attribute__ ((target ("avx512f"))) void work_values_avx512 (paper::block_hash const & root_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	work_values_lanes<work_lanes8, true> (&root_a, nonces_a, values_a);
+}
+
+__attribute__ ((target ("avx512f"))) void work_values_roots_avx512 (paper::block_hash const * roots_a, uint64_t const * nonces_a, uint64_t * values_a)
+{
+	work_values_lanes<work_lanes8, false> (roots_a, nonces_a, values_a);
+}
+#endif
+
+std::vector<paper::work_kernel> available_work_kernels ()
+{
+	std::vector<paper::work_kernel> result;
+	result.push_back ({ "scalar", 1, work_values_scalar, work_values_roots_scalar });
+#ifdef PAPER_WORK_LANES
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx2"))
+	{
+		result.push_back ({ "avx2", 4, work_values_avx2, work_values_roots_avx2 });
+	}
+	if (__builtin_cpu_supports ("avx512f"))
+	{
+		result.push_back ({ "avx512", 8, work_values_avx512, work_values_roots_avx512 });
+	}
+#endif
+	return result;
+}
+}
+
+size_t constexpr paper::work_kernel::max_lanes;
+
+std::vector<paper::work_kernel> const & paper::work_kernels ()
+{
+	static std::vector<paper::work_kernel> const result (available_work_kernels ());
+	return result;
+}
+
 paper::work_pool::work_pool (unsigned max_threads_a, std::function<boost::optional<uint64_t> (paper::uint256_union const &)> opencl_a) :
 ticket (0),
 done (false),
-opencl (opencl_a)
+opencl (opencl_a),
+kernel (paper::work_kernels ().back ())
 {
 	static_assert (ATOMIC_INT_LOCK_FREE == 2, "Atomic int needed");
 	auto count (paper::paper_network == paper::paper_networks::paper_test_network ? 1 : std::max (1u, std::min (max_threads_a, std::thread::hardware_concurrency ())));
@@ -57,10 +255,9 @@ void paper::work_pool::loop (uint64_t thread)
 	// Quick RNG for work attempts.
 	xorshift1024star rng;
 	paper::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (rng.s.data ()), rng.s.size () * sizeof (decltype (rng.s)::value_type));
-	uint64_t work;
-	uint64_t output;
-	blake2b_state hash;
-	blake2b_init (&hash, sizeof (output));
+	std::array<uint64_t, paper::work_kernel::max_lanes> work;
+	std::array<uint64_t, paper::work_kernel::max_lanes> output;
+	auto lanes (kernel.lanes);
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!done || !pending.empty ())
 	{
@@ -75,21 +272,28 @@ void paper::work_pool::loop (uint64_t thread)
 			auto current_l (pending.front ());
 			int ticket_l (ticket);
 			lock.unlock ();
-			output = 0;
+			auto found (lanes);
 			// ticket != ticket_l indicates a different thread found a solution and we should stop
-			while (ticket == ticket_l && output < paper::work_pool::publish_threshold)
+			while (ticket == ticket_l && found == lanes)
 			{
 				// Don't query main memory every iteration in order to reduce memory bus traffic
 				// All operations here operate on stack memory
 				// Count iterations down to zero since comparing to zero is easier than comparing to another number
-				unsigned iteration (256);
-				while (iteration && output < paper::work_pool::publish_threshold)
+				unsigned iteration (256 / lanes);
+				while (iteration && found == lanes)
 				{
-					work = rng.next ();
-					blake2b_update (&hash, reinterpret_cast<uint8_t *> (&work), sizeof (work));
-					blake2b_update (&hash, current_l.first.bytes.data (), current_l.first.bytes.size ());
-					blake2b_final (&hash, reinterpret_cast<uint8_t *> (&output), sizeof (output));
-					blake2b_init (&hash, sizeof (output));
+					for (size_t i (0); i < lanes; ++i)
+					{
+						work[i] = rng.next ();
+					}
+					kernel.values (current_l.first, work.data (), output.data ());
+					for (size_t i (0); i < lanes && found == lanes; ++i)
+					{
+						if (output[i] >= paper::work_pool::publish_threshold)
+						{
+							found = i;
+						}
+					}
 					iteration -= 1;
 				}
 			}
@@ -97,11 +301,12 @@ void paper::work_pool::loop (uint64_t thread)
 			if (ticket == ticket_l)
 			{
 				// If the ticket matches what we started with, we're the ones that found the solution
-				assert (output >= paper::work_pool::publish_threshold);
-				assert (work_value (current_l.first, work) == output);
+				assert (found < lanes);
+				assert (output[found] >= paper::work_pool::publish_threshold);
+				assert (work_value (current_l.first, work[found]) == output[found]);
 				// Signal other threads to stop their work next time they check ticket
 				++ticket;
-				current_l.second (work);
+				current_l.second (work[found]);
 				pending.pop_front ();
 			}
 			else
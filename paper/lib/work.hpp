@@ -9,13 +9,30 @@
 #include <condition_variable>
 #include <memory>
 #include <thread>
+#include <vector>
 
 namespace paper
 {
 class block;
 bool work_validate (paper::block_hash const &, uint64_t);
 bool work_validate (paper::block const &);
+// Validates the work of many (root, work) pairs at once, element i of the result is work_validate's result for pair i
+std::vector<bool> work_validate (std::vector<std::pair<paper::block_hash, uint64_t>> const &);
 uint64_t work_value (paper::block_hash const &, uint64_t);
+// Computes work_value for `lanes' nonces in a single call
+class work_kernel
+{
+public:
+	char const * name;
+	size_t lanes;
+	// Values of `lanes' nonces against a single root
+	void (*values) (paper::block_hash const &, uint64_t const *, uint64_t *);
+	// Values of `lanes' nonces, each against the root at the same index
+	void (*values_roots) (paper::block_hash const *, uint64_t const *, uint64_t *);
+	static size_t constexpr max_lanes = 8;
+};
+// Kernels the running CPU supports, ordered from slowest to fastest
+std::vector<paper::work_kernel> const & work_kernels ();
 class opencl_work;
 class work_pool
 {
@@ -34,6 +51,7 @@ public:
 	std::mutex mutex;
 	std::condition_variable producer_condition;
 	std::function<boost::optional<uint64_t> (paper::uint256_union const &)> opencl;
+	paper::work_kernel kernel;
 	paper::observer_set<bool> work_observers;
 	// Local work threshold for rate-limiting publishing blocks. ~5 seconds of work.
 	static uint64_t const publish_test_threshold = 0xff00000000000000;
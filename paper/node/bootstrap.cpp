@@ -12,6 +12,13 @@ constexpr double bootstrap_minimum_frontier_blocks_per_sec = 1000.0;
 constexpr unsigned bootstrap_frontier_retry_limit = 16;
 constexpr double bootstrap_minimum_termination_time_sec = 30.0;
 constexpr unsigned bootstrap_max_new_connections = 10;
+constexpr size_t bulk_pull_send_buffer_target = 128 * 1024;
+constexpr size_t frontier_req_send_buffer_target = 128 * 1024;
+constexpr std::chrono::milliseconds frontier_req_transaction_max = std::chrono::milliseconds (500);
+constexpr uint32_t bootstrap_chain_pull_max = 64 * 1024;
+constexpr uint64_t bootstrap_chain_segment_blocks = 4096;
+constexpr std::chrono::seconds bootstrap_reassembly_stall_max = std::chrono::seconds (5);
+constexpr size_t bootstrap_work_validate_batch = 64;
 
 paper::block_synchronization::block_synchronization (boost::log::sources::logger_mt & log_a) :
 log (log_a)
@@ -163,7 +170,8 @@ timeout (node_a->service),
 block_count (0),
 pending_stop (false),
 hard_stop (false),
-start_time (std::chrono::steady_clock::now ())
+start_time (std::chrono::steady_clock::now ()),
+network_version (node_a->peers.network_version (paper::endpoint (endpoint_a.address (), endpoint_a.port ())))
 {
 	++attempt->connections;
 }
@@ -179,6 +187,11 @@ double paper::bootstrap_client::block_rate () const
 	return elapsed > 0.0 ? (double)block_count.load () / elapsed : 0.0;
 }
 
+bool paper::bootstrap_client::chain_pulls () const
+{
+	return network_version >= paper::protocol_version_chain_pulls;
+}
+
 double paper::bootstrap_client::elapsed_seconds () const
 {
 	return std::chrono::duration_cast<std::chrono::duration<double>> (std::chrono::steady_clock::now () - start_time).count ();
@@ -462,7 +475,12 @@ void paper::frontier_req_client::next (MDB_txn * transaction_a)
 }
 
 paper::bulk_pull_client::bulk_pull_client (std::shared_ptr<paper::bootstrap_client> connection_a) :
-connection (connection_a)
+connection (connection_a),
+pulled (0),
+finished (false),
+chain_account (0),
+chain_height (0),
+holding (false)
 {
 	assert (!connection->attempt->mutex.try_lock ());
 	++connection->attempt->pulling;
@@ -471,13 +489,13 @@ connection (connection_a)
 
 paper::bulk_pull_client::~bulk_pull_client ()
 {
+	// Queue what's left before this pull stops counting so the attempt doesn't finish in between
+	if (chain_pull ())
 	{
-		std::lock_guard<std::mutex> mutex (connection->attempt->mutex);
-		--connection->attempt->pulling;
-		connection->attempt->condition.notify_all ();
+		continue_chains ();
 	}
 	// If received end block is not expected end block
-	if (expected != pull.end)
+	else if (expected != pull.end)
 	{
 		pull.head = expected;
 		connection->attempt->requeue_pull (pull);
@@ -486,27 +504,134 @@ paper::bulk_pull_client::~bulk_pull_client ()
 			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk pull end block is not expected %1% for account %2%") % pull.end.to_string () % pull.account.to_account ());
 		}
 	}
+	{
+		std::lock_guard<std::mutex> mutex (connection->attempt->mutex);
+		--connection->attempt->pulling;
+		connection->attempt->condition.notify_all ();
+	}
+}
+
+bool paper::bulk_pull_client::chain_pull () const
+{
+	return pull.chain_pull ();
+}
+
+void paper::bulk_pull_client::continue_chains ()
+{
+	auto & attempt (*connection->attempt);
+	// Segments of a long chain kept in flight at once
+	auto window (std::max (1u, connection->node->config.bootstrap_ranges));
+	// A peer that doesn't serve the mode ends the list straight away, that says nothing about the range
+	auto served (connection->chain_pulls ());
+	if (pull.range)
+	{
+		if (!served || !finished || pulled >= bootstrap_chain_pull_max)
+		{
+			if (chain_height != 0)
+			{
+				// The last chain may go on past the last block received, the rest of it is pulled in segments by height
+				attempt.add_segments (chain_account, chain_height + 1, window);
+				// Every chain received is below max_hash so this can't wrap
+				paper::uint256_t next (chain_account.number () + 1);
+				if (next < pull.max_hash.number ())
+				{
+					auto rest (pull);
+					rest.min_hash = next;
+					rest.attempts = 0;
+					attempt.add_pull (rest);
+				}
+			}
+			else
+			{
+				attempt.requeue_pull (pull);
+			}
+			if (connection->node->config.logging.bulk_pull_logging ())
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk pull of range %1% to %2% stopped after %3% blocks") % pull.min_hash.to_string () % pull.max_hash.to_string () % pulled);
+			}
+		}
+	}
+	else
+	{
+		if (finished && served)
+		{
+			if (pulled == pull.max_height - pull.min_height)
+			{
+				// The chain reaches the end of this segment, queue the one after those already in flight
+				attempt.add_segments (pull.account, pull.max_height + (window - 1) * bootstrap_chain_segment_blocks, 1);
+			}
+		}
+		else if (pulled > 0)
+		{
+			auto rest (pull);
+			rest.min_height += pulled;
+			rest.attempts = 0;
+			attempt.add_pull (rest);
+		}
+		else
+		{
+			attempt.requeue_pull (pull);
+		}
+	}
 }
 
 void paper::bulk_pull_client::request (paper::pull_info const & pull_a)
 {
 	pull = pull_a;
-	expected = pull_a.head;
-	paper::bulk_pull req;
-	req.start = pull_a.account;
-	req.end = pull_a.end;
 	auto buffer (std::make_shared<std::vector<uint8_t>> ());
+	if (!chain_pull ())
 	{
-		paper::vectorstream stream (*buffer);
-		req.serialize (stream);
-	}
-	if (connection->node->config.logging.bulk_pull_logging ())
-	{
-		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting account %1% from %2%. %3% accounts in queue") % req.start.to_account () % connection->endpoint % connection->attempt->pulls.size ());
+		expected = pull_a.head;
+		paper::bulk_pull req;
+		req.start = pull_a.account;
+		req.end = pull_a.end;
+		{
+			paper::vectorstream stream (*buffer);
+			req.serialize (stream);
+		}
+		if (connection->node->config.logging.bulk_pull_logging ())
+		{
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting account %1% from %2%. %3% accounts in queue") % req.start.to_account () % connection->endpoint % connection->attempt->pulls.size ());
+		}
+		else if (connection->node->config.logging.network_logging () && connection->attempt->account_count++ % 256 == 0)
+		{
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting account %1% from %2%. %3% accounts in queue") % req.start.to_account () % connection->endpoint % connection->attempt->pulls.size ());
+		}
 	}
-	else if (connection->node->config.logging.network_logging () && connection->attempt->account_count++ % 256 == 0)
+	else
 	{
-		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting account %1% from %2%. %3% accounts in queue") % req.start.to_account () % connection->endpoint % connection->attempt->pulls.size ());
+		assert (connection->chain_pulls ());
+		paper::bulk_pull_blocks req;
+		if (pull_a.range)
+		{
+			req.min_hash = pull_a.min_hash;
+			req.max_hash = pull_a.max_hash;
+			req.mode = paper::bulk_pull_blocks_mode::list_chains;
+			req.max_count = bootstrap_chain_pull_max;
+		}
+		else
+		{
+			req.min_hash = pull_a.account;
+			req.min_height = pull_a.min_height;
+			req.max_height = pull_a.max_height;
+			req.mode = paper::bulk_pull_blocks_mode::list_chain_heights;
+			req.max_count = 0;
+		}
+		{
+			paper::vectorstream stream (*buffer);
+			req.serialize (stream);
+		}
+		if (connection->node->config.logging.network_logging ())
+		{
+			if (pull_a.range)
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting chains of accounts %1% to %2% from %3%") % pull_a.min_hash.to_account () % pull_a.max_hash.to_account () % connection->endpoint);
+			}
+			else
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Requesting heights %1% to %2% of account %3% from %4%") % pull_a.min_height % pull_a.max_height % pull_a.account.to_account () % connection->endpoint);
+			}
+		}
 	}
 	auto this_l (shared_from_this ());
 	connection->start_timeout ();
@@ -584,10 +709,15 @@ void paper::bulk_pull_client::received_type ()
 		}
 		case paper::block_type::not_a_block:
 		{
-			// Avoid re-using slow peers, or peers that sent the wrong blocks.
-			if (!connection->pending_stop && expected == pull.end)
+			// The list only counts as finished once the blocks still waiting on their work check have gone through
+			if (process_unvalidated ())
 			{
-				connection->attempt->pool_connection (connection);
+				finished = true;
+				// Avoid re-using slow peers, or peers that sent the wrong blocks.
+				if (!connection->pending_stop && (chain_pull () || expected == pull.end))
+				{
+					connection->attempt->pool_connection (connection);
+				}
 			}
 			break;
 		}
@@ -599,45 +729,154 @@ void paper::bulk_pull_client::received_type ()
 	}
 }
 
+void paper::bulk_pull_client::receive_block_throttled ()
+{
+	auto waiting (holding && connection->attempt->reassembly.full ());
+	if (!waiting)
+	{
+		stalled = std::chrono::steady_clock::time_point ();
+	}
+	else if (stalled == std::chrono::steady_clock::time_point ())
+	{
+		stalled = std::chrono::steady_clock::now ();
+	}
+	if (!waiting && !connection->node->block_processor.full ())
+	{
+		receive_block ();
+	}
+	else if (waiting && std::chrono::steady_clock::now () - stalled > bootstrap_reassembly_stall_max)
+	{
+		// Give the connection up so the pulls this one is waiting on can get one, the rest of this pull is queued again
+		if (connection->node->config.logging.bulk_pull_logging ())
+		{
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Stopping pull from %1% waiting on the reassembly buffer") % connection->endpoint);
+		}
+		connection->stop (true);
+	}
+	else
+	{
+		// Stop reading from the peer until the block processor or reassembly buffer has caught up
+		auto this_l (shared_from_this ());
+		connection->node->alarm.add (std::chrono::steady_clock::now () + std::chrono::milliseconds (50), [this_l]() {
+			if (!this_l->connection->hard_stop.load ())
+			{
+				this_l->receive_block_throttled ();
+			}
+		});
+	}
+}
+
 void paper::bulk_pull_client::received_block (boost::system::error_code const & ec, size_t size_a)
 {
 	if (!ec)
 	{
 		paper::bufferstream stream (connection->receive_buffer.data (), 1 + size_a);
 		std::shared_ptr<paper::block> block (paper::deserialize_block (stream));
-		if (block != nullptr && !paper::work_validate (*block))
+		if (block != nullptr)
+		{
+			unvalidated.push_back (block);
+			if (unvalidated.size () < bootstrap_work_validate_batch)
+			{
+				receive_block ();
+			}
+			else if (process_unvalidated () && !connection->hard_stop.load ())
+			{
+				receive_block_throttled ();
+			}
+		}
+		else
+		{
+			BOOST_LOG (connection->node->log) << "Error deserializing block received from pull request";
+		}
+	}
+	else
+	{
+		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Error bulk receiving block: %1%") % ec.message ());
+	}
+}
+
+bool paper::bulk_pull_client::process_unvalidated ()
+{
+	std::vector<std::pair<paper::block_hash, uint64_t>> work;
+	work.reserve (unvalidated.size ());
+	for (auto & block : unvalidated)
+	{
+		work.push_back (std::make_pair (block->root (), block->block_work ()));
+	}
+	auto insufficient (paper::work_validate (work));
+	auto result (true);
+	for (size_t i (0), n (unvalidated.size ()); result && i < n; ++i)
+	{
+		auto & block (unvalidated[i]);
+		auto hash (block->hash ());
+		if (!insufficient[i])
 		{
-			auto hash (block->hash ());
 			if (connection->node->config.logging.bulk_pull_logging ())
 			{
 				std::string block_l;
 				block->serialize_json (block_l);
 				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Pulled block %1% %2%") % hash.to_string () % block_l);
 			}
-			if (hash == expected)
+			auto valid (true);
+			if (pull.range)
+			{
+				// Chains are listed in account order, each starting with its open block
+				if (block->type () == paper::block_type::open)
+				{
+					auto account (static_cast<paper::open_block const &> (*block).hashables.account);
+					valid = !(account < pull.min_hash) && account < pull.max_hash && (chain_height == 0 || chain_account < account);
+					if (valid)
+					{
+						chain_account = account;
+						chain_height = 1;
+					}
+				}
+				else
+				{
+					valid = chain_height != 0;
+					if (valid)
+					{
+						++chain_height;
+					}
+				}
+			}
+			else if (pull.max_height == 0 && hash == expected)
 			{
 				expected = block->previous ();
 			}
-			if (connection->block_count++ == 0)
+			if (valid)
 			{
-				connection->start_time = std::chrono::steady_clock::now ();
+				if (connection->block_count++ == 0)
+				{
+					connection->start_time = std::chrono::steady_clock::now ();
+				}
+				connection->attempt->total_blocks++;
+				if (chain_pull ())
+				{
+					++pulled;
+					holding = connection->attempt->reassembly.add (block);
+				}
+				else
+				{
+					connection->attempt->node->block_processor.add (paper::block_processor_item (block));
+				}
 			}
-			connection->attempt->total_blocks++;
-			connection->attempt->node->block_processor.add (paper::block_processor_item (block));
-			if (!connection->hard_stop.load ())
+			else
 			{
-				receive_block ();
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Block %1% from %2% is out of order for a range pull") % hash.to_string () % connection->endpoint);
+				connection->stop (true);
+				result = false;
 			}
 		}
 		else
 		{
-			BOOST_LOG (connection->node->log) << "Error deserializing block received from pull request";
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Insufficient work for block %1% from %2%") % hash.to_string () % connection->endpoint);
+			connection->stop (true);
+			result = false;
 		}
 	}
-	else
-	{
-		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Error bulk receiving block: %1%") % ec.message ());
-	}
+	unvalidated.clear ();
+	return result;
 }
 
 paper::bulk_push_client::bulk_push_client (std::shared_ptr<paper::bootstrap_client> const & connection_a) :
@@ -760,7 +999,12 @@ void paper::bulk_push_client::push_block (paper::block const & block_a)
 paper::pull_info::pull_info () :
 account (0),
 end (0),
-attempts (0)
+attempts (0),
+range (false),
+min_hash (0),
+max_hash (0),
+min_height (0),
+max_height (0)
 {
 }
 
@@ -768,17 +1012,122 @@ paper::pull_info::pull_info (paper::account const & account_a, paper::block_hash
 account (account_a),
 head (head_a),
 end (end_a),
-attempts (0)
+attempts (0),
+range (false),
+min_hash (0),
+max_hash (0),
+min_height (0),
+max_height (0)
 {
 }
 
+bool paper::pull_info::chain_pull () const
+{
+	return range || max_height != 0;
+}
+
+paper::block_reassembly::block_reassembly (paper::node & node_a) :
+node (node_a)
+{
+}
+
+bool paper::block_reassembly::add (std::shared_ptr<paper::block> block_a)
+{
+	auto hash (block_a->hash ());
+	auto previous (block_a->previous ());
+	auto held (false);
+	if (!previous.is_zero ())
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			held = released.find (previous) == released.end () && blocks.find (previous) == blocks.end ();
+		}
+		if (held)
+		{
+			paper::transaction transaction (node.store.environment, nullptr, false);
+			held = !node.store.block_exists (transaction, previous);
+		}
+	}
+	std::lock_guard<std::mutex> lock (mutex);
+	// The previous block may have been released while the ledger was read
+	held = held || blocks.find (previous) != blocks.end ();
+	held = held && released.find (previous) == released.end ();
+	if (held)
+	{
+		if (blocks.find (hash) == blocks.end ())
+		{
+			blocks.insert (paper::reassembly_entry{ hash, previous, block_a });
+		}
+	}
+	else
+	{
+		release (block_a);
+	}
+	return held;
+}
+
+void paper::block_reassembly::flush ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto & arrival (blocks.get<2> ());
+	while (!arrival.empty ())
+	{
+		auto oldest (arrival.front ().block);
+		arrival.pop_front ();
+		release (oldest);
+	}
+}
+
+size_t paper::block_reassembly::size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return blocks.size ();
+}
+
+bool paper::block_reassembly::full ()
+{
+	return size () >= blocks_max;
+}
+
+void paper::block_reassembly::release (std::shared_ptr<paper::block> block_a)
+{
+	assert (!mutex.try_lock ());
+	std::deque<std::shared_ptr<paper::block>> ready;
+	ready.push_back (block_a);
+	while (!ready.empty ())
+	{
+		auto block (ready.front ());
+		ready.pop_front ();
+		auto hash (block->hash ());
+		node.block_processor.add (paper::block_processor_item (block));
+		if (released.insert (hash).second)
+		{
+			released_order.push_back (hash);
+			if (released_order.size () > released_max)
+			{
+				released.erase (released_order.front ());
+				released_order.pop_front ();
+			}
+		}
+		auto & dependents (blocks.get<1> ());
+		auto existing (dependents.equal_range (hash));
+		for (auto i (existing.first); i != existing.second; ++i)
+		{
+			ready.push_back (i->block);
+		}
+		dependents.erase (existing.first, existing.second);
+	}
+}
+
 paper::bootstrap_attempt::bootstrap_attempt (std::shared_ptr<paper::node> node_a) :
 connections (0),
 pulling (0),
 node (node_a),
 account_count (0),
-stopped (false),
-total_blocks (0)
+total_blocks (0),
+reassembly (*node_a),
+chain_pulls_dropped (false),
+stopped (false)
 {
 	BOOST_LOG (node->log) << "Starting bootstrap attempt";
 	node->bootstrap_initiator.notify_listeners (true);
@@ -826,20 +1175,88 @@ bool paper::bootstrap_attempt::request_frontier (std::unique_lock<std::mutex> &
 	return result;
 }
 
+void paper::bootstrap_attempt::request_ranges (std::unique_lock<std::mutex> & lock_a)
+{
+	if (!chain_peers ())
+	{
+		BOOST_LOG (node->log) << "No peers serve account range pulls, pulling by frontiers instead";
+		return;
+	}
+	auto ranges (node->config.bootstrap_ranges);
+	paper::uint256_t step (std::numeric_limits<paper::uint256_t>::max () / ranges);
+	for (unsigned i (0); i < ranges; ++i)
+	{
+		paper::pull_info pull;
+		pull.range = true;
+		pull.min_hash = paper::uint256_t (step * i);
+		pull.max_hash = i + 1 < ranges ? paper::uint256_t (step * (i + 1)) : std::numeric_limits<paper::uint256_t>::max ();
+		pulls.push_back (pull);
+	}
+	BOOST_LOG (node->log) << boost::str (boost::format ("Pulling all chains in %1% account ranges") % ranges);
+	while (still_pulling ())
+	{
+		if (!pulls.empty ())
+		{
+			request_pull (lock_a);
+		}
+		else
+		{
+			condition.wait (lock_a);
+		}
+	}
+	lock_a.unlock ();
+	reassembly.flush ();
+	node->block_processor.flush ();
+	lock_a.lock ();
+	if (!stopped && !chain_pulls_dropped)
+	{
+		node->bootstrap_initiator.ranges_complete = true;
+		BOOST_LOG (node->log) << "Completed account range pulls";
+	}
+	else if (!stopped)
+	{
+		BOOST_LOG (node->log) << "Account range pulls were incomplete, pulling by frontiers";
+	}
+}
+
 void paper::bootstrap_attempt::request_pull (std::unique_lock<std::mutex> & lock_a)
 {
 	auto connection_l (connection (lock_a));
 	if (connection_l)
 	{
 		auto pull (pulls.front ());
-		pulls.pop_front ();
-		auto client (std::make_shared<paper::bulk_pull_client> (connection_l));
-		// The bulk_pull_client destructor attempt to requeue_pull which can cause a deadlock if this is the last reference
-		// Dispatch request in an external thread in case it needs to be destroyed
-		node->background ([client, pull]() {
-			client->request (pull);
-		});
+		if (!pull.chain_pull () || connection_l->chain_pulls ())
+		{
+			pulls.pop_front ();
+			auto client (std::make_shared<paper::bulk_pull_client> (connection_l));
+			// The bulk_pull_client destructor attempt to requeue_pull which can cause a deadlock if this is the last reference
+			// Dispatch request in an external thread in case it needs to be destroyed
+			node->background ([client, pull]() {
+				client->request (pull);
+			});
+		}
+		else if (chain_peers ())
+		{
+			// The connection is released so populate_connections can replace it with another peer
+		}
+		else
+		{
+			pulls.pop_front ();
+			chain_pulls_dropped = true;
+			idle.push_back (connection_l);
+			BOOST_LOG (node->log) << "Dropping a chain pull, no peers serve them any more";
+		}
+	}
+}
+
+bool paper::bootstrap_attempt::chain_peers ()
+{
+	auto result (false);
+	for (auto & i : node->peers.list_version ())
+	{
+		result = result || i.second >= paper::protocol_version_chain_pulls;
 	}
+	return result;
 }
 
 bool paper::bootstrap_attempt::request_push (std::unique_lock<std::mutex> & lock_a)
@@ -885,6 +1302,10 @@ void paper::bootstrap_attempt::run ()
 	populate_connections ();
 	resolve_forks ();
 	std::unique_lock<std::mutex> lock (mutex);
+	if (node->config.bootstrap_ranges > 0 && !node->bootstrap_initiator.ranges_complete)
+	{
+		request_ranges (lock);
+	}
 	auto frontier_failure (true);
 	while (!stopped && frontier_failure)
 	{
@@ -912,6 +1333,7 @@ void paper::bootstrap_attempt::run ()
 		// Flushing may resolve forks which can add more pulls
 		BOOST_LOG (node->log) << "Flushing unchecked blocks";
 		lock.unlock ();
+		reassembly.flush ();
 		node->block_processor.flush ();
 		lock.lock ();
 		BOOST_LOG (node->log) << "Finished flushing unchecked blocks";
@@ -1214,6 +1636,20 @@ void paper::bootstrap_attempt::add_pull (paper::pull_info const & pull)
 	condition.notify_all ();
 }
 
+void paper::bootstrap_attempt::add_segments (paper::account const & account_a, uint64_t height_a, unsigned count_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	for (unsigned i (0); i < count_a; ++i)
+	{
+		paper::pull_info pull;
+		pull.account = account_a;
+		pull.min_height = height_a + i * bootstrap_chain_segment_blocks;
+		pull.max_height = pull.min_height + bootstrap_chain_segment_blocks;
+		pulls.push_back (pull);
+	}
+	condition.notify_all ();
+}
+
 void paper::bootstrap_attempt::requeue_pull (paper::pull_info const & pull_a)
 {
 	auto pull (pull_a);
@@ -1223,6 +1659,15 @@ void paper::bootstrap_attempt::requeue_pull (paper::pull_info const & pull_a)
 		pulls.push_front (pull);
 		condition.notify_all ();
 	}
+	else if (pull.chain_pull ())
+	{
+		// The frontier peer isn't asked, it may not serve chain pulls and the frontier pulls cover these accounts anyway
+		chain_pulls_dropped = true;
+		if (node->config.logging.bulk_pull_logging ())
+		{
+			BOOST_LOG (node->log) << boost::str (boost::format ("Failed to pull chains of account %1% after %2% attempts") % (pull.range ? pull.min_hash : pull.account).to_account () % pull.attempts);
+		}
+	}
 	else if (pull.attempts == bootstrap_frontier_retry_limit)
 	{
 		pull.attempts++;
@@ -1251,6 +1696,7 @@ void paper::bootstrap_attempt::requeue_pull (paper::pull_info const & pull_a)
 paper::bootstrap_initiator::bootstrap_initiator (paper::node & node_a) :
 node (node_a),
 stopped (false),
+ranges_complete (false),
 thread ([this]() { run_bootstrap (); })
 {
 }
@@ -1320,6 +1766,12 @@ bool paper::bootstrap_initiator::in_progress ()
 	return attempt != nullptr;
 }
 
+std::shared_ptr<paper::bootstrap_attempt> paper::bootstrap_initiator::current_attempt ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return attempt;
+}
+
 void paper::bootstrap_initiator::stop ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
@@ -1533,17 +1985,30 @@ void paper::bootstrap_server::receive_bulk_pull_blocks_action (boost::system::er
 {
 	if (!ec)
 	{
-		std::unique_ptr<paper::bulk_pull_blocks> request (new paper::bulk_pull_blocks);
-		paper::bufferstream stream (receive_buffer.data (), 8 + sizeof (paper::uint256_union) + sizeof (paper::uint256_union) + sizeof (bulk_pull_blocks_mode) + sizeof (uint32_t));
-		auto error (request->deserialize (stream));
-		if (!error)
+		size_t const fixed_size (sizeof (paper::uint256_union) + sizeof (paper::uint256_union) + sizeof (bulk_pull_blocks_mode) + sizeof (uint32_t));
+		auto mode (static_cast<paper::bulk_pull_blocks_mode> (receive_buffer[paper::bootstrap_message_header_size + sizeof (paper::uint256_union) + sizeof (paper::uint256_union)]));
+		if (mode == paper::bulk_pull_blocks_mode::list_chain_heights && size_a == fixed_size)
 		{
-			if (node->config.logging.bulk_pull_logging ())
+			// Height pulls carry min_height and max_height after the fixed fields
+			auto this_l (shared_from_this ());
+			boost::asio::async_read (*socket, boost::asio::buffer (receive_buffer.data () + paper::bootstrap_message_header_size + fixed_size, sizeof (uint64_t) + sizeof (uint64_t)), [this_l, fixed_size](boost::system::error_code const & ec, size_t size_a) {
+				this_l->receive_bulk_pull_blocks_action (ec, fixed_size + size_a);
+			});
+		}
+		else
+		{
+			std::unique_ptr<paper::bulk_pull_blocks> request (new paper::bulk_pull_blocks);
+			paper::bufferstream stream (receive_buffer.data (), paper::bootstrap_message_header_size + size_a);
+			auto error (request->deserialize (stream));
+			if (!error)
 			{
-				BOOST_LOG (node->log) << boost::str (boost::format ("Received bulk pull blocks for %1% to %2%") % request->min_hash.to_string () % request->max_hash.to_string ());
+				if (node->config.logging.bulk_pull_logging ())
+				{
+					BOOST_LOG (node->log) << boost::str (boost::format ("Received bulk pull blocks for %1% to %2%") % request->min_hash.to_string () % request->max_hash.to_string ());
+				}
+				add_request (std::unique_ptr<paper::message> (request.release ()));
+				receive ();
 			}
-			add_request (std::unique_ptr<paper::message> (request.release ()));
-			receive ();
 		}
 	}
 }
@@ -1702,19 +2167,29 @@ void paper::bulk_pull_server::set_current_end ()
 
 void paper::bulk_pull_server::send_next ()
 {
-	std::unique_ptr<paper::block> block (get_next ());
-	if (block != nullptr)
+	send_buffer.clear ();
+	size_t blocks (0);
 	{
+		paper::vectorstream stream (send_buffer);
+		auto logging (connection->node->config.logging.bulk_pull_logging ());
+		paper::block_view block;
+		// Blocks are copied from LMDB's memory straight in to the send buffer
+		while (send_buffer.size () < bulk_pull_send_buffer_target && !(block = get_next ()).empty ())
 		{
-			send_buffer.clear ();
-			paper::vectorstream stream (send_buffer);
-			paper::serialize_block (stream, *block);
+			if (logging)
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block.hash ().to_string ());
+			}
+			block.serialize (stream);
+			++blocks;
 		}
+	}
+	// Don't hold the read transaction open while the peer drains the socket
+	transaction.reset ();
+	if (blocks != 0)
+	{
+		blocks_sent += blocks;
 		auto this_l (shared_from_this ());
-		if (connection->node->config.logging.bulk_pull_logging ())
-		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block->hash ().to_string ());
-		}
 		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -1725,16 +2200,19 @@ void paper::bulk_pull_server::send_next ()
 	}
 }
 
-std::unique_ptr<paper::block> paper::bulk_pull_server::get_next ()
+paper::block_view paper::bulk_pull_server::get_next ()
 {
-	std::unique_ptr<paper::block> result;
+	paper::block_view result;
 	if (current != request->end)
 	{
-		paper::transaction transaction (connection->node->store.environment, nullptr, false);
-		result = connection->node->store.block_get (transaction, current);
-		if (result != nullptr)
+		if (transaction == nullptr)
+		{
+			transaction.reset (new paper::transaction (connection->node->store.environment, nullptr, false));
+		}
+		result = connection->node->store.block_get_view (*transaction, current);
+		if (!result.empty ())
 		{
-			auto previous (result->previous ());
+			auto previous (result.previous ());
 			if (!previous.is_zero ())
 			{
 				current = previous;
@@ -1756,6 +2234,7 @@ void paper::bulk_pull_server::sent_action (boost::system::error_code const & ec,
 {
 	if (!ec)
 	{
+		bytes_sent += size_a;
 		send_next ();
 	}
 	else
@@ -1771,7 +2250,8 @@ void paper::bulk_pull_server::send_finished ()
 	auto this_l (shared_from_this ());
 	if (connection->node->config.logging.bulk_pull_logging ())
 	{
-		BOOST_LOG (connection->node->log) << "Bulk sending finished";
+		auto elapsed (std::max<double> (std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - start_time).count (), 1.0) / 1000.0);
+		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk sending finished, %1% blocks and %2% bytes in %3% seconds (%4% blocks/s, %5% bytes/s)") % blocks_sent % bytes_sent % elapsed % static_cast<uint64_t> (blocks_sent / elapsed) % static_cast<uint64_t> (bytes_sent / elapsed));
 	}
 	async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), 1), [this_l](boost::system::error_code const & ec, size_t size_a) {
 		this_l->no_block_sent (ec, size_a);
@@ -1793,7 +2273,10 @@ void paper::bulk_pull_server::no_block_sent (boost::system::error_code const & e
 
 paper::bulk_pull_server::bulk_pull_server (std::shared_ptr<paper::bootstrap_server> const & connection_a, std::unique_ptr<paper::bulk_pull> request_a) :
 connection (connection_a),
-request (std::move (request_a))
+request (std::move (request_a)),
+blocks_sent (0),
+bytes_sent (0),
+start_time (std::chrono::steady_clock::now ())
 {
 	set_current_end ();
 }
@@ -1821,14 +2304,22 @@ void paper::bulk_pull_blocks_server::set_params ()
 			case paper::bulk_pull_blocks_mode::checksum_blocks:
 				modeName = "checksum";
 				break;
+			case paper::bulk_pull_blocks_mode::list_chains:
+				modeName = "chains";
+				break;
+			case paper::bulk_pull_blocks_mode::list_chain_heights:
+				modeName = "chain heights";
+				break;
 		}
 
 		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk pull of block range starting, min (%1%) to max (%2%), max_count = %3%, mode = %4%") % request->min_hash.to_string () % request->max_hash.to_string () % request->max_count % modeName);
 	}
 
-	stream = connection->node->store.block_info_begin (stream_transaction, request->min_hash);
+	// Chain modes walk the heights table, which lists each account's blocks in chain order
+	next = request->min_hash;
+	next_height = request->mode == paper::bulk_pull_blocks_mode::list_chain_heights ? request->min_height : 1;
 
-	if (request->max_hash < request->min_hash)
+	if (request->mode != paper::bulk_pull_blocks_mode::list_chain_heights && request->max_hash < request->min_hash)
 	{
 		if (connection->node->config.logging.bulk_pull_logging ())
 		{
@@ -1841,27 +2332,35 @@ void paper::bulk_pull_blocks_server::set_params ()
 
 void paper::bulk_pull_blocks_server::send_next ()
 {
-	std::unique_ptr<paper::block> block (get_next ());
-	if (block != nullptr)
+	send_buffer.clear ();
 	{
-		if (connection->node->config.logging.bulk_pull_logging ())
+		paper::vectorstream stream_l (send_buffer);
+		auto logging (connection->node->config.logging.bulk_pull_logging ());
+		paper::block_view block;
+		// Checksums never fill the buffer, so they walk the whole range under one read transaction
+		while (send_buffer.size () < bulk_pull_send_buffer_target && !(block = get_next ()).empty ())
 		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block->hash ().to_string ());
+			if (logging)
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block.hash ().to_string ());
+			}
+			if (request->mode == paper::bulk_pull_blocks_mode::checksum_blocks)
+			{
+				checksum ^= block.hash ();
+			}
+			else
+			{
+				// list_blocks, list_chains and list_chain_heights all send the block itself
+				block.serialize (stream_l);
+			}
 		}
-
-		send_buffer.clear ();
+	}
+	// Don't hold the read transaction open while the peer drains the socket
+	stream = paper::store_iterator (nullptr);
+	transaction.reset ();
+	if (!send_buffer.empty ())
+	{
 		auto this_l (shared_from_this ());
-
-		if (request->mode == paper::bulk_pull_blocks_mode::list_blocks)
-		{
-			paper::vectorstream stream (send_buffer);
-			paper::serialize_block (stream, *block);
-		}
-		else if (request->mode == paper::bulk_pull_blocks_mode::checksum_blocks)
-		{
-			checksum ^= block->hash ();
-		}
-
 		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -1899,9 +2398,9 @@ void paper::bulk_pull_blocks_server::send_next ()
 	}
 }
 
-std::unique_ptr<paper::block> paper::bulk_pull_blocks_server::get_next ()
+paper::block_view paper::bulk_pull_blocks_server::get_next ()
 {
-	std::unique_ptr<paper::block> result;
+	paper::block_view result;
 	bool out_of_bounds;
 
 	out_of_bounds = false;
@@ -1917,15 +2416,42 @@ std::unique_ptr<paper::block> paper::bulk_pull_blocks_server::get_next ()
 
 	if (!out_of_bounds)
 	{
+		auto chains (request->mode == paper::bulk_pull_blocks_mode::list_chains || request->mode == paper::bulk_pull_blocks_mode::list_chain_heights);
+		if (transaction == nullptr)
+		{
+			// Resume where the previous batch stopped
+			transaction.reset (new paper::transaction (connection->node->store.environment, nullptr, false));
+			stream = chains ? connection->node->store.height_begin (*transaction, next, next_height) : connection->node->store.block_begin (*transaction, next);
+		}
 		if (stream->first.size () != 0)
 		{
-			auto current = stream->first.uint256 ();
-			if (current < request->max_hash)
+			if (chains)
 			{
-				paper::transaction transaction (connection->node->store.environment, nullptr, false);
-				result = connection->node->store.block_get (transaction, current);
+				paper::height_key key (stream->first);
+				auto in_range (request->mode == paper::bulk_pull_blocks_mode::list_chains ? key.account < request->max_hash : key.account == request->min_hash && key.height () < request->max_height);
+				if (in_range)
+				{
+					result = connection->node->store.block_get_view (*transaction, stream->second.uint256 ());
+					assert (!result.empty ());
 
-				++stream;
+					next = key.account;
+					next_height = key.height () + 1;
+					++stream;
+				}
+			}
+			else
+			{
+				auto current = stream->first.uint256 ();
+				if (current < request->max_hash)
+				{
+					// Blocks are read in place from the cursor
+					result = paper::block_view (stream->second);
+					assert (!result.empty ());
+
+					// current is below max_hash so this can't wrap
+					next = current.number () + 1;
+					++stream;
+				}
 			}
 		}
 	}
@@ -1975,7 +2501,7 @@ paper::bulk_pull_blocks_server::bulk_pull_blocks_server (std::shared_ptr<paper::
 connection (connection_a),
 request (std::move (request_a)),
 stream (nullptr),
-stream_transaction (connection_a->node->store.environment, nullptr, false),
+next_height (1),
 sent_count (0),
 checksum (0)
 {
@@ -2074,40 +2600,35 @@ paper::frontier_req_server::frontier_req_server (std::shared_ptr<paper::bootstra
 connection (connection_a),
 current (request_a->start.number () - 1),
 info (0, 0, 0, 0, 0, 0),
-request (std::move (request_a))
+request (std::move (request_a)),
+iterator (nullptr)
 {
 	next ();
-	skip_old ();
-}
-
-void paper::frontier_req_server::skip_old ()
-{
-	if (request->age != std::numeric_limits<decltype (request->age)>::max ())
-	{
-		auto now (paper::seconds_since_epoch ());
-		while (!current.is_zero () && (now - info.modified) >= request->age)
-		{
-			next ();
-		}
-	}
 }
 
 void paper::frontier_req_server::send_next ()
 {
-	if (!current.is_zero ())
+	send_buffer.clear ();
 	{
+		paper::vectorstream stream (send_buffer);
+		auto logging (connection->node->config.logging.bulk_pull_logging ());
+		while (!current.is_zero () && send_buffer.size () < frontier_req_send_buffer_target)
 		{
-			send_buffer.clear ();
-			paper::vectorstream stream (send_buffer);
+			if (logging)
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
+			}
 			write (stream, current.bytes);
 			write (stream, info.head.bytes);
+			next ();
 		}
+	}
+	// current hasn't been sent yet, next () resumes the scan after it once it is
+	iterator = paper::store_iterator (nullptr);
+	transaction.reset ();
+	if (!send_buffer.empty ())
+	{
 		auto this_l (shared_from_this ());
-		if (connection->node->config.logging.bulk_pull_logging ())
-		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
-		}
-		next ();
 		async_write (*connection->socket, boost::asio::buffer (send_buffer.data (), send_buffer.size ()), [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -2169,9 +2690,49 @@ void paper::frontier_req_server::sent_action (boost::system::error_code const &
 
 void paper::frontier_req_server::next ()
 {
-	paper::transaction transaction (connection->node->store.environment, nullptr, false);
-	auto iterator (connection->node->store.latest_begin (transaction, current.number () + 1));
-	if (iterator != connection->node->store.latest_end ())
+	auto now (std::chrono::steady_clock::now ());
+	if (transaction != nullptr && now - transaction_start > frontier_req_transaction_max)
+	{
+		// The batch has held its snapshot long enough, resume after current in a new one
+		iterator = paper::store_iterator (nullptr);
+		transaction.reset ();
+	}
+	if (transaction == nullptr)
+	{
+		transaction.reset (new paper::transaction (connection->node->store.environment, nullptr, false));
+		transaction_start = now;
+		iterator = connection->node->store.latest_begin (*transaction, current.number () + 1);
+	}
+	else
+	{
+		++iterator;
+	}
+	auto end (connection->node->store.latest_end ());
+	if (request->age != std::numeric_limits<decltype (request->age)>::max ())
+	{
+		auto seconds (paper::seconds_since_epoch ());
+		while (iterator != end && (seconds - paper::account_info (iterator->second).modified) >= request->age)
+		{
+			// Skipped accounts are never sent, so current can move past them
+			current = paper::uint256_union (iterator->first.uint256 ());
+			++iterator;
+			now = std::chrono::steady_clock::now ();
+			if (now - transaction_start > frontier_req_transaction_max)
+			{
+				// Don't pin an old snapshot while skipping through a long run of old accounts
+				iterator = paper::store_iterator (nullptr);
+				transaction.reset ();
+				transaction.reset (new paper::transaction (connection->node->store.environment, nullptr, false));
+				transaction_start = now;
+				iterator = connection->node->store.latest_begin (*transaction, current);
+				if (iterator != end && paper::uint256_union (iterator->first.uint256 ()) == current)
+				{
+					++iterator;
+				}
+			}
+		}
+	}
+	if (iterator != end)
 	{
 		current = paper::uint256_union (iterator->first.uint256 ());
 		info = paper::account_info (iterator->second);
@@ -11,6 +11,10 @@
 #include <unordered_set>
 
 #include <boost/log/sources/logger.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
 
 namespace paper
 {
@@ -67,6 +71,55 @@ public:
 	paper::block_hash head;
 	paper::block_hash end;
 	unsigned attempts;
+	// Pull the chains of every account in [min_hash, max_hash) instead of one account's chain
+	bool range;
+	paper::block_hash min_hash;
+	paper::block_hash max_hash;
+	// Pull the blocks of account with heights in [min_height, max_height) when max_height isn't zero
+	uint64_t min_height;
+	uint64_t max_height;
+	// Range and segment pulls use bulk_pull_blocks modes only some peers serve
+	bool chain_pull () const;
+};
+class reassembly_entry
+{
+public:
+	paper::block_hash hash;
+	// Previous block, which is neither in the ledger nor released yet
+	paper::block_hash dependency;
+	std::shared_ptr<paper::block> block;
+};
+/**
+ * Holds blocks from chain pulls until their previous block has been handed to the block processor,
+ * so segments of a chain pulled over several connections are processed in order
+ */
+class block_reassembly
+{
+public:
+	block_reassembly (paper::node &);
+	// Returns true if the block is held for its previous block
+	bool add (std::shared_ptr<paper::block>);
+	// Hand every waiting block to the block processor, oldest first
+	void flush ();
+	size_t size ();
+	// Pulls whose blocks are being held wait while this is true
+	bool full ();
+	void release (std::shared_ptr<paper::block>);
+	paper::node & node;
+	std::mutex mutex;
+	boost::multi_index_container<
+	paper::reassembly_entry,
+	boost::multi_index::indexed_by<
+	boost::multi_index::hashed_unique<boost::multi_index::member<paper::reassembly_entry, paper::block_hash, &paper::reassembly_entry::hash>>,
+	boost::multi_index::hashed_non_unique<boost::multi_index::member<paper::reassembly_entry, paper::block_hash, &paper::reassembly_entry::dependency>>,
+	boost::multi_index::sequenced<>>>
+	blocks;
+	// Blocks given to the block processor that may not have reached the ledger yet
+	std::unordered_set<paper::block_hash> released;
+	std::deque<paper::block_hash> released_order;
+	// Releasing every held block at once stays within what the block processor accepts
+	static size_t constexpr blocks_max = 16 * 1024;
+	static size_t constexpr released_max = 64 * 1024;
 };
 class frontier_req_client;
 class bulk_push_client;
@@ -80,13 +133,18 @@ public:
 	bool consume_future (std::future<bool> &);
 	void populate_connections ();
 	bool request_frontier (std::unique_lock<std::mutex> &);
+	void request_ranges (std::unique_lock<std::mutex> &);
 	void request_pull (std::unique_lock<std::mutex> &);
+	// Whether any known peer serves range and segment pulls
+	bool chain_peers ();
 	bool request_push (std::unique_lock<std::mutex> &);
 	void add_connection (paper::endpoint const &);
 	void pool_connection (std::shared_ptr<paper::bootstrap_client>);
 	void stop ();
 	void requeue_pull (paper::pull_info const &);
 	void add_pull (paper::pull_info const &);
+	// Queue a number of consecutive segments of an account's chain starting at a height
+	void add_segments (paper::account const &, uint64_t, unsigned);
 	bool still_pulling ();
 	void process_fork (MDB_txn *, std::shared_ptr<paper::block>);
 	void try_resolve_fork (MDB_txn *, std::shared_ptr<paper::block>, bool);
@@ -103,7 +161,10 @@ public:
 	std::shared_ptr<paper::node> node;
 	std::atomic<unsigned> account_count;
 	std::atomic<uint64_t> total_blocks;
+	paper::block_reassembly reassembly;
 	std::unordered_map<paper::block_hash, std::shared_ptr<paper::block>> unresolved_forks;
+	// A range or segment pull was given up on so the account ranges can't be counted as complete
+	std::atomic<bool> chain_pulls_dropped;
 	bool stopped;
 	std::mutex mutex;
 	std::condition_variable condition;
@@ -137,12 +198,31 @@ public:
 	~bulk_pull_client ();
 	void request (paper::pull_info const &);
 	void receive_block ();
+	// Reads the next block once the block processor has room for it
+	void receive_block_throttled ();
 	void received_type ();
 	void received_block (boost::system::error_code const &, size_t);
+	// Checks the work of the blocks received since the last call in one batch and passes them on, false if the pull was stopped
+	bool process_unvalidated ();
 	paper::block_hash first ();
+	bool chain_pull () const;
+	// Queue what's left of an interrupted or capped range or segment pull
+	void continue_chains ();
 	std::shared_ptr<paper::bootstrap_client> connection;
+	// Next block expected from an account pull
 	paper::block_hash expected;
 	paper::pull_info pull;
+	// Blocks received by a range or segment pull and whether the peer finished the list
+	uint32_t pulled;
+	bool finished;
+	// Account and height of the last block received by a range pull
+	paper::account chain_account;
+	uint64_t chain_height;
+	// Whether the last block received is held by the reassembly buffer, and since when the pull has waited on it
+	bool holding;
+	std::chrono::steady_clock::time_point stalled;
+	// Blocks read from the peer whose work hasn't been checked yet
+	std::vector<std::shared_ptr<paper::block>> unvalidated;
 };
 class bootstrap_client : public std::enable_shared_from_this<bootstrap_client>
 {
@@ -156,6 +236,8 @@ public:
 	void stop (bool force);
 	double block_rate () const;
 	double elapsed_seconds () const;
+	// Whether the peer advertised a protocol version that serves range and segment pulls
+	bool chain_pulls () const;
 	std::shared_ptr<paper::node> node;
 	std::shared_ptr<paper::bootstrap_attempt> attempt;
 	boost::asio::ip::tcp::socket socket;
@@ -166,6 +248,8 @@ public:
 	std::atomic<uint64_t> block_count;
 	std::atomic<bool> pending_stop;
 	std::atomic<bool> hard_stop;
+	// Protocol version of the peer when the connection was made, 0 if it wasn't known
+	unsigned network_version;
 };
 class bulk_push_client : public std::enable_shared_from_this<paper::bulk_push_client>
 {
@@ -191,11 +275,14 @@ public:
 	void notify_listeners (bool);
 	void add_observer (std::function<void(bool)> const &);
 	bool in_progress ();
+	std::shared_ptr<paper::bootstrap_attempt> current_attempt ();
 	void process_fork (MDB_txn *, std::shared_ptr<paper::block>);
 	void stop ();
 	paper::node & node;
 	std::shared_ptr<paper::bootstrap_attempt> attempt;
 	bool stopped;
+	// Set once an attempt has pulled every configured account range, later attempts only use frontiers
+	std::atomic<bool> ranges_complete;
 
 private:
 	std::mutex mutex;
@@ -248,15 +335,21 @@ class bulk_pull_server : public std::enable_shared_from_this<paper::bulk_pull_se
 public:
 	bulk_pull_server (std::shared_ptr<paper::bootstrap_server> const &, std::unique_ptr<paper::bulk_pull>);
 	void set_current_end ();
-	std::unique_ptr<paper::block> get_next ();
+	paper::block_view get_next ();
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
 	void no_block_sent (boost::system::error_code const &, size_t);
 	std::shared_ptr<paper::bootstrap_server> connection;
 	std::unique_ptr<paper::bulk_pull> request;
+	// Many serialized blocks are batched in to each write
 	std::vector<uint8_t> send_buffer;
 	paper::block_hash current;
+	// Read transaction shared by every block in the batch being filled
+	std::unique_ptr<paper::transaction> transaction;
+	uint64_t blocks_sent;
+	uint64_t bytes_sent;
+	std::chrono::steady_clock::time_point start_time;
 };
 class bulk_pull_blocks;
 class bulk_pull_blocks_server : public std::enable_shared_from_this<paper::bulk_pull_blocks_server>
@@ -264,16 +357,21 @@ class bulk_pull_blocks_server : public std::enable_shared_from_this<paper::bulk_
 public:
 	bulk_pull_blocks_server (std::shared_ptr<paper::bootstrap_server> const &, std::unique_ptr<paper::bulk_pull_blocks>);
 	void set_params ();
-	std::unique_ptr<paper::block> get_next ();
+	paper::block_view get_next ();
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
 	void no_block_sent (boost::system::error_code const &, size_t);
 	std::shared_ptr<paper::bootstrap_server> connection;
 	std::unique_ptr<paper::bulk_pull_blocks> request;
+	// Many serialized blocks are batched in to each write
 	std::vector<uint8_t> send_buffer;
+	// Read transaction and cursor shared by every block in the batch being filled
+	std::unique_ptr<paper::transaction> transaction;
 	paper::store_iterator stream;
-	paper::transaction stream_transaction;
+	// Where the next batch resumes, a block hash or the account and height of a height_key
+	paper::uint256_union next;
+	uint64_t next_height;
 	uint32_t sent_count;
 	paper::block_hash checksum;
 };
@@ -293,7 +391,6 @@ class frontier_req_server : public std::enable_shared_from_this<paper::frontier_
 {
 public:
 	frontier_req_server (std::shared_ptr<paper::bootstrap_server> const &, std::unique_ptr<paper::frontier_req>);
-	void skip_old ();
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
@@ -303,7 +400,12 @@ public:
 	paper::account current;
 	paper::account_info info;
 	std::unique_ptr<paper::frontier_req> request;
+	// Many frontiers are batched in to each write
 	std::vector<uint8_t> send_buffer;
 	size_t count;
+	// Cursor over the accounts table, kept for a batch and renewed if a scan runs past its time budget
+	std::unique_ptr<paper::transaction> transaction;
+	std::chrono::steady_clock::time_point transaction_start;
+	paper::store_iterator iterator;
 };
 }
@@ -9,8 +9,8 @@ size_t constexpr paper::message::bootstrap_server_position;
 std::bitset<16> constexpr paper::message::block_type_mask;
 
 paper::message::message (paper::message_type type_a) :
-version_max (0x06),
-version_using (0x06),
+version_max (0x07),
+version_using (0x07),
 version_min (0x01),
 type (type_a)
 {
@@ -74,7 +74,8 @@ paper::message_parser::message_parser (paper::message_visitor & visitor_a, paper
 visitor (visitor_a),
 pool (pool_a),
 error (false),
-insufficient_work (false)
+insufficient_work (false),
+validate_work (true)
 {
 }
 
@@ -146,7 +147,7 @@ void paper::message_parser::deserialize_publish (uint8_t const * buffer_a, size_
 	auto error_l (incoming.deserialize (stream));
 	if (!error_l && at_end (stream))
 	{
-		if (!paper::work_validate (*incoming.block))
+		if (!validate_work || !paper::work_validate (*incoming.block))
 		{
 			visitor.publish (incoming);
 		}
@@ -168,7 +169,7 @@ void paper::message_parser::deserialize_confirm_req (uint8_t const * buffer_a, s
 	auto error_l (incoming.deserialize (stream));
 	if (!error_l && at_end (stream))
 	{
-		if (!paper::work_validate (*incoming.block))
+		if (!validate_work || !paper::work_validate (*incoming.block))
 		{
 			visitor.confirm_req (incoming);
 		}
@@ -190,7 +191,7 @@ void paper::message_parser::deserialize_confirm_ack (uint8_t const * buffer_a, s
 	paper::confirm_ack incoming (error_l, stream);
 	if (!error_l && at_end (stream))
 	{
-		if (!paper::work_validate (*incoming.vote->block))
+		if (!validate_work || !paper::work_validate (*incoming.vote->block))
 		{
 			visitor.confirm_ack (incoming);
 		}
@@ -479,7 +480,9 @@ void paper::bulk_pull::serialize (paper::stream & stream_a)
 }
 
 paper::bulk_pull_blocks::bulk_pull_blocks () :
-message (paper::message_type::bulk_pull_blocks)
+message (paper::message_type::bulk_pull_blocks),
+min_height (0),
+max_height (0)
 {
 }
 
@@ -511,6 +514,15 @@ bool paper::bulk_pull_blocks::deserialize (paper::stream & stream_a)
 		{
 			result = read (stream_a, max_count);
 		}
+
+		if (!result && mode == paper::bulk_pull_blocks_mode::list_chain_heights)
+		{
+			result = read (stream_a, min_height);
+			if (!result)
+			{
+				result = read (stream_a, max_height);
+			}
+		}
 	}
 	return result;
 }
@@ -522,6 +534,11 @@ void paper::bulk_pull_blocks::serialize (paper::stream & stream_a)
 	write (stream_a, max_hash);
 	write (stream_a, mode);
 	write (stream_a, max_count);
+	if (mode == paper::bulk_pull_blocks_mode::list_chain_heights)
+	{
+		write (stream_a, min_height);
+		write (stream_a, max_height);
+	}
 }
 
 paper::bulk_push::bulk_push () :
@@ -98,8 +98,14 @@ enum class message_type : uint8_t
 enum class bulk_pull_blocks_mode : uint8_t
 {
 	list_blocks,
-	checksum_blocks
+	checksum_blocks,
+	// Chains of the accounts in [min_hash, max_hash), each from its open block to its head
+	list_chains,
+	// Blocks of account min_hash with heights in [min_height, max_height)
+	list_chain_heights
 };
+// Peers advertising at least this protocol version serve list_chains and list_chain_heights
+uint8_t constexpr protocol_version_chain_pulls = 0x07;
 class message_visitor;
 class message
 {
@@ -141,6 +147,8 @@ public:
 	paper::work_pool & pool;
 	bool error;
 	bool insufficient_work;
+	// Cleared by callers that validate the work of a whole burst of messages themselves
+	bool validate_work;
 };
 class keepalive : public message
 {
@@ -218,6 +226,9 @@ public:
 	paper::block_hash max_hash;
 	bulk_pull_blocks_mode mode;
 	uint32_t max_count;
+	// Only on the wire for list_chain_heights, after max_count
+	uint64_t min_height;
+	uint64_t max_height;
 };
 class bulk_push : public message
 {
@@ -23,14 +23,27 @@
 
 #include <ed25519-donna/ed25519.h>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 double constexpr paper::node::price_max;
 double constexpr paper::node::free_cutoff;
 std::chrono::seconds constexpr paper::node::period;
 std::chrono::seconds constexpr paper::node::cutoff;
 std::chrono::minutes constexpr paper::node::backup_interval;
+std::chrono::minutes constexpr paper::node::unchecked_cleanup_interval;
+size_t constexpr paper::node::unchecked_cleanup_slice;
 int constexpr paper::port_mapping::mapping_timeout;
 int constexpr paper::port_mapping::check_timeout;
 unsigned constexpr paper::active_transactions::announce_interval_ms;
+size_t constexpr paper::active_transactions::shard_count;
+std::chrono::seconds constexpr paper::callback_dispatcher::retry_delay;
+size_t constexpr paper::network::burst_max;
+size_t constexpr paper::network::ring_size;
+size_t constexpr paper::network::send_queue_max;
+size_t constexpr paper::block_processor::queue_max;
+size_t constexpr paper::block_processor::queue_limit;
 
 paper::message_statistics::message_statistics () :
 keepalive (0),
@@ -40,6 +53,162 @@ confirm_ack (0)
 {
 }
 
+std::atomic<uint64_t> * paper::message_statistics::counter (paper::message_type type_a)
+{
+	std::atomic<uint64_t> * result (nullptr);
+	switch (type_a)
+	{
+		case paper::message_type::keepalive:
+			result = &keepalive;
+			break;
+		case paper::message_type::publish:
+			result = &publish;
+			break;
+		case paper::message_type::confirm_req:
+			result = &confirm_req;
+			break;
+		case paper::message_type::confirm_ack:
+			result = &confirm_ack;
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+void paper::message_statistics::add (paper::message_type type_a, uint64_t count_a)
+{
+	auto value (counter (type_a));
+	if (value != nullptr)
+	{
+		*value += count_a;
+	}
+}
+
+void paper::message_statistics::subtract (paper::message_type type_a, uint64_t count_a)
+{
+	auto value (counter (type_a));
+	if (value != nullptr)
+	{
+		*value -= count_a;
+	}
+}
+
+namespace
+{
+paper::message_type datagram_type (uint8_t const * data_a, size_t size_a)
+{
+	paper::bufferstream stream (data_a, size_a);
+	uint8_t version_max;
+	uint8_t version_using;
+	uint8_t version_min;
+	paper::message_type result;
+	std::bitset<16> extensions;
+	if (paper::message::read_header (stream, version_max, version_using, version_min, result, extensions))
+	{
+		result = paper::message_type::invalid;
+	}
+	return result;
+}
+}
+
+bool paper::outgoing_datagram_compare::operator() (paper::outgoing_datagram const * lhs, paper::outgoing_datagram const * rhs) const
+{
+	bool result;
+	if (lhs->endpoint != rhs->endpoint)
+	{
+		result = lhs->endpoint < rhs->endpoint;
+	}
+	else
+	{
+		result = std::lexicographical_compare (lhs->data, lhs->data + lhs->size, rhs->data, rhs->data + rhs->size);
+	}
+	return result;
+}
+
+paper::datagram_ring::datagram_ring (size_t size_a) :
+datagrams (size_a),
+stopped (false),
+starved (false),
+available ([]() {})
+{
+	free.reserve (size_a);
+	for (auto & i : datagrams)
+	{
+		free.push_back (&i);
+	}
+}
+
+void paper::datagram_ring::allocate (std::vector<paper::datagram *> & datagrams_a, size_t count_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	while (!free.empty () && datagrams_a.size () < count_a)
+	{
+		datagrams_a.push_back (free.back ());
+		free.pop_back ();
+	}
+	starved = datagrams_a.empty ();
+}
+
+void paper::datagram_ring::enqueue (std::vector<paper::datagram *> const & datagrams_a)
+{
+	if (!datagrams_a.empty ())
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			ready.insert (ready.end (), datagrams_a.begin (), datagrams_a.end ());
+		}
+		condition.notify_one ();
+	}
+}
+
+bool paper::datagram_ring::dequeue (std::vector<paper::datagram *> & datagrams_a, size_t count_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped && ready.empty ())
+	{
+		condition.wait (lock);
+	}
+	while (!ready.empty () && datagrams_a.size () < count_a)
+	{
+		datagrams_a.push_back (ready.front ());
+		ready.pop_front ();
+	}
+	if (!ready.empty ())
+	{
+		// Let another processing thread start on the rest
+		condition.notify_one ();
+	}
+	return !datagrams_a.empty ();
+}
+
+void paper::datagram_ring::release (std::vector<paper::datagram *> const & datagrams_a)
+{
+	auto resume (false);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		free.insert (free.end (), datagrams_a.begin (), datagrams_a.end ());
+		resume = starved && !free.empty ();
+		if (resume)
+		{
+			starved = false;
+		}
+	}
+	if (resume)
+	{
+		available ();
+	}
+}
+
+void paper::datagram_ring::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+	}
+	condition.notify_all ();
+}
+
 paper::network::network (paper::node & node_a, uint16_t port) :
 socket (node_a.service, paper::endpoint (boost::asio::ip::address_v6::any (), port)),
 resolver (node_a.service),
@@ -47,8 +216,35 @@ node (node_a),
 bad_sender_count (0),
 on (true),
 insufficient_work_count (0),
-error_count (0)
+error_count (0),
+ring (ring_size),
+ring_full_count (0),
+kernel_dropped_count (0),
+send_flushing (false)
+{
+#ifdef __linux__
+	// Have the kernel report how many datagrams it dropped with each read
+	int overflow (1);
+	setsockopt (socket.native_handle (), SOL_SOCKET, SO_RXQ_OVFL, &overflow, sizeof (overflow));
+#endif
+	ring.available = [this]() {
+		if (on)
+		{
+			auto node_l (node.shared ());
+			node.service.post ([node_l]() {
+				node_l->network.receive ();
+			});
+		}
+	};
+	for (auto i (0u); i < node_a.config.network_threads; ++i)
+	{
+		processing_threads.push_back (std::thread ([this]() { process_loop (); }));
+	}
+}
+
+paper::network::~network ()
 {
+	stop ();
 }
 
 void paper::network::receive ()
@@ -58,16 +254,37 @@ void paper::network::receive ()
 		BOOST_LOG (node.log) << "Receiving packet";
 	}
 	std::unique_lock<std::mutex> lock (socket_mutex);
-	socket.async_receive_from (boost::asio::buffer (buffer.data (), buffer.size ()), remote, [this](boost::system::error_code const & error, size_t size_a) {
-		receive_action (error, size_a);
+	socket.async_wait (boost::asio::ip::udp::socket::wait_read, [this](boost::system::error_code const & error) {
+		receive_action (error);
 	});
 }
 
 void paper::network::stop ()
 {
 	on = false;
+	std::deque<paper::outgoing_datagram> aborted;
+	{
+		// A flush posted to a service that's no longer running would never clear this, and the queued callbacks would keep what they captured alive
+		std::lock_guard<std::mutex> lock (send_mutex);
+		std::swap (aborted, send_queue);
+		send_pending.clear ();
+		send_flushing = false;
+	}
+	for (auto & i : aborted)
+	{
+		send_queued.subtract (i.type);
+		i.callback (boost::system::error_code (boost::asio::error::operation_aborted), 0);
+	}
 	socket.close ();
 	resolver.cancel ();
+	ring.stop ();
+	for (auto & i : processing_threads)
+	{
+		if (i.joinable ())
+		{
+			i.join ();
+		}
+	}
 }
 
 void paper::network::send_keepalive (paper::endpoint const & endpoint_a)
@@ -342,7 +559,15 @@ public:
 		++node.network.incoming.publish;
 		node.peers.contacted (sender, message_a.version_using);
 		node.peers.insert (sender, message_a.version_using);
-		node.process_active (message_a.block);
+		if (!node.block_processor.full ())
+		{
+			node.process_active (message_a.block);
+		}
+		else
+		{
+			// Republished blocks are dropped while the block processor catches up, votes and keepalives are still processed
+			++node.network.receive_dropped.publish;
+		}
 	}
 	void confirm_req (paper::confirm_req const & message_a) override
 	{
@@ -371,9 +596,9 @@ public:
 		node.peers.insert (sender, message_a.version_using);
 		node.process_active (message_a.vote->block);
 		auto vote (node.vote_processor.vote (message_a.vote, sender));
-		if (vote.code == paper::vote_code::replay)
+		// Votes the full vote cache couldn't record come back as replays of themselves
+		if (vote.code == paper::vote_code::replay && vote.vote->sequence > message_a.vote->sequence)
 		{
-			assert (vote.vote->sequence > message_a.vote->sequence);
 			// This tries to assist rep nodes that have lost track of their highest sequence number by replaying our highest known vote back to them
 			// Only do this if the sequence number is significantly different to account for network reordering
 			// Amplify attack considerations: We're sending out a confirm_ack in response to a confirm_ack for no net traffic increase
@@ -408,52 +633,216 @@ public:
 	paper::node & node;
 	paper::endpoint sender;
 };
+
+class burst_message
+{
+public:
+	std::unique_ptr<paper::message> message;
+	// Block whose work still needs validating, null for messages without one
+	std::shared_ptr<paper::block> block;
+	paper::endpoint sender;
+};
+
+// Holds on to the messages parsed from a burst of datagrams so their work can be validated in one batch
+class burst_visitor : public paper::message_visitor
+{
+public:
+	void keepalive (paper::keepalive const & message_a) override
+	{
+		add (message_a, nullptr);
+	}
+	void publish (paper::publish const & message_a) override
+	{
+		add (message_a, message_a.block);
+	}
+	void confirm_req (paper::confirm_req const & message_a) override
+	{
+		add (message_a, message_a.block);
+	}
+	void confirm_ack (paper::confirm_ack const & message_a) override
+	{
+		add (message_a, message_a.vote->block);
+	}
+	void bulk_pull (paper::bulk_pull const &) override
+	{
+		assert (false);
+	}
+	void bulk_pull_blocks (paper::bulk_pull_blocks const &) override
+	{
+		assert (false);
+	}
+	void bulk_push (paper::bulk_push const &) override
+	{
+		assert (false);
+	}
+	void frontier_req (paper::frontier_req const &) override
+	{
+		assert (false);
+	}
+	template <typename T>
+	void add (T const & message_a, std::shared_ptr<paper::block> block_a)
+	{
+		messages.push_back (burst_message{ std::unique_ptr<paper::message> (new T (message_a)), block_a, sender });
+	}
+	paper::endpoint sender;
+	std::vector<burst_message> messages;
+};
 }
 
-void paper::network::receive_action (boost::system::error_code const & error, size_t size_a)
+void paper::network::receive_action (boost::system::error_code const & error)
 {
 	if (!error && on)
 	{
-		if (!paper::reserved_address (remote) && remote != endpoint ())
+		if (receive_datagrams ())
 		{
-			network_message_visitor visitor (node, remote);
-			paper::message_parser parser (visitor, node.work);
-			parser.deserialize_buffer (buffer.data (), size_a);
-			if (parser.error)
+			receive ();
+		}
+	}
+	else
+	{
+		if (error)
+		{
+			if (node.config.logging.network_logging ())
 			{
-				++error_count;
+				BOOST_LOG (node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
 			}
-			else if (parser.insufficient_work)
+		}
+		if (on)
+		{
+			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+		}
+	}
+}
+
+bool paper::network::receive_datagrams ()
+{
+	std::vector<paper::datagram *> datagrams;
+	datagrams.reserve (burst_max);
+	ring.allocate (datagrams, burst_max);
+	size_t result (0);
+	std::lock_guard<std::mutex> lock (socket_mutex);
+	if (!datagrams.empty ())
+	{
+#ifdef __linux__
+		// Read everything that's queued, up to the number of free buffers, in one syscall
+		std::array<mmsghdr, burst_max> headers;
+		std::array<iovec, burst_max> vectors;
+		// Room for the SO_RXQ_OVFL drop counter the kernel attaches to each datagram
+		std::array<std::array<uint8_t, CMSG_SPACE (sizeof (uint32_t))>, burst_max> controls;
+		for (size_t i (0), n (datagrams.size ()); i < n; ++i)
+		{
+			auto & datagram (*datagrams[i]);
+			vectors[i].iov_base = datagram.buffer.data ();
+			vectors[i].iov_len = datagram.buffer.size ();
+			std::memset (&headers[i], 0, sizeof (headers[i]));
+			headers[i].msg_hdr.msg_name = datagram.remote.data ();
+			headers[i].msg_hdr.msg_namelen = datagram.remote.capacity ();
+			headers[i].msg_hdr.msg_iov = &vectors[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+			headers[i].msg_hdr.msg_control = controls[i].data ();
+			headers[i].msg_hdr.msg_controllen = controls[i].size ();
+		}
+		auto count (recvmmsg (socket.native_handle (), headers.data (), datagrams.size (), MSG_DONTWAIT, nullptr));
+		for (auto i (0); i < count; ++i)
+		{
+			datagrams[i]->remote.resize (headers[i].msg_hdr.msg_namelen);
+			datagrams[i]->size = headers[i].msg_len;
+			for (auto control (CMSG_FIRSTHDR (&headers[i].msg_hdr)); control != nullptr; control = CMSG_NXTHDR (&headers[i].msg_hdr, control))
 			{
-				if (node.config.logging.insufficient_work_logging ())
+				if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL)
 				{
-					BOOST_LOG (node.log) << "Insufficient work in message";
+					// The kernel's count is a running total for the socket
+					uint32_t dropped;
+					std::memcpy (&dropped, CMSG_DATA (control), sizeof (dropped));
+					kernel_dropped_count = dropped;
 				}
-				++insufficient_work_count;
 			}
 		}
-		else
+		result = std::max (0, count);
+#else
+		boost::system::error_code ec;
+		while (result < datagrams.size () && socket.available (ec) > 0 && !ec)
 		{
-			if (node.config.logging.network_logging ())
+			auto & datagram (*datagrams[result]);
+			datagram.size = socket.receive_from (boost::asio::buffer (datagram.buffer.data (), datagram.buffer.size ()), datagram.remote, 0, ec);
+			if (!ec)
 			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % remote.address ().to_string ());
+				++result;
 			}
-			++bad_sender_count;
 		}
-		receive ();
+#endif
+		ring.enqueue (std::vector<paper::datagram *> (datagrams.begin (), datagrams.begin () + result));
+		ring.release (std::vector<paper::datagram *> (datagrams.begin () + result, datagrams.end ()));
 	}
 	else
 	{
-		if (error)
+		// Every buffer is waiting on the processing threads, leave datagrams queued in the kernel's buffer until some are released
+		++ring_full_count;
+	}
+	return !datagrams.empty ();
+}
+
+void paper::network::process_loop ()
+{
+	std::vector<paper::datagram *> datagrams;
+	datagrams.reserve (burst_max);
+	while (ring.dequeue (datagrams, burst_max))
+	{
+		process_datagrams (datagrams);
+		ring.release (datagrams);
+		datagrams.clear ();
+	}
+}
+
+void paper::network::process_datagrams (std::vector<paper::datagram *> const & datagrams_a)
+{
+	burst_visitor burst;
+	paper::message_parser parser (burst, node.work);
+	parser.validate_work = false;
+	for (auto datagram : datagrams_a)
+	{
+		if (!paper::reserved_address (datagram->remote) && datagram->remote != endpoint ())
+		{
+			burst.sender = datagram->remote;
+			parser.deserialize_buffer (datagram->buffer.data (), datagram->size);
+			if (parser.error)
+			{
+				++error_count;
+			}
+		}
+		else
 		{
 			if (node.config.logging.network_logging ())
 			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
+				BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % datagram->remote.address ().to_string ());
 			}
+			++bad_sender_count;
 		}
-		if (on)
+	}
+	std::vector<std::pair<paper::block_hash, uint64_t>> work;
+	for (auto & i : burst.messages)
+	{
+		if (i.block != nullptr)
 		{
-			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+			work.push_back (std::make_pair (i.block->root (), i.block->block_work ()));
+		}
+	}
+	auto insufficient (paper::work_validate (work));
+	auto insufficient_i (insufficient.begin ());
+	for (auto & i : burst.messages)
+	{
+		if (i.block == nullptr || !*insufficient_i++)
+		{
+			network_message_visitor visitor (node, i.sender);
+			i.message->visit (visitor);
+		}
+		else
+		{
+			if (node.config.logging.insufficient_work_logging ())
+			{
+				BOOST_LOG (node.log) << "Insufficient work in message";
+			}
+			++insufficient_work_count;
 		}
 	}
 }
@@ -751,11 +1140,26 @@ inactive_supply (0),
 password_fanout (1024),
 io_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
 work_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+network_threads (std::max<unsigned> (1, std::thread::hardware_concurrency ())),
+wallet_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
 enable_voting (true),
 bootstrap_connections (4),
 bootstrap_connections_max (64),
+bootstrap_ranges (0),
 callback_port (0),
-lmdb_max_dbs (128)
+callback_connections (4),
+callback_batch (1),
+callback_queue_max (64 * 1024),
+callback_retries (3),
+stream_address (boost::asio::ip::address_v4::loopback ()),
+stream_port (0),
+stream_buffer (4096),
+stream_history (64 * 1024),
+lmdb_max_dbs (128),
+unchecked_cache_max (paper::block_store::unchecked_cache_max_default),
+account_cache_max (paper::block_store::account_cache_max_default),
+block_cache_max (paper::block_store::block_cache_max_default),
+unchecked_cutoff_time (std::chrono::hours (4))
 {
 	switch (paper::paper_network)
 	{
@@ -788,7 +1192,7 @@ lmdb_max_dbs (128)
 
 void paper::node_config::serialize_json (boost::property_tree::ptree & tree_a) const
 {
-	tree_a.put ("version", "9");
+	tree_a.put ("version", "17");
 	tree_a.put ("peering_port", std::to_string (peering_port));
 	tree_a.put ("bootstrap_fraction_numerator", std::to_string (bootstrap_fraction_numerator));
 	tree_a.put ("receive_minimum", receive_minimum.to_string_dec ());
@@ -823,13 +1227,28 @@ void paper::node_config::serialize_json (boost::property_tree::ptree & tree_a) c
 	tree_a.put ("password_fanout", std::to_string (password_fanout));
 	tree_a.put ("io_threads", std::to_string (io_threads));
 	tree_a.put ("work_threads", std::to_string (work_threads));
+	tree_a.put ("network_threads", std::to_string (network_threads));
+	tree_a.put ("wallet_threads", std::to_string (wallet_threads));
 	tree_a.put ("enable_voting", enable_voting);
 	tree_a.put ("bootstrap_connections", bootstrap_connections);
 	tree_a.put ("bootstrap_connections_max", bootstrap_connections_max);
+	tree_a.put ("bootstrap_ranges", std::to_string (bootstrap_ranges));
 	tree_a.put ("callback_address", callback_address);
 	tree_a.put ("callback_port", std::to_string (callback_port));
 	tree_a.put ("callback_target", callback_target);
+	tree_a.put ("callback_connections", std::to_string (callback_connections));
+	tree_a.put ("callback_batch", std::to_string (callback_batch));
+	tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
+	tree_a.put ("callback_retries", std::to_string (callback_retries));
+	tree_a.put ("stream_address", stream_address.to_string ());
+	tree_a.put ("stream_port", std::to_string (stream_port));
+	tree_a.put ("stream_buffer", std::to_string (stream_buffer));
+	tree_a.put ("stream_history", std::to_string (stream_history));
 	tree_a.put ("lmdb_max_dbs", lmdb_max_dbs);
+	tree_a.put ("unchecked_cache_max", std::to_string (unchecked_cache_max));
+	tree_a.put ("unchecked_cutoff_time", std::to_string (unchecked_cutoff_time.count ()));
+	tree_a.put ("account_cache_max", std::to_string (account_cache_max));
+	tree_a.put ("block_cache_max", std::to_string (block_cache_max));
 }
 
 bool paper::node_config::upgrade_json (unsigned version, boost::property_tree::ptree & tree_a)
@@ -904,6 +1323,53 @@ bool paper::node_config::upgrade_json (unsigned version, boost::property_tree::p
 			tree_a.put ("version", "9");
 			result = true;
 		case 9:
+			tree_a.put ("network_threads", std::to_string (network_threads));
+			tree_a.erase ("version");
+			tree_a.put ("version", "10");
+			result = true;
+		case 10:
+			tree_a.put ("unchecked_cache_max", std::to_string (unchecked_cache_max));
+			tree_a.put ("unchecked_cutoff_time", std::to_string (unchecked_cutoff_time.count ()));
+			tree_a.erase ("version");
+			tree_a.put ("version", "11");
+			result = true;
+		case 11:
+			tree_a.put ("bootstrap_ranges", std::to_string (bootstrap_ranges));
+			tree_a.erase ("version");
+			tree_a.put ("version", "12");
+			result = true;
+		case 12:
+			tree_a.put ("account_cache_max", std::to_string (account_cache_max));
+			tree_a.put ("block_cache_max", std::to_string (block_cache_max));
+			tree_a.erase ("version");
+			tree_a.put ("version", "13");
+			result = true;
+		case 13:
+			tree_a.put ("callback_connections", std::to_string (callback_connections));
+			tree_a.put ("callback_batch", std::to_string (callback_batch));
+			tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
+			tree_a.put ("callback_retries", std::to_string (callback_retries));
+			tree_a.erase ("version");
+			tree_a.put ("version", "14");
+			result = true;
+		case 14:
+			tree_a.put ("stream_port", std::to_string (stream_port));
+			tree_a.put ("stream_buffer", std::to_string (stream_buffer));
+			tree_a.put ("stream_history", std::to_string (stream_history));
+			tree_a.erase ("version");
+			tree_a.put ("version", "15");
+			result = true;
+		case 15:
+			tree_a.put ("wallet_threads", std::to_string (wallet_threads));
+			tree_a.erase ("version");
+			tree_a.put ("version", "16");
+			result = true;
+		case 16:
+			tree_a.put ("stream_address", stream_address.to_string ());
+			tree_a.erase ("version");
+			tree_a.put ("version", "17");
+			result = true;
+		case 17:
 			break;
 		default:
 			throw std::runtime_error ("Unknown node_config version");
@@ -969,14 +1435,33 @@ bool paper::node_config::deserialize_json (bool & upgraded_a, boost::property_tr
 		auto password_fanout_l (tree_a.get<std::string> ("password_fanout"));
 		auto io_threads_l (tree_a.get<std::string> ("io_threads"));
 		auto work_threads_l (tree_a.get<std::string> ("work_threads"));
+		auto network_threads_l (tree_a.get<std::string> ("network_threads"));
+		auto wallet_threads_l (tree_a.get<std::string> ("wallet_threads"));
 		enable_voting = tree_a.get<bool> ("enable_voting");
 		auto bootstrap_connections_l (tree_a.get<std::string> ("bootstrap_connections"));
 		auto bootstrap_connections_max_l (tree_a.get<std::string> ("bootstrap_connections_max"));
+		auto bootstrap_ranges_l (tree_a.get<std::string> ("bootstrap_ranges"));
 		callback_address = tree_a.get<std::string> ("callback_address");
 		auto callback_port_l (tree_a.get<std::string> ("callback_port"));
 		callback_target = tree_a.get<std::string> ("callback_target");
+		auto callback_connections_l (tree_a.get<std::string> ("callback_connections"));
+		auto callback_batch_l (tree_a.get<std::string> ("callback_batch"));
+		auto callback_queue_max_l (tree_a.get<std::string> ("callback_queue_max"));
+		auto callback_retries_l (tree_a.get<std::string> ("callback_retries"));
+		auto stream_address_l (tree_a.get<std::string> ("stream_address"));
+		auto stream_port_l (tree_a.get<std::string> ("stream_port"));
+		auto stream_buffer_l (tree_a.get<std::string> ("stream_buffer"));
+		auto stream_history_l (tree_a.get<std::string> ("stream_history"));
 		auto lmdb_max_dbs_l = tree_a.get<std::string> ("lmdb_max_dbs");
+		auto unchecked_cache_max_l (tree_a.get<std::string> ("unchecked_cache_max"));
+		auto unchecked_cutoff_time_l (tree_a.get<std::string> ("unchecked_cutoff_time"));
+		auto account_cache_max_l (tree_a.get<std::string> ("account_cache_max"));
+		auto block_cache_max_l (tree_a.get<std::string> ("block_cache_max"));
 		result |= parse_port (callback_port_l, callback_port);
+		result |= parse_port (stream_port_l, stream_port);
+		boost::system::error_code stream_address_ec;
+		stream_address = boost::asio::ip::address::from_string (stream_address_l, stream_address_ec);
+		result |= !!stream_address_ec;
 		try
 		{
 			peering_port = std::stoul (peering_port_l);
@@ -984,9 +1469,22 @@ bool paper::node_config::deserialize_json (bool & upgraded_a, boost::property_tr
 			password_fanout = std::stoul (password_fanout_l);
 			io_threads = std::stoul (io_threads_l);
 			work_threads = std::stoul (work_threads_l);
+			network_threads = std::stoul (network_threads_l);
+			wallet_threads = std::stoul (wallet_threads_l);
 			bootstrap_connections = std::stoul (bootstrap_connections_l);
 			bootstrap_connections_max = std::stoul (bootstrap_connections_max_l);
+			bootstrap_ranges = std::stoul (bootstrap_ranges_l);
+			callback_connections = std::stoul (callback_connections_l);
+			callback_batch = std::stoul (callback_batch_l);
+			callback_queue_max = std::stoull (callback_queue_max_l);
+			callback_retries = std::stoul (callback_retries_l);
+			stream_buffer = std::stoull (stream_buffer_l);
+			stream_history = std::stoull (stream_history_l);
 			lmdb_max_dbs = std::stoi (lmdb_max_dbs_l);
+			unchecked_cache_max = std::stoull (unchecked_cache_max_l);
+			unchecked_cutoff_time = std::chrono::seconds (std::stoull (unchecked_cutoff_time_l));
+			account_cache_max = std::stoull (account_cache_max_l);
+			block_cache_max = std::stoull (block_cache_max_l);
 			result |= peering_port > std::numeric_limits<uint16_t>::max ();
 			result |= logging.deserialize_json (upgraded_a, logging_l);
 			result |= receive_minimum.decode_dec (receive_minimum_l);
@@ -995,6 +1493,11 @@ bool paper::node_config::deserialize_json (bool & upgraded_a, boost::property_tr
 			result |= password_fanout > 1024 * 1024;
 			result |= io_threads == 0;
 			result |= work_threads == 0;
+			result |= network_threads == 0;
+			result |= wallet_threads == 0;
+			result |= callback_connections == 0;
+			result |= callback_batch == 0;
+			result |= stream_buffer == 0;
 		}
 		catch (std::logic_error const &)
 		{
@@ -1081,66 +1584,235 @@ block_processor_item (block_a, false)
 
 paper::block_processor_item::block_processor_item (std::shared_ptr<paper::block> block_a, bool force_a) :
 block (block_a),
-force (force_a)
+force (force_a),
+verification (paper::signature_verification::unknown)
 {
 }
 
-paper::block_processor::block_processor (paper::node & node_a) :
-stopped (false),
-idle (true),
-node (node_a)
+paper::signature_checker::signature_checker (unsigned thread_count_a) :
+stopped (false)
 {
+	for (auto i (0u); i < thread_count_a; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
 }
 
-paper::block_processor::~block_processor ()
+paper::signature_checker::~signature_checker ()
 {
 	stop ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
 }
 
-void paper::block_processor::stop ()
+void paper::signature_checker::stop ()
 {
 	std::lock_guard<std::mutex> lock (mutex);
 	stopped = true;
 	condition.notify_all ();
 }
 
-void paper::block_processor::flush ()
+void paper::signature_checker::run ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
-	while (!stopped && (!blocks.empty () || !idle))
+	// Drain queued tasks even when stopping, a caller is waiting on them
+	while (!stopped || !tasks.empty ())
 	{
-		condition.wait (lock);
+		if (!tasks.empty ())
+		{
+			auto task (tasks.front ());
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
 	}
 }
 
-void paper::block_processor::add (paper::block_processor_item const & item_a)
+void paper::signature_checker::verify (paper::signature_check_set & check_a)
 {
-	std::lock_guard<std::mutex> lock (mutex);
-	blocks.push_back (item_a);
-	condition.notify_all ();
-}
+	auto verify_range ([&check_a](size_t begin_a, size_t end_a) {
+		paper::validate_message_batch (check_a.messages + begin_a, check_a.message_lengths + begin_a, check_a.pub_keys + begin_a, check_a.signatures + begin_a, end_a - begin_a, check_a.verifications + begin_a);
+	});
+	std::mutex completion_mutex;
+	std::condition_variable completion;
+	size_t remaining (0);
+	// Counted separately from remaining, which the pool threads decrement as they finish
+	size_t dispatched (0);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (!stopped && !threads.empty ())
+		{
+			// The calling thread verifies the first batch itself, the rest are handed to the pool
+			for (size_t i (batch_size); i < check_a.size; i += batch_size)
+			{
+				auto end (std::min (i + batch_size, check_a.size));
+				++dispatched;
+				{
+					std::lock_guard<std::mutex> lock (completion_mutex);
+					++remaining;
+				}
+				tasks.push_back ([&verify_range, &completion_mutex, &completion, &remaining, i, end]() {
+					verify_range (i, end);
+					std::lock_guard<std::mutex> lock (completion_mutex);
+					--remaining;
+					completion.notify_all ();
+				});
+			}
+			condition.notify_all ();
+		}
+	}
+	verify_range (0, dispatched == 0 ? check_a.size : batch_size);
+	std::unique_lock<std::mutex> lock (completion_mutex);
+	while (remaining != 0)
+	{
+		completion.wait (lock);
+	}
+}
+
+paper::block_processor::block_processor (paper::node & node_a) :
+checker (std::max (1u, std::thread::hardware_concurrency ()) - 1),
+dropped (0),
+stopped (false),
+verify_idle (true),
+process_idle (true),
+overflowing (false),
+node (node_a)
+{
+}
+
+paper::block_processor::~block_processor ()
+{
+	stop ();
+}
+
+void paper::block_processor::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		condition.notify_all ();
+	}
+	checker.stop ();
+}
+
+void paper::block_processor::flush ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped && (!blocks.empty () || !verified.empty () || !verify_idle || !process_idle))
+	{
+		condition.wait (lock);
+	}
+}
+
+bool paper::block_processor::add (paper::block_processor_item const & item_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (blocks.size () >= queue_limit);
+	if (!result)
+	{
+		blocks.push_back (item_a);
+		condition.notify_all ();
+		overflowing = overflowing && blocks.size () >= queue_max;
+	}
+	else
+	{
+		++dropped;
+		if (!overflowing)
+		{
+			// Logged once each time the queue fills, the rest are only counted in dropped
+			overflowing = true;
+			BOOST_LOG (node.log) << boost::str (boost::format ("Block processor queue reached %1% blocks, dropping blocks until it drains") % queue_limit);
+		}
+	}
+	return result;
+}
+
+bool paper::block_processor::full ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return blocks.size () >= queue_max;
+}
+
+size_t paper::block_processor::incoming_size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return blocks.size ();
+}
+
+size_t paper::block_processor::verified_size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return verified.size ();
+}
+
+void paper::block_processor::verify_blocks ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!blocks.empty () && verified.size () < queue_max)
+		{
+			// Only as many blocks as the verified queue has room for are taken, so it never holds more than queue_max
+			auto count (std::min<size_t> (blocks.size (), queue_max - verified.size ()));
+			std::deque<paper::block_processor_item> blocks_verifying (std::make_move_iterator (blocks.begin ()), std::make_move_iterator (blocks.begin () + count));
+			blocks.erase (blocks.begin (), blocks.begin () + count);
+			// Producers waiting on a full queue can continue
+			condition.notify_all ();
+			lock.unlock ();
+			// Ordering first lets chains that arrive newest first find their signing account earlier in the batch
+			order_dependencies (blocks_verifying);
+			verify_signatures (blocks_verifying);
+			lock.lock ();
+			verified.insert (verified.end (), blocks_verifying.begin (), blocks_verifying.end ());
+			condition.notify_all ();
+		}
+		else
+		{
+			verify_idle = true;
+			condition.notify_all ();
+			condition.wait (lock);
+			verify_idle = false;
+		}
+	}
+}
 
 void paper::block_processor::process_blocks ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!stopped)
 	{
-		if (!blocks.empty ())
+		if (!verified.empty ())
 		{
 			std::deque<paper::block_processor_item> blocks_processing;
-			std::swap (blocks, blocks_processing);
+			std::swap (verified, blocks_processing);
+			// The verifier may be waiting for room
+			condition.notify_all ();
 			lock.unlock ();
-			process_receive_many (blocks_processing);
+			std::deque<paper::block_processor_item> released;
+			process_items (blocks_processing, &released);
 			// Let other threads get an opportunity to transaction lock
 			std::this_thread::yield ();
 			lock.lock ();
+			// Unchecked blocks released by this pass go back through the verifier ahead of newly arrived blocks
+			blocks.insert (blocks.begin (), released.begin (), released.end ());
+			if (!released.empty ())
+			{
+				condition.notify_all ();
+			}
 		}
 		else
 		{
-			idle = true;
+			process_idle = true;
 			condition.notify_all ();
 			condition.wait (lock);
-			idle = false;
+			process_idle = false;
 		}
 	}
 }
@@ -1152,7 +1824,132 @@ void paper::block_processor::process_receive_many (paper::block_processor_item c
 	process_receive_many (blocks_processing);
 }
 
+void paper::block_processor::verify_signatures (std::deque<paper::block_processor_item> & items_a)
+{
+	std::vector<paper::block_processor_item *> items;
+	std::vector<paper::block_hash> hashes;
+	std::vector<paper::account> accounts;
+	std::vector<paper::signature> signatures;
+	{
+		// Accounts of blocks earlier in this batch so chains arriving together can be verified in one pass
+		std::unordered_map<paper::block_hash, paper::account> batch_accounts;
+		paper::transaction transaction (node.store.environment, nullptr, false);
+		for (auto & i : items_a)
+		{
+			if (i.verification == paper::signature_verification::unknown)
+			{
+				auto hash (i.block->hash ());
+				paper::account account (0);
+				if (i.block->type () == paper::block_type::open)
+				{
+					account = i.block->root ();
+				}
+				else
+				{
+					auto previous (i.block->previous ());
+					auto existing (batch_accounts.find (previous));
+					account = existing != batch_accounts.end () ? existing->second : node.store.frontier_get (transaction, previous);
+				}
+				// Blocks whose account can't be determined yet are validated by the ledger as usual
+				if (!account.is_zero ())
+				{
+					batch_accounts[hash] = account;
+					items.push_back (&i);
+					hashes.push_back (hash);
+					accounts.push_back (account);
+					signatures.push_back (i.block->block_signature ());
+				}
+			}
+		}
+	}
+	auto size (items.size ());
+	if (size > 0)
+	{
+		std::vector<unsigned char const *> messages (size);
+		std::vector<size_t> lengths (size, sizeof (paper::block_hash));
+		std::vector<unsigned char const *> pub_keys (size);
+		std::vector<unsigned char const *> signature_bytes (size);
+		std::vector<int> verifications (size, 0);
+		for (size_t i (0); i < size; ++i)
+		{
+			messages[i] = hashes[i].bytes.data ();
+			pub_keys[i] = accounts[i].bytes.data ();
+			signature_bytes[i] = signatures[i].bytes.data ();
+		}
+		paper::signature_check_set check = { size, messages.data (), lengths.data (), pub_keys.data (), signature_bytes.data (), verifications.data () };
+		checker.verify (check);
+		for (size_t i (0); i < size; ++i)
+		{
+			// Bad signatures are left unknown so the ledger reports them through the normal path
+			if (verifications[i] == 1)
+			{
+				items[i]->verification = paper::signature_verification::valid;
+			}
+		}
+	}
+}
+
+void paper::block_processor::order_dependencies (std::deque<paper::block_processor_item> & items_a)
+{
+	std::vector<paper::block_hash> hashes;
+	hashes.reserve (items_a.size ());
+	std::unordered_map<paper::block_hash, size_t> positions;
+	for (size_t i (0), n (items_a.size ()); i < n; ++i)
+	{
+		hashes.push_back (items_a[i].block->hash ());
+		positions[hashes.back ()] = i;
+	}
+	// Depth first through each block's dependencies with an explicit stack, long chains arrive newest first from bulk_pull
+	std::vector<bool> placed (items_a.size (), false);
+	std::vector<bool> visiting (items_a.size (), false);
+	std::deque<paper::block_processor_item> result;
+	std::vector<size_t> stack;
+	for (size_t i (0), n (items_a.size ()); i < n; ++i)
+	{
+		if (!placed[i])
+		{
+			stack.push_back (i);
+			while (!stack.empty ())
+			{
+				auto current (stack.back ());
+				if (placed[current])
+				{
+					stack.pop_back ();
+				}
+				else
+				{
+					visiting[current] = true;
+					auto pushed (false);
+					auto & block (*items_a[current].block);
+					for (auto dependency : { block.previous (), block.source () })
+					{
+						auto existing (positions.find (dependency));
+						if (!dependency.is_zero () && existing != positions.end () && !placed[existing->second] && !visiting[existing->second])
+						{
+							stack.push_back (existing->second);
+							pushed = true;
+						}
+					}
+					if (!pushed)
+					{
+						placed[current] = true;
+						result.push_back (items_a[current]);
+						stack.pop_back ();
+					}
+				}
+			}
+		}
+	}
+	assert (result.size () == items_a.size ());
+	std::swap (items_a, result);
+}
+
 void paper::block_processor::process_receive_many (std::deque<paper::block_processor_item> & blocks_processing)
+{
+	process_items (blocks_processing, nullptr);
+}
+
+void paper::block_processor::process_items (std::deque<paper::block_processor_item> & blocks_processing, std::deque<paper::block_processor_item> * released_a)
 {
 	while (!blocks_processing.empty ())
 	{
@@ -1175,7 +1972,7 @@ void paper::block_processor::process_receive_many (std::deque<paper::block_proce
 						node.ledger.rollback (transaction, successor->hash ());
 					}
 				}
-				auto process_result (process_receive_one (transaction, item.block));
+				auto process_result (process_receive_one (transaction, item.block, item.verification));
 				switch (process_result.code)
 				{
 					case paper::process_result::progress:
@@ -1188,7 +1985,14 @@ void paper::block_processor::process_receive_many (std::deque<paper::block_proce
 						for (auto i (cached.begin ()), n (cached.end ()); i != n; ++i)
 						{
 							node.store.unchecked_del (transaction, hash, **i);
-							blocks_processing.push_front (paper::block_processor_item (*i));
+							if (released_a != nullptr)
+							{
+								released_a->push_back (paper::block_processor_item (*i));
+							}
+							else
+							{
+								blocks_processing.push_front (paper::block_processor_item (*i));
+							}
 						}
 						std::lock_guard<std::mutex> lock (node.gap_cache.mutex);
 						node.gap_cache.blocks.get<1> ().erase (hash);
@@ -1214,10 +2018,10 @@ void paper::block_processor::process_receive_many (std::deque<paper::block_proce
 	}
 }
 
-paper::process_return paper::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<paper::block> block_a)
+paper::process_return paper::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<paper::block> block_a, paper::signature_verification verification_a)
 {
 	paper::process_return result;
-	result = node.ledger.process (transaction_a, *block_a);
+	result = node.ledger.process (transaction_a, *block_a, verification_a);
 	switch (result.code)
 	{
 		case paper::process_result::progress:
@@ -1350,7 +2154,7 @@ service (service_a),
 config (config_a),
 alarm (alarm_a),
 work (work_a),
-store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs),
+store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs, config_a.unchecked_cache_max, config_a.account_cache_max, config_a.block_cache_max),
 gap_cache (*this),
 ledger (store, config_a.inactive_supply.number ()),
 active (*this),
@@ -1364,7 +2168,10 @@ port_mapping (*this),
 vote_processor (*this),
 warmed_up (0),
 block_processor (*this),
-block_processor_thread ([this]() { this->block_processor.process_blocks (); })
+block_processor_thread ([this]() { this->block_processor.process_blocks (); }),
+block_verifier_thread ([this]() { this->block_processor.verify_blocks (); }),
+callbacks (*this),
+stream (*this)
 {
 	wallets.observer = [this](bool active) {
 		observers.wallet (active);
@@ -1399,89 +2206,15 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 					std::stringstream ostream;
 					boost::property_tree::write_json (ostream, event);
 					ostream.flush ();
-					auto body (std::make_shared<std::string> (ostream.str ()));
-					auto address (node_l->config.callback_address);
-					auto port (node_l->config.callback_port);
-					auto target (std::make_shared<std::string> (node_l->config.callback_target));
-					auto resolver (std::make_shared<boost::asio::ip::tcp::resolver> (node_l->service));
-					resolver->async_resolve (boost::asio::ip::tcp::resolver::query (address, std::to_string (port)), [node_l, address, port, target, body, resolver](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
-						if (!ec)
-						{
-							for (auto i (i_a), n (boost::asio::ip::tcp::resolver::iterator{}); i != n; ++i)
-							{
-								auto sock (std::make_shared<boost::asio::ip::tcp::socket> (node_l->service));
-								sock->async_connect (i->endpoint (), [node_l, target, body, sock, address, port](boost::system::error_code const & ec) {
-									if (!ec)
-									{
-										auto req (std::make_shared<boost::beast::http::request<boost::beast::http::string_body>> ());
-										req->method (boost::beast::http::verb::post);
-										req->target (*target);
-										req->version (11);
-										req->insert (boost::beast::http::field::host, address);
-										req->insert (boost::beast::http::field::content_type, "application/json");
-										req->body () = *body;
-										//req->prepare (*req);
-										//boost::beast::http::prepare(req);
-										req->prepare_payload ();
-										boost::beast::http::async_write (*sock, *req, [node_l, sock, address, port, req](boost::system::error_code const & ec, size_t bytes_transferred) {
-											if (!ec)
-											{
-												auto sb (std::make_shared<boost::beast::flat_buffer> ());
-												auto resp (std::make_shared<boost::beast::http::response<boost::beast::http::string_body>> ());
-												boost::beast::http::async_read (*sock, *sb, *resp, [node_l, sb, resp, sock, address, port](boost::system::error_code const & ec, size_t bytes_transferred) {
-													if (!ec)
-													{
-														if (resp->result () == boost::beast::http::status::ok)
-														{
-														}
-														else
-														{
-															if (node_l->config.logging.callback_logging ())
-															{
-																BOOST_LOG (node_l->log) << boost::str (boost::format ("Callback to %1%:%2% failed with status: %3%") % address % port % resp->result ());
-															}
-														}
-													}
-													else
-													{
-														if (node_l->config.logging.callback_logging ())
-														{
-															BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable complete callback: %1%:%2% %3%") % address % port % ec.message ());
-														}
-													};
-												});
-											}
-											else
-											{
-												if (node_l->config.logging.callback_logging ())
-												{
-													BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to send callback: %1%:%2% %3%") % address % port % ec.message ());
-												}
-											}
-										});
-									}
-									else
-									{
-										if (node_l->config.logging.callback_logging ())
-										{
-											BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to connect to callback address: %1%:%2%, %3%") % address % port % ec.message ());
-										}
-									}
-								});
-							}
-						}
-						else
-						{
-							if (node_l->config.logging.callback_logging ())
-							{
-								BOOST_LOG (node_l->log) << boost::str (boost::format ("Error resolving callback: %1%:%2%, %3%") % address % port % ec.message ());
-							}
-						}
-					});
+					node_l->callbacks.add (ostream.str ());
 				}
 			});
 		}
 	});
+	observers.blocks.add ([this](std::shared_ptr<paper::block> block_a, paper::account const & account_a, paper::amount const &) {
+		// Any new head for a wallet account, including ones created elsewhere, invalidates its cached work
+		this->wallets.work_precompute (account_a);
+	});
 	observers.endpoint.add ([this](paper::endpoint const & endpoint_a) {
 		this->network.send_keepalive (endpoint_a);
 		rep_query (*this, endpoint_a);
@@ -1492,6 +2225,12 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 	observers.vote.add ([this](std::shared_ptr<paper::vote> vote_a, paper::endpoint const &) {
 		this->gap_cache.vote (vote_a);
 	});
+	observers.vote.add ([this](std::shared_ptr<paper::vote> vote_a, paper::endpoint const &) {
+		this->stream.vote (*vote_a);
+	});
+	observers.account_balance.add ([this](paper::account const & account_a, bool pending_a) {
+		this->stream.account_balance (account_a, pending_a);
+	});
 	observers.vote.add ([this](std::shared_ptr<paper::vote> vote_a, paper::endpoint const & endpoint_a) {
 		if (this->rep_crawler.exists (vote_a->block->hash ()))
 		{
@@ -1727,6 +2466,18 @@ std::map<paper::endpoint, unsigned> paper::peer_container::list_version ()
 	return result;
 }
 
+unsigned paper::peer_container::network_version (paper::endpoint const & endpoint_a)
+{
+	unsigned result (0);
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (peers.find (endpoint_a));
+	if (existing != peers.end ())
+	{
+		result = existing->network_version;
+	}
+	return result;
+}
+
 paper::endpoint paper::peer_container::bootstrap_peer ()
 {
 	paper::endpoint result (boost::asio::ip::address_v6::any (), 0);
@@ -1774,7 +2525,7 @@ bool paper::parse_address_port (std::string const & string, boost::asio::ip::add
 			{
 				boost::system::error_code ec;
 				auto address (boost::asio::ip::address_v6::from_string (string.substr (0, port_position), ec));
-				if (ec == 0)
+				if (!ec)
 				{
 					address_a = address;
 					port_a = port;
@@ -1831,8 +2582,13 @@ void paper::node::start ()
 	ongoing_keepalive ();
 	ongoing_bootstrap ();
 	ongoing_store_flush ();
+	ongoing_unchecked_cleanup ();
 	ongoing_rep_crawl ();
 	bootstrap.start ();
+	if (config.stream_port != 0)
+	{
+		stream.start ();
+	}
 	backup_wallet ();
 	active.announce_votes ();
 	port_mapping.start ();
@@ -1848,16 +2604,27 @@ void paper::node::stop ()
 	{
 		block_processor_thread.join ();
 	}
+	if (block_verifier_thread.joinable ())
+	{
+		block_verifier_thread.join ();
+	}
 	active.stop ();
 	network.stop ();
 	bootstrap_initiator.stop ();
 	bootstrap.stop ();
 	port_mapping.stop ();
 	wallets.stop ();
+	callbacks.stop ();
+	stream.stop ();
+	store.vote_flush ();
 	if (block_processor_thread.joinable ())
 	{
 		block_processor_thread.join ();
 	}
+	if (block_verifier_thread.joinable ())
+	{
+		block_verifier_thread.join ();
+	}
 }
 
 void paper::node::keepalive_preconfigured (std::vector<std::string> const & peers_a)
@@ -1975,6 +2742,7 @@ void paper::node::ongoing_store_flush ()
 		paper::transaction transaction (store.environment, nullptr, true);
 		store.flush (transaction);
 	}
+	store.vote_flush ();
 	std::weak_ptr<paper::node> node_w (shared_from_this ());
 	alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [node_w]() {
 		if (auto node_l = node_w.lock ())
@@ -1984,14 +2752,38 @@ void paper::node::ongoing_store_flush ()
 	});
 }
 
+void paper::node::ongoing_unchecked_cleanup ()
+{
+	size_t evicted (0);
+	auto cutoff (paper::seconds_since_epoch () - config.unchecked_cutoff_time.count ());
+	paper::unchecked_key next (0, 0);
+	do
+	{
+		// Each slice gets its own write transaction so blocks are written in between
+		paper::transaction transaction (store.environment, nullptr, true);
+		evicted += store.unchecked_evict (transaction, cutoff, next, unchecked_cleanup_slice);
+	} while (!(next == paper::unchecked_key (0, 0)));
+	if (evicted > 0)
+	{
+		BOOST_LOG (log) << boost::str (boost::format ("Evicted %1% unchecked blocks older than %2% seconds") % evicted % config.unchecked_cutoff_time.count ());
+	}
+	std::weak_ptr<paper::node> node_w (shared_from_this ());
+	alarm.add (std::chrono::steady_clock::now () + unchecked_cleanup_interval, [node_w]() {
+		if (auto node_l = node_w.lock ())
+		{
+			node_l->ongoing_unchecked_cleanup ();
+		}
+	});
+}
+
 void paper::node::backup_wallet ()
 {
 	paper::transaction transaction (store.environment, nullptr, false);
-	for (auto i (wallets.items.begin ()), n (wallets.items.end ()); i != n; ++i)
+	for (auto & i : wallets.items_copy ())
 	{
 		auto backup_path (application_path / "backup");
 		boost::filesystem::create_directories (backup_path);
-		i->second->store.write_backup (transaction, backup_path / (i->first.to_string () + ".json"));
+		i.second->store.write_backup (transaction, backup_path / (i.first.to_string () + ".json"));
 	}
 	auto this_l (shared ());
 	alarm.add (std::chrono::steady_clock::now () + backup_interval, [this_l]() {
@@ -2263,9 +3055,9 @@ public:
 	virtual ~confirmed_visitor () = default;
 	void send_block (paper::send_block const & block_a) override
 	{
-		for (auto i (node.wallets.items.begin ()), n (node.wallets.items.end ()); i != n; ++i)
+		for (auto & i : node.wallets.items_copy ())
 		{
-			auto wallet (i->second);
+			auto wallet (i.second);
 			if (wallet->exists (block_a.hashables.destination))
 			{
 				paper::account representative;
@@ -2308,6 +3100,7 @@ void paper::node::process_confirmed (std::shared_ptr<paper::block> confirmed_a)
 {
 	confirmed_visitor visitor (*this, confirmed_a);
 	confirmed_a->visit (visitor);
+	stream.confirmed_block (*confirmed_a);
 }
 
 void paper::node::process_message (paper::message & message_a, paper::endpoint const & sender_a)
@@ -2672,41 +3465,229 @@ void paper::peer_container::contacted (paper::endpoint const & endpoint_a, unsig
 
 void paper::network::send_buffer (uint8_t const * data_a, size_t size_a, paper::endpoint const & endpoint_a, std::function<void(boost::system::error_code const &, size_t)> callback_a)
 {
-	std::unique_lock<std::mutex> lock (socket_mutex);
 	if (node.config.logging.network_packet_logging ())
 	{
 		BOOST_LOG (node.log) << "Sending packet";
 	}
-	socket.async_send_to (boost::asio::buffer (data_a, size_a), endpoint_a, [this, callback_a](boost::system::error_code const & ec, size_t size_a) {
-		callback_a (ec, size_a);
-		if (this->node.config.logging.network_packet_logging ())
+	paper::outgoing_datagram datagram ({ data_a, size_a, endpoint_a, datagram_type (data_a, size_a), callback_a });
+	auto dropped (false);
+	auto aborted (false);
+	auto flush (false);
+	{
+		std::lock_guard<std::mutex> lock (send_mutex);
+		auto existing (send_pending.find (&datagram));
+		if (!on)
 		{
-			BOOST_LOG (this->node.log) << "Packet send complete";
+			aborted = true;
 		}
-	});
-}
-
-bool paper::peer_container::known_peer (paper::endpoint const & endpoint_a)
-{
-	std::lock_guard<std::mutex> lock (mutex);
-	auto existing (peers.find (endpoint_a));
-	return existing != peers.end ();
+		else if (existing != send_pending.end ())
+		{
+			// This peer already has the same message waiting, both callers are told about the one send
+			auto & queued (const_cast<paper::outgoing_datagram &> (**existing));
+			auto first (queued.callback);
+			queued.callback = [first, callback_a](boost::system::error_code const & ec, size_t size_a) {
+				first (ec, size_a);
+				callback_a (ec, size_a);
+			};
+		}
+		else if (send_queue.size () < send_queue_max)
+		{
+			send_queue.push_back (datagram);
+			send_pending.insert (&send_queue.back ());
+			send_queued.add (datagram.type);
+			flush = !send_flushing;
+			send_flushing = true;
+		}
+		else
+		{
+			dropped = true;
+		}
+	}
+	if (dropped)
+	{
+		send_dropped.add (datagram.type);
+		callback_a (boost::system::error_code (boost::asio::error::no_buffer_space), 0);
+	}
+	if (aborted)
+	{
+		callback_a (boost::system::error_code (boost::asio::error::operation_aborted), 0);
+	}
+	if (flush)
+	{
+		// Flushing from the io thread lets everything queued by the current handler, e.g. a block flooded to every peer, go out together
+		std::weak_ptr<paper::node> node_w (node.shared ());
+		node.service.post ([node_w]() {
+			if (auto node_l = node_w.lock ())
+			{
+				node_l->network.send_flush ();
+			}
+		});
+	}
 }
 
-std::shared_ptr<paper::node> paper::node::shared ()
+void paper::network::send_flush ()
 {
-	return shared_from_this ();
+	std::vector<paper::outgoing_datagram> datagrams;
+	datagrams.reserve (burst_max);
+	{
+		std::lock_guard<std::mutex> lock (send_mutex);
+		while (!send_queue.empty () && datagrams.size () < burst_max)
+		{
+			send_pending.erase (&send_queue.front ());
+			datagrams.push_back (std::move (send_queue.front ()));
+			send_queue.pop_front ();
+		}
+	}
+	auto sent (send_datagrams (datagrams));
+	for (size_t i (0); i < sent; ++i)
+	{
+		send_queued.subtract (datagrams[i].type);
+	}
+	std::weak_ptr<paper::node> node_w (node.shared ());
+	auto aborted (datagrams.size ());
+	{
+		std::lock_guard<std::mutex> lock (send_mutex);
+		if (!on)
+		{
+			// Stopped while this batch was being written, stop () has already drained and aborted the queue, the rest of the batch is aborted here
+			send_flushing = false;
+			aborted = sent;
+		}
+		else if (sent < datagrams.size ())
+		{
+			// The socket buffer is full, put back what's left and continue once it can be written
+			for (auto i (datagrams.rbegin ()), n (datagrams.rend () - sent); i != n; ++i)
+			{
+				send_queue.push_front (std::move (*i));
+				send_pending.insert (&send_queue.front ());
+			}
+			std::lock_guard<std::mutex> socket_lock (socket_mutex);
+			socket.async_wait (boost::asio::ip::udp::socket::wait_write, [node_w](boost::system::error_code const & ec) {
+				if (auto node_l = node_w.lock ())
+				{
+					node_l->network.send_flush ();
+				}
+			});
+		}
+		else if (!send_queue.empty ())
+		{
+			node.service.post ([node_w]() {
+				if (auto node_l = node_w.lock ())
+				{
+					node_l->network.send_flush ();
+				}
+			});
+		}
+		else
+		{
+			send_flushing = false;
+		}
+	}
+	for (auto i (aborted), n (datagrams.size ()); i < n; ++i)
+	{
+		send_queued.subtract (datagrams[i].type);
+		datagrams[i].callback (boost::system::error_code (boost::asio::error::operation_aborted), 0);
+	}
 }
 
-paper::election::election (MDB_txn * transaction_a, paper::node & node_a, std::shared_ptr<paper::block> block_a, std::function<void(std::shared_ptr<paper::block>, bool)> const & confirmation_action_a) :
-confirmation_action (confirmation_action_a),
-votes (block_a),
-node (node_a),
-last_vote (std::chrono::steady_clock::now ()),
-last_winner (block_a)
+// Writes datagrams to the socket in order and calls their callbacks, returns how many were handled before the socket would block
+size_t paper::network::send_datagrams (std::vector<paper::outgoing_datagram> & datagrams_a)
 {
-	assert (node_a.store.block_exists (transaction_a, block_a->hash ()));
+	std::vector<std::pair<boost::system::error_code, size_t>> results;
+	results.reserve (datagrams_a.size ());
+	{
+		std::lock_guard<std::mutex> lock (socket_mutex);
+#ifdef __linux__
+		std::array<mmsghdr, burst_max> headers;
+		std::array<iovec, burst_max> vectors;
+		for (size_t i (0), n (datagrams_a.size ()); i < n; ++i)
+		{
+			auto & datagram (datagrams_a[i]);
+			vectors[i].iov_base = const_cast<uint8_t *> (datagram.data);
+			vectors[i].iov_len = datagram.size;
+			std::memset (&headers[i], 0, sizeof (headers[i]));
+			headers[i].msg_hdr.msg_name = datagram.endpoint.data ();
+			headers[i].msg_hdr.msg_namelen = datagram.endpoint.size ();
+			headers[i].msg_hdr.msg_iov = &vectors[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
+		auto done (false);
+		while (!done && results.size () < datagrams_a.size ())
+		{
+			auto offset (results.size ());
+			auto count (sendmmsg (socket.native_handle (), headers.data () + offset, datagrams_a.size () - offset, MSG_DONTWAIT));
+			if (count > 0)
+			{
+				for (auto i (0); i < count; ++i)
+				{
+					results.push_back (std::make_pair (boost::system::error_code (), headers[offset + i].msg_len));
+				}
+			}
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				done = true;
+			}
+			else
+			{
+				// The first datagram in the call failed, report it and carry on with the rest
+				results.push_back (std::make_pair (boost::system::error_code (errno, boost::system::system_category ()), 0));
+			}
+		}
+#else
+		for (auto & i : datagrams_a)
+		{
+			boost::system::error_code ec;
+			auto size (socket.send_to (boost::asio::buffer (i.data, i.size), i.endpoint, 0, ec));
+			results.push_back (std::make_pair (ec, size));
+		}
+#endif
+	}
+	for (size_t i (0), n (results.size ()); i < n; ++i)
+	{
+		auto & datagram (datagrams_a[i]);
+		if (!results[i].first)
+		{
+			send_bytes.add (datagram.type, results[i].second);
+		}
+		datagram.callback (results[i].first, results[i].second);
+		if (node.config.logging.network_packet_logging ())
+		{
+			BOOST_LOG (node.log) << "Packet send complete";
+		}
+	}
+	return results.size ();
+}
+
+bool paper::peer_container::known_peer (paper::endpoint const & endpoint_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (peers.find (endpoint_a));
+	return existing != peers.end ();
+}
+
+std::shared_ptr<paper::node> paper::node::shared ()
+{
+	return shared_from_this ();
+}
+
+paper::election::election (MDB_txn * transaction_a, paper::node & node_a, std::shared_ptr<paper::block> block_a, std::function<void(std::shared_ptr<paper::block>, bool)> const & confirmation_action_a) :
+confirmation_action (confirmation_action_a),
+votes (block_a),
+node (node_a),
+last_vote (std::chrono::steady_clock::now ()),
+last_winner (block_a)
+{
+	assert (node_a.store.block_exists (transaction_a, block_a->hash ()));
 	confirmed.clear ();
+	for (auto & i : votes.rep_votes)
+	{
+		auto weight (node.ledger.weight (transaction_a, i.first));
+		rep_weights[i.first] = weight;
+		auto & total (totals[i.second->hash ()]);
+		total.block = i.second;
+		total.weight += weight;
+		++total.reps;
+	}
 	compute_rep_votes (transaction_a);
 }
 
@@ -2714,18 +3695,75 @@ void paper::election::compute_rep_votes (MDB_txn * transaction_a)
 {
 	node.wallets.foreach_representative (transaction_a, [this, transaction_a](paper::public_key const & pub_a, paper::raw_key const & prv_a) {
 		auto vote (this->node.store.vote_generate (transaction_a, pub_a, prv_a, last_winner));
-		this->votes.vote (vote);
+		this->apply_vote (transaction_a, vote);
 	});
 }
 
+paper::tally_result paper::election::apply_vote (MDB_txn * transaction_a, std::shared_ptr<paper::vote> vote_a)
+{
+	std::shared_ptr<paper::block> previous;
+	auto existing (votes.rep_votes.find (vote_a->account));
+	if (existing != votes.rep_votes.end ())
+	{
+		previous = existing->second;
+	}
+	auto result (votes.vote (vote_a));
+	switch (result)
+	{
+		case paper::tally_result::vote:
+		{
+			auto weight (node.ledger.weight (transaction_a, vote_a->account));
+			rep_weights[vote_a->account] = weight;
+			auto & total (totals[vote_a->block->hash ()]);
+			total.block = vote_a->block;
+			total.weight += weight;
+			++total.reps;
+			break;
+		}
+		case paper::tally_result::changed:
+		{
+			auto weight (rep_weights[vote_a->account]);
+			auto old_total (totals.find (previous->hash ()));
+			assert (old_total != totals.end ());
+			assert (old_total->second.weight >= weight && old_total->second.reps > 0);
+			old_total->second.weight -= weight;
+			if (--old_total->second.reps == 0)
+			{
+				totals.erase (old_total);
+			}
+			auto & total (totals[vote_a->block->hash ()]);
+			total.block = vote_a->block;
+			total.weight += weight;
+			++total.reps;
+			break;
+		}
+		case paper::tally_result::confirm:
+			break;
+	}
+	return result;
+}
+
+std::map<paper::uint128_t, std::shared_ptr<paper::block>, std::greater<paper::uint128_t>> paper::election::tally ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	std::map<paper::uint128_t, std::shared_ptr<paper::block>, std::greater<paper::uint128_t>> result;
+	for (auto & i : totals)
+	{
+		result.insert (std::make_pair (i.second.weight, i.second.block));
+	}
+	return result;
+}
+
 void paper::election::broadcast_winner ()
 {
+	paper::transaction transaction (node.store.environment, nullptr, false);
+	std::shared_ptr<paper::block> winner_l;
 	{
-		paper::transaction transaction (node.store.environment, nullptr, true);
+		std::lock_guard<std::mutex> lock (mutex);
 		compute_rep_votes (transaction);
+		winner_l = last_winner;
 	}
-	paper::transaction transaction_a (node.store.environment, nullptr, false);
-	node.network.republish_block (transaction_a, last_winner);
+	node.network.republish_block (transaction, winner_l);
 }
 
 paper::uint128_t paper::election::quorum_threshold (MDB_txn * transaction_a, paper::ledger & ledger_a)
@@ -2776,9 +3814,13 @@ void paper::election::confirm_once (MDB_txn * transaction_a)
 
 bool paper::election::have_quorum (MDB_txn * transaction_a)
 {
-	auto tally_l (node.ledger.tally (transaction_a, votes));
-	assert (tally_l.size () > 0);
-	auto result (tally_l.begin ()->first > quorum_threshold (transaction_a, node.ledger));
+	assert (!totals.empty ());
+	paper::uint128_t leading (0);
+	for (auto & i : totals)
+	{
+		leading = std::max (leading, i.second.weight);
+	}
+	auto result (leading > quorum_threshold (transaction_a, node.ledger));
 	return result;
 }
 
@@ -2793,6 +3835,7 @@ void paper::election::confirm_if_quorum (MDB_txn * transaction_a)
 
 void paper::election::confirm_cutoff (MDB_txn * transaction_a)
 {
+	std::lock_guard<std::mutex> lock (mutex);
 	if (node.config.logging.vote_logging ())
 	{
 		BOOST_LOG (node.log) << boost::str (boost::format ("Vote tally weight %2% for root %1%") % votes.id.to_string () % last_winner->root ().to_string ());
@@ -2806,21 +3849,24 @@ void paper::election::confirm_cutoff (MDB_txn * transaction_a)
 
 void paper::election::vote (std::shared_ptr<paper::vote> vote_a)
 {
+	paper::transaction transaction (node.store.environment, nullptr, false);
+	std::lock_guard<std::mutex> lock (mutex);
 	node.network.republish_vote (last_vote, vote_a);
 	last_vote = std::chrono::steady_clock::now ();
-	paper::transaction transaction (node.store.environment, nullptr, true);
 	assert (node.store.vote_validate (transaction, vote_a).code != paper::vote_code::invalid);
-	votes.vote (vote_a);
+	apply_vote (transaction, vote_a);
 	confirm_if_quorum (transaction);
 }
 
 void paper::active_transactions::announce_votes ()
 {
-	std::vector<paper::block_hash> inactive;
-	paper::transaction transaction (node.store.environment, nullptr, true);
-	std::lock_guard<std::mutex> lock (mutex);
-
+	// Elections are confirmed under their own mutex, the sweep only reads the ledger
+	paper::transaction transaction (node.store.environment, nullptr, false);
+	for (auto & shard_l : shards)
 	{
+		std::vector<paper::block_hash> inactive;
+		std::lock_guard<std::mutex> lock (shard_l.mutex);
+		auto & roots (shard_l.roots);
 		size_t announcements (0);
 		auto i (roots.begin ());
 		auto n (roots.end ());
@@ -2838,12 +3884,17 @@ void paper::active_transactions::announce_votes ()
 			}
 			else
 			{
-				unsigned announcements;
-				roots.modify (i, [&announcements](paper::conflict_info & info_a) {
-					announcements = ++info_a.announcements;
+				unsigned announcements_l;
+				roots.modify (i, [&announcements_l](paper::conflict_info & info_a) {
+					announcements_l = ++info_a.announcements;
 				});
+				size_t rep_votes_l;
+				{
+					std::lock_guard<std::mutex> lock (i->election->mutex);
+					rep_votes_l = i->election->votes.rep_votes.size ();
+				}
 				// If more than one full announcement interval has passed and no one has voted on this block, we need to synchronize
-				if (announcements > 1 && i->election->votes.rep_votes.size () <= 1)
+				if (announcements_l > 1 && rep_votes_l <= 1)
 				{
 					node.bootstrap_initiator.bootstrap ();
 				}
@@ -2859,11 +3910,11 @@ void paper::active_transactions::announce_votes ()
 				info_a.announcements = 0;
 			});
 		}
-	}
-	for (auto i (inactive.begin ()), n (inactive.end ()); i != n; ++i)
-	{
-		assert (roots.find (*i) != roots.end ());
-		roots.erase (*i);
+		for (auto i (inactive.begin ()), n (inactive.end ()); i != n; ++i)
+		{
+			assert (roots.find (*i) != roots.end ());
+			roots.erase (*i);
+		}
 	}
 	auto now (std::chrono::steady_clock::now ());
 	auto node_l (node.shared ());
@@ -2872,46 +3923,89 @@ void paper::active_transactions::announce_votes ()
 
 void paper::active_transactions::stop ()
 {
-	std::lock_guard<std::mutex> lock (mutex);
-	roots.clear ();
+	for (auto & i : shards)
+	{
+		std::lock_guard<std::mutex> lock (i.mutex);
+		i.roots.clear ();
+	}
 }
 
 bool paper::active_transactions::start (MDB_txn * transaction_a, std::shared_ptr<paper::block> block_a, std::function<void(std::shared_ptr<paper::block>, bool)> const & confirmation_action_a)
 {
-	std::lock_guard<std::mutex> lock (mutex);
 	auto root (block_a->root ());
-	auto existing (roots.find (root));
-	if (existing == roots.end ())
+	auto & shard_l (shard (root));
+	std::lock_guard<std::mutex> lock (shard_l.mutex);
+	auto existing (shard_l.roots.find (root));
+	if (existing == shard_l.roots.end ())
 	{
 		auto election (std::make_shared<paper::election> (transaction_a, node, block_a, confirmation_action_a));
-		roots.insert (paper::conflict_info{ root, election, 0 });
+		shard_l.roots.insert (paper::conflict_info{ root, election, 0 });
 	}
-	return existing != roots.end ();
+	return existing != shard_l.roots.end ();
 }
 
 // Validate a vote and apply it to the current election if one exists
 void paper::active_transactions::vote (std::shared_ptr<paper::vote> vote_a)
 {
-	std::shared_ptr<paper::election> election;
+	auto election_l (election (vote_a->block->root ()));
+	if (election_l)
 	{
-		std::lock_guard<std::mutex> lock (mutex);
-		auto root (vote_a->block->root ());
-		auto existing (roots.find (root));
-		if (existing != roots.end ())
+		election_l->vote (vote_a);
+	}
+}
+
+bool paper::active_transactions::active (paper::block const & block_a)
+{
+	return election (block_a.root ()) != nullptr;
+}
+
+std::shared_ptr<paper::election> paper::active_transactions::election (paper::block_hash const & root_a)
+{
+	std::shared_ptr<paper::election> result;
+	auto & shard_l (shard (root_a));
+	std::lock_guard<std::mutex> lock (shard_l.mutex);
+	auto existing (shard_l.roots.find (root_a));
+	if (existing != shard_l.roots.end ())
+	{
+		result = existing->election;
+	}
+	return result;
+}
+
+std::vector<std::shared_ptr<paper::election>> paper::active_transactions::elections ()
+{
+	std::vector<std::shared_ptr<paper::election>> result;
+	for (auto & i : shards)
+	{
+		std::lock_guard<std::mutex> lock (i.mutex);
+		for (auto & j : i.roots)
 		{
-			election = existing->election;
+			result.push_back (j.election);
 		}
 	}
-	if (election)
+	return result;
+}
+
+size_t paper::active_transactions::size ()
+{
+	size_t result (0);
+	for (auto & i : shards)
 	{
-		election->vote (vote_a);
+		std::lock_guard<std::mutex> lock (i.mutex);
+		result += i.roots.size ();
 	}
+	return result;
 }
 
-bool paper::active_transactions::active (paper::block const & block_a)
+bool paper::active_transactions::empty ()
 {
-	std::lock_guard<std::mutex> lock (mutex);
-	return roots.find (block_a.root ()) != roots.end ();
+	return size () == 0;
+}
+
+paper::active_shard & paper::active_transactions::shard (paper::block_hash const & root_a)
+{
+	static_assert (256 % shard_count == 0, "Shards must evenly divide the first byte of the root");
+	return shards[root_a.bytes[0] / (256 / shard_count)];
 }
 
 paper::active_transactions::active_transactions (paper::node & node_a) :
@@ -2925,6 +4019,315 @@ int paper::node::store_version ()
 	return store.version_get (transaction);
 }
 
+paper::callback_connection::callback_connection (paper::callback_dispatcher & dispatcher_a) :
+dispatcher (dispatcher_a),
+socket (dispatcher_a.node.service),
+connected (false)
+{
+}
+
+void paper::callback_connection::send (std::vector<paper::callback_event> batch_a, std::vector<boost::asio::ip::tcp::endpoint> const & endpoints_a)
+{
+	batch = std::move (batch_a);
+	auto & config (dispatcher.node.config);
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	request.method (boost::beast::http::verb::post);
+	request.target (config.callback_target);
+	request.version (11);
+	request.keep_alive (true);
+	request.insert (boost::beast::http::field::host, config.callback_address);
+	request.insert (boost::beast::http::field::content_type, "application/json");
+	if (config.callback_batch == 1)
+	{
+		assert (batch.size () == 1);
+		request.body () = batch.front ().body;
+	}
+	else
+	{
+		std::string body ("[");
+		for (auto i (batch.begin ()), n (batch.end ()); i != n; ++i)
+		{
+			if (i != batch.begin ())
+			{
+				body += ",";
+			}
+			body += i->body;
+		}
+		body += "]";
+		request.body () = std::move (body);
+	}
+	request.prepare_payload ();
+	if (connected)
+	{
+		write ();
+	}
+	else
+	{
+		// Copied as the dispatcher may discard its endpoints while this connection attempt is in progress
+		endpoints = endpoints_a;
+		auto this_l (shared_from_this ());
+		auto node_l (dispatcher.node.shared ());
+		boost::asio::async_connect (socket, endpoints.begin (), endpoints.end (), [this_l, node_l](boost::system::error_code const & ec, std::vector<boost::asio::ip::tcp::endpoint>::const_iterator) {
+			if (!ec)
+			{
+				this_l->connected = true;
+				this_l->write ();
+			}
+			else
+			{
+				if (node_l->config.logging.callback_logging ())
+				{
+					BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to connect to callback address: %1%:%2%, %3%") % node_l->config.callback_address % node_l->config.callback_port % ec.message ());
+				}
+				this_l->close ();
+				node_l->callbacks.completed (this_l, false, true);
+			}
+		});
+	}
+}
+
+void paper::callback_connection::write ()
+{
+	auto this_l (shared_from_this ());
+	auto node_l (dispatcher.node.shared ());
+	boost::beast::http::async_write (socket, request, [this_l, node_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec)
+		{
+			this_l->response = boost::beast::http::response<boost::beast::http::string_body> ();
+			boost::beast::http::async_read (this_l->socket, this_l->buffer, this_l->response, [this_l, node_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+				if (!ec)
+				{
+					auto success (this_l->response.result () == boost::beast::http::status::ok);
+					if (!success && node_l->config.logging.callback_logging ())
+					{
+						BOOST_LOG (node_l->log) << boost::str (boost::format ("Callback to %1%:%2% failed with status: %3%") % node_l->config.callback_address % node_l->config.callback_port % this_l->response.result ());
+					}
+					if (!this_l->response.keep_alive ())
+					{
+						this_l->close ();
+					}
+					node_l->callbacks.completed (this_l, success, false);
+				}
+				else
+				{
+					if (node_l->config.logging.callback_logging ())
+					{
+						BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable complete callback: %1%:%2% %3%") % node_l->config.callback_address % node_l->config.callback_port % ec.message ());
+					}
+					this_l->close ();
+					node_l->callbacks.completed (this_l, false, false);
+				}
+			});
+		}
+		else
+		{
+			if (node_l->config.logging.callback_logging ())
+			{
+				BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to send callback: %1%:%2% %3%") % node_l->config.callback_address % node_l->config.callback_port % ec.message ());
+			}
+			this_l->close ();
+			node_l->callbacks.completed (this_l, false, false);
+		}
+	});
+}
+
+void paper::callback_connection::close ()
+{
+	boost::system::error_code ignored;
+	socket.close (ignored);
+	buffer.consume (buffer.size ());
+	connected = false;
+}
+
+paper::callback_dispatcher::callback_dispatcher (paper::node & node_a) :
+node (node_a),
+resolving (false),
+stopped (false),
+delivered (0),
+failed (0),
+dropped (0)
+{
+}
+
+void paper::callback_dispatcher::add (std::string const & body_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		if (queue.size () < node.config.callback_queue_max)
+		{
+			queue.push_back (paper::callback_event{ body_a, 0 });
+			dispatch (lock);
+		}
+		else
+		{
+			++dropped;
+		}
+	}
+}
+
+void paper::callback_dispatcher::dispatch (std::unique_lock<std::mutex> & lock_a)
+{
+	assert (lock_a.owns_lock ());
+	if (!stopped && !queue.empty ())
+	{
+		if (endpoints.empty ())
+		{
+			if (!resolving)
+			{
+				resolving = true;
+				resolve ();
+			}
+		}
+		else
+		{
+			auto done (false);
+			while (!done && !queue.empty ())
+			{
+				std::shared_ptr<paper::callback_connection> connection;
+				if (!idle.empty ())
+				{
+					connection = idle.back ();
+					idle.pop_back ();
+				}
+				else if (connections.size () < node.config.callback_connections)
+				{
+					connection = std::make_shared<paper::callback_connection> (*this);
+					connections.insert (connection);
+				}
+				if (connection != nullptr)
+				{
+					std::vector<paper::callback_event> batch;
+					while (!queue.empty () && batch.size () < node.config.callback_batch)
+					{
+						batch.push_back (std::move (queue.front ()));
+						queue.pop_front ();
+					}
+					connection->send (std::move (batch), endpoints);
+				}
+				else
+				{
+					done = true;
+				}
+			}
+		}
+	}
+}
+
+void paper::callback_dispatcher::resolve ()
+{
+	auto node_l (node.shared ());
+	auto resolver (std::make_shared<boost::asio::ip::tcp::resolver> (node.service));
+	resolver->async_resolve (boost::asio::ip::tcp::resolver::query (node.config.callback_address, std::to_string (node.config.callback_port)), [node_l, resolver](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
+		auto & callbacks (node_l->callbacks);
+		std::unique_lock<std::mutex> lock (callbacks.mutex);
+		if (!ec)
+		{
+			callbacks.resolving = false;
+			callbacks.endpoints.assign (i_a, boost::asio::ip::tcp::resolver::iterator{});
+			callbacks.dispatch (lock);
+		}
+		else
+		{
+			if (node_l->config.logging.callback_logging ())
+			{
+				BOOST_LOG (node_l->log) << boost::str (boost::format ("Error resolving callback: %1%:%2%, %3%") % node_l->config.callback_address % node_l->config.callback_port % ec.message ());
+			}
+			std::weak_ptr<paper::node> node_w (node_l);
+			node_l->alarm.add (std::chrono::steady_clock::now () + retry_delay, [node_w]() {
+				if (auto node_l = node_w.lock ())
+				{
+					auto & callbacks (node_l->callbacks);
+					std::unique_lock<std::mutex> lock (callbacks.mutex);
+					callbacks.resolving = false;
+					callbacks.dispatch (lock);
+				}
+			});
+		}
+	});
+}
+
+void paper::callback_dispatcher::completed (std::shared_ptr<paper::callback_connection> connection_a, bool success_a, bool resolve_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (success_a)
+	{
+		delivered += connection_a->batch.size ();
+	}
+	else
+	{
+		// Retried events go back to the front so they're still delivered roughly in order
+		for (auto i (connection_a->batch.rbegin ()), n (connection_a->batch.rend ()); i != n; ++i)
+		{
+			if (++i->attempts <= node.config.callback_retries && !stopped)
+			{
+				queue.push_front (std::move (*i));
+			}
+			else
+			{
+				++failed;
+			}
+		}
+		if (resolve_a)
+		{
+			endpoints.clear ();
+		}
+	}
+	connection_a->batch.clear ();
+	if (stopped)
+	{
+		connection_a->close ();
+		connections.erase (connection_a);
+	}
+	else if (success_a)
+	{
+		idle.push_back (connection_a);
+		dispatch (lock);
+	}
+	else
+	{
+		// Give the destination a moment before this connection is used again
+		std::weak_ptr<paper::node> node_w (node.shared ());
+		node.alarm.add (std::chrono::steady_clock::now () + retry_delay, [node_w, connection_a]() {
+			if (auto node_l = node_w.lock ())
+			{
+				auto & callbacks (node_l->callbacks);
+				std::unique_lock<std::mutex> lock (callbacks.mutex);
+				if (!callbacks.stopped)
+				{
+					callbacks.idle.push_back (connection_a);
+					callbacks.dispatch (lock);
+				}
+			}
+		});
+	}
+}
+
+void paper::callback_dispatcher::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	queue.clear ();
+	for (auto & i : idle)
+	{
+		i->close ();
+		connections.erase (i);
+	}
+	idle.clear ();
+}
+
+size_t paper::callback_dispatcher::queue_size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return queue.size ();
+}
+
+size_t paper::callback_dispatcher::connection_count ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return connections.size ();
+}
+
 paper::thread_runner::thread_runner (boost::asio::io_service & service_a, unsigned service_threads_a)
 {
 	for (auto i (0); i < service_threads_a; ++i)
@@ -2967,6 +4370,8 @@ void paper::add_node_options (boost::program_options::options_description & desc
 		("account_key", "Get the public key for <account>")
 		("vacuum", "Compact database. If data_path is missing, the database in data directory is compacted.")
 		("snapshot", "Compact database and create snapshot, functions similar to vacuum but does not replace the existing database")
+		("ledger_export", "Export the ledger to <file> in a checksummed format for ledger_import")
+		("ledger_import", "Load a ledger exported to <file> in to a data directory that has no database yet")
 		("data_path", boost::program_options::value<std::string> (), "Use the supplied path as the data directory")
 		("diagnostics", "Run internal diagnostics")
 		("key_create", "Generates a adhoc random keypair and prints it to stdout")
@@ -3137,6 +4542,96 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 			std::cerr << "Snapshot Failed" << std::endl;
 		}
 	}
+	else if (vm.count ("ledger_export"))
+	{
+		if (vm.count ("file") == 1)
+		{
+			auto export_path (vm["file"].as<std::string> ());
+			std::ofstream stream (export_path, std::ios::binary);
+			if (stream)
+			{
+				std::cout << "Exporting ledger to " << export_path << std::endl;
+				inactive_node node (data_path);
+				paper::transaction transaction (node.node->store.environment, nullptr, false);
+				node.node->store.ledger_export (transaction, stream);
+				stream.flush ();
+				if (stream)
+				{
+					std::cout << "Export completed" << std::endl;
+				}
+				else
+				{
+					std::cerr << "Error writing " << export_path << std::endl;
+					result = true;
+				}
+			}
+			else
+			{
+				std::cerr << "Unable to open " << export_path << std::endl;
+				result = true;
+			}
+		}
+		else
+		{
+			std::cerr << "ledger_export command requires one <file> option\n";
+			result = true;
+		}
+	}
+	else if (vm.count ("ledger_import"))
+	{
+		if (vm.count ("file") == 1)
+		{
+			auto import_path (vm["file"].as<std::string> ());
+			auto source_path (data_path / "data.ldb");
+			auto staging_path (data_path / "import.ldb");
+			std::ifstream stream (import_path, std::ios::binary);
+			if (!stream)
+			{
+				std::cerr << "Unable to open " << import_path << std::endl;
+				result = true;
+			}
+			else if (boost::filesystem::exists (source_path))
+			{
+				std::cerr << "Database " << source_path << " already exists, ledger_import needs an empty data directory" << std::endl;
+				result = true;
+			}
+			else
+			{
+				std::cout << "Importing ledger from " << import_path << std::endl;
+				boost::filesystem::create_directories (data_path);
+				boost::filesystem::remove (staging_path);
+				boost::filesystem::remove (data_path / "import.ldb-votes");
+				auto error (false);
+				{
+					// Load in to a staging file so a bad export never leaves a partial database behind
+					paper::block_store store (error, staging_path);
+					if (!error)
+					{
+						error = store.ledger_import (stream);
+					}
+				}
+				// The staging store's vote log is empty, the node starts its own next to data.ldb
+				boost::filesystem::remove (data_path / "import.ldb-votes");
+				boost::filesystem::remove (data_path / "import.ldb-lock");
+				if (!error)
+				{
+					boost::filesystem::rename (staging_path, source_path);
+					std::cout << "Import completed" << std::endl;
+				}
+				else
+				{
+					boost::filesystem::remove (staging_path);
+					std::cerr << "Ledger import failed, the file is corrupt or from a different database version" << std::endl;
+					result = true;
+				}
+			}
+		}
+		else
+		{
+			std::cerr << "ledger_import command requires one <file> option\n";
+			result = true;
+		}
+	}
 	else if (vm.count ("diagnostics"))
 	{
 		inactive_node node (data_path);
@@ -3319,20 +4814,20 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 			if (!wallet_id.decode_hex (vm["wallet"].as<std::string> ()))
 			{
 				inactive_node node (data_path);
-				auto existing (node.node->wallets.items.find (wallet_id));
-				if (existing != node.node->wallets.items.end ())
+				auto existing (node.node->wallets.open (wallet_id));
+				if (existing != nullptr)
 				{
-					if (!existing->second->enter_password (password))
+					if (!existing->enter_password (password))
 					{
-						paper::transaction transaction (existing->second->store.environment, nullptr, false);
+						paper::transaction transaction (existing->store.environment, nullptr, false);
 						paper::raw_key seed;
-						existing->second->store.seed (seed, transaction);
+						existing->store.seed (seed, transaction);
 						std::cout << boost::str (boost::format ("Seed: %1%\n") % seed.data.to_string ());
-						for (auto i (existing->second->store.begin (transaction)), m (existing->second->store.end ()); i != m; ++i)
+						for (auto i (existing->store.begin (transaction)), m (existing->store.end ()); i != m; ++i)
 						{
 							paper::account account (i->first.uint256 ());
 							paper::raw_key key;
-							auto error (existing->second->store.fetch (transaction, account, key));
+							auto error (existing->store.fetch (transaction, account, key));
 							assert (!error);
 							std::cout << boost::str (boost::format ("Pub: %1% Prv: %2%\n") % account.to_account () % key.data.to_string ());
 						}
@@ -3369,7 +4864,7 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 			if (!wallet_id.decode_hex (vm["wallet"].as<std::string> ()))
 			{
 				inactive_node node (data_path);
-				if (node.node->wallets.items.find (wallet_id) != node.node->wallets.items.end ())
+				if (node.node->wallets.open (wallet_id) != nullptr)
 				{
 					node.node->wallets.destroy (wallet_id);
 				}
@@ -3413,10 +4908,10 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 					if (!wallet_id.decode_hex (vm["wallet"].as<std::string> ()))
 					{
 						inactive_node node (data_path);
-						auto existing (node.node->wallets.items.find (wallet_id));
-						if (existing != node.node->wallets.items.end ())
+						auto existing (node.node->wallets.open (wallet_id));
+						if (existing != nullptr)
 						{
-							if (!existing->second->import (contents.str (), password))
+							if (!existing->import (contents.str (), password))
 							{
 								result = false;
 							}
@@ -3459,11 +4954,11 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 	else if (vm.count ("wallet_list"))
 	{
 		inactive_node node (data_path);
-		for (auto i (node.node->wallets.items.begin ()), n (node.node->wallets.items.end ()); i != n; ++i)
+		for (auto & i : node.node->wallets.items_copy ())
 		{
-			std::cout << boost::str (boost::format ("Wallet ID: %1%\n") % i->first.to_string ());
-			paper::transaction transaction (i->second->store.environment, nullptr, false);
-			for (auto j (i->second->store.begin (transaction)), m (i->second->store.end ()); j != m; ++j)
+			std::cout << boost::str (boost::format ("Wallet ID: %1%\n") % i.first.to_string ());
+			paper::transaction transaction (i.second->store.environment, nullptr, false);
+			for (auto j (i.second->store.begin (transaction)), m (i.second->store.end ()); j != m; ++j)
 			{
 				std::cout << paper::uint256_union (j->first.uint256 ()).to_account () << '\n';
 			}
@@ -3477,17 +4972,17 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 			paper::uint256_union wallet_id;
 			if (!wallet_id.decode_hex (vm["wallet"].as<std::string> ()))
 			{
-				auto wallet (node.node->wallets.items.find (wallet_id));
-				if (wallet != node.node->wallets.items.end ())
+				auto wallet (node.node->wallets.open (wallet_id));
+				if (wallet != nullptr)
 				{
 					paper::account account_id;
 					if (!account_id.decode_account (vm["account"].as<std::string> ()))
 					{
-						paper::transaction transaction (wallet->second->store.environment, nullptr, true);
-						auto account (wallet->second->store.find (transaction, account_id));
-						if (account != wallet->second->store.end ())
+						paper::transaction transaction (wallet->store.environment, nullptr, true);
+						auto account (wallet->store.find (transaction, account_id));
+						if (account != wallet->store.end ())
 						{
-							wallet->second->store.erase (transaction, account_id);
+							wallet->store.erase (transaction, account_id);
 						}
 						else
 						{
@@ -3527,11 +5022,11 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 			if (!wallet_id.decode_hex (vm["wallet"].as<std::string> ()))
 			{
 				inactive_node node (data_path);
-				auto wallet (node.node->wallets.items.find (wallet_id));
-				if (wallet != node.node->wallets.items.end ())
+				auto wallet (node.node->wallets.open (wallet_id));
+				if (wallet != nullptr)
 				{
-					paper::transaction transaction (wallet->second->store.environment, nullptr, false);
-					auto representative (wallet->second->store.representative (transaction));
+					paper::transaction transaction (wallet->store.environment, nullptr, false);
+					auto representative (wallet->store.representative (transaction));
 					std::cout << boost::str (boost::format ("Representative: %1%\n") % representative.to_account ());
 				}
 				else
@@ -3565,11 +5060,11 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 					if (!account.decode_account (vm["account"].as<std::string> ()))
 					{
 						inactive_node node (data_path);
-						auto wallet (node.node->wallets.items.find (wallet_id));
-						if (wallet != node.node->wallets.items.end ())
+						auto wallet (node.node->wallets.open (wallet_id));
+						if (wallet != nullptr)
 						{
-							paper::transaction transaction (wallet->second->store.environment, nullptr, true);
-							wallet->second->store.representative_set (transaction, account);
+							paper::transaction transaction (wallet->store.environment, nullptr, true);
+							wallet->store.representative_set (transaction, account);
 						}
 						else
 						{
@@ -3604,14 +5099,10 @@ bool paper::handle_node_options (boost::program_options::variables_map & vm)
 	else if (vm.count ("vote_dump") == 1)
 	{
 		inactive_node node (data_path);
-		paper::transaction transaction (node.node->store.environment, nullptr, false);
-		for (auto i (node.node->store.vote_begin (transaction)), n (node.node->store.vote_end ()); i != n; ++i)
-		{
-			bool error (false);
-			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto vote (std::make_shared<paper::vote> (error, stream));
-			assert (!error);
-			std::cerr << boost::str (boost::format ("%1%\n") % vote->to_json ());
+		std::lock_guard<std::mutex> lock (node.node->store.cache_mutex);
+		for (auto & i : node.node->store.vote_cache)
+		{
+			std::cerr << boost::str (boost::format ("%1%\n") % i.second->to_json ());
 		}
 	}
 	else
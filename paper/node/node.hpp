@@ -3,16 +3,20 @@
 #include <paper/ledger.hpp>
 #include <paper/lib/work.hpp>
 #include <paper/node/bootstrap.hpp>
+#include <paper/node/stream.hpp>
 #include <paper/node/wallet.hpp>
 
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <unordered_set>
 
 #include <boost/asio.hpp>
+#include <boost/beast.hpp>
 #include <boost/circular_buffer.hpp>
 #include <boost/iostreams/device/array.hpp>
 #include <boost/log/trivial.hpp>
@@ -36,6 +40,16 @@ namespace program_options
 namespace paper
 {
 class node;
+class vote_total
+{
+public:
+	std::shared_ptr<paper::block> block;
+	paper::uint128_t weight;
+	// Number of representatives voting for the block, the total is dropped when it reaches zero
+	size_t reps;
+};
+// Votes only need a read transaction, the vote sequence numbers they update are persisted through the vote log
+// mutex must be held around apply_vote, compute_rep_votes, have_quorum and confirm_if_quorum, the other members take it themselves
 class election : public std::enable_shared_from_this<paper::election>
 {
 	std::function<void(std::shared_ptr<paper::block>, bool)> confirmation_action;
@@ -56,11 +70,21 @@ public:
 	void confirm_cutoff (MDB_txn *);
 	paper::uint128_t quorum_threshold (MDB_txn *, paper::ledger &);
 	paper::uint128_t minimum_threshold (MDB_txn *, paper::ledger &);
+	// Record a vote and move the representative's weight on to the block they voted for
+	paper::tally_result apply_vote (MDB_txn *, std::shared_ptr<paper::vote>);
+	// Vote totals per block from the running tally, same shape as ledger::tally without reading weights
+	std::map<paper::uint128_t, std::shared_ptr<paper::block>, std::greater<paper::uint128_t>> tally ();
 	paper::votes votes;
+	// Weight behind each block currently voted for, by block hash
+	std::unordered_map<paper::block_hash, paper::vote_total> totals;
+	// Each representative's weight as it was read when their first vote arrived
+	std::unordered_map<paper::account, paper::uint128_t> rep_weights;
 	paper::node & node;
 	std::chrono::steady_clock::time_point last_vote;
 	std::shared_ptr<paper::block> last_winner;
 	std::atomic_flag confirmed;
+	// Guards votes, totals, rep_weights, last_vote and last_winner
+	std::mutex mutex;
 };
 class conflict_info
 {
@@ -70,6 +94,17 @@ public:
 	// Number of announcements in a row for this fork
 	unsigned announcements;
 };
+// Elections whose roots fall in one slice of the root hash space, locked independently of the other slices
+class active_shard
+{
+public:
+	boost::multi_index_container<
+	paper::conflict_info,
+	boost::multi_index::indexed_by<
+	boost::multi_index::ordered_unique<boost::multi_index::member<paper::conflict_info, paper::block_hash, &paper::conflict_info::root>>>>
+	roots;
+	std::mutex mutex;
+};
 // Core class for determining consensus
 // Holds all active blocks i.e. recently added blocks that need confirmation
 class active_transactions
@@ -82,15 +117,19 @@ public:
 	void vote (std::shared_ptr<paper::vote>);
 	// Is the root of this block in the roots container
 	bool active (paper::block const &);
+	// Election for this root or nullptr if there isn't one
+	std::shared_ptr<paper::election> election (paper::block_hash const &);
+	// All elections, lowest root hash first
+	std::vector<std::shared_ptr<paper::election>> elections ();
+	size_t size ();
+	bool empty ();
 	void announce_votes ();
 	void stop ();
-	boost::multi_index_container<
-	paper::conflict_info,
-	boost::multi_index::indexed_by<
-	boost::multi_index::ordered_unique<boost::multi_index::member<paper::conflict_info, paper::block_hash, &paper::conflict_info::root>>>>
-	roots;
+	// Shards split the root hash space in to contiguous ranges so walking them in order walks roots in order
+	paper::active_shard & shard (paper::block_hash const &);
+	static size_t constexpr shard_count = 16;
+	std::array<paper::active_shard, shard_count> shards;
 	paper::node & node;
-	std::mutex mutex;
 	// Maximum number of conflicts to vote on per interval, lowest root hash first
 	static unsigned constexpr announcements_per_interval = 32;
 	// After this many successive vote announcements, block is confirmed
@@ -182,6 +221,8 @@ public:
 	// List of all peers
 	std::vector<paper::endpoint> list ();
 	std::map<paper::endpoint, unsigned> list_version ();
+	// Protocol version the peer advertised, 0 if it isn't known
+	unsigned network_version (paper::endpoint const &);
 	// A list of random peers with size the square root of total peer count
 	std::vector<paper::endpoint> list_sqrt ();
 	// Get the next peer for attempting bootstrap
@@ -268,11 +309,43 @@ class message_statistics
 {
 public:
 	message_statistics ();
+	void add (paper::message_type, uint64_t = 1);
+	void subtract (paper::message_type, uint64_t = 1);
+	std::atomic<uint64_t> * counter (paper::message_type);
 	std::atomic<uint64_t> keepalive;
 	std::atomic<uint64_t> publish;
 	std::atomic<uint64_t> confirm_req;
 	std::atomic<uint64_t> confirm_ack;
 };
+// A datagram read off the socket, waiting to be parsed
+class datagram
+{
+public:
+	paper::endpoint remote;
+	size_t size;
+	std::array<uint8_t, 512> buffer;
+};
+// Preallocated datagram buffers handed from the receiving thread to the network processing threads
+class datagram_ring
+{
+public:
+	datagram_ring (size_t);
+	// Takes up to `count' free buffers, when none are free `available' is called once some are released
+	void allocate (std::vector<paper::datagram *> &, size_t);
+	void enqueue (std::vector<paper::datagram *> const &);
+	// Waits for up to `count' received datagrams, returns false once stopped and drained
+	bool dequeue (std::vector<paper::datagram *> &, size_t);
+	void release (std::vector<paper::datagram *> const &);
+	void stop ();
+	std::vector<paper::datagram> datagrams;
+	std::vector<paper::datagram *> free;
+	std::deque<paper::datagram *> ready;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopped;
+	bool starved;
+	std::function<void()> available;
+};
 class block_arrival_info
 {
 public:
@@ -294,13 +367,34 @@ public:
 	arrival;
 	std::mutex mutex;
 };
+// A serialized message waiting to be sent, the buffer is owned by the callback and may be shared with other destinations
+class outgoing_datagram
+{
+public:
+	uint8_t const * data;
+	size_t size;
+	paper::endpoint endpoint;
+	paper::message_type type;
+	std::function<void(boost::system::error_code const &, size_t)> callback;
+};
+// Orders queued datagrams by destination then contents so a repeat of a message still waiting for a peer can be found
+class outgoing_datagram_compare
+{
+public:
+	bool operator() (paper::outgoing_datagram const *, paper::outgoing_datagram const *) const;
+};
 class network
 {
 public:
 	network (paper::node &, uint16_t);
+	~network ();
 	void receive ();
 	void stop ();
-	void receive_action (boost::system::error_code const &, size_t);
+	void receive_action (boost::system::error_code const &);
+	// Returns false when no buffers were free, reading resumes once the processing threads release some
+	bool receive_datagrams ();
+	void process_datagrams (std::vector<paper::datagram *> const &);
+	void process_loop ();
 	void rpc_action (boost::system::error_code const &, size_t);
 	void rebroadcast_reps (std::shared_ptr<paper::block>);
 	void republish_vote (std::chrono::steady_clock::time_point const &, std::shared_ptr<paper::vote>);
@@ -313,19 +407,41 @@ public:
 	void broadcast_confirm_req (std::shared_ptr<paper::block>);
 	void send_confirm_req (paper::endpoint const &, std::shared_ptr<paper::block>);
 	void send_buffer (uint8_t const *, size_t, paper::endpoint const &, std::function<void(boost::system::error_code const &, size_t)>);
+	void send_flush ();
+	size_t send_datagrams (std::vector<paper::outgoing_datagram> &);
 	paper::endpoint endpoint ();
-	paper::endpoint remote;
-	std::array<uint8_t, 512> buffer;
 	boost::asio::ip::udp::socket socket;
 	std::mutex socket_mutex;
 	boost::asio::ip::udp::resolver resolver;
 	paper::node & node;
-	uint64_t bad_sender_count;
+	std::atomic<uint64_t> bad_sender_count;
 	bool on;
-	uint64_t insufficient_work_count;
-	uint64_t error_count;
+	std::atomic<uint64_t> insufficient_work_count;
+	std::atomic<uint64_t> error_count;
 	paper::message_statistics incoming;
 	paper::message_statistics outgoing;
+	paper::datagram_ring ring;
+	// Times reading paused because every buffer in the ring was waiting to be processed
+	std::atomic<uint64_t> ring_full_count;
+	// Received messages dropped without being processed, publishes are dropped while the block processor is full
+	paper::message_statistics receive_dropped;
+	// Datagrams the kernel dropped because the socket's receive buffer was full, as reported by SO_RXQ_OVFL
+	std::atomic<uint64_t> kernel_dropped_count;
+	std::vector<std::thread> processing_threads;
+	std::mutex send_mutex;
+	std::deque<paper::outgoing_datagram> send_queue;
+	// Queued datagrams by destination and contents, identical messages to the same peer are coalesced in to one send
+	std::set<paper::outgoing_datagram const *, paper::outgoing_datagram_compare> send_pending;
+	// Whether a flush is scheduled or running, only one drains the queue at a time
+	bool send_flushing;
+	// Datagrams waiting in the send queue, bytes written to the socket, and datagrams discarded because the queue was full
+	paper::message_statistics send_queued;
+	paper::message_statistics send_bytes;
+	paper::message_statistics send_dropped;
+	// Most datagrams read per syscall and parsed, work validated together per processing pass
+	static size_t constexpr burst_max = 64;
+	static size_t constexpr ring_size = 4096;
+	static size_t constexpr send_queue_max = 16384;
 	static uint16_t const node_port = paper::paper_network == paper::paper_networks::paper_live_network ? 7075 : 54000;
 };
 class logging
@@ -399,13 +515,41 @@ public:
 	unsigned password_fanout;
 	unsigned io_threads;
 	unsigned work_threads;
+	unsigned network_threads;
+	// Threads running wallet sends, receives and changes, each account's actions still run one at a time
+	unsigned wallet_threads;
 	bool enable_voting;
 	unsigned bootstrap_connections;
 	unsigned bootstrap_connections_max;
+	// Account ranges whose chains are pulled in parallel ahead of the first frontier scan, also the number of segments of a long chain pulled at once, 0 disables
+	unsigned bootstrap_ranges;
 	std::string callback_address;
 	uint16_t callback_port;
 	std::string callback_target;
+	// Persistent connections kept open to the callback address
+	unsigned callback_connections;
+	// Events posted together as a JSON array, 1 posts each event on its own as a JSON object
+	unsigned callback_batch;
+	// Events waiting for a connection before new ones are dropped
+	size_t callback_queue_max;
+	// Times delivery of an event is retried before it's counted as failed
+	unsigned callback_retries;
+	// Address the event stream listens on, the stream isn't authenticated so this should stay a loopback address
+	boost::asio::ip::address stream_address;
+	// Local port serving the binary event stream, 0 disables it
+	uint16_t stream_port;
+	// Records buffered for each stream subscriber before the oldest are dropped
+	size_t stream_buffer;
+	// Records retained for subscribers resuming after a reconnect
+	size_t stream_history;
 	int lmdb_max_dbs;
+	// Unchecked blocks held in memory before the oldest are spilled to the store
+	size_t unchecked_cache_max;
+	// Unchecked blocks still waiting on their dependency after this long are deleted
+	std::chrono::seconds unchecked_cutoff_time;
+	// Entries kept by the store's account_info and block caches, 0 disables either
+	size_t account_cache_max;
+	size_t block_cache_max;
 	static std::chrono::seconds constexpr keepalive_period = std::chrono::seconds (60);
 	static std::chrono::seconds constexpr keepalive_cutoff = keepalive_period * 5;
 	static std::chrono::minutes constexpr wallet_backup_interval = std::chrono::minutes (5);
@@ -445,9 +589,43 @@ public:
 	block_processor_item (std::shared_ptr<paper::block>, bool);
 	std::shared_ptr<paper::block> block;
 	bool force;
+	paper::signature_verification verification;
+};
+class signature_check_set
+{
+public:
+	size_t size;
+	unsigned char const ** messages;
+	size_t * message_lengths;
+	unsigned char const ** pub_keys;
+	unsigned char const ** signatures;
+	int * verifications;
+};
+// Splits sets of signatures in to batches and verifies them across a pool of threads
+class signature_checker
+{
+public:
+	signature_checker (unsigned);
+	~signature_checker ();
+	void stop ();
+	// Blocks until every signature in the set has been verified
+	void verify (paper::signature_check_set &);
+	// Number of signatures handed to a thread at once, large enough to amortize the batch verification setup
+	static size_t constexpr batch_size = 256;
+
+private:
+	void run ();
+	bool stopped;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::thread> threads;
 };
 // Processing blocks is a potentially long IO operation
 // This class isolates block insertion from other operations like servicing network operations
+// Blocks pass through two stages connected by bounded queues:
+// verify_blocks orders each batch so blocks follow the blocks they depend on and checks signatures across the checker's threads,
+// process_blocks is the single writer that applies them to the ledger
 class block_processor
 {
 public:
@@ -455,20 +633,97 @@ public:
 	~block_processor ();
 	void stop ();
 	void flush ();
-	void add (paper::block_processor_item const &);
+	// Returns true if the block was dropped because the incoming queue is at queue_limit
+	bool add (paper::block_processor_item const &);
+	// Whether the incoming queue is at queue_max, publishes and bootstrap pulls hold off until it isn't
+	bool full ();
+	// Process blocks on the calling thread, unchecked blocks they release are processed along with them
 	void process_receive_many (paper::block_processor_item const &);
 	void process_receive_many (std::deque<paper::block_processor_item> &);
-	paper::process_return process_receive_one (MDB_txn *, std::shared_ptr<paper::block>);
+	paper::process_return process_receive_one (MDB_txn *, std::shared_ptr<paper::block>, paper::signature_verification = paper::signature_verification::unknown);
+	void verify_blocks ();
 	void process_blocks ();
+	// Check signatures of queued blocks in batches before the write transaction is opened
+	void verify_signatures (std::deque<paper::block_processor_item> &);
+	// Reorder blocks so any block whose previous or source is also in the set comes after it
+	static void order_dependencies (std::deque<paper::block_processor_item> &);
+	// Blocks waiting to be verified and blocks verified and waiting to be written
+	size_t incoming_size ();
+	size_t verified_size ();
+	paper::signature_checker checker;
+	// Bound on blocks verified and waiting to be written, and the incoming size at which full () holds producers off
+	static size_t constexpr queue_max = 16384;
+	// Bound on blocks waiting to be verified, for producers that don't check full, like blocks carried by votes
+	static size_t constexpr queue_limit = 4 * queue_max;
+	// Blocks add () turned away at queue_limit
+	std::atomic<uint64_t> dropped;
 
 private:
+	// Released unchecked blocks are moved to released_a when it's given instead of being processed in the same pass
+	void process_items (std::deque<paper::block_processor_item> &, std::deque<paper::block_processor_item> * released_a);
 	bool stopped;
-	bool idle;
+	bool verify_idle;
+	bool process_idle;
+	// The incoming queue filled and hasn't drained below queue_max since
+	bool overflowing;
 	std::deque<paper::block_processor_item> blocks;
+	std::deque<paper::block_processor_item> verified;
 	std::mutex mutex;
 	std::condition_variable condition;
 	paper::node & node;
 };
+class callback_event
+{
+public:
+	std::string body;
+	unsigned attempts;
+};
+class callback_dispatcher;
+// A keep-alive HTTP connection to the callback address, carrying one batch of events at a time
+class callback_connection : public std::enable_shared_from_this<paper::callback_connection>
+{
+public:
+	callback_connection (paper::callback_dispatcher &);
+	void send (std::vector<paper::callback_event>, std::vector<boost::asio::ip::tcp::endpoint> const &);
+	void write ();
+	void close ();
+	paper::callback_dispatcher & dispatcher;
+	boost::asio::ip::tcp::socket socket;
+	bool connected;
+	std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+	std::vector<paper::callback_event> batch;
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::request<boost::beast::http::string_body> request;
+	boost::beast::http::response<boost::beast::http::string_body> response;
+};
+// Delivers live block events to the configured callback address over a bounded pool of persistent connections.
+// The address is resolved once and again only after a connection to it fails, events that can't be delivered are retried
+// a few times and new events are dropped while the queue is full.
+class callback_dispatcher
+{
+public:
+	callback_dispatcher (paper::node &);
+	void add (std::string const &);
+	void stop ();
+	// Hands queued events to idle connections, opening new ones up to the configured limit
+	void dispatch (std::unique_lock<std::mutex> &);
+	void resolve ();
+	void completed (std::shared_ptr<paper::callback_connection>, bool, bool);
+	size_t queue_size ();
+	size_t connection_count ();
+	paper::node & node;
+	std::mutex mutex;
+	std::deque<paper::callback_event> queue;
+	std::vector<std::shared_ptr<paper::callback_connection>> idle;
+	std::unordered_set<std::shared_ptr<paper::callback_connection>> connections;
+	std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+	bool resolving;
+	bool stopped;
+	std::atomic<uint64_t> delivered;
+	std::atomic<uint64_t> failed;
+	std::atomic<uint64_t> dropped;
+	static std::chrono::seconds constexpr retry_delay = std::chrono::seconds (1);
+};
 class node : public std::enable_shared_from_this<paper::node>
 {
 public:
@@ -502,6 +757,7 @@ public:
 	void ongoing_rep_crawl ();
 	void ongoing_bootstrap ();
 	void ongoing_store_flush ();
+	void ongoing_unchecked_cleanup ();
 	void backup_wallet ();
 	int price (paper::uint128_t const &, int);
 	void generate_work (paper::block &);
@@ -530,12 +786,18 @@ public:
 	unsigned warmed_up;
 	paper::block_processor block_processor;
 	std::thread block_processor_thread;
+	std::thread block_verifier_thread;
 	paper::block_arrival block_arrival;
+	paper::callback_dispatcher callbacks;
+	paper::stream_server stream;
 	static double constexpr price_max = 16.0;
 	static double constexpr free_cutoff = 1024.0;
 	static std::chrono::seconds constexpr period = std::chrono::seconds (60);
 	static std::chrono::seconds constexpr cutoff = period * 5;
 	static std::chrono::minutes constexpr backup_interval = std::chrono::minutes (5);
+	static std::chrono::minutes constexpr unchecked_cleanup_interval = std::chrono::minutes (5);
+	// Unchecked table entries scanned per write transaction while cleaning up
+	static size_t constexpr unchecked_cleanup_slice = 4096;
 };
 class thread_runner
 {
@@ -11,6 +11,8 @@
 #include <paper/node/rpc_secure.hpp>
 #endif
 
+size_t constexpr paper::rpc_body_source::batch_size;
+
 paper::rpc_secure_config::rpc_secure_config () :
 enable (false),
 verbose_logging (false)
@@ -53,7 +55,10 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (paper::rpc::rpc_port),
 enable_control (false),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+action_limits ({ { "delegators", 2 }, { "frontiers", 2 }, { "ledger", 2 }, { "unchecked", 2 }, { "wallet_ledger", 2 } }),
+keepalive_timeout (30)
 {
 }
 
@@ -62,7 +67,10 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (paper::rpc::rpc_port),
 enable_control (enable_control_a),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+action_limits ({ { "delegators", 2 }, { "frontiers", 2 }, { "ledger", 2 }, { "unchecked", 2 }, { "wallet_ledger", 2 } }),
+keepalive_timeout (30)
 {
 }
 
@@ -73,6 +81,14 @@ void paper::rpc_config::serialize_json (boost::property_tree::ptree & tree_a) co
 	tree_a.put ("enable_control", enable_control);
 	tree_a.put ("frontier_request_limit", frontier_request_limit);
 	tree_a.put ("chain_request_limit", chain_request_limit);
+	tree_a.put ("threads", threads);
+	boost::property_tree::ptree action_limits_l;
+	for (auto & i : action_limits)
+	{
+		action_limits_l.put (i.first, i.second);
+	}
+	tree_a.add_child ("action_limits", action_limits_l);
+	tree_a.put ("keepalive_timeout", keepalive_timeout);
 }
 
 bool paper::rpc_config::deserialize_json (boost::property_tree::ptree const & tree_a)
@@ -99,6 +115,29 @@ bool paper::rpc_config::deserialize_json (boost::property_tree::ptree const & tr
 				result = port > std::numeric_limits<uint16_t>::max ();
 				frontier_request_limit = std::stoull (frontier_request_limit_l);
 				chain_request_limit = std::stoull (chain_request_limit_l);
+				auto threads_l (tree_a.get_optional<std::string> ("threads"));
+				if (threads_l)
+				{
+					threads = std::stoul (threads_l.get ());
+					result |= threads == 0;
+				}
+				auto action_limits_l (tree_a.get_child_optional ("action_limits"));
+				if (action_limits_l)
+				{
+					action_limits.clear ();
+					for (auto & i : action_limits_l.get ())
+					{
+						auto limit (std::stoul (i.second.data ()));
+						result |= limit == 0;
+						action_limits[i.first] = limit;
+					}
+				}
+				auto keepalive_timeout_l (tree_a.get_optional<std::string> ("keepalive_timeout"));
+				if (keepalive_timeout_l)
+				{
+					keepalive_timeout = std::stoul (keepalive_timeout_l.get ());
+					result |= keepalive_timeout == 0;
+				}
 			}
 			catch (std::logic_error const &)
 			{
@@ -119,13 +158,87 @@ bool paper::rpc_config::deserialize_json (boost::property_tree::ptree const & tr
 	return result;
 }
 
+paper::rpc_action_limiter::rpc_action_limiter (boost::asio::io_service & service_a, std::unordered_map<std::string, unsigned> const & limits_a) :
+service (service_a),
+limits (limits_a)
+{
+}
+
+bool paper::rpc_action_limiter::limited (std::string const & action_a) const
+{
+	return limits.find (action_a) != limits.end ();
+}
+
+void paper::rpc_action_limiter::run (std::string const & action_a, std::function<void()> const & handler_a)
+{
+	auto run_now (false);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		auto & running_l (running[action_a]);
+		if (running_l < limits.find (action_a)->second)
+		{
+			++running_l;
+			run_now = true;
+		}
+		else
+		{
+			pending[action_a].push_back (handler_a);
+		}
+	}
+	if (run_now)
+	{
+		handler_a ();
+	}
+}
+
+void paper::rpc_action_limiter::finished (std::string const & action_a)
+{
+	std::function<void()> next;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		auto & pending_l (pending[action_a]);
+		if (!pending_l.empty ())
+		{
+			// Hand the slot straight to the next waiting request
+			next = pending_l.front ();
+			pending_l.pop_front ();
+		}
+		else
+		{
+			assert (running[action_a] > 0);
+			--running[action_a];
+		}
+	}
+	if (next)
+	{
+		service.post (next);
+	}
+}
+
+size_t paper::rpc_action_limiter::pending_size (std::string const & action_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (pending.find (action_a));
+	return existing != pending.end () ? existing->second.size () : 0;
+}
+
 paper::rpc::rpc (boost::asio::io_service & service_a, paper::node & node_a, paper::rpc_config const & config_a) :
 acceptor (service_a),
 config (config_a),
+limiter (service, config.action_limits),
 node (node_a)
 {
 }
 
+paper::rpc::~rpc ()
+{
+	stop ();
+	if (runner != nullptr)
+	{
+		runner->join ();
+	}
+}
+
 void paper::rpc::start ()
 {
 	auto endpoint (paper::tcp_endpoint (config.address, config.port));
@@ -141,6 +254,8 @@ void paper::rpc::start ()
 	}
 
 	acceptor.listen ();
+	service_work.reset (new boost::asio::io_service::work (service));
+	runner.reset (new paper::thread_runner (service, config.threads));
 	node.observers.blocks.add ([this](std::shared_ptr<paper::block> block_a, paper::account const & account_a, paper::amount const &) {
 		observer_action (account_a);
 	});
@@ -167,6 +282,8 @@ void paper::rpc::accept ()
 void paper::rpc::stop ()
 {
 	acceptor.close ();
+	service_work.reset ();
+	service.stop ();
 }
 
 paper::rpc_handler::rpc_handler (paper::node & node_a, paper::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
@@ -270,6 +387,41 @@ void paper::rpc_handler::account_block_count ()
 	}
 }
 
+void paper::rpc_handler::account_block_at_height ()
+{
+	std::string account_text (request.get<std::string> ("account"));
+	std::string height_text (request.get<std::string> ("height"));
+	paper::uint256_union account;
+	auto error (account.decode_account (account_text));
+	if (!error)
+	{
+		uint64_t height;
+		if (!decode_unsigned (height_text, height))
+		{
+			paper::transaction transaction (node.store.environment, nullptr, false);
+			auto hash (node.store.height_get (transaction, account, height));
+			if (!hash.is_zero ())
+			{
+				boost::property_tree::ptree response_l;
+				response_l.put ("hash", hash.to_string ());
+				response (response_l);
+			}
+			else
+			{
+				error_response (response, "Block not found");
+			}
+		}
+		else
+		{
+			error_response (response, "Invalid height");
+		}
+	}
+	else
+	{
+		error_response (response, "Bad account number");
+	}
+}
+
 void paper::rpc_handler::account_create ()
 {
 	if (rpc.config.enable_control)
@@ -279,8 +431,8 @@ void paper::rpc_handler::account_create ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				bool generate_work (true);
 				boost::optional<bool> work (request.get_optional<bool> ("work"));
@@ -288,7 +440,7 @@ void paper::rpc_handler::account_create ()
 				{
 					generate_work = work.get ();
 				}
-				paper::account new_key (existing->second->deterministic_insert (generate_work));
+				paper::account new_key (existing->deterministic_insert (generate_work));
 				if (!new_key.is_zero ())
 				{
 					boost::property_tree::ptree response_l;
@@ -424,13 +576,13 @@ void paper::rpc_handler::account_list ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree accounts;
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), j (existing->second->store.end ()); i != j; ++i)
+			for (auto i (existing->store.begin (transaction)), j (existing->store.end ()); i != j; ++i)
 			{
 				boost::property_tree::ptree entry;
 				entry.put ("", paper::uint256_union (i->first.uint256 ()).to_account ());
@@ -461,18 +613,18 @@ void paper::rpc_handler::account_move ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
-				auto wallet (existing->second);
+				auto wallet (existing);
 				paper::uint256_union source;
 				auto error (source.decode_hex (source_text));
 				if (!error)
 				{
-					auto existing (node.wallets.items.find (source));
-					if (existing != node.wallets.items.end ())
+					auto existing (node.wallets.open (source));
+					if (existing != nullptr)
 					{
-						auto source (existing->second);
+						auto source (existing);
 						std::vector<paper::public_key> accounts;
 						for (auto i (accounts_text.begin ()), n (accounts_text.end ()); i != n; ++i)
 						{
@@ -522,12 +674,12 @@ void paper::rpc_handler::account_remove ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
-				auto wallet (existing->second);
+				auto wallet (existing);
 				paper::transaction transaction (node.store.environment, nullptr, true);
-				if (existing->second->store.valid_password (transaction))
+				if (existing->store.valid_password (transaction))
 				{
 					paper::account account_id;
 					auto error (account_id.decode_account (account_text));
@@ -610,10 +762,10 @@ void paper::rpc_handler::account_representative_set ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
-				auto wallet (existing->second);
+				auto wallet (existing);
 				std::string account_text (request.get<std::string> ("account"));
 				paper::account account;
 				auto error (account.decode_account (account_text));
@@ -642,7 +794,7 @@ void paper::rpc_handler::account_representative_set ()
 							{
 								if (!paper::work_validate (info.head, work))
 								{
-									existing->second->store.work_put (transaction, account, work);
+									existing->store.work_put (transaction, account, work);
 								}
 								else
 								{
@@ -739,8 +891,8 @@ void paper::rpc_handler::accounts_create ()
 			auto count_error (decode_unsigned (count_text, count));
 			if (!count_error && count != 0)
 			{
-				auto existing (node.wallets.items.find (wallet));
-				if (existing != node.wallets.items.end ())
+				auto existing (node.wallets.open (wallet));
+				if (existing != nullptr)
 				{
 					bool generate_work (true);
 					boost::optional<bool> work (request.get_optional<bool> ("work"));
@@ -752,7 +904,7 @@ void paper::rpc_handler::accounts_create ()
 					boost::property_tree::ptree accounts;
 					for (auto i (0); accounts.size () < count; ++i)
 					{
-						paper::account new_key (existing->second->deterministic_insert (generate_work));
+						paper::account new_key (existing->deterministic_insert (generate_work));
 						if (!new_key.is_zero ())
 						{
 							boost::property_tree::ptree entry;
@@ -1167,17 +1319,17 @@ void paper::rpc_handler::block_create ()
 		paper::uint128_union balance (0);
 		if (wallet != 0 && account != 0)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				paper::transaction transaction (node.store.environment, nullptr, false);
-				auto unlock_check (existing->second->store.valid_password (transaction));
+				auto unlock_check (existing->store.valid_password (transaction));
 				if (unlock_check)
 				{
-					auto account_check (existing->second->store.find (transaction, account));
-					if (account_check != existing->second->store.end ())
+					auto account_check (existing->store.find (transaction, account));
+					if (account_check != existing->store.end ())
 					{
-						existing->second->store.fetch (transaction, account, prv);
+						existing->store.fetch (transaction, account, prv);
 						previous = node.ledger.latest (transaction, account);
 						balance = node.ledger.account_balance (transaction, account);
 					}
@@ -1411,6 +1563,62 @@ void paper::rpc_handler::bootstrap_any ()
 	response (response_l);
 }
 
+void paper::rpc_handler::bootstrap_status ()
+{
+	boost::property_tree::ptree response_l;
+	auto attempt (node.bootstrap_initiator.current_attempt ());
+	response_l.put ("in_progress", attempt != nullptr ? "1" : "0");
+	if (attempt != nullptr)
+	{
+		boost::property_tree::ptree peers_l;
+		size_t pulls;
+		{
+			std::lock_guard<std::mutex> lock (attempt->mutex);
+			pulls = attempt->pulls.size () + attempt->pulling;
+			for (auto & i : attempt->clients)
+			{
+				if (auto client = i.lock ())
+				{
+					boost::property_tree::ptree entry;
+					std::stringstream endpoint;
+					endpoint << client->endpoint;
+					entry.put ("endpoint", endpoint.str ());
+					entry.put ("blocks", std::to_string (client->block_count));
+					entry.put ("blocks_per_second", std::to_string (client->block_rate ()));
+					peers_l.push_back (std::make_pair ("", entry));
+				}
+			}
+		}
+		response_l.put ("pulls_outstanding", std::to_string (pulls));
+		response_l.put ("reassembly_size", std::to_string (attempt->reassembly.size ()));
+		response_l.put ("total_blocks", std::to_string (attempt->total_blocks));
+		response_l.add_child ("peers", peers_l);
+	}
+	response (response_l);
+}
+
+void paper::rpc_handler::block_processor_stats ()
+{
+	boost::property_tree::ptree response_l;
+	response_l.put ("incoming", std::to_string (node.block_processor.incoming_size ()));
+	response_l.put ("verified", std::to_string (node.block_processor.verified_size ()));
+	response_l.put ("queue_max", std::to_string (paper::block_processor::queue_max));
+	response_l.put ("dropped", std::to_string (node.block_processor.dropped));
+	response_l.put ("publish_dropped", std::to_string (node.network.receive_dropped.publish));
+	response (response_l);
+}
+
+void paper::rpc_handler::callback_stats ()
+{
+	boost::property_tree::ptree response_l;
+	response_l.put ("delivered", std::to_string (node.callbacks.delivered));
+	response_l.put ("failed", std::to_string (node.callbacks.failed));
+	response_l.put ("dropped", std::to_string (node.callbacks.dropped));
+	response_l.put ("queue", std::to_string (node.callbacks.queue_size ()));
+	response_l.put ("connections", std::to_string (node.callbacks.connection_count ()));
+	response (response_l);
+}
+
 void paper::rpc_handler::chain ()
 {
 	std::string block_text (request.get<std::string> ("block"));
@@ -1426,13 +1634,13 @@ void paper::rpc_handler::chain ()
 			paper::transaction transaction (node.store.environment, nullptr, false);
 			while (!block.is_zero () && blocks.size () < count)
 			{
-				auto block_l (node.store.block_get (transaction, block));
-				if (block_l != nullptr)
+				auto block_l (node.store.block_get_view (transaction, block));
+				if (!block_l.empty ())
 				{
 					boost::property_tree::ptree entry;
 					entry.put ("", block.to_string ());
 					blocks.push_back (std::make_pair ("", entry));
-					block = block_l->previous ();
+					block = block_l.previous ();
 				}
 				else
 				{
@@ -1550,6 +1758,38 @@ void paper::rpc_handler::deterministic_key ()
 	}
 }
 
+namespace
+{
+/** Account heads in account order */
+class frontiers_source : public paper::rpc_body_source
+{
+public:
+	frontiers_source (paper::node & node_a, paper::account const & start_a, uint64_t count_a) :
+	rpc_body_source ("frontiers", count_a),
+	node (node_a.shared ()),
+	next_account (start_a)
+	{
+	}
+	bool fill (std::vector<std::pair<std::string, boost::property_tree::ptree>> & entries_a, size_t max_a) override
+	{
+		paper::transaction transaction (node->store.environment, nullptr, false);
+		auto i (node->store.latest_begin (transaction, next_account));
+		for (auto n (node->store.latest_end ()); i != n && entries_a.size () < max_a; ++i)
+		{
+			entries_a.push_back (std::make_pair (paper::account (i->first.uint256 ()).to_account (), boost::property_tree::ptree (paper::account_info (i->second).head.to_string ())));
+		}
+		auto done (i == node->store.latest_end ());
+		if (!done)
+		{
+			next_account = i->first.uint256 ();
+		}
+		return done;
+	}
+	std::shared_ptr<paper::node> node;
+	paper::account next_account;
+};
+}
+
 void paper::rpc_handler::frontiers ()
 {
 	std::string account_text (request.get<std::string> ("account"));
@@ -1560,15 +1800,7 @@ void paper::rpc_handler::frontiers ()
 		uint64_t count;
 		if (!decode_unsigned (count_text, count))
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree frontiers;
-			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && frontiers.size () < count; ++i)
-			{
-				frontiers.put (paper::account (i->first.uint256 ()).to_account (), paper::account_info (i->second).head.to_string ());
-			}
-			response_l.add_child ("frontiers", frontiers);
-			response (response_l);
+			stream_response (std::make_shared<frontiers_source> (node, start, count));
 		}
 		else
 		{
@@ -1592,57 +1824,39 @@ void paper::rpc_handler::frontier_count ()
 
 namespace
 {
-class history_visitor : public paper::block_visitor
+// Describe the block for history, change blocks aren't reported
+void history_entry (paper::rpc_handler & handler_a, MDB_txn * transaction_a, boost::property_tree::ptree & tree_a, paper::block_hash const & hash_a, paper::block_view const & block_a)
 {
-public:
-	history_visitor (paper::rpc_handler & handler_a, paper::transaction & transaction_a, boost::property_tree::ptree & tree_a, paper::block_hash const & hash_a) :
-	handler (handler_a),
-	transaction (transaction_a),
-	tree (tree_a),
-	hash (hash_a)
-	{
-	}
-	virtual ~history_visitor () = default;
-	void send_block (paper::send_block const & block_a)
-	{
-		tree.put ("type", "send");
-		auto account (block_a.hashables.destination.to_account ());
-		tree.put ("account", account);
-		auto amount (handler.node.ledger.amount (transaction, hash).convert_to<std::string> ());
-		tree.put ("amount", amount);
-	}
-	void receive_block (paper::receive_block const & block_a)
-	{
-		tree.put ("type", "receive");
-		auto account (handler.node.ledger.account (transaction, block_a.hashables.source).to_account ());
-		tree.put ("account", account);
-		auto amount (handler.node.ledger.amount (transaction, hash).convert_to<std::string> ());
-		tree.put ("amount", amount);
-	}
-	void open_block (paper::open_block const & block_a)
-	{
-		// Report opens as a receive
-		tree.put ("type", "receive");
-		if (block_a.hashables.source != paper::genesis_account)
-		{
-			tree.put ("account", handler.node.ledger.account (transaction, block_a.hashables.source).to_account ());
-			tree.put ("amount", handler.node.ledger.amount (transaction, hash).convert_to<std::string> ());
-		}
-		else
-		{
-			tree.put ("account", paper::genesis_account.to_account ());
-			tree.put ("amount", paper::genesis_amount.convert_to<std::string> ());
-		}
-	}
-	void change_block (paper::change_block const &)
-	{
-		// Don't report change blocks
+	switch (block_a.type ())
+	{
+		case paper::block_type::send:
+			tree_a.put ("type", "send");
+			tree_a.put ("account", block_a.destination ().to_account ());
+			tree_a.put ("amount", handler_a.node.ledger.amount (transaction_a, hash_a).convert_to<std::string> ());
+			break;
+		case paper::block_type::receive:
+			tree_a.put ("type", "receive");
+			tree_a.put ("account", handler_a.node.ledger.account (transaction_a, block_a.source ()).to_account ());
+			tree_a.put ("amount", handler_a.node.ledger.amount (transaction_a, hash_a).convert_to<std::string> ());
+			break;
+		case paper::block_type::open:
+			// Report opens as a receive
+			tree_a.put ("type", "receive");
+			if (block_a.source () != paper::genesis_account)
+			{
+				tree_a.put ("account", handler_a.node.ledger.account (transaction_a, block_a.source ()).to_account ());
+				tree_a.put ("amount", handler_a.node.ledger.amount (transaction_a, hash_a).convert_to<std::string> ());
+			}
+			else
+			{
+				tree_a.put ("account", paper::genesis_account.to_account ());
+				tree_a.put ("amount", paper::genesis_amount.convert_to<std::string> ());
+			}
+			break;
+		default:
+			break;
 	}
-	paper::rpc_handler & handler;
-	paper::transaction & transaction;
-	boost::property_tree::ptree & tree;
-	paper::block_hash const & hash;
-};
+}
 }
 
 void paper::rpc_handler::history ()
@@ -1658,19 +1872,18 @@ void paper::rpc_handler::history ()
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree history;
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			auto block (node.store.block_get (transaction, hash));
-			while (block != nullptr && count > 0)
+			auto block (node.store.block_get_view (transaction, hash));
+			while (!block.empty () && count > 0)
 			{
 				boost::property_tree::ptree entry;
-				history_visitor visitor (*this, transaction, entry, hash);
-				block->visit (visitor);
+				history_entry (*this, transaction, entry, hash, block);
 				if (!entry.empty ())
 				{
 					entry.put ("hash", hash.to_string ());
 					history.push_back (std::make_pair ("", entry));
 				}
-				hash = block->previous ();
-				block = node.store.block_get (transaction, hash);
+				hash = block.previous ();
+				block = node.store.block_get_view (transaction, hash);
 				--count;
 			}
 			response_l.add_child ("history", history);
@@ -1698,27 +1911,68 @@ void paper::rpc_handler::account_history ()
 		uint64_t count;
 		if (!decode_unsigned (count_text, count))
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree history;
-			paper::transaction transaction (node.store.environment, nullptr, false);
-			auto hash (node.ledger.latest (transaction, account));
-			auto block (node.store.block_get (transaction, hash));
-			while (block != nullptr && count > 0)
+			uint64_t offset (0);
+			boost::optional<std::string> offset_text (request.get_optional<std::string> ("offset"));
+			if (!offset_text.is_initialized () || !decode_unsigned (offset_text.get (), offset))
 			{
-				boost::property_tree::ptree entry;
-				history_visitor visitor (*this, transaction, entry, hash);
-				block->visit (visitor);
-				if (!entry.empty ())
+				paper::transaction transaction (node.store.environment, nullptr, false);
+				paper::block_hash hash (0);
+				boost::optional<std::string> head_text (request.get_optional<std::string> ("head"));
+				if (head_text.is_initialized ())
 				{
-					entry.put ("hash", hash.to_string ());
-					history.push_back (std::make_pair ("", entry));
+					// Continue from a block of this account, offset counts back from it
+					error = hash.decode_hex (head_text.get ()) || !node.store.block_exists (transaction, hash) || node.ledger.account (transaction, hash) != account;
+					if (!error && offset > 0)
+					{
+						// Seek from the head's height rather than walking back offset blocks
+						auto height (node.store.block_height (transaction, hash));
+						hash = offset < height ? node.store.height_get (transaction, account, height - offset) : paper::block_hash (0);
+					}
+				}
+				else
+				{
+					// Seek straight to the page through the height index instead of walking down from the head
+					paper::account_info info;
+					if (!node.store.account_get (transaction, account, info) && offset < info.block_count)
+					{
+						hash = node.store.height_get (transaction, account, info.block_count - offset);
+					}
+				}
+				if (!error)
+				{
+					boost::property_tree::ptree response_l;
+					boost::property_tree::ptree history;
+					auto block (node.store.block_get_view (transaction, hash));
+					while (!block.empty () && count > 0)
+					{
+						boost::property_tree::ptree entry;
+						history_entry (*this, transaction, entry, hash, block);
+						if (!entry.empty ())
+						{
+							entry.put ("hash", hash.to_string ());
+							history.push_back (std::make_pair ("", entry));
+						}
+						hash = block.previous ();
+						block = node.store.block_get_view (transaction, hash);
+						--count;
+					}
+					response_l.add_child ("history", history);
+					if (!block.empty ())
+					{
+						// Head of the next page
+						response_l.put ("previous", hash.to_string ());
+					}
+					response (response_l);
+				}
+				else
+				{
+					error_response (response, "Block not found");
 				}
-				hash = block->previous ();
-				block = node.store.block_get (transaction, hash);
-				--count;
 			}
-			response_l.add_child ("history", history);
-			response (response_l);
+			else
+			{
+				error_response (response, "Invalid offset");
+			}
 		}
 		else
 		{
@@ -1786,6 +2040,75 @@ void paper::rpc_handler::key_expand ()
 	}
 }
 
+namespace
+{
+void ledger_entry (paper::node & node_a, MDB_txn * transaction_a, paper::account const & account_a, paper::account_info const & info_a, bool representative_a, bool weight_a, bool pending_a, boost::property_tree::ptree & tree_a)
+{
+	tree_a.put ("frontier", info_a.head.to_string ());
+	tree_a.put ("open_block", info_a.open_block.to_string ());
+	tree_a.put ("representative_block", info_a.rep_block.to_string ());
+	std::string balance;
+	paper::uint128_union (info_a.balance).encode_dec (balance);
+	tree_a.put ("balance", balance);
+	tree_a.put ("modified_timestamp", std::to_string (info_a.modified));
+	tree_a.put ("block_count", std::to_string (info_a.block_count));
+	if (representative_a)
+	{
+		auto block (node_a.store.block_get (transaction_a, info_a.rep_block));
+		assert (block != nullptr);
+		tree_a.put ("representative", block->representative ().to_account ());
+	}
+	if (weight_a)
+	{
+		auto account_weight (node_a.ledger.weight (transaction_a, account_a));
+		tree_a.put ("weight", account_weight.convert_to<std::string> ());
+	}
+	if (pending_a)
+	{
+		auto account_pending (node_a.ledger.account_pending (transaction_a, account_a));
+		tree_a.put ("pending", account_pending.convert_to<std::string> ());
+	}
+}
+
+/** Accounts in account order */
+class ledger_source : public paper::rpc_body_source
+{
+public:
+	ledger_source (paper::node & node_a, paper::account const & start_a, uint64_t count_a, bool representative_a, bool weight_a, bool pending_a) :
+	rpc_body_source ("accounts", count_a),
+	node (node_a.shared ()),
+	next_account (start_a),
+	representative (representative_a),
+	weight (weight_a),
+	pending (pending_a)
+	{
+	}
+	bool fill (std::vector<std::pair<std::string, boost::property_tree::ptree>> & entries_a, size_t max_a) override
+	{
+		paper::transaction transaction (node->store.environment, nullptr, false);
+		auto i (node->store.latest_begin (transaction, next_account));
+		for (auto n (node->store.latest_end ()); i != n && entries_a.size () < max_a; ++i)
+		{
+			paper::account account (i->first.uint256 ());
+			boost::property_tree::ptree entry;
+			ledger_entry (*node, transaction, account, paper::account_info (i->second), representative, weight, pending, entry);
+			entries_a.push_back (std::make_pair (account.to_account (), entry));
+		}
+		auto done (i == node->store.latest_end ());
+		if (!done)
+		{
+			next_account = i->first.uint256 ();
+		}
+		return done;
+	}
+	std::shared_ptr<paper::node> node;
+	paper::account next_account;
+	bool representative;
+	bool weight;
+	bool pending;
+};
+}
+
 void paper::rpc_handler::ledger ()
 {
 	if (rpc.config.enable_control)
@@ -1793,23 +2116,18 @@ void paper::rpc_handler::ledger ()
 		paper::account start (0);
 		uint64_t count (std::numeric_limits<uint64_t>::max ());
 		bool sorting (false);
+		bool error (false);
 		boost::optional<std::string> account_text (request.get_optional<std::string> ("account"));
-		if (account_text.is_initialized ())
+		if (account_text.is_initialized () && start.decode_account (account_text.get ()))
 		{
-			auto error (start.decode_account (account_text.get ()));
-			if (error)
-			{
-				error_response (response, "Invalid starting account");
-			}
+			error = true;
+			error_response (response, "Invalid starting account");
 		}
 		boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
-		if (count_text.is_initialized ())
+		if (!error && count_text.is_initialized () && decode_unsigned (count_text.get (), count))
 		{
-			auto error_count (decode_unsigned (count_text.get (), count));
-			if (error_count)
-			{
-				error_response (response, "Invalid count limit");
-			}
+			error = true;
+			error_response (response, "Invalid count limit");
 		}
 		boost::optional<bool> sorting_optional (request.get_optional<bool> ("sorting"));
 		if (sorting_optional.is_initialized ())
@@ -1834,88 +2152,38 @@ void paper::rpc_handler::ledger ()
 		{
 			pending = pending_optional.get ();
 		}
-		boost::property_tree::ptree response_a;
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree accounts;
-		paper::transaction transaction (node.store.environment, nullptr, false);
-		if (!sorting) // Simple
-		{
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && accounts.size () < count; ++i)
-			{
-				paper::account_info info (i->second);
-				paper::account account (i->first.uint256 ());
-				boost::property_tree::ptree response_l;
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
-				std::string balance;
-				paper::uint128_union (info.balance).encode_dec (balance);
-				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
-				if (representative)
-				{
-					auto block (node.store.block_get (transaction, info.rep_block));
-					assert (block != nullptr);
-					response_l.put ("representative", block->representative ().to_account ());
-				}
-				if (weight)
-				{
-					auto account_weight (node.ledger.weight (transaction, account));
-					response_l.put ("weight", account_weight.convert_to<std::string> ());
-				}
-				if (pending)
-				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
-					response_l.put ("pending", account_pending.convert_to<std::string> ());
-				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
-			}
-		}
-		else // Sorting
+		if (!error)
 		{
-			std::vector<std::pair<paper::uint128_union, paper::account>> ledger_l;
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
+			if (!sorting) // Simple
 			{
-				paper::uint128_union balance (paper::account_info (i->second).balance);
-				ledger_l.push_back (std::make_pair (balance, paper::account (i->first.uint256 ())));
+				stream_response (std::make_shared<ledger_source> (node, start, count, representative, weight, pending));
 			}
-			std::sort (ledger_l.begin (), ledger_l.end ());
-			std::reverse (ledger_l.begin (), ledger_l.end ());
-			paper::account_info info;
-			for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && accounts.size () < count; ++i)
+			else // Sorting
 			{
-				node.store.account_get (transaction, i->second, info);
-				paper::account account (i->second);
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
-				std::string balance;
-				(i->first).encode_dec (balance);
-				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
-				if (representative)
-				{
-					auto block (node.store.block_get (transaction, info.rep_block));
-					assert (block != nullptr);
-					response_l.put ("representative", block->representative ().to_account ());
-				}
-				if (weight)
+				// Every account is read to sort by balance so the listing is built in memory
+				boost::property_tree::ptree response_a;
+				boost::property_tree::ptree accounts;
+				paper::transaction transaction (node.store.environment, nullptr, false);
+				std::vector<std::pair<paper::uint128_union, paper::account>> ledger_l;
+				for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
 				{
-					auto account_weight (node.ledger.weight (transaction, account));
-					response_l.put ("weight", account_weight.convert_to<std::string> ());
+					paper::uint128_union balance (paper::account_info (i->second).balance);
+					ledger_l.push_back (std::make_pair (balance, paper::account (i->first.uint256 ())));
 				}
-				if (pending)
+				std::sort (ledger_l.begin (), ledger_l.end ());
+				std::reverse (ledger_l.begin (), ledger_l.end ());
+				paper::account_info info;
+				for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && accounts.size () < count; ++i)
 				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
-					response_l.put ("pending", account_pending.convert_to<std::string> ());
+					node.store.account_get (transaction, i->second, info);
+					boost::property_tree::ptree entry;
+					ledger_entry (node, transaction, i->second, info, representative, weight, pending, entry);
+					accounts.push_back (std::make_pair (i->second.to_account (), entry));
 				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
+				response_a.add_child ("accounts", accounts);
+				response (response_a);
 			}
 		}
-		response_a.add_child ("accounts", accounts);
-		response (response_a);
 	}
 	else
 	{
@@ -1964,6 +2232,37 @@ void paper::rpc_handler::mpaper_to_raw ()
 	}
 }
 
+namespace
+{
+boost::property_tree::ptree message_statistics_tree (paper::message_statistics & statistics_a)
+{
+	boost::property_tree::ptree result;
+	result.put ("keepalive", std::to_string (statistics_a.keepalive));
+	result.put ("publish", std::to_string (statistics_a.publish));
+	result.put ("confirm_req", std::to_string (statistics_a.confirm_req));
+	result.put ("confirm_ack", std::to_string (statistics_a.confirm_ack));
+	return result;
+}
+}
+
+void paper::rpc_handler::network_stats ()
+{
+	auto & network (node.network);
+	boost::property_tree::ptree response_l;
+	response_l.add_child ("incoming", message_statistics_tree (network.incoming));
+	response_l.add_child ("outgoing", message_statistics_tree (network.outgoing));
+	response_l.add_child ("receive_dropped", message_statistics_tree (network.receive_dropped));
+	response_l.add_child ("send_queued", message_statistics_tree (network.send_queued));
+	response_l.add_child ("send_bytes", message_statistics_tree (network.send_bytes));
+	response_l.add_child ("send_dropped", message_statistics_tree (network.send_dropped));
+	response_l.put ("kernel_dropped", std::to_string (network.kernel_dropped_count));
+	response_l.put ("ring_full", std::to_string (network.ring_full_count));
+	response_l.put ("insufficient_work", std::to_string (network.insufficient_work_count));
+	response_l.put ("error", std::to_string (network.error_count));
+	response_l.put ("bad_sender", std::to_string (network.bad_sender_count));
+	response (response_l);
+}
+
 void paper::rpc_handler::kpaper_from_raw ()
 {
 	std::string amount_text (request.get<std::string> ("amount"));
@@ -2014,13 +2313,13 @@ void paper::rpc_handler::password_change ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				paper::transaction transaction (node.store.environment, nullptr, true);
 				boost::property_tree::ptree response_l;
 				std::string password_text (request.get<std::string> ("password"));
-				auto error (existing->second->store.rekey (transaction, password_text));
+				auto error (existing->store.rekey (transaction, password_text));
 				response_l.put ("changed", error ? "0" : "1");
 				response (response_l);
 			}
@@ -2047,12 +2346,12 @@ void paper::rpc_handler::password_enter ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			boost::property_tree::ptree response_l;
 			std::string password_text (request.get<std::string> ("password"));
-			auto error (existing->second->enter_password (password_text));
+			auto error (existing->enter_password (password_text));
 			response_l.put ("valid", error ? "0" : "1");
 			response (response_l);
 		}
@@ -2074,12 +2373,12 @@ void paper::rpc_handler::password_valid (bool wallet_locked = false)
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			paper::transaction transaction (node.store.environment, nullptr, false);
 			boost::property_tree::ptree response_l;
-			auto valid (existing->second->store.valid_password (transaction));
+			auto valid (existing->store.valid_password (transaction));
 			if (!wallet_locked)
 			{
 				response_l.put ("valid", valid ? "1" : "0");
@@ -2230,11 +2529,11 @@ void paper::rpc_handler::payment_begin ()
 	paper::uint256_union id;
 	if (!id.decode_hex (id_text))
 	{
-		auto existing (node.wallets.items.find (id));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (id));
+		if (existing != nullptr)
 		{
 			paper::transaction transaction (node.store.environment, nullptr, true);
-			std::shared_ptr<paper::wallet> wallet (existing->second);
+			std::shared_ptr<paper::wallet> wallet (existing);
 			if (wallet->store.valid_password (transaction))
 			{
 				paper::account account (0);
@@ -2299,10 +2598,10 @@ void paper::rpc_handler::payment_init ()
 	if (!id.decode_hex (id_text))
 	{
 		paper::transaction transaction (node.store.environment, nullptr, true);
-		auto existing (node.wallets.items.find (id));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (id));
+		if (existing != nullptr)
 		{
-			auto wallet (existing->second);
+			auto wallet (existing);
 			if (wallet->store.valid_password (transaction))
 			{
 				wallet->init_free_accounts (transaction);
@@ -2338,10 +2637,10 @@ void paper::rpc_handler::payment_end ()
 	if (!id.decode_hex (id_text))
 	{
 		paper::transaction transaction (node.store.environment, nullptr, false);
-		auto existing (node.wallets.items.find (id));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (id));
+		if (existing != nullptr)
 		{
-			auto wallet (existing->second);
+			auto wallet (existing);
 			paper::account account;
 			if (!account.decode_account (account_text))
 			{
@@ -2562,8 +2861,8 @@ void paper::rpc_handler::receive ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				std::string account_text (request.get<std::string> ("account"));
 				paper::account account;
@@ -2571,8 +2870,8 @@ void paper::rpc_handler::receive ()
 				if (!error)
 				{
 					paper::transaction transaction (node.store.environment, nullptr, false);
-					auto account_check (existing->second->store.find (transaction, account));
-					if (account_check != existing->second->store.end ())
+					auto account_check (existing->store.find (transaction, account));
+					if (account_check != existing->store.end ())
 					{
 						std::string hash_text (request.get<std::string> ("block"));
 						paper::uint256_union hash;
@@ -2609,7 +2908,7 @@ void paper::rpc_handler::receive ()
 										if (!paper::work_validate (head, work))
 										{
 											paper::transaction transaction_a (node.store.environment, nullptr, true);
-											existing->second->store.work_put (transaction_a, account, work);
+											existing->store.work_put (transaction_a, account, work);
 										}
 										else
 										{
@@ -2617,7 +2916,7 @@ void paper::rpc_handler::receive ()
 										}
 									}
 									auto response_a (response);
-									existing->second->receive_async (std::move (block), account, paper::genesis_amount, [response_a](std::shared_ptr<paper::block> block_a) {
+									existing->receive_async (std::move (block), account, paper::genesis_amount, [response_a](std::shared_ptr<paper::block> block_a) {
 										paper::uint256_union hash_a (0);
 										if (block_a != nullptr)
 										{
@@ -2729,23 +3028,20 @@ void paper::rpc_handler::representatives ()
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree representatives;
 	paper::transaction transaction (node.store.environment, nullptr, false);
+	auto weights (node.store.representation_weights (transaction));
 	if (!sorting) // Simple
 	{
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n && representatives.size () < count; ++i)
+		for (auto i (weights.begin ()), n (weights.end ()); i != n && representatives.size () < count; ++i)
 		{
-			paper::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representatives.put (account.to_account (), amount.convert_to<std::string> ());
+			representatives.put (i->first.to_account (), i->second.convert_to<std::string> ());
 		}
 	}
 	else // Sorting
 	{
 		std::vector<std::pair<paper::uint128_union, std::string>> representation;
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n; ++i)
+		for (auto i (weights.begin ()), n (weights.end ()); i != n; ++i)
 		{
-			paper::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representation.push_back (std::make_pair (amount, account.to_account ()));
+			representation.push_back (std::make_pair (i->second, i->first.to_account ()));
 		}
 		std::sort (representation.begin (), representation.end ());
 		std::reverse (representation.begin (), representation.end ());
@@ -2892,10 +3188,10 @@ void paper::rpc_handler::search_pending ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
-				auto error (existing->second->search_pending ());
+				auto error (existing->search_pending ());
 				boost::property_tree::ptree response_l;
 				response_l.put ("started", !error);
 				response (response_l);
@@ -2936,8 +3232,8 @@ void paper::rpc_handler::send ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				std::string source_text (request.get<std::string> ("source"));
 				paper::account source;
@@ -2980,7 +3276,7 @@ void paper::rpc_handler::send ()
 								{
 									if (!paper::work_validate (info.head, work))
 									{
-										existing->second->store.work_put (transaction, source, work);
+										existing->store.work_put (transaction, source, work);
 									}
 									else
 									{
@@ -2993,7 +3289,7 @@ void paper::rpc_handler::send ()
 							{
 								auto rpc_l (shared_from_this ());
 								auto response_a (response);
-								existing->second->send_async (source, destination, amount.number (), [response_a](std::shared_ptr<paper::block> block_a) {
+								existing->send_async (source, destination, amount.number (), [response_a](std::shared_ptr<paper::block> block_a) {
 									if (block_a != nullptr)
 									{
 										paper::uint256_union hash (block_a->hash ());
@@ -3044,6 +3340,30 @@ void paper::rpc_handler::send ()
 	}
 }
 
+namespace
+{
+template <typename T>
+boost::property_tree::ptree store_cache_stats (paper::store_cache<T> & cache_a)
+{
+	boost::property_tree::ptree result;
+	result.put ("hits", std::to_string (cache_a.hits));
+	result.put ("misses", std::to_string (cache_a.misses));
+	result.put ("size", std::to_string (cache_a.size ()));
+	result.put ("max", std::to_string (cache_a.max));
+	return result;
+}
+}
+
+void paper::rpc_handler::store_cache ()
+{
+	boost::property_tree::ptree response_l;
+	response_l.add_child ("accounts", store_cache_stats (node.store.account_cache));
+	response_l.add_child ("blocks", store_cache_stats (node.store.block_cache));
+	response_l.add_child ("pending", store_cache_stats (node.store.pending_cache));
+	response_l.add_child ("blocks_info", store_cache_stats (node.store.block_info_cache));
+	response (response_l);
+}
+
 void paper::rpc_handler::stop ()
 {
 	if (rpc.config.enable_control)
@@ -3060,31 +3380,53 @@ void paper::rpc_handler::stop ()
 	}
 }
 
+namespace
+{
+/** Unchecked blocks in the order they're keyed, by dependency then hash */
+class unchecked_source : public paper::rpc_body_source
+{
+public:
+	unchecked_source (paper::node & node_a, uint64_t count_a) :
+	rpc_body_source ("blocks", count_a),
+	node (node_a.shared ()),
+	next_key (0, 0)
+	{
+	}
+	bool fill (std::vector<std::pair<std::string, boost::property_tree::ptree>> & entries_a, size_t max_a) override
+	{
+		paper::transaction transaction (node->store.environment, nullptr, false);
+		paper::store_iterator i (transaction, node->store.unchecked, next_key.val ());
+		for (auto n (node->store.unchecked_end ()); i != n && entries_a.size () < max_a; ++i)
+		{
+			paper::unchecked_info info (i->second);
+			std::string contents;
+			info.block->serialize_json (contents);
+			entries_a.push_back (std::make_pair (info.block->hash ().to_string (), boost::property_tree::ptree (contents)));
+		}
+		auto done (i == node->store.unchecked_end ());
+		if (!done)
+		{
+			next_key = paper::unchecked_key (i->first);
+		}
+		return done;
+	}
+	std::shared_ptr<paper::node> node;
+	paper::unchecked_key next_key;
+};
+}
+
 void paper::rpc_handler::unchecked ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
-	if (count_text.is_initialized ())
+	if (count_text.is_initialized () && decode_unsigned (count_text.get (), count))
 	{
-		auto error (decode_unsigned (count_text.get (), count));
-		if (error)
-		{
-			error_response (response, "Invalid count limit");
-		}
+		error_response (response, "Invalid count limit");
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree unchecked;
-	paper::transaction transaction (node.store.environment, nullptr, false);
-	for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
+	else
 	{
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (paper::deserialize_block (stream));
-		std::string contents;
-		block->serialize_json (contents);
-		unchecked.put (block->hash ().to_string (), contents);
+		stream_response (std::make_shared<unchecked_source> (node, count));
 	}
-	response_l.add_child ("blocks", unchecked);
-	response (response_l);
 }
 
 void paper::rpc_handler::unchecked_clear ()
@@ -3114,12 +3456,11 @@ void paper::rpc_handler::unchecked_get ()
 		paper::transaction transaction (node.store.environment, nullptr, false);
 		for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n; ++i)
 		{
-			paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto block (paper::deserialize_block (stream));
-			if (block->hash () == hash)
+			if (paper::unchecked_key (i->first).hash == hash)
 			{
+				paper::unchecked_info info (i->second);
 				std::string contents;
-				block->serialize_json (contents);
+				info.block->serialize_json (contents);
 				response_l.put ("contents", contents);
 				break;
 			}
@@ -3167,12 +3508,12 @@ void paper::rpc_handler::unchecked_keys ()
 	for (auto i (node.store.unchecked_begin (transaction, key)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
 	{
 		boost::property_tree::ptree entry;
-		paper::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (paper::deserialize_block (stream));
+		paper::unchecked_key unchecked_key (i->first);
+		paper::unchecked_info info (i->second);
 		std::string contents;
-		block->serialize_json (contents);
-		entry.put ("key", paper::block_hash (i->first.uint256 ()).to_string ());
-		entry.put ("hash", block->hash ().to_string ());
+		info.block->serialize_json (contents);
+		entry.put ("key", unchecked_key.dependency.to_string ());
+		entry.put ("hash", unchecked_key.hash.to_string ());
 		entry.put ("contents", contents);
 		unchecked.push_back (std::make_pair ("", entry));
 	}
@@ -3199,6 +3540,24 @@ void paper::rpc_handler::validate_account_number ()
 	response (response_l);
 }
 
+void paper::rpc_handler::wallet_action_stats ()
+{
+	boost::property_tree::ptree response_l;
+	{
+		std::lock_guard<std::mutex> lock (node.wallets.mutex);
+		response_l.put ("queued", std::to_string (node.wallets.queued));
+		response_l.put ("running", std::to_string (node.wallets.running));
+		response_l.put ("accounts", std::to_string (node.wallets.actions.size ()));
+		response_l.put ("completed", std::to_string (node.wallets.completed));
+		auto wait_average (node.wallets.completed == 0 ? 0 : node.wallets.wait_total.count () / node.wallets.completed);
+		response_l.put ("wait_average", std::to_string (wait_average / 1000));
+		response_l.put ("wait_max", std::to_string (node.wallets.wait_max.count () / 1000));
+	}
+	response_l.put ("work_cached", std::to_string (node.wallets.work_cached));
+	response_l.put ("work_waited", std::to_string (node.wallets.work_waited));
+	response (response_l);
+}
+
 void paper::rpc_handler::wallet_add ()
 {
 	if (rpc.config.enable_control)
@@ -3213,8 +3572,8 @@ void paper::rpc_handler::wallet_add ()
 			auto error (wallet.decode_hex (wallet_text));
 			if (!error)
 			{
-				auto existing (node.wallets.items.find (wallet));
-				if (existing != node.wallets.items.end ())
+				auto existing (node.wallets.open (wallet));
+				if (existing != nullptr)
 				{
 					bool generate_work (true);
 					boost::optional<bool> work (request.get_optional<bool> ("work"));
@@ -3222,7 +3581,7 @@ void paper::rpc_handler::wallet_add ()
 					{
 						generate_work = work.get ();
 					}
-					auto pub (existing->second->insert_adhoc (key, generate_work));
+					auto pub (existing->insert_adhoc (key, generate_work));
 					if (!pub.is_zero ())
 					{
 						boost::property_tree::ptree response_l;
@@ -3262,13 +3621,13 @@ void paper::rpc_handler::wallet_balance_total ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			paper::uint128_t balance (0);
 			paper::uint128_t pending (0);
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+			for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 			{
 				paper::account account (i->first.uint256 ());
 				balance = balance + node.ledger.account_balance (transaction, account);
@@ -3307,13 +3666,13 @@ void paper::rpc_handler::wallet_balances ()
 				error_response (response, "Bad threshold number");
 			}
 		}
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree balances;
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+			for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 			{
 				paper::account account (i->first.uint256 ());
 				paper::uint128_t balance = node.ledger.account_balance (transaction, account);
@@ -3365,13 +3724,13 @@ void paper::rpc_handler::wallet_change_seed ()
 			auto error (wallet.decode_hex (wallet_text));
 			if (!error)
 			{
-				auto existing (node.wallets.items.find (wallet));
-				if (existing != node.wallets.items.end ())
+				auto existing (node.wallets.open (wallet));
+				if (existing != nullptr)
 				{
 					paper::transaction transaction (node.store.environment, nullptr, true);
-					if (existing->second->store.valid_password (transaction))
+					if (existing->store.valid_password (transaction))
 					{
-						existing->second->store.seed_set (transaction, seed);
+						existing->store.seed_set (transaction, seed);
 						boost::property_tree::ptree response_l;
 						response_l.put ("success", "");
 						response (response_l);
@@ -3414,11 +3773,11 @@ void paper::rpc_handler::wallet_contains ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				paper::transaction transaction (node.store.environment, nullptr, false);
-				auto exists (existing->second->store.find (transaction, account) != existing->second->store.end ());
+				auto exists (existing->store.find (transaction, account) != existing->store.end ());
 				boost::property_tree::ptree response_l;
 				response_l.put ("exists", exists ? "1" : "0");
 				response (response_l);
@@ -3446,8 +3805,8 @@ void paper::rpc_handler::wallet_create ()
 		paper::keypair wallet_id;
 		node.wallets.create (wallet_id.pub);
 		paper::transaction transaction (node.store.environment, nullptr, false);
-		auto existing (node.wallets.items.find (wallet_id.pub));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet_id.pub));
+		if (existing != nullptr)
 		{
 			boost::property_tree::ptree response_l;
 			response_l.put ("wallet", wallet_id.pub.to_string ());
@@ -3473,8 +3832,8 @@ void paper::rpc_handler::wallet_destroy ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				node.wallets.destroy (wallet);
 				boost::property_tree::ptree response_l;
@@ -3503,12 +3862,12 @@ void paper::rpc_handler::wallet_export ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			paper::transaction transaction (node.store.environment, nullptr, false);
 			std::string json;
-			existing->second->store.serialize_json (transaction, json);
+			existing->store.serialize_json (transaction, json);
 			boost::property_tree::ptree response_l;
 			response_l.put ("json", json);
 			response (response_l);
@@ -3531,13 +3890,13 @@ void paper::rpc_handler::wallet_frontiers ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree frontiers;
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+			for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 			{
 				paper::account account (i->first.uint256 ());
 				auto latest (node.ledger.latest (transaction, account));
@@ -3567,11 +3926,11 @@ void paper::rpc_handler::wallet_key_valid ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			auto valid (existing->second->store.valid_password (transaction));
+			auto valid (existing->store.valid_password (transaction));
 			boost::property_tree::ptree response_l;
 			response_l.put ("valid", valid ? "1" : "0");
 			response (response_l);
@@ -3596,13 +3955,13 @@ void paper::rpc_handler::wallet_lock ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				boost::property_tree::ptree response_l;
 				paper::raw_key empty;
 				empty.data.clear ();
-				existing->second->store.password.value_set (empty);
+				existing->store.password.value_set (empty);
 				response_l.put ("locked", "1");
 				response (response_l);
 			}
@@ -3629,8 +3988,8 @@ void paper::rpc_handler::wallet_pending ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			uint64_t count (std::numeric_limits<uint64_t>::max ());
 			paper::uint128_union threshold (0);
@@ -3661,7 +4020,7 @@ void paper::rpc_handler::wallet_pending ()
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree pending;
 			paper::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+			for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 			{
 				paper::account account (i->first.uint256 ());
 				boost::property_tree::ptree peers_l;
@@ -3720,12 +4079,12 @@ void paper::rpc_handler::wallet_representative ()
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
-		auto existing (node.wallets.items.find (wallet));
-		if (existing != node.wallets.items.end ())
+		auto existing (node.wallets.open (wallet));
+		if (existing != nullptr)
 		{
 			paper::transaction transaction (node.store.environment, nullptr, false);
 			boost::property_tree::ptree response_l;
-			response_l.put ("representative", existing->second->store.representative (transaction).to_account ());
+			response_l.put ("representative", existing->store.representative (transaction).to_account ());
 			response (response_l);
 		}
 		else
@@ -3748,8 +4107,8 @@ void paper::rpc_handler::wallet_representative_set ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				std::string representative_text (request.get<std::string> ("representative"));
 				paper::account representative;
@@ -3757,7 +4116,7 @@ void paper::rpc_handler::wallet_representative_set ()
 				if (!error)
 				{
 					paper::transaction transaction (node.store.environment, nullptr, true);
-					existing->second->store.representative_set (transaction, representative);
+					existing->store.representative_set (transaction, representative);
 					boost::property_tree::ptree response_l;
 					response_l.put ("set", "1");
 					response (response_l);
@@ -3792,8 +4151,8 @@ void paper::rpc_handler::wallet_republish ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				uint64_t count;
 				std::string count_text (request.get<std::string> ("count"));
@@ -3803,7 +4162,7 @@ void paper::rpc_handler::wallet_republish ()
 					boost::property_tree::ptree response_l;
 					boost::property_tree::ptree blocks;
 					paper::transaction transaction (node.store.environment, nullptr, false);
-					for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+					for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 					{
 						paper::account account (i->first.uint256 ());
 						auto latest (node.ledger.latest (transaction, account));
@@ -3859,17 +4218,17 @@ void paper::rpc_handler::wallet_work_get ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				boost::property_tree::ptree response_l;
 				boost::property_tree::ptree works;
 				paper::transaction transaction (node.store.environment, nullptr, false);
-				for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
+				for (auto i (existing->store.begin (transaction)), n (existing->store.end ()); i != n; ++i)
 				{
 					paper::account account (i->first.uint256 ());
 					uint64_t work (0);
-					auto error_work (existing->second->store.work_get (transaction, account, work));
+					auto error_work (existing->store.work_get (transaction, account, work));
 					works.put (account.to_account (), paper::to_string_hex (work));
 				}
 				response_l.add_child ("works", works);
@@ -3958,8 +4317,8 @@ void paper::rpc_handler::work_get ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				std::string account_text (request.get<std::string> ("account"));
 				paper::account account;
@@ -3967,11 +4326,11 @@ void paper::rpc_handler::work_get ()
 				if (!error)
 				{
 					paper::transaction transaction (node.store.environment, nullptr, false);
-					auto account_check (existing->second->store.find (transaction, account));
-					if (account_check != existing->second->store.end ())
+					auto account_check (existing->store.find (transaction, account));
+					if (account_check != existing->store.end ())
 					{
 						uint64_t work (0);
-						auto error_work (existing->second->store.work_get (transaction, account, work));
+						auto error_work (existing->store.work_get (transaction, account, work));
 						boost::property_tree::ptree response_l;
 						response_l.put ("work", paper::to_string_hex (work));
 						response (response_l);
@@ -4011,8 +4370,8 @@ void paper::rpc_handler::work_set ()
 		auto error (wallet.decode_hex (wallet_text));
 		if (!error)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
+			auto existing (node.wallets.open (wallet));
+			if (existing != nullptr)
 			{
 				std::string account_text (request.get<std::string> ("account"));
 				paper::account account;
@@ -4020,15 +4379,15 @@ void paper::rpc_handler::work_set ()
 				if (!error)
 				{
 					paper::transaction transaction (node.store.environment, nullptr, true);
-					auto account_check (existing->second->store.find (transaction, account));
-					if (account_check != existing->second->store.end ())
+					auto account_check (existing->store.find (transaction, account));
+					if (account_check != existing->store.end ())
 					{
 						std::string work_text (request.get<std::string> ("work"));
 						uint64_t work;
 						auto work_error (paper::from_string_hex (work_text, work));
 						if (!work_error)
 						{
-							existing->second->store.work_put (transaction, account, work);
+							existing->store.work_put (transaction, account, work);
 							boost::property_tree::ptree response_l;
 							response_l.put ("success", "");
 							response (response_l);
@@ -4162,11 +4521,82 @@ void paper::rpc_handler::work_peers_clear ()
 	}
 }
 
+paper::rpc_body_source::rpc_body_source (std::string const & name_a, uint64_t count_a) :
+name (name_a),
+count (count_a),
+first (true)
+{
+}
+
+paper::rpc_body_source::~rpc_body_source ()
+{
+	if (finished)
+	{
+		finished ();
+	}
+}
+
+bool paper::rpc_body_source::next (std::string & chunk_a)
+{
+	std::vector<std::pair<std::string, boost::property_tree::ptree>> entries;
+	auto done (count == 0 || fill (entries, std::min<uint64_t> (count, batch_size)));
+	count -= std::min<uint64_t> (count, entries.size ());
+	for (auto & i : entries)
+	{
+		// Written as a single entry object so keys and values are escaped, then unwrapped in to the listing
+		boost::property_tree::ptree entry;
+		entry.push_back (i);
+		std::stringstream stream;
+		boost::property_tree::write_json (stream, entry, false);
+		auto text (stream.str ());
+		assert (text.size () >= 3 && text.front () == '{');
+		// The listing is opened with its first entry
+		chunk_a += first ? "{\"" + name + "\":{" : ",";
+		first = false;
+		chunk_a.append (text, 1, text.size () - 3);
+	}
+	done = done || count == 0;
+	if (done)
+	{
+		// write_json writes an empty listing as an empty string, not an empty object
+		chunk_a += first ? "{\"" + name + "\":\"\"}\n" : "}}\n";
+	}
+	return done;
+}
+
 paper::rpc_connection::rpc_connection (paper::node & node_a, paper::rpc & rpc_a) :
 node (node_a.shared ()),
 rpc (rpc_a),
-socket (node_a.service)
+socket (node_a.service),
+timeout (node_a.service)
+{
+}
+
+std::string paper::rpc_connection::log_prefix () const
+{
+	return "";
+}
+
+void paper::rpc_connection::start_timeout ()
+{
+	timeout.expires_from_now (boost::posix_time::seconds (rpc.config.keepalive_timeout));
+	std::weak_ptr<paper::rpc_connection> this_w (shared_from_this ());
+	timeout.async_wait ([this_w](boost::system::error_code const & ec) {
+		if (ec != boost::asio::error::operation_aborted)
+		{
+			auto this_l (this_w.lock ());
+			if (this_l != nullptr)
+			{
+				boost::system::error_code ignored;
+				this_l->socket.close (ignored);
+			}
+		}
+	});
+}
+
+void paper::rpc_connection::stop_timeout ()
 {
+	timeout.cancel ();
 }
 
 void paper::rpc_connection::parse_connection ()
@@ -4179,54 +4609,145 @@ void paper::rpc_connection::write_result (std::string body, unsigned version)
 	res.set ("Content-Type", "application/json");
 	res.set ("Access-Control-Allow-Origin", "*");
 	res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
-	res.set ("Connection", "close");
 	res.result (boost::beast::http::status::ok);
 	res.body () = body;
 	res.version (version);
+	res.keep_alive (request.keep_alive ());
 	res.prepare_payload ();
 }
 
 void paper::rpc_connection::read ()
 {
 	auto this_l (shared_from_this ());
+	start_timeout ();
 	boost::beast::http::async_read (socket, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->stop_timeout ();
 		if (!ec)
 		{
-			this_l->node->background ([this_l]() {
-				auto start (std::chrono::steady_clock::now ());
-				auto version (this_l->request.version ());
-				auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-					});
-
-					if (this_l->node->config.logging.log_rpc ())
-					{
-						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
-					}
-				});
-				if (this_l->request.method () == boost::beast::http::verb::post)
-				{
-					auto handler (std::make_shared<paper::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
-					handler->process_request ();
-				}
-				else
-				{
-					error_response (response_handler, "Can only POST requests");
-				}
+			this_l->rpc.service.post ([this_l]() {
+				this_l->process ();
 			});
 		}
-		else
+		else if (ec != boost::beast::http::error::end_of_stream && ec != boost::asio::error::operation_aborted)
 		{
 			BOOST_LOG (this_l->node->log) << "RPC read error: " << ec.message ();
 		}
 	});
 }
 
+void paper::rpc_connection::write ()
+{
+	auto this_l (shared_from_this ());
+	boost::beast::http::async_write (socket, res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec && this_l->res.keep_alive ())
+		{
+			// Requests pipelined by the client are already in the buffer and are answered in order
+			this_l->reset ();
+			this_l->read ();
+		}
+	});
+}
+
+void paper::rpc_connection::write_stream_result (std::shared_ptr<paper::rpc_body_source> source_a, unsigned version)
+{
+	source = source_a;
+	stream_res.set ("Content-Type", "application/json");
+	stream_res.set ("Access-Control-Allow-Origin", "*");
+	stream_res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+	stream_res.result (boost::beast::http::status::ok);
+	stream_res.version (version);
+	stream_res.keep_alive (request.keep_alive ());
+	stream_res.chunked (true);
+	serializer.reset (new boost::beast::http::response_serializer<boost::beast::http::buffer_body> (stream_res));
+	write_stream ();
+}
+
+void paper::rpc_connection::write_stream ()
+{
+	auto this_l (shared_from_this ());
+	rpc.service.post ([this_l]() {
+		this_l->chunk.clear ();
+		auto done (this_l->source->next (this_l->chunk));
+		auto & body (this_l->stream_res.body ());
+		body.data = this_l->chunk.empty () ? nullptr : &this_l->chunk[0];
+		body.size = this_l->chunk.size ();
+		body.more = !done;
+		this_l->write_chunk ();
+	});
+}
+
+void paper::rpc_connection::write_chunk ()
+{
+	auto this_l (shared_from_this ());
+	boost::beast::http::async_write (socket, *serializer, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->chunk_written (ec);
+	});
+}
+
+void paper::rpc_connection::chunk_written (boost::system::error_code const & ec)
+{
+	if (ec == boost::beast::http::error::need_buffer)
+	{
+		// The chunk was sent and the serializer is waiting on the next one
+		write_stream ();
+	}
+	else if (!ec && stream_res.keep_alive ())
+	{
+		reset ();
+		read ();
+	}
+	else
+	{
+		source.reset ();
+	}
+}
+
+void paper::rpc_connection::reset ()
+{
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	res = boost::beast::http::response<boost::beast::http::string_body> ();
+	serializer.reset ();
+	stream_res = boost::beast::http::response<boost::beast::http::buffer_body> ();
+	source.reset ();
+	chunk.clear ();
+}
+
+void paper::rpc_connection::process ()
+{
+	auto this_l (shared_from_this ());
+	auto start (std::chrono::steady_clock::now ());
+	auto version (request.version ());
+	auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
+		std::stringstream ostream;
+		boost::property_tree::write_json (ostream, tree_a);
+		ostream.flush ();
+		auto body (ostream.str ());
+		this_l->write_result (body, version);
+		this_l->write ();
+
+		if (this_l->node->config.logging.log_rpc ())
+		{
+			BOOST_LOG (this_l->node->log) << boost::str (boost::format ("%3%RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())) % this_l->log_prefix ());
+		}
+	});
+	if (request.method () == boost::beast::http::verb::post)
+	{
+		auto handler (std::make_shared<paper::rpc_handler> (*node, rpc, request.body (), response_handler));
+		handler->stream_response = [this_l, version, start](std::shared_ptr<paper::rpc_body_source> source_a) {
+			this_l->write_stream_result (source_a, version);
+			if (this_l->node->config.logging.log_rpc ())
+			{
+				BOOST_LOG (this_l->node->log) << boost::str (boost::format ("%3%RPC request %2% started streaming in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())) % this_l->log_prefix ());
+			}
+		};
+		handler->process_request ();
+	}
+	else
+	{
+		error_response (response_handler, "Can only POST requests");
+	}
+}
+
 namespace
 {
 void reprocess_body (std::string & body, boost::property_tree::ptree & tree_a)
@@ -4266,6 +4787,100 @@ void paper::rpc_handler::process_request ()
 		{
 			BOOST_LOG (node.log) << body;
 		}
+		if (rpc.limiter.limited (action))
+		{
+			// Release the action's slot once the response has been handed off, which may be asynchronous
+			auto response_l (response);
+			auto & limiter (rpc.limiter);
+			response = [response_l, &limiter, action](boost::property_tree::ptree const & tree_a) {
+				response_l (tree_a);
+				limiter.finished (action);
+			};
+			if (stream_response)
+			{
+				// Streamed bodies are still being read while they're sent, the slot is held until they're done
+				auto stream_response_l (stream_response);
+				stream_response = [stream_response_l, &limiter, action](std::shared_ptr<paper::rpc_body_source> source_a) {
+					source_a->finished = [&limiter, action]() {
+						limiter.finished (action);
+					};
+					stream_response_l (source_a);
+				};
+			}
+			auto this_l (shared_from_this ());
+			limiter.run (action, [this_l, action]() {
+				this_l->process_action (action);
+			});
+		}
+		else
+		{
+			process_action (action);
+		}
+	}
+	catch (std::runtime_error const & err)
+	{
+		error_response (response, "Unable to parse JSON");
+	}
+	catch (...)
+	{
+		error_response (response, "Internal server error in RPC");
+	}
+}
+
+namespace
+{
+/** Holds back a response given while an action is still running until the action returns */
+class deferred_response
+{
+public:
+	deferred_response (std::function<void(boost::property_tree::ptree const &)> const & response_a) :
+	response (response_a),
+	held (true),
+	responded (false)
+	{
+	}
+	void respond (boost::property_tree::ptree const & tree_a)
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		if (held)
+		{
+			tree = tree_a;
+			responded = true;
+		}
+		else
+		{
+			lock.unlock ();
+			response (tree_a);
+		}
+	}
+	void release ()
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		held = false;
+		if (responded)
+		{
+			lock.unlock ();
+			response (tree);
+		}
+	}
+	std::mutex mutex;
+	std::function<void(boost::property_tree::ptree const &)> response;
+	boost::property_tree::ptree tree;
+	bool held;
+	bool responded;
+};
+}
+
+void paper::rpc_handler::process_action (std::string const & action)
+{
+	// Handlers usually respond while their write transaction is still open, replying once the action
+	// has returned makes sure the client can't observe state from before the commit.
+	auto deferred (std::make_shared<deferred_response> (response));
+	response = [deferred](boost::property_tree::ptree const & tree_a) {
+		deferred->respond (tree_a);
+	};
+	try
+	{
 		if (action == "account_balance")
 		{
 			account_balance ();
@@ -4274,6 +4889,10 @@ void paper::rpc_handler::process_request ()
 		{
 			account_block_count ();
 		}
+		else if (action == "account_block_at_height")
+		{
+			account_block_at_height ();
+		}
 		else if (action == "account_create")
 		{
 			account_create ();
@@ -4366,6 +4985,10 @@ void paper::rpc_handler::process_request ()
 		{
 			block_create ();
 		}
+		else if (action == "block_processor_stats")
+		{
+			block_processor_stats ();
+		}
 		else if (action == "successors")
 		{
 			successors ();
@@ -4378,6 +5001,14 @@ void paper::rpc_handler::process_request ()
 		{
 			bootstrap_any ();
 		}
+		else if (action == "bootstrap_status")
+		{
+			bootstrap_status ();
+		}
+		else if (action == "callback_stats")
+		{
+			callback_stats ();
+		}
 		else if (action == "chain")
 		{
 			chain ();
@@ -4438,6 +5069,10 @@ void paper::rpc_handler::process_request ()
 		{
 			mpaper_to_raw ();
 		}
+		else if (action == "network_stats")
+		{
+			network_stats ();
+		}
 		else if (action == "password_change")
 		{
 			// Processed before logging
@@ -4526,6 +5161,10 @@ void paper::rpc_handler::process_request ()
 		{
 			stop ();
 		}
+		else if (action == "store_cache")
+		{
+			store_cache ();
+		}
 		else if (action == "unchecked")
 		{
 			unchecked ();
@@ -4550,6 +5189,10 @@ void paper::rpc_handler::process_request ()
 		{
 			version ();
 		}
+		else if (action == "wallet_action_stats")
+		{
+			wallet_action_stats ();
+		}
 		else if (action == "wallet_add")
 		{
 			wallet_add ();
@@ -4667,6 +5310,7 @@ void paper::rpc_handler::process_request ()
 	{
 		error_response (response, "Internal server error in RPC");
 	}
+	deferred->release ();
 }
 
 paper::payment_observer::payment_observer (std::function<void(boost::property_tree::ptree const &)> const & response_a, paper::rpc & rpc_a, paper::account const & account_a, paper::amount const & amount_a) :
@@ -5,6 +5,7 @@
 #include <boost/beast.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <deque>
 #include <paper/node/utility.hpp>
 #include <unordered_map>
 
@@ -12,6 +13,7 @@ namespace paper
 {
 void error_response (std::function<void(boost::property_tree::ptree const &)> response_a, std::string const & message_a);
 class node;
+class thread_runner;
 /** Configuration options for RPC TLS */
 class rpc_secure_config
 {
@@ -47,6 +49,12 @@ public:
 	bool enable_control;
 	uint64_t frontier_request_limit;
 	uint64_t chain_request_limit;
+	/** Number of threads running request handlers, separate from the node's I/O threads */
+	unsigned threads;
+	/** Maximum number of requests for a given action handled at once, further requests wait their turn */
+	std::unordered_map<std::string, unsigned> action_limits;
+	/** Seconds a connection may wait for its next request before it's closed */
+	unsigned keepalive_timeout;
 	rpc_secure_config secure;
 };
 enum class payment_status
@@ -61,22 +69,65 @@ enum class payment_status
 };
 class wallet;
 class payment_observer;
+/** Queues requests for an action once its configured number of concurrent requests is reached */
+class rpc_action_limiter
+{
+public:
+	rpc_action_limiter (boost::asio::io_service &, std::unordered_map<std::string, unsigned> const &);
+	bool limited (std::string const &) const;
+	void run (std::string const &, std::function<void()> const &);
+	void finished (std::string const &);
+	size_t pending_size (std::string const &);
+	boost::asio::io_service & service;
+	std::unordered_map<std::string, unsigned> const limits;
+	std::mutex mutex;
+	std::unordered_map<std::string, unsigned> running;
+	std::unordered_map<std::string, std::deque<std::function<void()>>> pending;
+};
 class rpc
 {
 public:
 	rpc (boost::asio::io_service &, paper::node &, paper::rpc_config const &);
+	virtual ~rpc ();
 	void start ();
 	virtual void accept ();
 	void stop ();
 	void observer_action (paper::account const &);
+	/** Runs request handlers so heavy queries don't occupy the node's I/O threads */
+	boost::asio::io_service service;
+	std::unique_ptr<boost::asio::io_service::work> service_work;
+	std::unique_ptr<paper::thread_runner> runner;
 	boost::asio::ip::tcp::acceptor acceptor;
 	std::mutex mutex;
 	std::unordered_map<paper::account, std::shared_ptr<paper::payment_observer>> payment_observers;
 	paper::rpc_config config;
+	paper::rpc_action_limiter limiter;
 	paper::node & node;
 	bool on;
 	static uint16_t const rpc_port = paper::paper_network == paper::paper_networks::paper_live_network ? 7076 : 55000;
 };
+/**
+ * Produces a response of the form {"name": {"key": value, ...}} a batch of entries at a time, or {"name": ""} if there are none.
+ * Each batch is read under its own transaction so long listings are neither built in memory
+ * nor hold a read transaction open while the client is slow to read.
+ */
+class rpc_body_source
+{
+public:
+	rpc_body_source (std::string const &, uint64_t);
+	virtual ~rpc_body_source ();
+	/** Appends the next piece of the body, returns true once the body is complete */
+	bool next (std::string &);
+	/** Reads up to max entries continuing from the last batch, returns true once there are none left */
+	virtual bool fill (std::vector<std::pair<std::string, boost::property_tree::ptree>> &, size_t) = 0;
+	/** Called once the body has been sent or abandoned */
+	std::function<void()> finished;
+	std::string name;
+	uint64_t count;
+	// No entry has been written yet, so the listing hasn't been opened
+	bool first;
+	static size_t constexpr batch_size = 1024;
+};
 class rpc_connection : public std::enable_shared_from_this<paper::rpc_connection>
 {
 public:
@@ -84,12 +135,32 @@ public:
 	virtual void parse_connection ();
 	virtual void read ();
 	virtual void write_result (std::string body, unsigned version);
+	virtual void write ();
+	/** Sends the response headers and then the body as chunks produced by source */
+	void write_stream_result (std::shared_ptr<paper::rpc_body_source>, unsigned version);
+	/** Produces the next chunk on the RPC threads and writes it */
+	void write_stream ();
+	/** Writes the chunk in stream_res, or the headers along with the first chunk */
+	virtual void write_chunk ();
+	void chunk_written (boost::system::error_code const &);
+	/** Prefix telling plain and TLS connections apart in the log */
+	virtual std::string log_prefix () const;
+	void process ();
+	void reset ();
+	/** Closes the connection if the next request doesn't arrive in time */
+	void start_timeout ();
+	void stop_timeout ();
 	std::shared_ptr<paper::node> node;
 	paper::rpc & rpc;
 	boost::asio::ip::tcp::socket socket;
+	boost::asio::deadline_timer timeout;
 	boost::beast::flat_buffer buffer;
 	boost::beast::http::request<boost::beast::http::string_body> request;
 	boost::beast::http::response<boost::beast::http::string_body> res;
+	boost::beast::http::response<boost::beast::http::buffer_body> stream_res;
+	std::unique_ptr<boost::beast::http::response_serializer<boost::beast::http::buffer_body>> serializer;
+	std::shared_ptr<paper::rpc_body_source> source;
+	std::string chunk;
 };
 class payment_observer : public std::enable_shared_from_this<paper::payment_observer>
 {
@@ -113,8 +184,10 @@ class rpc_handler : public std::enable_shared_from_this<paper::rpc_handler>
 public:
 	rpc_handler (paper::node &, paper::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &);
 	void process_request ();
+	void process_action (std::string const &);
 	void account_balance ();
 	void account_block_count ();
+	void account_block_at_height ();
 	void account_create ();
 	void account_get ();
 	void account_history ();
@@ -138,8 +211,11 @@ public:
 	void block_count ();
 	void block_count_type ();
 	void block_create ();
+	void block_processor_stats ();
 	void bootstrap ();
 	void bootstrap_any ();
+	void bootstrap_status ();
+	void callback_stats ();
 	void chain ();
 	void delegators ();
 	void delegators_count ();
@@ -155,6 +231,7 @@ public:
 	void ledger ();
 	void mpaper_to_raw ();
 	void mpaper_from_raw ();
+	void network_stats ();
 	void password_change ();
 	void password_enter ();
 	void password_valid (bool wallet_locked);
@@ -177,6 +254,7 @@ public:
 	void search_pending_all ();
 	void send ();
 	void stop ();
+	void store_cache ();
 	void successors ();
 	void unchecked ();
 	void unchecked_clear ();
@@ -184,6 +262,7 @@ public:
 	void unchecked_keys ();
 	void validate_account_number ();
 	void version ();
+	void wallet_action_stats ();
 	void wallet_add ();
 	void wallet_balance_total ();
 	void wallet_balances ();
@@ -213,6 +292,8 @@ public:
 	paper::rpc & rpc;
 	boost::property_tree::ptree request;
 	std::function<void(boost::property_tree::ptree const &)> response;
+	/** Sends a listing's body in chunks, used in place of response by actions that can return the whole ledger */
+	std::function<void(std::shared_ptr<paper::rpc_body_source>)> stream_response;
 };
 /** Returns the correct RPC implementation based on TLS configuration */
 std::unique_ptr<paper::rpc> get_rpc (boost::asio::io_service & service_a, paper::node & node_a, paper::rpc_config const & config_a);
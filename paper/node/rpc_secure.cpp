@@ -125,9 +125,14 @@ void paper::rpc_connection_secure::parse_connection ()
 	std::placeholders::_1));
 }
 
+std::string paper::rpc_connection_secure::log_prefix () const
+{
+	return "TLS: ";
+}
+
 void paper::rpc_connection_secure::on_shutdown (const boost::system::error_code & error)
 {
-	// No-op. We initiate the shutdown (since the RPC server kills the connection after each request)
+	// No-op. We initiate the shutdown (once a request without keep-alive has been answered)
 	// and we'll thus get an expected EOF error. If the client disconnects, a short-read error will be expected.
 }
 
@@ -146,49 +151,59 @@ void paper::rpc_connection_secure::handle_handshake (const boost::system::error_
 void paper::rpc_connection_secure::read ()
 {
 	auto this_l (std::static_pointer_cast<paper::rpc_connection_secure> (shared_from_this ()));
+	start_timeout ();
 	boost::beast::http::async_read (stream, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->stop_timeout ();
 		if (!ec)
 		{
-			this_l->node->background ([this_l]() {
-				auto start (std::chrono::steady_clock::now ());
-				auto version (this_l->request.version ());
-				auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->stream, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-
-						// Perform the SSL shutdown
-						this_l->stream.async_shutdown (
-						std::bind (
-						&paper::rpc_connection_secure::on_shutdown,
-						this_l,
-						std::placeholders::_1));
-
-					});
-
-					if (this_l->node->config.logging.log_rpc ())
-					{
-						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("TLS: RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
-					}
-				});
-
-				if (this_l->request.method () == boost::beast::http::verb::post)
-				{
-					auto handler (std::make_shared<paper::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
-					handler->process_request ();
-				}
-				else
-				{
-					error_response (response_handler, "Can only POST requests");
-				}
+			this_l->rpc.service.post ([this_l]() {
+				this_l->process ();
 			});
 		}
-		else
+		else if (ec != boost::beast::http::error::end_of_stream && ec != boost::asio::error::operation_aborted)
 		{
 			BOOST_LOG (this_l->node->log) << "TLS: Read error: " << ec.message () << std::endl;
 		}
 	});
 }
+
+void paper::rpc_connection_secure::write ()
+{
+	auto this_l (std::static_pointer_cast<paper::rpc_connection_secure> (shared_from_this ()));
+	boost::beast::http::async_write (stream, res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec && this_l->res.keep_alive ())
+		{
+			this_l->reset ();
+			this_l->read ();
+		}
+		else
+		{
+			// Perform the SSL shutdown
+			this_l->stream.async_shutdown (
+			std::bind (
+			&paper::rpc_connection_secure::on_shutdown,
+			this_l,
+			std::placeholders::_1));
+		}
+	});
+}
+
+void paper::rpc_connection_secure::write_chunk ()
+{
+	auto this_l (std::static_pointer_cast<paper::rpc_connection_secure> (shared_from_this ()));
+	boost::beast::http::async_write (stream, *serializer, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (ec == boost::beast::http::error::need_buffer || (!ec && this_l->stream_res.keep_alive ()))
+		{
+			this_l->chunk_written (ec);
+		}
+		else
+		{
+			this_l->source.reset ();
+			this_l->stream.async_shutdown (
+			std::bind (
+			&paper::rpc_connection_secure::on_shutdown,
+			this_l,
+			std::placeholders::_1));
+		}
+	});
+}
@@ -39,6 +39,9 @@ public:
 	rpc_connection_secure (paper::node &, paper::rpc_secure &);
 	virtual void parse_connection () override;
 	virtual void read () override;
+	virtual void write () override;
+	virtual void write_chunk () override;
+	virtual std::string log_prefix () const override;
 	/** The TLS handshake callback */
 	void handle_handshake (const boost::system::error_code & error);
 	/** The TLS async shutdown callback */
@@ -0,0 +1,358 @@
+#include <paper/node/stream.hpp>
+
+#include <paper/node/node.hpp>
+
+namespace
+{
+// Frames a record with its length, the sequence number is filled in once it's allocated
+std::shared_ptr<std::vector<uint8_t>> stream_record_data (paper::stream_topic topic_a, std::function<void(paper::stream &)> const & payload_a)
+{
+	auto result (std::make_shared<std::vector<uint8_t>> ());
+	{
+		paper::vectorstream stream (*result);
+		paper::write (stream, uint32_t (0));
+		paper::write (stream, uint64_t (0));
+		paper::write (stream, topic_a);
+		payload_a (stream);
+	}
+	uint32_t length (result->size () - sizeof (uint32_t));
+	std::copy (reinterpret_cast<uint8_t *> (&length), reinterpret_cast<uint8_t *> (&length) + sizeof (length), result->begin ());
+	return result;
+}
+
+void stream_record_sequence (std::vector<uint8_t> & data_a, uint64_t sequence_a)
+{
+	std::copy (reinterpret_cast<uint8_t *> (&sequence_a), reinterpret_cast<uint8_t *> (&sequence_a) + sizeof (sequence_a), data_a.begin () + sizeof (uint32_t));
+}
+}
+
+paper::stream_subscriber::stream_subscriber (paper::stream_server & server_a) :
+server (server_a),
+socket (server_a.node.service),
+strand (server_a.node.service),
+topics (0),
+buffer (server_a.node.config.stream_buffer),
+writing (false),
+dropped (0)
+{
+}
+
+void paper::stream_subscriber::receive ()
+{
+	auto this_l (shared_from_this ());
+	auto node_l (server.node.shared ());
+	boost::asio::async_read (socket, boost::asio::buffer (request.data (), request.size ()), strand.wrap ([this_l, node_l](boost::system::error_code const & ec, size_t size_a) {
+		if (!ec)
+		{
+			uint8_t topics_l;
+			uint64_t sequence_l;
+			paper::bufferstream stream (this_l->request.data (), this_l->request.size ());
+			auto error (paper::read (stream, topics_l));
+			error |= paper::read (stream, sequence_l);
+			assert (!error);
+			node_l->stream.subscribe (this_l, topics_l, sequence_l);
+			this_l->receive ();
+		}
+		else
+		{
+			node_l->stream.remove (this_l);
+		}
+	}));
+}
+
+bool paper::stream_subscriber::wants (paper::stream_topic topic_a) const
+{
+	return (topics & static_cast<uint8_t> (topic_a)) != 0;
+}
+
+void paper::stream_subscriber::push (paper::stream_record const & record_a)
+{
+	auto start (false);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (buffer.full ())
+		{
+			++dropped;
+		}
+		buffer.push_back (record_a.data);
+		start = !writing;
+		writing = true;
+	}
+	if (start)
+	{
+		auto this_l (shared_from_this ());
+		strand.post ([this_l]() {
+			this_l->write_next ();
+		});
+	}
+}
+
+void paper::stream_subscriber::write_next ()
+{
+	std::shared_ptr<std::vector<uint8_t>> data;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		assert (writing);
+		assert (!buffer.empty ());
+		data = buffer.front ();
+		buffer.pop_front ();
+	}
+	auto this_l (shared_from_this ());
+	auto node_l (server.node.shared ());
+	boost::asio::async_write (socket, boost::asio::buffer (data->data (), data->size ()), strand.wrap ([this_l, node_l, data](boost::system::error_code const & ec, size_t size_a) {
+		if (!ec)
+		{
+			auto next (false);
+			{
+				std::lock_guard<std::mutex> lock (this_l->mutex);
+				next = !this_l->buffer.empty ();
+				this_l->writing = next;
+			}
+			if (next)
+			{
+				this_l->write_next ();
+			}
+		}
+		else
+		{
+			node_l->stream.remove (this_l);
+		}
+	}));
+}
+
+void paper::stream_subscriber::close ()
+{
+	auto this_l (shared_from_this ());
+	strand.dispatch ([this_l]() {
+		boost::system::error_code ignored;
+		this_l->socket.close (ignored);
+	});
+}
+
+paper::stream_server::stream_server (paper::node & node_a) :
+node (node_a),
+acceptor (node_a.service),
+run_id (0),
+sequence (0),
+topics (0),
+balances_running (false),
+history (node_a.config.stream_history),
+on (false)
+{
+	paper::random_pool.GenerateBlock (reinterpret_cast<uint8_t *> (&run_id), sizeof (run_id));
+}
+
+void paper::stream_server::start ()
+{
+	// Only local clients should be served, the stream isn't authenticated
+	auto endpoint (paper::tcp_endpoint (node.config.stream_address, node.config.stream_port));
+	boost::system::error_code ec;
+	acceptor.open (endpoint.protocol (), ec);
+	if (!ec)
+	{
+		acceptor.set_option (boost::asio::ip::tcp::acceptor::reuse_address (true), ec);
+	}
+	if (!ec)
+	{
+		acceptor.bind (endpoint, ec);
+	}
+	if (!ec)
+	{
+		acceptor.listen (boost::asio::socket_base::max_connections, ec);
+	}
+	if (!ec)
+	{
+		on = true;
+		accept ();
+	}
+	else
+	{
+		BOOST_LOG (node.log) << boost::str (boost::format ("Error while starting event stream on %1%: %2%") % endpoint % ec.message ());
+		boost::system::error_code ignored;
+		acceptor.close (ignored);
+	}
+}
+
+void paper::stream_server::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	on = false;
+	boost::system::error_code ignored;
+	acceptor.close (ignored);
+	for (auto & i : subscribers)
+	{
+		i->close ();
+	}
+	subscribers.clear ();
+	topics = 0;
+	history.clear ();
+}
+
+void paper::stream_server::accept ()
+{
+	auto subscriber (std::make_shared<paper::stream_subscriber> (*this));
+	auto node_l (node.shared ());
+	acceptor.async_accept (subscriber->socket, [node_l, subscriber](boost::system::error_code const & ec) {
+		if (!ec)
+		{
+			node_l->stream.accept ();
+			subscriber->receive ();
+		}
+		else if (ec != boost::asio::error::operation_aborted)
+		{
+			BOOST_LOG (node_l->log) << boost::str (boost::format ("Error accepting event stream connections: %1%") % ec.message ());
+		}
+	});
+}
+
+void paper::stream_server::subscribe (std::shared_ptr<paper::stream_subscriber> subscriber_a, uint8_t topics_a, uint64_t sequence_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	if (on)
+	{
+		subscriber_a->topics = topics_a;
+		auto run_id_l (run_id);
+		auto data (stream_record_data (paper::stream_topic::subscribed, [run_id_l](paper::stream & stream_a) {
+			paper::write (stream_a, run_id_l);
+		}));
+		stream_record_sequence (*data, sequence);
+		subscriber_a->push (paper::stream_record{ sequence, paper::stream_topic::subscribed, data });
+		if (sequence_a != 0)
+		{
+			// Replaying while holding the lock keeps records from being skipped or repeated between the replay and live records
+			for (auto & i : history)
+			{
+				if (i.sequence > sequence_a && subscriber_a->wants (i.topic))
+				{
+					subscriber_a->push (i);
+				}
+			}
+		}
+		subscribers.insert (subscriber_a);
+		update_topics ();
+	}
+	else
+	{
+		subscriber_a->close ();
+	}
+}
+
+void paper::stream_server::remove (std::shared_ptr<paper::stream_subscriber> subscriber_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	subscriber_a->close ();
+	subscribers.erase (subscriber_a);
+	update_topics ();
+}
+
+void paper::stream_server::update_topics ()
+{
+	assert (!mutex.try_lock ());
+	uint8_t topics_l (0);
+	for (auto & i : subscribers)
+	{
+		topics_l |= i->topics;
+	}
+	topics = topics_l;
+}
+
+bool paper::stream_server::wanted (paper::stream_topic topic_a) const
+{
+	return (topics & static_cast<uint8_t> (topic_a)) != 0;
+}
+
+void paper::stream_server::publish (paper::stream_topic topic_a, std::function<void(paper::stream &)> const & payload_a)
+{
+	auto data (stream_record_data (topic_a, payload_a));
+	std::lock_guard<std::mutex> lock (mutex);
+	if (on)
+	{
+		paper::stream_record record{ ++sequence, topic_a, data };
+		stream_record_sequence (*data, record.sequence);
+		history.push_back (record);
+		for (auto & i : subscribers)
+		{
+			if (i->wants (topic_a))
+			{
+				i->push (record);
+			}
+		}
+	}
+}
+
+void paper::stream_server::confirmed_block (paper::block const & block_a)
+{
+	if (on)
+	{
+		publish (paper::stream_topic::confirmed_block, [&block_a](paper::stream & stream_a) {
+			paper::serialize_block (stream_a, block_a);
+		});
+	}
+}
+
+void paper::stream_server::vote (paper::vote & vote_a)
+{
+	if (on)
+	{
+		publish (paper::stream_topic::vote, [&vote_a](paper::stream & stream_a) {
+			vote_a.serialize (stream_a);
+		});
+	}
+}
+
+void paper::stream_server::account_balance (paper::account const & account_a, bool pending_a)
+{
+	if (on && wanted (paper::stream_topic::account_balance))
+	{
+		std::lock_guard<std::mutex> lock (balances_mutex);
+		balances.push_back (std::make_pair (account_a, pending_a));
+		if (!balances_running)
+		{
+			// One thread at a time works through the queue so an account's changes are published in order
+			balances_running = true;
+			auto node_l (node.shared ());
+			node.background ([node_l]() {
+				node_l->stream.process_balances ();
+			});
+		}
+	}
+}
+
+void paper::stream_server::process_balances ()
+{
+	std::unique_lock<std::mutex> lock (balances_mutex);
+	while (!balances.empty ())
+	{
+		std::deque<std::pair<paper::account, bool>> balances_l;
+		balances_l.swap (balances);
+		lock.unlock ();
+		std::vector<std::pair<paper::amount, paper::amount>> amounts;
+		{
+			paper::transaction transaction (node.store.environment, nullptr, false);
+			for (auto & i : balances_l)
+			{
+				amounts.push_back (std::make_pair (node.ledger.account_balance (transaction, i.first), node.ledger.account_pending (transaction, i.first)));
+			}
+		}
+		for (size_t i (0); i < balances_l.size (); ++i)
+		{
+			auto & account (balances_l[i].first);
+			auto pending (balances_l[i].second);
+			auto & amounts_l (amounts[i]);
+			publish (paper::stream_topic::account_balance, [&account, pending, &amounts_l](paper::stream & stream_a) {
+				paper::write (stream_a, account);
+				paper::write (stream_a, static_cast<uint8_t> (pending));
+				paper::write (stream_a, amounts_l.first);
+				paper::write (stream_a, amounts_l.second);
+			});
+		}
+		lock.lock ();
+	}
+	balances_running = false;
+}
+
+size_t paper::stream_server::subscriber_count ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return subscribers.size ();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <paper/common.hpp>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+
+#include <boost/asio.hpp>
+#include <boost/circular_buffer.hpp>
+
+namespace paper
+{
+class node;
+enum class stream_topic : uint8_t
+{
+	// Sent in reply to every subscription request, it can't be subscribed to
+	subscribed = 0,
+	confirmed_block = 1,
+	vote = 2,
+	account_balance = 4
+};
+/**
+ * An event as written to subscribers: a uint32 length of the rest of the record, a uint64 sequence number,
+ * the uint8 topic, then the topic's payload.
+ * subscribed: the uint64 run id, with the sequence number of the last record published. The run id is picked at random each time
+ * the node starts so a client can tell sequence numbers starting over from a gap
+ * confirmed_block: the serialized block preceded by its type
+ * vote: the serialized vote, its block preceded by the block's type
+ * account_balance: account, whether the change was a new pending entry, balance, pending
+ */
+class stream_record
+{
+public:
+	uint64_t sequence;
+	paper::stream_topic topic;
+	std::shared_ptr<std::vector<uint8_t>> data;
+};
+class stream_server;
+/**
+ * A client connected to the event stream. It subscribes by sending a uint8 mask of stream_topic values and
+ * a uint64 sequence number; retained records after that sequence number are replayed before live ones, 0 subscribes to live records only.
+ * Each request is answered with a subscribed record first. Sending another request replaces the subscription.
+ */
+class stream_subscriber : public std::enable_shared_from_this<paper::stream_subscriber>
+{
+public:
+	stream_subscriber (paper::stream_server &);
+	void receive ();
+	bool wants (paper::stream_topic) const;
+	// Called from publishing threads, only touches buffer under mutex and leaves the socket to the strand
+	void push (paper::stream_record const &);
+	void write_next ();
+	void close ();
+	paper::stream_server & server;
+	boost::asio::ip::tcp::socket socket;
+	// Every operation on socket runs here, publishing threads and io_service threads never use it at the same time
+	boost::asio::io_service::strand strand;
+	std::array<uint8_t, 9> request;
+	std::mutex mutex;
+	uint8_t topics;
+	// Records waiting to be written, a consumer falling further behind loses the oldest and sees a gap in sequence numbers
+	boost::circular_buffer<std::shared_ptr<std::vector<uint8_t>>> buffer;
+	bool writing;
+	uint64_t dropped;
+};
+/**
+ * Pushes confirmed blocks, votes and account balance changes to local subscribers as binary records.
+ * Publishing never waits on a subscriber, each has its own bounded buffer.
+ * Account balances are only looked up while someone is subscribed to them, in order on a background thread rather than
+ * on the thread that processed the block.
+ */
+class stream_server
+{
+public:
+	stream_server (paper::node &);
+	void start ();
+	void stop ();
+	void accept ();
+	void subscribe (std::shared_ptr<paper::stream_subscriber>, uint8_t, uint64_t);
+	void remove (std::shared_ptr<paper::stream_subscriber>);
+	void publish (paper::stream_topic, std::function<void(paper::stream &)> const &);
+	void confirmed_block (paper::block const &);
+	void vote (paper::vote &);
+	void account_balance (paper::account const &, bool);
+	void process_balances ();
+	// Whether any subscriber wants a topic
+	bool wanted (paper::stream_topic) const;
+	void update_topics ();
+	size_t subscriber_count ();
+	paper::node & node;
+	boost::asio::ip::tcp::acceptor acceptor;
+	std::mutex mutex;
+	uint64_t run_id;
+	uint64_t sequence;
+	// Every topic some subscriber wants
+	std::atomic<uint8_t> topics;
+	// Balance changes waiting to be looked up and published, and whether a background thread is working through them
+	std::mutex balances_mutex;
+	std::deque<std::pair<paper::account, bool>> balances;
+	bool balances_running;
+	// Most recent records, replayed to subscribers resuming after a reconnect
+	boost::circular_buffer<paper::stream_record> history;
+	std::unordered_set<std::shared_ptr<paper::stream_subscriber>> subscribers;
+	std::atomic<bool> on;
+};
+}
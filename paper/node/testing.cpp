@@ -55,9 +55,9 @@ paper::system::~system ()
 std::shared_ptr<paper::wallet> paper::system::wallet (size_t index_a)
 {
 	assert (nodes.size () > index_a);
-	auto size (nodes[index_a]->wallets.items.size ());
-	assert (size >= 1);
-	return nodes[index_a]->wallets.items.begin ()->second;
+	auto items (nodes[index_a]->wallets.items_copy ());
+	assert (items.size () >= 1);
+	return items.begin ()->second;
 }
 
 paper::account paper::system::account (MDB_txn * transaction_a, size_t index_a)
@@ -281,7 +281,7 @@ void paper::system::generate_change_unknown (paper::node & node_a, std::vector<p
 
 void paper::system::generate_send_new (paper::node & node_a, std::vector<paper::account> & accounts_a)
 {
-	assert (node_a.wallets.items.size () == 1);
+	assert (node_a.wallets.items_copy ().size () == 1);
 	paper::uint128_t amount;
 	paper::account source;
 	{
@@ -291,7 +291,7 @@ void paper::system::generate_send_new (paper::node & node_a, std::vector<paper::
 	}
 	if (!amount.is_zero ())
 	{
-		auto pub (node_a.wallets.items.begin ()->second->deterministic_insert ());
+		auto pub (node_a.wallets.items_copy ().begin ()->second->deterministic_insert ());
 		accounts_a.push_back (pub);
 		auto hash (wallet (0)->send_sync (source, pub, amount));
 		assert (!hash.is_zero ());
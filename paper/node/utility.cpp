@@ -129,15 +129,20 @@ paper::mdb_val::operator MDB_val const & () const
 	return value;
 }
 
-paper::transaction::transaction (paper::mdb_env & environment_a, MDB_txn * parent_a, bool write) :
-environment (environment_a)
+paper::transaction::transaction (paper::mdb_env & environment_a, MDB_txn * parent_a, bool write_a) :
+environment (environment_a),
+write (write_a)
 {
-	auto status (mdb_txn_begin (environment_a, parent_a, write ? 0 : MDB_RDONLY, &handle));
+	auto status (mdb_txn_begin (environment_a, parent_a, write_a ? 0 : MDB_RDONLY, &handle));
 	assert (status == 0);
 }
 
 paper::transaction::~transaction ()
 {
+	if (write && environment.before_commit)
+	{
+		environment.before_commit (handle);
+	}
 	auto status (mdb_txn_commit (handle));
 	assert (status == 0);
 }
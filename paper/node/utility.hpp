@@ -3,6 +3,7 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <type_traits>
 
 #include <boost/filesystem.hpp>
@@ -108,6 +109,8 @@ public:
 	~mdb_env ();
 	operator MDB_env * () const;
 	MDB_env * environment;
+	// Called with each write transaction just before it commits
+	std::function<void(MDB_txn *)> before_commit;
 };
 
 /**
@@ -141,5 +144,6 @@ public:
 	operator MDB_txn * () const;
 	MDB_txn * handle;
 	paper::mdb_env & environment;
+	bool write;
 };
 }
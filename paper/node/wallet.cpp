@@ -389,6 +389,14 @@ void paper::wallet_store::initialize (MDB_txn * transaction_a, bool & init_a, st
 	auto error (0);
 	error |= mdb_dbi_open (transaction_a, path_a.c_str (), MDB_CREATE, &handle);
 	init_a = error != 0;
+	if (!init_a)
+	{
+		std::lock_guard<std::mutex> lock (accounts_mutex);
+		for (auto i (begin (transaction_a)), n (end ()); i != n; ++i)
+		{
+			accounts_mem.insert (i->first.uint256 ());
+		}
+	}
 }
 
 bool paper::wallet_store::is_representative (MDB_txn * transaction_a)
@@ -424,6 +432,8 @@ void paper::wallet_store::erase (MDB_txn * transaction_a, paper::public_key cons
 {
 	auto status (mdb_del (transaction_a, handle, paper::mdb_val (pub), nullptr));
 	assert (status == 0);
+	std::lock_guard<std::mutex> lock (accounts_mutex);
+	accounts_mem.erase (pub);
 }
 
 paper::wallet_value paper::wallet_store::entry_get_raw (MDB_txn * transaction_a, paper::public_key const & pub_a)
@@ -447,6 +457,11 @@ void paper::wallet_store::entry_put_raw (MDB_txn * transaction_a, paper::public_
 {
 	auto status (mdb_put (transaction_a, handle, paper::mdb_val (pub_a), entry_a.val (), 0));
 	assert (status == 0);
+	if (!(pub_a < paper::uint256_union (special_count)))
+	{
+		std::lock_guard<std::mutex> lock (accounts_mutex);
+		accounts_mem.insert (pub_a);
+	}
 }
 
 paper::key_type paper::wallet_store::key_type (paper::wallet_value const & value_a)
@@ -531,6 +546,12 @@ bool paper::wallet_store::exists (MDB_txn * transaction_a, paper::public_key con
 	return find (transaction_a, pub) != end ();
 }
 
+bool paper::wallet_store::exists_mem (paper::public_key const & pub_a)
+{
+	std::lock_guard<std::mutex> lock (accounts_mutex);
+	return accounts_mem.find (pub_a) != accounts_mem.end ();
+}
+
 void paper::wallet_store::serialize_json (MDB_txn * transaction_a, std::string & string_a)
 {
 	boost::property_tree::ptree tree;
@@ -830,6 +851,8 @@ void paper::wallet_store::destroy (MDB_txn * transaction_a)
 {
 	auto status (mdb_drop (transaction_a, handle, 1));
 	assert (status == 0);
+	std::lock_guard<std::mutex> lock (accounts_mutex);
+	accounts_mem.clear ();
 }
 
 std::shared_ptr<paper::block> paper::wallet::receive_action (paper::send_block const & send_a, paper::account const & representative_a, paper::uint128_union const & amount_a, bool generate_work_a)
@@ -881,7 +904,7 @@ std::shared_ptr<paper::block> paper::wallet::receive_action (paper::send_block c
 			auto hash (block->hash ());
 			auto this_l (shared_from_this ());
 			auto source (send_a.hashables.destination);
-			node.wallets.queue_wallet_action (paper::wallets::generate_priority, [this_l, source, hash] {
+			node.wallets.queue_wallet_action (paper::wallets::generate_priority, source, [this_l, source, hash] {
 				this_l->work_generate (source, hash);
 			});
 		}
@@ -918,7 +941,7 @@ std::shared_ptr<paper::block> paper::wallet::change_action (paper::account const
 		{
 			auto hash (block->hash ());
 			auto this_l (shared_from_this ());
-			node.wallets.queue_wallet_action (paper::wallets::generate_priority, [this_l, source_a, hash] {
+			node.wallets.queue_wallet_action (paper::wallets::generate_priority, source_a, [this_l, source_a, hash] {
 				this_l->work_generate (source_a, hash);
 			});
 		}
@@ -936,27 +959,30 @@ std::shared_ptr<paper::block> paper::wallet::send_action (paper::account const &
 	}
 	bool error = false;
 	bool cached_block = false;
-	{
-		paper::transaction transaction (store.environment, nullptr, (bool)id_mdb_val);
-		if (id_mdb_val)
+	auto previous_send = [this, &id_mdb_val, &block, &cached_block, &error](MDB_txn * transaction_a) {
+		paper::mdb_val result;
+		auto status (mdb_get (transaction_a, node.wallets.send_action_ids, *id_mdb_val, result));
+		if (status == 0)
 		{
-			paper::mdb_val result;
-			auto status (mdb_get (transaction, node.wallets.send_action_ids, *id_mdb_val, result));
-			if (status == 0)
-			{
-				auto hash (result.uint256 ());
-				block = node.store.block_get (transaction, hash);
-				if (block != nullptr)
-				{
-					cached_block = true;
-					node.network.republish_block (transaction, block);
-				}
-			}
-			else if (status != MDB_NOTFOUND)
+			auto existing (node.store.block_get (transaction_a, result.uint256 ()));
+			if (existing != nullptr)
 			{
-				error = true;
+				block = std::move (existing);
+				cached_block = true;
+				node.network.republish_block (transaction_a, block);
 			}
 		}
+		else if (status != MDB_NOTFOUND)
+		{
+			error = true;
+		}
+	};
+	{
+		paper::transaction transaction (store.environment, nullptr, false);
+		if (id_mdb_val)
+		{
+			previous_send (transaction);
+		}
 		if (!error && block == nullptr)
 		{
 			if (store.valid_password (transaction))
@@ -974,27 +1000,36 @@ std::shared_ptr<paper::block> paper::wallet::send_action (paper::account const &
 						auto error2 (store.fetch (transaction, source_a, prv));
 						assert (!error2);
 						block.reset (new paper::send_block (info.head, account_a, balance - amount_a, prv, source_a, generate_work_a ? work_fetch (transaction, source_a, info.head) : 0));
-						if (id_mdb_val)
-						{
-							auto status (mdb_put (transaction, node.wallets.send_action_ids, *id_mdb_val, paper::mdb_val (block->hash ()), 0));
-							if (status != 0)
-							{
-								block = nullptr;
-								error = true;
-							}
-						}
 					}
 				}
 			}
 		}
 	}
+	if (!error && block != nullptr && !cached_block && id_mdb_val)
+	{
+		// Work was generated without holding the write transaction, a send with the same id may have been recorded meanwhile
+		paper::transaction transaction (store.environment, nullptr, true);
+		previous_send (transaction);
+		if (!error && !cached_block)
+		{
+			auto status (mdb_put (transaction, node.wallets.send_action_ids, *id_mdb_val, paper::mdb_val (block->hash ()), 0));
+			if (status != 0)
+			{
+				error = true;
+			}
+		}
+		if (error)
+		{
+			block = nullptr;
+		}
+	}
 	if (!error && block != nullptr && !cached_block)
 	{
 		node.block_arrival.add (block->hash ());
 		node.block_processor.process_receive_many (block);
 		auto hash (block->hash ());
 		auto this_l (shared_from_this ());
-		node.wallets.queue_wallet_action (paper::wallets::generate_priority, [this_l, source_a, hash] {
+		node.wallets.queue_wallet_action (paper::wallets::generate_priority, source_a, [this_l, source_a, hash] {
 			this_l->work_generate (source_a, hash);
 		});
 	}
@@ -1013,7 +1048,7 @@ bool paper::wallet::change_sync (paper::account const & source_a, paper::account
 
 void paper::wallet::change_async (paper::account const & source_a, paper::account const & representative_a, std::function<void(std::shared_ptr<paper::block>)> const & action_a, bool generate_work_a)
 {
-	node.wallets.queue_wallet_action (paper::wallets::high_priority, [this, source_a, representative_a, action_a, generate_work_a]() {
+	node.wallets.queue_wallet_action (paper::wallets::high_priority, source_a, [this, source_a, representative_a, action_a, generate_work_a]() {
 		auto block (change_action (source_a, representative_a, generate_work_a));
 		action_a (block);
 	});
@@ -1032,7 +1067,7 @@ bool paper::wallet::receive_sync (std::shared_ptr<paper::block> block_a, paper::
 void paper::wallet::receive_async (std::shared_ptr<paper::block> block_a, paper::account const & representative_a, paper::uint128_t const & amount_a, std::function<void(std::shared_ptr<paper::block>)> const & action_a, bool generate_work_a)
 {
 	assert (dynamic_cast<paper::send_block *> (block_a.get ()) != nullptr);
-	node.wallets.queue_wallet_action (amount_a, [this, block_a, representative_a, amount_a, action_a, generate_work_a]() {
+	node.wallets.queue_wallet_action (amount_a, static_cast<paper::send_block *> (block_a.get ())->hashables.destination, [this, block_a, representative_a, amount_a, action_a, generate_work_a]() {
 		auto block (receive_action (*static_cast<paper::send_block *> (block_a.get ()), representative_a, amount_a, generate_work_a));
 		action_a (block);
 	});
@@ -1051,7 +1086,7 @@ paper::block_hash paper::wallet::send_sync (paper::account const & source_a, pap
 void paper::wallet::send_async (paper::account const & source_a, paper::account const & account_a, paper::uint128_t const & amount_a, std::function<void(std::shared_ptr<paper::block>)> const & action_a, bool generate_work_a, boost::optional<std::string> id_a)
 {
 	node.background ([this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
-		this->node.wallets.queue_wallet_action (paper::wallets::high_priority, [this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
+		this->node.wallets.queue_wallet_action (paper::wallets::high_priority, source_a, [this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
 			auto block (send_action (source_a, account_a, amount_a, generate_work_a, id_a));
 			action_a (block);
 		});
@@ -1081,13 +1116,19 @@ uint64_t paper::wallet::work_fetch (MDB_txn * transaction_a, paper::account cons
 	auto error (store.work_get (transaction_a, account_a, result));
 	if (error)
 	{
+		++node.wallets.work_waited;
 		result = node.generate_work (root_a);
 	}
 	else if (paper::work_validate (root_a, result))
 	{
 		BOOST_LOG (node.log) << "Cached work invalid, regenerating";
+		++node.wallets.work_waited;
 		result = node.generate_work (root_a);
 	}
+	else
+	{
+		++node.wallets.work_cached;
+	}
 
 	return result;
 }
@@ -1108,6 +1149,27 @@ void paper::wallet::work_ensure (MDB_txn * transaction_a, paper::account const &
 	}
 }
 
+// Generate work for the account's current head unless the cached work already matches it
+void paper::wallet::work_precompute (paper::account const & account_a)
+{
+	auto generate (false);
+	paper::block_hash root;
+	{
+		paper::transaction transaction (store.environment, nullptr, false);
+		uint64_t work (0);
+		auto missing (store.work_get (transaction, account_a, work));
+		if (store.exists (transaction, account_a))
+		{
+			root = node.ledger.latest_root (transaction, account_a);
+			generate = missing || paper::work_validate (root, work);
+		}
+	}
+	if (generate)
+	{
+		work_generate (account_a, root);
+	}
+}
+
 namespace
 {
 class search_action : public std::enable_shared_from_this<search_action>
@@ -1274,10 +1336,21 @@ void paper::wallet::work_generate (paper::account const & account_a, paper::bloc
 
 paper::wallets::wallets (bool & error_a, paper::node & node_a) :
 observer ([](bool) {}),
+observed (false),
+queued (0),
+running (0),
+completed (0),
+wait_total (0),
+wait_max (0),
+work_cached (0),
+work_waited (0),
 node (node_a),
-stopped (false),
-thread ([this]() { do_wallet_actions (); })
+stopped (false)
 {
+	for (auto i (0u); i < node_a.config.wallet_threads; ++i)
+	{
+		threads.push_back (std::thread ([this]() { do_wallet_actions (); }));
+	}
 	if (!error_a)
 	{
 		paper::transaction transaction (node.store.environment, nullptr, true);
@@ -1312,11 +1385,15 @@ thread ([this]() { do_wallet_actions (); })
 paper::wallets::~wallets ()
 {
 	stop ();
-	thread.join ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
 }
 
 std::shared_ptr<paper::wallet> paper::wallets::open (paper::uint256_union const & id_a)
 {
+	std::lock_guard<std::mutex> lock (items_mutex);
 	std::shared_ptr<paper::wallet> result;
 	auto existing (items.find (id_a));
 	if (existing != items.end ())
@@ -1328,7 +1405,6 @@ std::shared_ptr<paper::wallet> paper::wallets::open (paper::uint256_union const
 
 std::shared_ptr<paper::wallet> paper::wallets::create (paper::uint256_union const & id_a)
 {
-	assert (items.find (id_a) == items.end ());
 	std::shared_ptr<paper::wallet> result;
 	bool error;
 	{
@@ -1337,7 +1413,11 @@ std::shared_ptr<paper::wallet> paper::wallets::create (paper::uint256_union cons
 	}
 	if (!error)
 	{
-		items[id_a] = result;
+		{
+			std::lock_guard<std::mutex> lock (items_mutex);
+			assert (items.find (id_a) == items.end ());
+			items[id_a] = result;
+		}
 		node.background ([result]() {
 			result->enter_initial_password ();
 		});
@@ -1347,12 +1427,10 @@ std::shared_ptr<paper::wallet> paper::wallets::create (paper::uint256_union cons
 
 bool paper::wallets::search_pending (paper::uint256_union const & wallet_a)
 {
-	auto result (false);
-	auto existing (items.find (wallet_a));
-	result = existing == items.end ();
+	auto wallet (open (wallet_a));
+	auto result (wallet == nullptr);
 	if (!result)
 	{
-		auto wallet (existing->second);
 		result = wallet->search_pending ();
 	}
 	return result;
@@ -1360,19 +1438,29 @@ bool paper::wallets::search_pending (paper::uint256_union const & wallet_a)
 
 void paper::wallets::search_pending_all ()
 {
-	for (auto i : items)
+	for (auto & i : items_copy ())
 	{
 		i.second->search_pending ();
 	}
 }
 
+std::vector<std::pair<paper::uint256_union, std::shared_ptr<paper::wallet>>> paper::wallets::items_copy ()
+{
+	std::lock_guard<std::mutex> lock (items_mutex);
+	return std::vector<std::pair<paper::uint256_union, std::shared_ptr<paper::wallet>>> (items.begin (), items.end ());
+}
+
 void paper::wallets::destroy (paper::uint256_union const & id_a)
 {
 	paper::transaction transaction (node.store.environment, nullptr, true);
-	auto existing (items.find (id_a));
-	assert (existing != items.end ());
-	auto wallet (existing->second);
-	items.erase (existing);
+	std::shared_ptr<paper::wallet> wallet;
+	{
+		std::lock_guard<std::mutex> lock (items_mutex);
+		auto existing (items.find (id_a));
+		assert (existing != items.end ());
+		wallet = existing->second;
+		items.erase (existing);
+	}
 	wallet->store.destroy (transaction);
 }
 
@@ -1381,16 +1469,49 @@ void paper::wallets::do_wallet_actions ()
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!stopped)
 	{
-		if (!actions.empty ())
+		if (!ready.empty ())
 		{
-			auto first (actions.begin ());
-			auto current (std::move (first->second));
-			actions.erase (first);
+			auto first (ready.begin ());
+			auto account (first->second);
+			ready.erase (first);
+			auto & entry (actions[account]);
+			entry.ready = ready.end ();
+			assert (!entry.running);
+			assert (!entry.queue.empty ());
+			entry.running = true;
+			auto current (std::move (entry.queue.begin ()->second));
+			entry.queue.erase (entry.queue.begin ());
+			--queued;
+			auto wait (std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - current.queued));
+			wait_total += wait;
+			wait_max = std::max (wait_max, wait);
+			auto started (running++ == 0);
 			lock.unlock ();
-			observer (true);
-			current ();
-			observer (false);
+			if (started)
+			{
+				notify_observer ();
+			}
+			current.action ();
 			lock.lock ();
+			++completed;
+			auto idle (--running == 0);
+			auto & finished (actions[account]);
+			finished.running = false;
+			if (!finished.queue.empty ())
+			{
+				finished.ready = ready.insert (std::make_pair (finished.queue.begin ()->first, account));
+				condition.notify_one ();
+			}
+			else
+			{
+				actions.erase (account);
+			}
+			if (idle)
+			{
+				lock.unlock ();
+				notify_observer ();
+				lock.lock ();
+			}
 		}
 		else
 		{
@@ -1399,16 +1520,93 @@ void paper::wallets::do_wallet_actions ()
 	}
 }
 
-void paper::wallets::queue_wallet_action (paper::uint128_t const & amount_a, std::function<void()> const & action_a)
+void paper::wallets::notify_observer ()
+{
+	std::lock_guard<std::mutex> observer_lock (observer_mutex);
+	bool active;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		active = running != 0;
+	}
+	if (active != observed)
+	{
+		observed = active;
+		observer (active);
+	}
+}
+
+void paper::wallets::queue_wallet_action (paper::uint128_t const & amount_a, paper::account const & account_a, std::function<void()> const & action_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
-	actions.insert (std::make_pair (amount_a, std::move (action_a)));
-	condition.notify_all ();
+	auto existing (actions.find (account_a));
+	if (existing == actions.end ())
+	{
+		existing = actions.insert (std::make_pair (account_a, paper::wallet_account_actions ())).first;
+		existing->second.running = false;
+		existing->second.ready = ready.end ();
+	}
+	auto & entry (existing->second);
+	entry.queue.insert (std::make_pair (amount_a, paper::wallet_action{ action_a, std::chrono::steady_clock::now () }));
+	++queued;
+	if (!entry.running)
+	{
+		// Keep the account's place in the ready set at the priority of its first action
+		if (entry.ready != ready.end ())
+		{
+			ready.erase (entry.ready);
+		}
+		entry.ready = ready.insert (std::make_pair (entry.queue.begin ()->first, account_a));
+		condition.notify_one ();
+	}
+}
+
+size_t paper::wallets::actions_size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return queued;
+}
+
+void paper::wallets::work_precompute (paper::account const & account_a)
+{
+	// Called for every processed block, only in-memory lookups happen on the caller's thread
+	std::shared_ptr<paper::wallet> wallet;
+	{
+		std::lock_guard<std::mutex> lock (items_mutex);
+		for (auto i (items.begin ()), n (items.end ()); wallet == nullptr && i != n; ++i)
+		{
+			if (i->second->store.exists_mem (account_a))
+			{
+				wallet = i->second;
+			}
+		}
+	}
+	if (wallet != nullptr)
+	{
+		auto queue (false);
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			queue = precomputing.insert (account_a).second;
+		}
+		if (queue)
+		{
+			node.background ([this, wallet, account_a]() {
+				queue_wallet_action (paper::wallets::precompute_priority, account_a, [this, wallet, account_a]() {
+					{
+						// Another head change from here on queues a new precomputation
+						std::lock_guard<std::mutex> lock (mutex);
+						precomputing.erase (account_a);
+					}
+					wallet->work_precompute (account_a);
+				});
+			});
+		}
+	}
 }
 
 void paper::wallets::foreach_representative (MDB_txn * transaction_a, std::function<void(paper::public_key const & pub_a, paper::raw_key const & prv_a)> const & action_a)
 {
-	for (auto i (items.begin ()), n (items.end ()); i != n; ++i)
+	auto items_l (items_copy ());
+	for (auto i (items_l.begin ()), n (items_l.end ()); i != n; ++i)
 	{
 		auto & wallet (*i->second);
 		for (auto j (wallet.store.begin (transaction_a)), m (wallet.store.end ()); j != m; ++j)
@@ -1439,6 +1637,7 @@ void paper::wallets::foreach_representative (MDB_txn * transaction_a, std::funct
 
 bool paper::wallets::exists (MDB_txn * transaction_a, paper::public_key const & account_a)
 {
+	std::lock_guard<std::mutex> lock (items_mutex);
 	auto result (false);
 	for (auto i (items.begin ()), n (items.end ()); !result && i != n; ++i)
 	{
@@ -1456,6 +1655,7 @@ void paper::wallets::stop ()
 
 paper::uint128_t const paper::wallets::generate_priority = std::numeric_limits<paper::uint128_t>::max ();
 paper::uint128_t const paper::wallets::high_priority = std::numeric_limits<paper::uint128_t>::max () - 1;
+paper::uint128_t const paper::wallets::precompute_priority = 0;
 
 paper::store_iterator paper::wallet_store::begin (MDB_txn * transaction_a)
 {
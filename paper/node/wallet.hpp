@@ -5,6 +5,7 @@
 #include <paper/node/common.hpp>
 #include <paper/node/openclwork.hpp>
 
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -79,6 +80,8 @@ public:
 	void entry_put_raw (MDB_txn *, paper::public_key const &, paper::wallet_value const &);
 	bool fetch (MDB_txn *, paper::public_key const &, paper::raw_key &);
 	bool exists (MDB_txn *, paper::public_key const &);
+	// Whether the account is in the wallet without opening a transaction, entries written by a transaction still open are included
+	bool exists_mem (paper::public_key const &);
 	void destroy (MDB_txn *);
 	paper::store_iterator find (MDB_txn *, paper::uint256_union const &);
 	paper::store_iterator begin (MDB_txn *, paper::uint256_union const &);
@@ -116,6 +119,9 @@ public:
 	paper::mdb_env & environment;
 	MDB_dbi handle;
 	std::recursive_mutex mutex;
+	// Accounts in the wallet, kept in step by entry_put_raw, erase and destroy
+	std::unordered_set<paper::account> accounts_mem;
+	std::mutex accounts_mutex;
 };
 class node;
 // A wallet is a set of account keys encrypted by a common encryption key
@@ -147,6 +153,7 @@ public:
 	void work_update (MDB_txn *, paper::account const &, paper::block_hash const &, uint64_t);
 	uint64_t work_fetch (MDB_txn *, paper::account const &, paper::block_hash const &);
 	void work_ensure (MDB_txn *, paper::account const &);
+	void work_precompute (paper::account const &);
 	bool search_pending ();
 	void init_free_accounts (MDB_txn *);
 	/** Changes the wallet seed and returns the first account */
@@ -156,6 +163,21 @@ public:
 	paper::wallet_store store;
 	paper::node & node;
 };
+class wallet_action
+{
+public:
+	std::function<void()> action;
+	std::chrono::steady_clock::time_point queued;
+};
+// Actions waiting for one account, run one at a time highest priority first
+class wallet_account_actions
+{
+public:
+	std::multimap<paper::uint128_t, paper::wallet_action, std::greater<paper::uint128_t>> queue;
+	bool running;
+	// Entry in wallets::ready while the account is idle with actions queued
+	std::multimap<paper::uint128_t, paper::account, std::greater<paper::uint128_t>>::iterator ready;
+};
 // The wallets set is all the wallets a node controls.  A node may contain multiple wallets independently encrypted and operated.
 class wallets
 {
@@ -168,13 +190,40 @@ public:
 	void search_pending_all ();
 	void destroy (paper::uint256_union const &);
 	void do_wallet_actions ();
-	void queue_wallet_action (paper::uint128_t const &, std::function<void()> const &);
+	void queue_wallet_action (paper::uint128_t const &, paper::account const &, std::function<void()> const &);
+	size_t actions_size ();
+	void work_precompute (paper::account const &);
 	void foreach_representative (MDB_txn *, std::function<void(paper::public_key const &, paper::raw_key const &)> const &);
+	// Wallets in items at the time of the call, safe to walk while others are created or destroyed
+	std::vector<std::pair<paper::uint256_union, std::shared_ptr<paper::wallet>>> items_copy ();
 	bool exists (MDB_txn *, paper::public_key const &);
 	void stop ();
+	// Tells observer whether any action is running, called without mutex held
+	void notify_observer ();
 	std::function<void(bool)> observer;
+	// Serializes observer calls, the last one reflects the current state
+	std::mutex observer_mutex;
+	// Value last passed to observer
+	bool observed;
+	// Read through open or items_copy, which take items_mutex
 	std::unordered_map<paper::uint256_union, std::shared_ptr<paper::wallet>> items;
-	std::multimap<paper::uint128_t, std::function<void()>, std::greater<paper::uint128_t>> actions;
+	// Guards inserting and erasing items against lookups from the block observer and RPC threads
+	std::mutex items_mutex;
+	// Actions for different accounts run in parallel, actions for the same account never overlap
+	std::unordered_map<paper::account, paper::wallet_account_actions> actions;
+	// Idle accounts with queued actions by the priority of their first action
+	std::multimap<paper::uint128_t, paper::account, std::greater<paper::uint128_t>> ready;
+	size_t queued;
+	size_t running;
+	uint64_t completed;
+	// Time completed actions spent queued
+	std::chrono::microseconds wait_total;
+	std::chrono::microseconds wait_max;
+	// Accounts with a work precomputation queued and not yet started
+	std::unordered_set<paper::account> precomputing;
+	// Blocks created by wallets with work cached ahead of time or generated while they waited
+	std::atomic<uint64_t> work_cached;
+	std::atomic<uint64_t> work_waited;
 	std::mutex mutex;
 	std::condition_variable condition;
 	paper::kdf kdf;
@@ -182,8 +231,9 @@ public:
 	MDB_dbi send_action_ids;
 	paper::node & node;
 	bool stopped;
-	std::thread thread;
+	std::vector<std::thread> threads;
 	static paper::uint128_t const generate_priority;
 	static paper::uint128_t const high_priority;
+	static paper::uint128_t const precompute_priority;
 };
 }
@@ -128,7 +128,10 @@ int main (int argc, char * const * argv)
 		("debug_profile_kdf", "Profile kdf function")
 		("debug_verify_profile", "Profile signature verification")
 		("debug_profile_sign", "Profile signature generation")
+		("debug_profile_votes", "Profile vote processing against thread count")
+		("debug_profile_block_view", "Profile reading blocks in place against deserializing them")
 		("debug_xorshift_profile", "Profile xorshift algorithms")
+		("debug_validate_ledger", "Check every account chain, signature, work, weight and pending entry in the ledger")
 		("platform", boost::program_options::value<std::string> (), "Defines the <platform> for OpenCL commands")
 		("device", boost::program_options::value<std::string> (), "Defines <device> for OpenCL command")
 		("threads", boost::program_options::value<std::string> (), "Defines <threads> count for OpenCL command");
@@ -241,6 +244,29 @@ int main (int argc, char * const * argv)
 		paper::transaction transaction (node.node->store.environment, nullptr, false);
 		std::cout << boost::str (boost::format ("Frontier count: %1%\n") % node.node->store.frontier_count (transaction));
 	}
+	else if (vm.count ("debug_validate_ledger"))
+	{
+		paper::inactive_node node (data_path);
+		auto threads (std::max (1u, std::thread::hardware_concurrency ()));
+		std::cout << boost::str (boost::format ("Validating ledger with %1% threads\n") % threads);
+		paper::ledger_validator validator (node.node->ledger);
+		auto error (validator.validate (threads));
+		for (auto & i : validator.errors)
+		{
+			std::cout << i << std::endl;
+		}
+		auto ms (std::chrono::duration_cast<std::chrono::milliseconds> (validator.elapsed).count ());
+		std::cout << boost::str (boost::format ("%1% accounts %2% blocks %3% pending entries checked in %4%ms, %5% blocks per second\n") % validator.accounts % validator.blocks % validator.pending % ms % (ms ? validator.blocks * 1000 / ms : 0));
+		if (error)
+		{
+			std::cout << boost::str (boost::format ("%1% errors found\n") % validator.error_count);
+			result = -1;
+		}
+		else
+		{
+			std::cout << "Ledger is consistent\n";
+		}
+	}
 	else if (vm.count ("debug_mass_activity"))
 	{
 		paper::system system (24000, 1);
@@ -262,9 +288,32 @@ int main (int argc, char * const * argv)
 	}
 	else if (vm.count ("debug_profile_generate"))
 	{
+		paper::uint256_union root;
+		paper::random_pool.GenerateBlock (root.bytes.data (), root.bytes.size ());
+		for (auto & kernel : paper::work_kernels ())
+		{
+			std::array<uint64_t, paper::work_kernel::max_lanes> nonces;
+			std::array<uint64_t, paper::work_kernel::max_lanes> values;
+			nonces.fill (0);
+			uint64_t count (0);
+			auto begin1 (std::chrono::high_resolution_clock::now ());
+			auto end1 (begin1);
+			while (end1 - begin1 < std::chrono::seconds (1))
+			{
+				for (auto i (0); i < 1024; ++i)
+				{
+					kernel.values (root, nonces.data (), values.data ());
+					nonces[0] += values[0];
+				}
+				count += 1024 * kernel.lanes;
+				end1 = std::chrono::high_resolution_clock::now ();
+			}
+			auto us (std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count ());
+			std::cerr << boost::str (boost::format ("%1% kernel, %2% lanes: %3% nonces per second per thread\n") % kernel.name % kernel.lanes % (count * 1000000 / us));
+		}
 		paper::work_pool work (std::numeric_limits<unsigned>::max (), nullptr);
 		paper::change_block block (0, 0, paper::keypair ().prv, 0, 0);
-		std::cerr << "Starting generation profiling\n";
+		std::cerr << boost::str (boost::format ("Starting generation profiling using the %1% kernel\n") % work.kernel.name);
 		for (uint64_t i (0); true; ++i)
 		{
 			block.hashables.previous.qwords[0] += 1;
@@ -369,7 +418,8 @@ int main (int argc, char * const * argv)
 	{
 		paper::work_pool work (std::numeric_limits<unsigned>::max (), nullptr);
 		paper::change_block block (0, 0, paper::keypair ().prv, 0, 0);
-		std::cerr << "Starting verification profiling\n";
+		std::cerr << boost::str (boost::format ("Starting verification profiling, batches use the %1% kernel\n") % paper::work_kernels ().back ().name);
+		std::vector<std::pair<paper::block_hash, uint64_t>> batch;
 		for (uint64_t i (0); true; ++i)
 		{
 			block.hashables.previous.qwords[0] += 1;
@@ -381,22 +431,63 @@ int main (int argc, char * const * argv)
 				paper::work_validate (block);
 			}
 			auto end1 (std::chrono::high_resolution_clock::now ());
-			std::cerr << boost::str (boost::format ("%|1$ 12d|\n") % std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count ());
+			auto begin2 (std::chrono::high_resolution_clock::now ());
+			for (uint64_t t (0); t < 1000000; ++t)
+			{
+				block.hashables.previous.qwords[0] += 1;
+				batch.push_back (std::make_pair (block.root (), t));
+				if (batch.size () == 1024)
+				{
+					paper::work_validate (batch);
+					batch.clear ();
+				}
+			}
+			auto end2 (std::chrono::high_resolution_clock::now ());
+			std::cerr << boost::str (boost::format ("%|1$ 12d| per-block %|2$ 12d| batched\n") % std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count () % std::chrono::duration_cast<std::chrono::microseconds> (end2 - begin2).count ());
 		}
 	}
 	else if (vm.count ("debug_verify_profile"))
 	{
-		paper::keypair key;
-		paper::uint256_union message;
-		paper::uint512_union signature;
-		signature = paper::sign_message (key.prv, key.pub, message);
-		auto begin (std::chrono::high_resolution_clock::now ());
-		for (auto i (0u); i < 1000; ++i)
+		size_t const count (4096);
+		std::vector<paper::keypair> keys (16);
+		std::vector<paper::uint256_union> messages (count);
+		std::vector<paper::uint512_union> signatures (count);
+		std::vector<unsigned char const *> message_pointers (count);
+		std::vector<size_t> message_lengths (count, sizeof (paper::uint256_union));
+		std::vector<unsigned char const *> pub_keys (count);
+		std::vector<unsigned char const *> signature_pointers (count);
+		std::vector<int> verifications (count);
+		for (size_t i (0); i < count; ++i)
 		{
-			paper::validate_message (key.pub, message, signature);
+			auto & key (keys[i % keys.size ()]);
+			paper::random_pool.GenerateBlock (messages[i].bytes.data (), messages[i].bytes.size ());
+			signatures[i] = paper::sign_message (key.prv, key.pub, messages[i]);
+			message_pointers[i] = messages[i].bytes.data ();
+			pub_keys[i] = key.pub.bytes.data ();
+			signature_pointers[i] = signatures[i].bytes.data ();
 		}
-		auto end (std::chrono::high_resolution_clock::now ());
-		std::cerr << "Signature verifications " << std::chrono::duration_cast<std::chrono::microseconds> (end - begin).count () << std::endl;
+		auto profile ([count](std::string const & name_a, std::function<void()> const & action_a) {
+			auto begin (std::chrono::high_resolution_clock::now ());
+			action_a ();
+			auto end (std::chrono::high_resolution_clock::now ());
+			auto us (std::chrono::duration_cast<std::chrono::microseconds> (end - begin).count ());
+			std::cerr << boost::str (boost::format ("%1% signature verifications %2%us %3% per second\n") % name_a % us % (us ? count * 1000000 / us : 0));
+		});
+		profile ("Per-block", [&]() {
+			for (size_t i (0); i < count; ++i)
+			{
+				paper::validate_message (keys[i % keys.size ()].pub, messages[i], signatures[i]);
+			}
+		});
+		profile ("Batched", [&]() {
+			paper::validate_message_batch (message_pointers.data (), message_lengths.data (), pub_keys.data (), signature_pointers.data (), count, verifications.data ());
+		});
+		auto threads (std::max (1u, std::thread::hardware_concurrency ()) - 1);
+		paper::signature_checker checker (threads);
+		paper::signature_check_set check = { count, message_pointers.data (), message_lengths.data (), pub_keys.data (), signature_pointers.data (), verifications.data () };
+		profile (boost::str (boost::format ("Batched with %1% extra threads") % threads), [&]() {
+			checker.verify (check);
+		});
 	}
 	else if (vm.count ("debug_profile_sign"))
 	{
@@ -415,6 +506,108 @@ int main (int argc, char * const * argv)
 			std::cerr << boost::str (boost::format ("%|1$ 12d|\n") % std::chrono::duration_cast<std::chrono::microseconds> (end1 - begin1).count ());
 		}
 	}
+	else if (vm.count ("debug_profile_votes"))
+	{
+		paper::system system (24000, 1);
+		auto & node (*system.nodes[0]);
+		size_t const elections (1024);
+		size_t const count (16 * 1024);
+		std::vector<std::shared_ptr<paper::block>> blocks;
+		auto previous (node.latest (paper::test_genesis_key.pub));
+		{
+			paper::transaction transaction (node.store.environment, nullptr, true);
+			for (size_t i (0); i < elections; ++i)
+			{
+				auto send (std::make_shared<paper::send_block> (previous, paper::test_genesis_key.pub, paper::genesis_amount - i - 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0));
+				node.ledger.process (transaction, *send);
+				node.active.start (transaction, send);
+				blocks.push_back (send);
+				previous = send->hash ();
+			}
+		}
+		std::cerr << boost::str (boost::format ("Started %1% elections\n") % node.active.size ());
+		auto threads_max (std::max (1u, std::thread::hardware_concurrency ()) * 2);
+		for (auto threads (1u); threads <= threads_max; threads *= 2)
+		{
+			// Fresh representatives each round so no vote is a replay of an earlier one
+			std::vector<std::shared_ptr<paper::vote>> votes;
+			for (size_t i (0); i < count; ++i)
+			{
+				paper::keypair key;
+				votes.push_back (std::make_shared<paper::vote> (key.pub, key.prv, 1, blocks[i % blocks.size ()]));
+			}
+			std::atomic<size_t> next (0);
+			std::vector<std::thread> workers;
+			auto begin (std::chrono::high_resolution_clock::now ());
+			for (auto i (0u); i < threads; ++i)
+			{
+				workers.push_back (std::thread ([&node, &votes, &next]() {
+					for (auto j (next++); j < votes.size (); j = next++)
+					{
+						node.active.vote (votes[j]);
+					}
+				}));
+			}
+			for (auto & i : workers)
+			{
+				i.join ();
+			}
+			auto end (std::chrono::high_resolution_clock::now ());
+			auto us (std::chrono::duration_cast<std::chrono::microseconds> (end - begin).count ());
+			std::cerr << boost::str (boost::format ("%|1$ 3d| threads %2% votes %3%us %4% per second\n") % threads % count % us % (us ? count * 1000000 / us : 0));
+		}
+	}
+	else if (vm.count ("debug_profile_block_view"))
+	{
+		paper::system system (24000, 1);
+		auto & node (*system.nodes[0]);
+		// Longer than the block cache so block_get deserializes every block
+		size_t const count (node.config.block_cache_max * 2);
+		auto open (node.latest (paper::genesis_account));
+		auto head (open);
+		// Only reads are profiled so blocks are stored without ledger validation, in batches small enough for one write transaction
+		for (size_t i (0); i < count;)
+		{
+			paper::transaction transaction (node.store.environment, nullptr, true);
+			for (size_t j (0); j < 4096 && i < count; ++j, ++i)
+			{
+				paper::send_block send (head, paper::test_genesis_key.pub, paper::genesis_amount - i - 1, paper::test_genesis_key.prv, paper::test_genesis_key.pub, 0);
+				node.store.block_put (transaction, send.hash (), send);
+				head = send.hash ();
+			}
+		}
+		std::cerr << boost::str (boost::format ("Walking a chain of %1% blocks\n") % count);
+		auto profile ([count](std::string const & name_a, std::function<void()> const & action_a) {
+			auto begin (std::chrono::high_resolution_clock::now ());
+			action_a ();
+			auto end (std::chrono::high_resolution_clock::now ());
+			auto us (std::chrono::duration_cast<std::chrono::microseconds> (end - begin).count ());
+			std::cerr << boost::str (boost::format ("%1% %2%us %3% blocks per second\n") % name_a % us % (us ? count * 1000000 / us : 0));
+		});
+		paper::transaction transaction (node.store.environment, nullptr, false);
+		for (auto round (0); round < 4; ++round)
+		{
+			paper::uint128_t total1 (0);
+			profile ("block_get     ", [&]() {
+				for (auto current (head); current != open;)
+				{
+					auto block (node.store.block_get (transaction, current));
+					total1 += static_cast<paper::send_block const &> (*block).hashables.balance.number ();
+					current = block->previous ();
+				}
+			});
+			paper::uint128_t total2 (0);
+			profile ("block_get_view", [&]() {
+				for (auto current (head); current != open;)
+				{
+					auto block (node.store.block_get_view (transaction, current));
+					total2 += block.balance ().number ();
+					current = block.previous ();
+				}
+			});
+			assert (total1 == total2);
+		}
+	}
 	else if (vm.count ("version"))
 	{
 		std::cout << "Version " << PAPER_VERSION_MAJOR << "." << PAPER_VERSION_MINOR << std::endl;
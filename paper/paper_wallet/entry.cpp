@@ -224,11 +224,11 @@ int run_wallet (QApplication & application, int argc, char * const * argv, boost
 			auto wallet (node->wallets.open (config.wallet));
 			if (wallet == nullptr)
 			{
-				auto existing (node->wallets.items.begin ());
-				if (existing != node->wallets.items.end ())
+				auto items (node->wallets.items_copy ());
+				if (!items.empty ())
 				{
-					wallet = existing->second;
-					config.wallet = existing->first;
+					wallet = items.begin ()->second;
+					config.wallet = items.begin ()->first;
 				}
 				else
 				{
@@ -809,7 +809,7 @@ std::string paper_qt::status::color ()
 }
 
 paper_qt::wallet::wallet (QApplication & application_a, paper_qt::eventloop_processor & processor_a, paper::node & node_a, std::shared_ptr<paper::wallet> wallet_a, paper::account & account_a) :
-rendering_ratio (paper::Mxrb_ratio),
+rendering_ratio (paper::Mppr_ratio),
 node (node_a),
 wallet_m (wallet_a),
 account (account_a),
@@ -1243,11 +1243,11 @@ std::string paper_qt::wallet::format_balance (paper::uint128_t const & balance)
 {
 	auto balance_str = paper::amount (balance).format_balance (rendering_ratio, 0, false);
 	auto unit = std::string ("XRB");
-	if (rendering_ratio == paper::kxrb_ratio)
+	if (rendering_ratio == paper::kppr_ratio)
 	{
 		unit = std::string ("kxrb");
 	}
-	else if (rendering_ratio == paper::xrb_ratio)
+	else if (rendering_ratio == paper::ppr_ratio)
 	{
 		unit = std::string ("xrb");
 	}
@@ -1604,19 +1604,19 @@ wallet (wallet_a)
 	QObject::connect (mpaper, &QRadioButton::toggled, [this]() {
 		if (mpaper->isChecked ())
 		{
-			this->wallet.change_rendering_ratio (paper::Mxrb_ratio);
+			this->wallet.change_rendering_ratio (paper::Mppr_ratio);
 		}
 	});
 	QObject::connect (kpaper, &QRadioButton::toggled, [this]() {
 		if (kpaper->isChecked ())
 		{
-			this->wallet.change_rendering_ratio (paper::kxrb_ratio);
+			this->wallet.change_rendering_ratio (paper::kppr_ratio);
 		}
 	});
 	QObject::connect (paper, &QRadioButton::toggled, [this]() {
 		if (paper->isChecked ())
 		{
-			this->wallet.change_rendering_ratio (paper::xrb_ratio);
+			this->wallet.change_rendering_ratio (paper::ppr_ratio);
 		}
 	});
 	mpaper->click ();
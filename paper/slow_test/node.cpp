@@ -204,13 +204,13 @@ TEST (node, fork_storm)
 		empty = 0;
 		single = 0;
 		std::for_each (system.nodes.begin (), system.nodes.end (), [&](std::shared_ptr<paper::node> const & node_a) {
-			if (node_a->active.roots.empty ())
+			if (node_a->active.empty ())
 			{
 				++empty;
 			}
 			else
 			{
-				if (node_a->active.roots.begin ()->election->votes.rep_votes.size () == 1)
+				if (node_a->active.elections ().front ()->votes.rep_votes.size () == 1)
 				{
 					++single;
 				}